@@ -130,7 +130,8 @@ namespace i2p
 			LogPrint(eLogDebug, "FS: data directory: ", datadir);
 
 			bool precomputation; i2p::config::GetOption("precomputation.elgamal", precomputation);
-			i2p::crypto::InitCrypto (precomputation);
+			uint16_t numElGamalPairs; i2p::config::GetOption("precomputation.elgamalpairs", numElGamalPairs);
+			i2p::crypto::InitCrypto (precomputation, numElGamalPairs);
 
 			int netID; i2p::config::GetOption("netid", netID);
 			i2p::context.SetNetID (netID);
@@ -292,13 +292,29 @@ namespace http {
         s << "<b>Routers:</b> " << i2p::data::netdb.GetNumRouters () << " ";
 		s << "<b>Floodfills:</b> " << i2p::data::netdb.GetNumFloodfills () << " ";
 		s << "<b>LeaseSets:</b> " << i2p::data::netdb.GetNumLeaseSets () << "<br>\r\n";
+		auto loadStats = i2p::data::netdb.GetLoadStats ();
+		s << "<b>NetDb load:</b> " << loadStats.numRouters << " routers in " << loadStats.duration << " ms (" << loadStats.GetRate () << " RIs/s)";
+		auto reseedStats = i2p::data::netdb.GetReseedStats ();
+		if (reseedStats.numRouters)
+			s << " <b>Reseed:</b> " << reseedStats.numRouters << " routers in " << reseedStats.duration << " ms (" << reseedStats.GetRate () << " RIs/s)";
+		s << "<br>\r\n";
 
 		size_t clientTunnelCount = i2p::tunnel::tunnels.CountOutboundTunnels();
 		clientTunnelCount += i2p::tunnel::tunnels.CountInboundTunnels();
 		size_t transitTunnelCount = i2p::tunnel::tunnels.CountTransitTunnels();
 
 		s << "<b>Client Tunnels:</b> " << std::to_string(clientTunnelCount) << " ";
-		s << "<b>Transit Tunnels:</b> " << std::to_string(transitTunnelCount) << "<br>\r\n<br>\r\n";
+		s << "<b>Transit Tunnels:</b> " << std::to_string(transitTunnelCount) << "<br>\r\n";
+
+		s << "<b>I2NP buffers reused:</b>";
+		static const char * sizeClassNames[i2p::eNumI2NPMessageSizeClasses] = { "tunnel", "short", "full" };
+		for (int i = 0; i < i2p::eNumI2NPMessageSizeClasses; i++)
+		{
+			auto stats = i2p::GetI2NPMessagesPoolStats ((i2p::I2NPMessageSizeClass)i);
+			s << " " << sizeClassNames[i] << " " << (stats.numAcquired ? stats.numHits*100/stats.numAcquired : 0) << "%";
+			s << " (" << stats.numHits << "/" << stats.numAcquired << ")";
+		}
+		s << "<br>\r\n<br>\r\n";
 
         if(outputFormat==OutputFormatEnum::forWebConsole) {
             s << "<table><caption>Services</caption><tr><th>Service</th><th>State</th></tr>\r\n";
@@ -353,6 +369,8 @@ namespace http {
 			s << "</p>\r\n</div>\r\n";
 		} else
 			s << "<b>LeaseSets:</b> <i>0</i><br>\r\n";
+		if (dest->IsLocalDelivery ())
+			s << "<b>Delivered locally:</b> <i>" << dest->GetNumLocallyDelivered () << "</i> messages<br>\r\n";
 		auto pool = dest->GetTunnelPool ();
 		if (pool)
 		{
@@ -479,6 +497,8 @@ namespace http {
 	{
 		s << "<b>Tunnels:</b><br>\r\n<br>\r\n";
 		s << "<b>Queue size:</b> " << i2p::tunnel::tunnels.GetQueueSize () << "<br>\r\n";
+		s << "<b>Build requests queue size:</b> " << i2p::tunnel::tunnels.GetBuildRequestsQueueSize ()
+		  << " (" << i2p::tunnel::tunnels.GetNumDroppedBuildRequests () << " dropped)<br>\r\n";
 
 		auto ExplPool = i2p::tunnel::tunnels.GetExploratoryPool ();
 
@@ -586,6 +606,15 @@ namespace http {
 		}
 	}
 
+	static void ShowSSUCongestion (std::stringstream& s, const i2p::transport::SSUCongestionControl& cc)
+	{
+		s << " [cwnd:" << cc.GetWindowSize () << " inflight:" << cc.GetNumInFlight ();
+		if (cc.GetRTT ()) s << " rtt:" << cc.GetRTT () << "ms";
+		s << " rto:" << cc.GetRTO () << "ms";
+		if (cc.GetNumRetransmits ()) s << " resent:" << cc.GetNumRetransmits () << " lost:" << cc.GetNumLost ();
+		s << "]";
+	}
+
 	void ShowTransports (std::stringstream& s)
 	{
 		s << "<b>Transports:</b><br>\r\n<br>\r\n";
@@ -617,6 +646,7 @@ namespace http {
 					s << endpoint.address ().to_string () << ":" << endpoint.port ();
 					if (!it.second->IsOutgoing ()) s << " &#8658; ";
 					s << " [" << it.second->GetNumSentBytes () << ":" << it.second->GetNumReceivedBytes () << "]";
+					ShowSSUCongestion (s, it.second->GetCongestionControl ());
 					if (it.second->GetRelayTag ())
 						s << " [itag:" << it.second->GetRelayTag () << "]";
 					s << "<br>\r\n" << std::endl;
@@ -634,6 +664,7 @@ namespace http {
 					s << "[" << endpoint.address ().to_string () << "]:" << endpoint.port ();
 					if (!it.second->IsOutgoing ()) s << " &#8658; ";
 					s << " [" << it.second->GetNumSentBytes () << ":" << it.second->GetNumReceivedBytes () << "]";
+					ShowSSUCongestion (s, it.second->GetCongestionControl ());
 					if (it.second->GetRelayTag ())
 						s << " [itag:" << it.second->GetRelayTag () << "]";
 					s << "<br>\r\n" << std::endl;
@@ -691,6 +722,16 @@ namespace http {
 		}
 	}
 
+	static void ShowBufferUsage (std::stringstream& s, std::shared_ptr<const i2p::client::I2PServiceBufferUsage> usage)
+	{
+		if (!usage || !usage->maxSize) return;
+		s << " (buffers: " << usage->numBuffers << ", ";
+		ShowTraffic (s, usage->size);
+		s << ", max ";
+		ShowTraffic (s, usage->maxSize);
+		s << ")";
+	}
+
 	void ShowI2PTunnels (std::stringstream& s)
 	{
 		s << "<b>Client Tunnels:</b><br>\r\n<br>\r\n";
@@ -700,6 +741,7 @@ namespace http {
 			s << "<a href=\"/?page=" << HTTP_PAGE_LOCAL_DESTINATION << "&b32=" << ident.ToBase32 () << "\">";
 			s << it.second->GetName () << "</a> &#8656; ";
 			s << i2p::client::context.GetAddressBook ().ToAddress(ident);
+			ShowBufferUsage (s, it.second->GetBufferUsage ());
 			s << "<br>\r\n"<< std::endl;
 		}
 		auto httpProxy = i2p::client::context.GetHttpProxy ();
@@ -709,7 +751,28 @@ namespace http {
 			s << "<a href=\"/?page=" << HTTP_PAGE_LOCAL_DESTINATION << "&b32=" << ident.ToBase32 () << "\">";
 			s << "HTTP Proxy" << "</a> &#8656; ";
 			s << i2p::client::context.GetAddressBook ().ToAddress(ident);
+			ShowBufferUsage (s, httpProxy->GetBufferUsage ());
 			s << "<br>\r\n"<< std::endl;
+			if (httpProxy->IsKeepAlive ())
+			{
+				auto numCreated = httpProxy->GetNumStreamsCreated (), numReused = httpProxy->GetNumStreamsReused ();
+				s << "&nbsp;&nbsp;Keep-alive requests: " << httpProxy->GetNumRequests ()
+				  << " (" << httpProxy->GetNumClientConnectionsReused () << " on reused connections), streams: "
+				  << numCreated << " new, " << numReused << " reused";
+				if (numCreated + numReused > 0)
+					s << " (" << (int)(numReused*100/(numCreated + numReused)) << "%)";
+				s << ", " << httpProxy->GetNumIdleStreams () << " idle<br>\r\n" << std::endl;
+			}
+			auto cache = httpProxy->GetCache ();
+			if (cache)
+			{
+				s << "&nbsp;&nbsp;Cache: " << cache->GetNumEntries () << " responses, ";
+				ShowTraffic (s, cache->GetSize ());
+				s << " of ";
+				ShowTraffic (s, cache->GetMaxSize ());
+				s << ", hits: " << cache->GetNumHits () << ", misses: " << cache->GetNumMisses ()
+				  << ", revalidated: " << cache->GetNumRevalidated () << "<br>\r\n" << std::endl;
+			}
 		}
 		auto socksProxy = i2p::client::context.GetSocksProxy ();
 		if (socksProxy)
@@ -718,6 +781,7 @@ namespace http {
 			s << "<a href=\"/?page=" << HTTP_PAGE_LOCAL_DESTINATION << "&b32=" << ident.ToBase32 () << "\">";
 			s << "SOCKS Proxy" << "</a> &#8656; ";
 			s << i2p::client::context.GetAddressBook ().ToAddress(ident);
+			ShowBufferUsage (s, socksProxy->GetBufferUsage ());
 			s << "<br>\r\n"<< std::endl;
 		}
 		auto& serverTunnels = i2p::client::context.GetServerTunnels ();
@@ -730,7 +794,16 @@ namespace http {
 				s << it.second->GetName () << "</a> &#8658; ";
 				s << i2p::client::context.GetAddressBook ().ToAddress(ident);
 				s << ":" << it.second->GetLocalPort ();
+				ShowBufferUsage (s, it.second->GetBufferUsage ());
 				s << "</a><br>\r\n"<< std::endl;
+				auto& backends = it.second->GetBackends ();
+				if (backends.size () > 1)
+					for (auto& backend: backends)
+					{
+						s << "&nbsp;&nbsp;&#8658; " << backend->address << ":" << backend->port << " "
+							<< (backend->isUp ? "up" : "down") << ", connections: " << backend->numConnections
+							<< ", failures: " << backend->numFailures << "<br>\r\n" << std::endl;
+					}
 			}
 		}
 		auto& clientForwards = i2p::client::context.GetClientForwards ();
@@ -759,6 +832,9 @@ namespace http {
 				s << "<br>\r\n"<< std::endl;
 			}
 		}
+		s << "<br>\r\n<b>Free connection buffers:</b> ";
+		ShowTraffic (s, i2p::client::I2PTunnelBufferPool::GetPool ()->GetPooledSize ());
+		s << "<br>\r\n";
 	}
 
 	HTTPConnection::HTTPConnection (std::string hostname, std::shared_ptr<boost::asio::ip::tcp::socket> socket):
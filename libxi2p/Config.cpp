@@ -74,6 +74,13 @@ namespace config {
 			("limits.ntcpsoft", value<uint16_t>()->default_value(0),          "Threshold to start probabalistic backoff with ntcp sessions (default: use system limit)")
 			("limits.ntcphard", value<uint16_t>()->default_value(0),          "Maximum number of ntcp sessions (default: use system limit)")
 			("limits.ntcpthreads", value<uint16_t>()->default_value(1),       "Maximum number of threads used by NTCP DH worker (default: 1)")
+			("limits.ntcpiothreads", value<uint16_t>()->default_value(0),     "Number of threads running NTCP and NTCP2 sessions, 0 - transport's thread (default: 0)")
+			("limits.tunnelthreads", value<uint16_t>()->default_value(0),     "Number of threads handling tunnel data, 0 - tunnels thread (default: 0)")
+			("limits.destinationthreads", value<uint16_t>()->default_value(0), "Number of threads shared by local destinations, 0 - thread per destination (default: 0)")
+			("limits.netdbthreads", value<uint16_t>()->default_value(0),      "Number of threads parsing and verifying RouterInfos at netDb load and reseed, 0 - number of CPU cores (default: 0)")
+			("limits.buildthreads", value<uint16_t>()->default_value(1),      "Number of threads decrypting tunnel build requests, 0 - tunnels thread (default: 1)")
+			("limits.ssubatch", value<uint16_t>()->default_value(32),         "Max number of SSU datagrams per recvmmsg/sendmmsg, 0 - one per syscall, Linux only (default: 32)")
+			("limits.ssugso", value<bool>()->default_value(false),            "Send SSU datagrams to the same peer with UDP GSO, Linux only (default: disabled)")
 		;
 
 		options_description httpserver("HTTP Server options");
@@ -101,8 +108,12 @@ namespace config {
 			("httpproxy.outbound.quantity", value<std::string>()->default_value("5"), "HTTP proxy outbound tunnels quantity")
 			("httpproxy.latency.min", value<std::string>()->default_value("0"),       "HTTP proxy min latency for tunnels")
 			("httpproxy.latency.max", value<std::string>()->default_value("0"),       "HTTP proxy max latency for tunnels")
+			("httpproxy.i2p.localDelivery", value<std::string>()->default_value("false"), "HTTP proxy sends to destinations on this router directly")
 			("httpproxy.outproxy", value<std::string>()->default_value(""),           "HTTP proxy upstream out proxy url")
 			("httpproxy.addresshelper", value<bool>()->default_value(true),           "Enable or disable addresshelper")
+			("httpproxy.keepalive", value<bool>()->default_value(false),              "Keep client connections and reuse streams to I2P sites")
+			("httpproxy.cache", value<bool>()->default_value(false),                  "Cache responses of I2P sites in memory, requires httpproxy.keepalive")
+			("httpproxy.cachesize", value<uint32_t>()->default_value(32),             "HTTP proxy cache size in megabytes")
 		;
 
 		options_description socksproxy("SOCKS Proxy options");
@@ -118,6 +129,7 @@ namespace config {
 			("socksproxy.outbound.quantity", value<std::string>()->default_value("5"), "SOCKS proxy outbound tunnels quantity")
 			("socksproxy.latency.min", value<std::string>()->default_value("0"),       "SOCKS proxy min latency for tunnels")
 			("socksproxy.latency.max", value<std::string>()->default_value("0"),       "SOCKS proxy max latency for tunnels")
+			("socksproxy.i2p.localDelivery", value<std::string>()->default_value("false"), "SOCKS proxy sends to destinations on this router directly")
 			("socksproxy.outproxy.enabled", value<bool>()->default_value(false),       "Enable or disable SOCKS outproxy")
 			("socksproxy.outproxy", value<std::string>()->default_value("127.0.0.1"),  "Upstream outproxy address for SOCKS Proxy")
 			("socksproxy.outproxyport", value<uint16_t>()->default_value(9050),        "Upstream outproxy port for SOCKS Proxy")
@@ -173,6 +185,7 @@ namespace config {
 				value<bool>()->default_value(true),
 #endif
 				"Enable or disable elgamal precomputation table")
+			("precomputation.elgamalpairs", value<uint16_t>()->default_value(16), "Number of pre-generated ElGamal encryption exponents, 0 - disabled (default: 16)")
 		;
 
 		options_description reseed("Reseed options");
@@ -0,0 +1,102 @@
+#ifndef CONGESTION_H__
+#define CONGESTION_H__
+
+#include <inttypes.h>
+#include <math.h>
+#include <algorithm>
+
+namespace i2p
+{
+namespace util
+{
+	// Shared by SSU and streaming congestion controls. All times are in milliseconds
+	const int RTO_CLOCK_GRANULARITY = 10; // G of RFC 6298
+
+	// smoothed RTT and RTO by RFC 6298, extra time is added to RTO (e.g. remote's ACK delay)
+	class RTOEstimator
+	{
+		public:
+
+			RTOEstimator (double rtt, int rto, int minRTO, int maxRTO, int extra = 0):
+				m_RTT (rtt), m_RTTVar (0), m_RTO (rto), m_MinRTO (minRTO), m_MaxRTO (maxRTO),
+				m_Extra (extra), m_IsMeasured (false) {};
+
+			void SetRTT (double rtt, double rttVar, bool isMeasured) // known from elsewhere, samples are smoothed into it
+			{
+				m_RTT = rtt;
+				m_RTTVar = rttVar;
+				m_IsMeasured = isMeasured;
+				UpdateRTO ();
+			}
+
+			void AddSample (int rtt) // from packet which was not resent
+			{
+				if (rtt <= 0) rtt = 1;
+				if (!m_IsMeasured)
+				{
+					m_RTT = rtt;
+					m_RTTVar = m_RTT/2;
+					m_IsMeasured = true;
+				}
+				else
+				{
+					m_RTTVar = 0.75*m_RTTVar + 0.25*fabs (m_RTT - rtt);
+					m_RTT = std::max (0.875*m_RTT + 0.125*rtt, 1.0);
+				}
+				UpdateRTO ();
+			}
+
+			void BackOff () { m_RTO = std::min (m_RTO*2, m_MaxRTO); }; // until new sample
+			void SetRTO (int rto) { m_RTO = rto; };
+
+			double GetRTT () const { return m_RTT; };
+			double GetRTTVar () const { return m_RTTVar; };
+			int GetRTO () const { return m_RTO; };
+			bool IsMeasured () const { return m_IsMeasured; };
+
+		private:
+
+			void UpdateRTO ()
+			{
+				m_RTO = m_RTT + std::max ((double)RTO_CLOCK_GRANULARITY, 4*m_RTTVar) + m_Extra;
+				if (m_RTO < m_MinRTO) m_RTO = m_MinRTO;
+				if (m_RTO > m_MaxRTO) m_RTO = m_MaxRTO;
+			}
+
+		private:
+
+			double m_RTT, m_RTTVar;
+			int m_RTO, m_MinRTO, m_MaxRTO, m_Extra;
+			bool m_IsMeasured;
+	};
+
+	// spreads packets of window over RTT, credit accumulates while idle up to burst
+	class Pacer
+	{
+		public:
+
+			Pacer (int maxBurst): m_MaxBurst (maxBurst), m_LastTime (0), m_Credit (0) {};
+
+			void OnPacketSent () { m_Credit -= 1; };
+			int GetDelay (uint64_t ts, double rate) // rate in packets per millisecond, returns 0 if can send now
+			{
+				if (ts > m_LastTime)
+				{
+					// don't accumulate more than fits into two timer ticks
+					m_Credit = std::min (m_Credit + (ts - m_LastTime)*rate, std::max ((double)m_MaxBurst, 2*rate));
+					m_LastTime = ts;
+				}
+				if (m_Credit >= 1) return 0;
+				return std::max ((int)ceil ((1 - m_Credit)/rate), 1);
+			}
+
+		private:
+
+			int m_MaxBurst;
+			uint64_t m_LastTime;
+			double m_Credit; // in packets
+	};
+}
+}
+
+#endif
@@ -1,7 +1,11 @@
 #include <string.h>
 #include <string>
 #include <vector>
+#include <queue>
+#include <thread>
+#include <atomic>
 #include <mutex>
+#include <condition_variable>
 #include <memory>
 #include <openssl/dh.h>
 #include <openssl/md5.h>
@@ -229,6 +233,41 @@ namespace crypto
 
 	static BIGNUM * (* g_ElggTable)[255] = nullptr;
 
+	struct ElGamalPrecomputedPair
+	{
+		uint8_t k[256], a[256]; // a = g^k mod p
+
+		void Clear () { OPENSSL_cleanse (k, 256); } // k is secret, wipe it once not needed
+	};
+
+	class ElGamalPairsSupplier // pre-generates (k, g^k) for ElGamalEncrypt
+	{
+		public:
+
+			ElGamalPairsSupplier (int size);
+			~ElGamalPairsSupplier ();
+			void Start ();
+			void Stop ();
+			bool Acquire (ElGamalPrecomputedPair& pair); // false if nothing is ready, every pair is used once
+
+		private:
+
+			void Run ();
+			void CreatePairs (int num);
+
+		private:
+
+			const int m_QueueSize;
+			std::queue<ElGamalPrecomputedPair> m_Queue;
+
+			std::atomic<bool> m_IsRunning;
+			std::thread * m_Thread;
+			std::condition_variable m_Acquired;
+			std::mutex m_AcquiredMutex;
+	};
+
+	static ElGamalPairsSupplier * g_ElGamalPairsSupplier = nullptr;
+
 // DH
 
 	DHKeys::DHKeys ()
@@ -279,21 +318,18 @@ namespace crypto
 	}
 
 // ElGamal
-	void ElGamalEncrypt (const uint8_t * key, const uint8_t * data, uint8_t * encrypted, BN_CTX * ctx, bool zeroPadding)
+	static void GenerateElGamalK (BIGNUM * k)
 	{
-		BN_CTX_start (ctx);
-		// everything, but a, because a might come from table
-		BIGNUM * k = BN_CTX_get (ctx);
-		BIGNUM * y = BN_CTX_get (ctx);
-		BIGNUM * b1 = BN_CTX_get (ctx);
-		BIGNUM * b = BN_CTX_get (ctx);
 		// select random k
 #if defined(__x86_64__)
 		BN_rand (k, ELGAMAL_FULL_EXPONENT_NUM_BITS, -1, 1); // full exponent for x64
 #else
 		BN_rand (k, ELGAMAL_SHORT_EXPONENT_NUM_BITS, -1, 1); // short exponent of 226 bits
 #endif
-		// calculate a
+	}
+
+	static BIGNUM * CalculateElGamalA (const BIGNUM * k, BN_CTX * ctx) // g^k mod p
+	{
 		BIGNUM * a;
 		if (g_ElggTable)
 			a = ElggPow (k, g_ElggTable, ctx);
@@ -302,6 +338,117 @@ namespace crypto
 			a = BN_new ();
 			BN_mod_exp (a, elgg, k, elgp, ctx);
 		}
+		return a;
+	}
+
+	ElGamalPairsSupplier::ElGamalPairsSupplier (int size):
+		m_QueueSize (size), m_IsRunning (false), m_Thread (nullptr)
+	{
+	}
+
+	ElGamalPairsSupplier::~ElGamalPairsSupplier ()
+	{
+		Stop ();
+	}
+
+	void ElGamalPairsSupplier::Start ()
+	{
+		m_IsRunning = true;
+		m_Thread = new std::thread (std::bind (&ElGamalPairsSupplier::Run, this));
+	}
+
+	void ElGamalPairsSupplier::Stop ()
+	{
+		{
+			std::unique_lock<std::mutex> l(m_AcquiredMutex);
+			m_IsRunning = false;
+			m_Acquired.notify_one ();
+		}
+		if (m_Thread)
+		{
+			m_Thread->join ();
+			delete m_Thread;
+			m_Thread = 0;
+		}
+		std::unique_lock<std::mutex> l(m_AcquiredMutex);
+		while (!m_Queue.empty ())
+		{
+			m_Queue.front ().Clear ();
+			m_Queue.pop ();
+		}
+	}
+
+	void ElGamalPairsSupplier::Run ()
+	{
+		while (m_IsRunning)
+		{
+			int num;
+			{
+				std::unique_lock<std::mutex> l(m_AcquiredMutex);
+				// wait for element gets acquired, Stop might notify before we wait
+				m_Acquired.wait (l, [this]{ return !m_IsRunning || (int)m_Queue.size () < m_QueueSize; });
+				if (!m_IsRunning) break;
+				num = m_QueueSize - (int)m_Queue.size ();
+			}
+			CreatePairs (num);
+		}
+	}
+
+	void ElGamalPairsSupplier::CreatePairs (int num)
+	{
+		BN_CTX * ctx = BN_CTX_new ();
+		BIGNUM * k = BN_new ();
+		for (int i = 0; i < num && m_IsRunning; i++)
+		{
+			ElGamalPrecomputedPair pair;
+			GenerateElGamalK (k);
+			BIGNUM * a = CalculateElGamalA (k, ctx);
+			bn2buf (k, pair.k, 256);
+			bn2buf (a, pair.a, 256);
+			BN_free (a);
+			{
+				std::unique_lock<std::mutex> l(m_AcquiredMutex);
+				m_Queue.push (pair);
+			}
+			pair.Clear ();
+		}
+		BN_clear_free (k);
+		BN_CTX_free (ctx);
+	}
+
+	bool ElGamalPairsSupplier::Acquire (ElGamalPrecomputedPair& pair)
+	{
+		std::unique_lock<std::mutex> l(m_AcquiredMutex);
+		if (m_Queue.empty ()) return false;
+		pair = m_Queue.front ();
+		m_Queue.front ().Clear ();
+		m_Queue.pop ();
+		m_Acquired.notify_one ();
+		return true;
+	}
+
+	void ElGamalEncrypt (const uint8_t * key, const uint8_t * data, uint8_t * encrypted, BN_CTX * ctx, bool zeroPadding)
+	{
+		BN_CTX_start (ctx);
+		// everything, but a, because a might come from table
+		BIGNUM * k = BN_CTX_get (ctx);
+		BIGNUM * y = BN_CTX_get (ctx);
+		BIGNUM * b1 = BN_CTX_get (ctx);
+		BIGNUM * b = BN_CTX_get (ctx);
+		// select random k and calculate a, or take them from pool
+		BIGNUM * a;
+		ElGamalPrecomputedPair pair;
+		if (g_ElGamalPairsSupplier && g_ElGamalPairsSupplier->Acquire (pair))
+		{
+			BN_bin2bn (pair.k, 256, k);
+			a = BN_bin2bn (pair.a, 256, NULL);
+			pair.Clear ();
+		}
+		else
+		{
+			GenerateElGamalK (k);
+			a = CalculateElGamalA (k, ctx);
+		}
 
 		// restore y from key
 		BN_bin2bn (key, 256, y);
@@ -329,6 +476,7 @@ namespace crypto
 			bn2buf (b, encrypted + 256, 256);
 		}
 		BN_free (a);
+		BN_clear (k);
 		BN_CTX_end (ctx);
 	}
 
@@ -1104,7 +1252,7 @@ namespace crypto
 	}*/
 
 
-	void InitCrypto (bool precomputation)
+	void InitCrypto (bool precomputation, int numElGamalPairs)
 	{
 		i2p::cpu::Detect ();
 		SSL_library_init ();
@@ -1122,10 +1270,20 @@ namespace crypto
 			PrecalculateElggTable (g_ElggTable, ELGAMAL_SHORT_EXPONENT_NUM_BYTES);
 #endif
 		}
+		if (numElGamalPairs > 0)
+		{
+			g_ElGamalPairsSupplier = new ElGamalPairsSupplier (numElGamalPairs);
+			g_ElGamalPairsSupplier->Start ();
+		}
 	}
 
 	void TerminateCrypto ()
 	{
+		if (g_ElGamalPairsSupplier)
+		{
+			g_ElGamalPairsSupplier->Stop ();
+			delete g_ElGamalPairsSupplier; g_ElGamalPairsSupplier = nullptr;
+		}
 		if (g_ElggTable)
 		{
 			DestroyElggTable (g_ElggTable,
@@ -341,6 +341,15 @@ namespace datagram
 	void DatagramSession::FlushSendQueue ()
 	{
 
+		auto localDestination = m_LocalDestination->FindLocalDestination (m_RemoteIdent);
+		if (localDestination)
+		{
+			if (!m_SendQueue.empty ())
+				m_LocalDestination->DeliverLocally (localDestination, m_SendQueue);
+			m_SendQueue.clear ();
+			ScheduleFlushSendQueue ();
+			return;
+		}
 		std::vector<i2p::tunnel::TunnelMessageBlock> send;
 		auto routingPath = GetSharedRoutingPath();
 		// if we don't have a routing path we will drop all queued messages
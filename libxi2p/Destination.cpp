@@ -1,6 +1,7 @@
 #include <algorithm>
 #include <cassert>
 #include <string>
+#include <future>
 #include "Crypto.h"
 #include "Log.h"
 #include "FS.h"
@@ -13,10 +14,19 @@ namespace i2p
 {
 namespace client
 {
+	i2p::util::IOServicePool destinationServices ("Destinations");
+
+	// destinations accepting messages from destinations on this router directly
+	static std::mutex localDeliveryDestinationsMutex;
+	static std::map<i2p::data::IdentHash, std::weak_ptr<LeaseSetDestination> > localDeliveryDestinations;
+
 	LeaseSetDestination::LeaseSetDestination (bool isPublic, const std::map<std::string, std::string> * params):
-		m_IsRunning (false), m_Thread (nullptr), m_IsPublic (isPublic),
+		m_IsRunning (false), m_Thread (nullptr),
+		m_OwnService (destinationServices.IsRunning () ? nullptr : new boost::asio::io_service ()),
+		m_Service (m_OwnService ? *m_OwnService : destinationServices.GetNextService ()), m_IsPublic (isPublic),
 		m_PublishReplyToken (0), m_LastSubmissionTime (0), m_PublishConfirmationTimer (m_Service),
-		m_PublishVerificationTimer (m_Service), m_PublishDelayTimer (m_Service), m_CleanupTimer (m_Service)
+		m_PublishVerificationTimer (m_Service), m_PublishDelayTimer (m_Service), m_CleanupTimer (m_Service),
+		m_IsLocalDelivery (false), m_NumLocallyDelivered (0)
 	{
 		int inLen   = DEFAULT_INBOUND_TUNNEL_LENGTH;
 		int inQty   = DEFAULT_INBOUND_TUNNELS_QUANTITY;
@@ -43,6 +53,9 @@ namespace client
 				it = params->find (I2CP_PARAM_TAGS_TO_SEND);
 				if (it != params->end ())
 					numTags = std::stoi(it->second);
+				it = params->find (I2CP_PARAM_LOCAL_DELIVERY);
+				if (it != params->end ())
+					m_IsLocalDelivery = (it->second == "true");
 				LogPrint (eLogInfo, "Destination: parameters for tunnel set to: ", inQty, " inbound (", inLen, " hops), ", outQty, " outbound (", outLen, " hops), ", numTags, " tags");
 				it = params->find (I2CP_PARAM_EXPLICIT_PEERS);
 				if (it != params->end ())
@@ -132,7 +145,13 @@ namespace client
 			m_CleanupTimer.expires_from_now (boost::posix_time::minutes (DESTINATION_CLEANUP_TIMEOUT));
 			m_CleanupTimer.async_wait (std::bind (&LeaseSetDestination::HandleCleanupTimer,
 				shared_from_this (), std::placeholders::_1));
-			m_Thread = new std::thread (std::bind (&LeaseSetDestination::Run, shared_from_this ()));
+			if (m_IsLocalDelivery)
+			{
+				std::unique_lock<std::mutex> l(localDeliveryDestinationsMutex);
+				localDeliveryDestinations[GetIdentHash ()] = shared_from_this ();
+			}
+			if (m_OwnService)
+				m_Thread = new std::thread (std::bind (&LeaseSetDestination::Run, shared_from_this ()));
 
 			return true;
 		}
@@ -144,6 +163,17 @@ namespace client
 	{
 		if (m_IsRunning)
 		{
+			if (IsStopInServiceThread ()) return StopInServiceThread ();
+			if (m_IsLocalDelivery)
+			{
+				std::unique_lock<std::mutex> l(localDeliveryDestinationsMutex);
+				auto it = localDeliveryDestinations.find (GetIdentHash ());
+				if (it != localDeliveryDestinations.end ())
+				{
+					auto dest = it->second.lock ();
+					if (!dest || dest.get () == this) localDeliveryDestinations.erase (it);
+				}
+			}
 			m_CleanupTimer.cancel ();
 			m_PublishConfirmationTimer.cancel ();
 			m_PublishVerificationTimer.cancel ();
@@ -154,12 +184,15 @@ namespace client
 				m_Pool->SetLocalDestination (nullptr);
 				i2p::tunnel::tunnels.StopTunnelPool (m_Pool);
 			}
-			m_Service.stop ();
-			if (m_Thread)
+			if (m_OwnService)
 			{
-				m_Thread->join ();
-				delete m_Thread;
-				m_Thread = 0;
+				m_Service.stop ();
+				if (m_Thread)
+				{
+					m_Thread->join ();
+					delete m_Thread;
+					m_Thread = 0;
+				}
 			}
 			SaveTags ();
 			CleanUp (); // GarlicDestination
@@ -169,6 +202,81 @@ namespace client
 			return false;
 	}
 
+	std::shared_ptr<LeaseSetDestination> LeaseSetDestination::FindLocalDestination (const i2p::data::IdentHash& ident) const
+	{
+		if (!m_IsLocalDelivery) return nullptr;
+		std::shared_ptr<LeaseSetDestination> dest;
+		{
+			std::unique_lock<std::mutex> l(localDeliveryDestinationsMutex);
+			auto it = localDeliveryDestinations.find (ident);
+			if (it != localDeliveryDestinations.end ())
+				dest = it->second.lock ();
+		}
+		if (dest && (dest.get () == this || !dest->IsRunning ())) dest = nullptr;
+		return dest;
+	}
+
+	void LeaseSetDestination::DeliverLocally (std::shared_ptr<LeaseSetDestination> dest, const std::vector<std::shared_ptr<I2NPMessage> >& msgs)
+	{
+		// our LeaseSet goes first, as if bundled to garlic, for replies
+		std::shared_ptr<I2NPMessage> leaseSet;
+		auto ls = GetLeaseSet ();
+		if (ls)
+		{
+			std::unique_lock<std::mutex> l(m_LocalDeliveryMutex);
+			auto& sent = m_LocallyDeliveredLeaseSets[dest->GetIdentHash ()];
+			if (sent != ls)
+			{
+				leaseSet = CreateDatabaseStoreMsg (ls);
+				sent = ls;
+			}
+		}
+		dest->GetService ().post ([dest, leaseSet, msgs](void)
+			{
+				if (!dest->IsRunning ()) return;
+				if (leaseSet)
+					dest->HandleI2NPMessage (leaseSet->GetBuffer (), leaseSet->GetLength (), nullptr);
+				for (auto& it: msgs)
+					if (it) dest->HandleI2NPMessage (it->GetBuffer (), it->GetLength (), nullptr);
+			});
+		m_NumLocallyDelivered += msgs.size ();
+	}
+
+	bool LeaseSetDestination::IsStopInServiceThread () const
+	{
+		// can't wait for pool thread from itself or if pool is stopped already
+		if (m_OwnService || !destinationServices.IsRunning () || destinationServices.IsServiceThread (m_Service)) return false;
+		if (destinationServices.IsPoolThread ())
+		{
+			try
+			{
+				shared_from_this ();
+			}
+			catch (std::bad_weak_ptr&)
+			{
+				// from destructor on thread of another destination. Nobody else refers to us, no handler of ours
+				// is pending, so we stop here. Waiting might deadlock if that thread waits for us
+				return false;
+			}
+		}
+		return true;
+	}
+
+	bool LeaseSetDestination::StopInServiceThread ()
+	{
+		if (destinationServices.IsPoolThread ())
+		{
+			// thread of another destination, waiting might deadlock if that one waits for us
+			auto s = shared_from_this (); // checked by IsStopInServiceThread
+			m_Service.post ([s](void) { s->Stop (); });
+			return false; // pending, stopped by its thread shortly
+		}
+		std::promise<bool> stopped;
+		auto result = stopped.get_future ();
+		m_Service.post ([this, &stopped](void) { stopped.set_value (Stop ()); }); // this is alive until we return
+		return result.get ();
+	}
+
 	bool LeaseSetDestination::Reconfigure(std::map<std::string, std::string> params)
 	{
 		
@@ -766,6 +874,7 @@ namespace client
 
 	ClientDestination::ClientDestination (const i2p::data::PrivateKeys& keys, bool isPublic, const std::map<std::string, std::string> * params):
 		LeaseSetDestination (isPublic, params), m_Keys (keys), m_StreamingAckDelay (DEFAULT_INITIAL_ACK_DELAY),
+		m_StreamingCongestionControl (i2p::stream::eStreamingCongestionControlCubic),
 		m_DatagramDestination (nullptr), m_RefCounter (0),
 		m_ReadyChecker(GetService())
 	{
@@ -784,6 +893,14 @@ namespace client
 			auto it = params->find (I2CP_PARAM_STREAMING_INITIAL_ACK_DELAY);
 			if (it != params->end ())
 				m_StreamingAckDelay = std::stoi(it->second);
+			it = params->find (I2CP_PARAM_STREAMING_CONGESTION_CONTROL);
+			if (it != params->end ())
+			{
+				if (it->second == "reno")
+					m_StreamingCongestionControl = i2p::stream::eStreamingCongestionControlReno;
+				else if (it->second != "cubic")
+					LogPrint (eLogWarning, "Destination: Unknown streaming congestion control ", it->second, ", using cubic");
+			}
 		}
 	}
 
@@ -807,17 +924,25 @@ namespace client
 
 	bool ClientDestination::Stop ()
 	{
+		if (IsRunning () && IsStopInServiceThread ()) return StopInServiceThread ();
 		if (LeaseSetDestination::Stop ())
 		{
 			m_ReadyChecker.cancel();
 			m_StreamingDestination->Stop ();
 			//m_StreamingDestination->SetOwner (nullptr);
-			m_StreamingDestination = nullptr;
 			for (auto& it: m_StreamingDestinationsByPorts)
 			{
 				it.second->Stop ();
 				//it.second->SetOwner (nullptr);
 			}
+			if (IsPooled ())
+			{
+				// pool keeps running, streams' handlers of cancelled timers are queued before this one
+				auto streamingDestination = m_StreamingDestination;
+				auto streamingDestinationsByPorts = m_StreamingDestinationsByPorts;
+				GetService ().post ([streamingDestination, streamingDestinationsByPorts](void) {});
+			}
+			m_StreamingDestination = nullptr;
 			m_StreamingDestinationsByPorts.clear ();
 			if (m_DatagramDestination)
 			{
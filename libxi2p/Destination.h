@@ -20,6 +20,7 @@
 #include "NetDb.hpp"
 #include "Streaming.h"
 #include "Datagram.h"
+#include "IOServicePool.h"
 
 namespace i2p
 {
@@ -52,6 +53,8 @@ namespace client
 	const int DEFAULT_TAGS_TO_SEND = 40;
 	const char I2CP_PARAM_INBOUND_NICKNAME[] = "inbound.nickname";
 	const char I2CP_PARAM_OUTBOUND_NICKNAME[] = "outbound.nickname";
+	const char I2CP_PARAM_LOCAL_DELIVERY[] = "i2p.localDelivery";
+	const char DEFAULT_LOCAL_DELIVERY[] = "false";
 
 	// latency
 	const char I2CP_PARAM_MIN_TUNNEL_LATENCY[] = "latency.min";
@@ -62,9 +65,14 @@ namespace client
 	// streaming
 	const char I2CP_PARAM_STREAMING_INITIAL_ACK_DELAY[] = "i2p.streaming.initialAckDelay";
 	const int DEFAULT_INITIAL_ACK_DELAY = 200; // milliseconds
+	const char I2CP_PARAM_STREAMING_CONGESTION_CONTROL[] = "i2p.streaming.congestionControl";
+	const char DEFAULT_STREAMING_CONGESTION_CONTROL[] = "cubic"; // or reno
 
 	typedef std::function<void (std::shared_ptr<i2p::stream::Stream> stream)> StreamRequestComplete;
 
+	// if started, destinations created after share its threads instead of own thread each
+	extern i2p::util::IOServicePool destinationServices;
+
 	class LeaseSetDestination: public i2p::garlic::GarlicDestination,
 		public std::enable_shared_from_this<LeaseSetDestination>
 	{
@@ -119,6 +127,11 @@ namespace client
 			void ProcessDeliveryStatusMessage (std::shared_ptr<I2NPMessage> msg);
 			void SetLeaseSetUpdated ();
 
+			// local delivery, both destinations must have it enabled
+			bool IsLocalDelivery () const { return m_IsLocalDelivery; };
+			std::shared_ptr<LeaseSetDestination> FindLocalDestination (const i2p::data::IdentHash& ident) const; // null if not on this router
+			void DeliverLocally (std::shared_ptr<LeaseSetDestination> dest, const std::vector<std::shared_ptr<I2NPMessage> >& msgs);
+
 		protected:
 
 			void SetLeaseSet (i2p::data::LocalLeaseSet * newLeaseSet);
@@ -126,6 +139,10 @@ namespace client
 			// I2CP
 			virtual void HandleDataMessage (const uint8_t * buf, size_t len) = 0;
 			virtual void CreateNewLeaseSet (std::vector<std::shared_ptr<i2p::tunnel::InboundTunnel> > tunnels) = 0;
+			// pooled destination is stopped by its thread, so none of its handlers runs meanwhile
+			bool IsPooled () const { return !m_OwnService; }; // service keeps running after stop
+			bool IsStopInServiceThread () const;
+			bool StopInServiceThread (); // false if only posted from another pool thread and still pending
 
 		private:
 
@@ -149,7 +166,8 @@ namespace client
 
 			volatile bool m_IsRunning;
 			std::thread * m_Thread;
-			boost::asio::io_service m_Service;
+			std::unique_ptr<boost::asio::io_service> m_OwnService; // null if runs on destinationServices
+			boost::asio::io_service& m_Service;
 			mutable std::mutex m_RemoteLeaseSetsMutex;
 			std::map<i2p::data::IdentHash, std::shared_ptr<i2p::data::LeaseSet> > m_RemoteLeaseSets;
 			std::map<i2p::data::IdentHash, std::shared_ptr<LeaseSetRequest> > m_LeaseSetRequests;
@@ -166,10 +184,16 @@ namespace client
 				m_PublishDelayTimer, m_CleanupTimer;
 			std::string m_Nickname;
 
+			bool m_IsLocalDelivery;
+			std::mutex m_LocalDeliveryMutex;
+			std::map<i2p::data::IdentHash, std::shared_ptr<const i2p::data::LocalLeaseSet> > m_LocallyDeliveredLeaseSets; // last sent to local destination
+			uint64_t m_NumLocallyDelivered;
+
 		public:
 
 			// for HTTP only
 			int GetNumRemoteLeaseSets () const { return m_RemoteLeaseSets.size (); };
+			uint64_t GetNumLocallyDelivered () const { return m_NumLocallyDelivered; };
 			const decltype(m_RemoteLeaseSets)& GetLeaseSets () const { return m_RemoteLeaseSets; };
 	};
 
@@ -209,6 +233,7 @@ namespace client
 			bool IsAcceptingStreams () const;
 			void AcceptOnce (const i2p::stream::StreamingDestination::Acceptor& acceptor);
 			int GetStreamingAckDelay () const { return m_StreamingAckDelay; }
+			i2p::stream::StreamingCongestionControlType GetStreamingCongestionControl () const { return m_StreamingCongestionControl; }
 
 			// datagram
       i2p::datagram::DatagramDestination * GetDatagramDestination () const { return m_DatagramDestination; };
@@ -241,6 +266,7 @@ namespace client
 			std::shared_ptr<i2p::crypto::CryptoKeyDecryptor> m_Decryptor;
 
 			int m_StreamingAckDelay;
+			i2p::stream::StreamingCongestionControlType m_StreamingCongestionControl;
 			std::shared_ptr<i2p::stream::StreamingDestination> m_StreamingDestination; // default
 			std::map<uint16_t, std::shared_ptr<i2p::stream::StreamingDestination> > m_StreamingDestinationsByPorts;
 			i2p::datagram::DatagramDestination * m_DatagramDestination;
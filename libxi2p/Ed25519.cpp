@@ -1,4 +1,8 @@
+#include <string.h>
+#include <algorithm>
+#include <vector>
 #include <openssl/sha.h>
+#include <openssl/rand.h>
 #include "Log.h"
 #include "Crypto.h"
 #include "Ed25519.h"
@@ -7,115 +11,542 @@ namespace i2p
 {
 namespace crypto
 {
-	Ed25519::Ed25519 ()
+	// 64x64 -> 128 bits multiplication
+#if defined(__SIZEOF_INT128__)
+	__extension__ typedef unsigned __int128 uint128;
+
+	static inline uint128 Mul64 (uint64_t a, uint64_t b) { return (uint128)a * b; }
+	static inline void Add128 (uint128& r, uint128 a) { r += a; }
+	static inline void Add128 (uint128& r, uint64_t a) { r += a; }
+	static inline uint64_t Lo64 (uint128 a) { return (uint64_t)a; }
+	static inline uint64_t Hi64 (uint128 a) { return (uint64_t)(a >> 64); }
+	static inline uint64_t Shr128 (uint128 a, int n) { return (uint64_t)(a >> n); } // 0 < n < 64, result must fit 64 bits
+#else
+	struct uint128 { uint64_t lo, hi; };
+
+	static inline uint128 Mul64 (uint64_t a, uint64_t b)
 	{
-		BN_CTX * ctx = BN_CTX_new ();
-		BIGNUM * tmp = BN_new ();
-
-		q = BN_new ();
-		// 2^255-19
-		BN_set_bit (q, 255); // 2^255
-		BN_sub_word (q, 19);
-
-		l = BN_new ();
-		// 2^252 + 27742317777372353535851937790883648493
-		BN_set_bit (l, 252);
-		two_252_2 = BN_dup (l);
-		BN_dec2bn (&tmp, "27742317777372353535851937790883648493");
-		BN_add (l, l, tmp);
-		BN_sub_word (two_252_2, 2); // 2^252 - 2
-
-		 // -121665*inv(121666)
-		d = BN_new ();
-		BN_set_word (tmp, 121666);
-		BN_mod_inverse (tmp, tmp, q, ctx);
-		BN_set_word (d, 121665);
-		BN_set_negative (d, 1);
-		BN_mul (d, d, tmp, ctx);
-
-		// 2^((q-1)/4)
-		I = BN_new ();
-		BN_free (tmp);
-		tmp = BN_dup (q);
-		BN_sub_word (tmp, 1);
-		BN_div_word (tmp, 4);
-		BN_set_word (I, 2);
-		BN_mod_exp (I, I, tmp, q, ctx);
-		BN_free (tmp);
-
-		// 4*inv(5)
-		BIGNUM * By = BN_new ();
-		BN_set_word (By, 5);
-		BN_mod_inverse (By, By, q, ctx);
-		BN_mul_word (By, 4);
-		BIGNUM * Bx = RecoverX (By, ctx);
-		BN_mod (Bx, Bx, q, ctx); // % q
-		BN_mod (By, By, q, ctx); // % q
-
-		// precalculate Bi256 table
-		Bi256Carry = { Bx, By };  // B
-		for (int i = 0; i < 32; i++)
+		uint64_t a0 = (uint32_t)a, a1 = a >> 32, b0 = (uint32_t)b, b1 = b >> 32;
+		uint64_t p00 = a0*b0, p01 = a0*b1, p10 = a1*b0, p11 = a1*b1;
+		uint64_t mid = (p00 >> 32) + (uint32_t)p01 + (uint32_t)p10;
+		uint128 r;
+		r.lo = (mid << 32) | (uint32_t)p00;
+		r.hi = p11 + (p01 >> 32) + (p10 >> 32) + (mid >> 32);
+		return r;
+	}
+	static inline void Add128 (uint128& r, uint128 a) { r.lo += a.lo; r.hi += a.hi + (r.lo < a.lo); }
+	static inline void Add128 (uint128& r, uint64_t a) { r.lo += a; r.hi += (r.lo < a); }
+	static inline uint64_t Lo64 (uint128 a) { return a.lo; }
+	static inline uint64_t Hi64 (uint128 a) { return a.hi; }
+	static inline uint64_t Shr128 (uint128 a, int n) { return (a.lo >> n) | (a.hi << (64 - n)); }
+#endif
+
+	const uint64_t MASK51 = (1ULL << 51) - 1;
+
+	static inline uint64_t Load64 (const uint8_t * buf)
+	{
+		uint64_t r = 0;
+		for (int i = 7; i >= 0; i--) r = (r << 8) | buf[i];
+		return r;
+	}
+
+	static inline void Store64 (uint8_t * buf, uint64_t v)
+	{
+		for (int i = 0; i < 8; i++) { buf[i] = v; v >>= 8; }
+	}
+
+	// field arithmetic mod 2^255-19
+	typedef EDDSAFieldElement fe;
+
+	static inline void FeZero (fe& r) { r.v[0] = r.v[1] = r.v[2] = r.v[3] = r.v[4] = 0; }
+	static inline void FeOne (fe& r) { FeZero (r); r.v[0] = 1; }
+
+	static inline void FeCarry (fe& r)
+	{
+		uint64_t c;
+		c = r.v[0] >> 51; r.v[0] &= MASK51; r.v[1] += c;
+		c = r.v[1] >> 51; r.v[1] &= MASK51; r.v[2] += c;
+		c = r.v[2] >> 51; r.v[2] &= MASK51; r.v[3] += c;
+		c = r.v[3] >> 51; r.v[3] &= MASK51; r.v[4] += c;
+		c = r.v[4] >> 51; r.v[4] &= MASK51; r.v[0] += c*19;
+	}
+
+	static inline void FeAdd (fe& r, const fe& a, const fe& b)
+	{
+		for (int i = 0; i < 5; i++) r.v[i] = a.v[i] + b.v[i];
+		FeCarry (r);
+	}
+
+	static inline void FeSub (fe& r, const fe& a, const fe& b)
+	{
+		// add 4*p to avoid underflow
+		r.v[0] = a.v[0] + 0x1FFFFFFFFFFFB4ULL - b.v[0];
+		r.v[1] = a.v[1] + 0x1FFFFFFFFFFFFCULL - b.v[1];
+		r.v[2] = a.v[2] + 0x1FFFFFFFFFFFFCULL - b.v[2];
+		r.v[3] = a.v[3] + 0x1FFFFFFFFFFFFCULL - b.v[3];
+		r.v[4] = a.v[4] + 0x1FFFFFFFFFFFFCULL - b.v[4];
+		FeCarry (r);
+	}
+
+	static inline void FeNeg (fe& r, const fe& a)
+	{
+		fe zero; FeZero (zero);
+		FeSub (r, zero, a);
+	}
+
+	static inline void FeReduce128 (fe& r, uint128 t[5])
+	{
+		uint64_t c;
+		r.v[0] = Lo64 (t[0]) & MASK51; c = Shr128 (t[0], 51); Add128 (t[1], c);
+		r.v[1] = Lo64 (t[1]) & MASK51; c = Shr128 (t[1], 51); Add128 (t[2], c);
+		r.v[2] = Lo64 (t[2]) & MASK51; c = Shr128 (t[2], 51); Add128 (t[3], c);
+		r.v[3] = Lo64 (t[3]) & MASK51; c = Shr128 (t[3], 51); Add128 (t[4], c);
+		r.v[4] = Lo64 (t[4]) & MASK51; c = Shr128 (t[4], 51);
+		r.v[0] += c*19;
+		c = r.v[0] >> 51; r.v[0] &= MASK51; r.v[1] += c;
+	}
+
+	static void FeMul (fe& r, const fe& a, const fe& b)
+	{
+		const uint64_t * f = a.v, * g = b.v;
+		uint64_t g1_19 = 19*g[1], g2_19 = 19*g[2], g3_19 = 19*g[3], g4_19 = 19*g[4];
+		uint128 t[5];
+		t[0] = Mul64 (f[0], g[0]); Add128 (t[0], Mul64 (f[1], g4_19)); Add128 (t[0], Mul64 (f[2], g3_19));
+			Add128 (t[0], Mul64 (f[3], g2_19)); Add128 (t[0], Mul64 (f[4], g1_19));
+		t[1] = Mul64 (f[0], g[1]); Add128 (t[1], Mul64 (f[1], g[0])); Add128 (t[1], Mul64 (f[2], g4_19));
+			Add128 (t[1], Mul64 (f[3], g3_19)); Add128 (t[1], Mul64 (f[4], g2_19));
+		t[2] = Mul64 (f[0], g[2]); Add128 (t[2], Mul64 (f[1], g[1])); Add128 (t[2], Mul64 (f[2], g[0]));
+			Add128 (t[2], Mul64 (f[3], g4_19)); Add128 (t[2], Mul64 (f[4], g3_19));
+		t[3] = Mul64 (f[0], g[3]); Add128 (t[3], Mul64 (f[1], g[2])); Add128 (t[3], Mul64 (f[2], g[1]));
+			Add128 (t[3], Mul64 (f[3], g[0])); Add128 (t[3], Mul64 (f[4], g4_19));
+		t[4] = Mul64 (f[0], g[4]); Add128 (t[4], Mul64 (f[1], g[3])); Add128 (t[4], Mul64 (f[2], g[2]));
+			Add128 (t[4], Mul64 (f[3], g[1])); Add128 (t[4], Mul64 (f[4], g[0]));
+		FeReduce128 (r, t);
+	}
+
+	static void FeSq (fe& r, const fe& a)
+	{
+		const uint64_t * f = a.v;
+		uint64_t f0_2 = 2*f[0], f1_2 = 2*f[1], f1_38 = 38*f[1], f2_38 = 38*f[2], f3_38 = 38*f[3], f3_19 = 19*f[3], f4_19 = 19*f[4];
+		uint128 t[5];
+		t[0] = Mul64 (f[0], f[0]); Add128 (t[0], Mul64 (f1_38, f[4])); Add128 (t[0], Mul64 (f2_38, f[3]));
+		t[1] = Mul64 (f0_2, f[1]); Add128 (t[1], Mul64 (f2_38, f[4])); Add128 (t[1], Mul64 (f3_19, f[3]));
+		t[2] = Mul64 (f0_2, f[2]); Add128 (t[2], Mul64 (f[1], f[1])); Add128 (t[2], Mul64 (f3_38, f[4]));
+		t[3] = Mul64 (f0_2, f[3]); Add128 (t[3], Mul64 (f1_2, f[2])); Add128 (t[3], Mul64 (f4_19, f[4]));
+		t[4] = Mul64 (f0_2, f[4]); Add128 (t[4], Mul64 (f1_2, f[3])); Add128 (t[4], Mul64 (f[2], f[2]));
+		FeReduce128 (r, t);
+	}
+
+	static void FeSqN (fe& r, const fe& a, int n) // a^(2^n)
+	{
+		FeSq (r, a);
+		for (int i = 1; i < n; i++) FeSq (r, r);
+	}
+
+	static void FeMulSmall (fe& r, const fe& a, uint32_t c)
+	{
+		uint128 t[5];
+		for (int i = 0; i < 5; i++) t[i] = Mul64 (a.v[i], c);
+		FeReduce128 (r, t);
+	}
+
+	static void FePow2523 (fe& r, const fe& z) // z^(2^252-3)
+	{
+		fe t0, t1, t2;
+		FeSq (t0, z); FeSqN (t1, t0, 2); FeMul (t1, z, t1); FeMul (t0, t0, t1); // z^11
+		FeSq (t0, t0); FeMul (t0, t1, t0); // z^(2^5-1)
+		FeSqN (t1, t0, 5); FeMul (t0, t1, t0); // z^(2^10-1)
+		FeSqN (t1, t0, 10); FeMul (t1, t1, t0); // z^(2^20-1)
+		FeSqN (t2, t1, 20); FeMul (t1, t2, t1); // z^(2^40-1)
+		FeSqN (t1, t1, 10); FeMul (t0, t1, t0); // z^(2^50-1)
+		FeSqN (t1, t0, 50); FeMul (t1, t1, t0); // z^(2^100-1)
+		FeSqN (t2, t1, 100); FeMul (t1, t2, t1); // z^(2^200-1)
+		FeSqN (t1, t1, 50); FeMul (t0, t1, t0); // z^(2^250-1)
+		FeSqN (t0, t0, 2); FeMul (r, t0, z); // z^(2^252-3)
+	}
+
+	static void FeInvert (fe& r, const fe& z) // z^(p-2)
+	{
+		fe t0, t1, t2, t3;
+		FeSq (t0, z); FeSqN (t1, t0, 2); FeMul (t1, z, t1); FeMul (t0, t0, t1); // z^11
+		FeSq (t2, t0); FeMul (t1, t1, t2); // z^(2^5-1)
+		FeSqN (t2, t1, 5); FeMul (t1, t2, t1); // z^(2^10-1)
+		FeSqN (t2, t1, 10); FeMul (t2, t2, t1); // z^(2^20-1)
+		FeSqN (t3, t2, 20); FeMul (t2, t3, t2); // z^(2^40-1)
+		FeSqN (t2, t2, 10); FeMul (t1, t2, t1); // z^(2^50-1)
+		FeSqN (t2, t1, 50); FeMul (t2, t2, t1); // z^(2^100-1)
+		FeSqN (t3, t2, 100); FeMul (t2, t3, t2); // z^(2^200-1)
+		FeSqN (t2, t2, 50); FeMul (t1, t2, t1); // z^(2^250-1)
+		FeSqN (t1, t1, 5); FeMul (r, t1, t0); // z^(2^255-21)
+	}
+
+	static void FeFromBytes (fe& r, const uint8_t * buf) // highest bit is ignored
+	{
+		r.v[0] = Load64 (buf) & MASK51;
+		r.v[1] = (Load64 (buf + 6) >> 3) & MASK51;
+		r.v[2] = (Load64 (buf + 12) >> 6) & MASK51;
+		r.v[3] = (Load64 (buf + 19) >> 1) & MASK51;
+		r.v[4] = (Load64 (buf + 24) >> 12) & MASK51;
+	}
+
+	static void FeToBytes (uint8_t * buf, const fe& a)
+	{
+		fe t = a;
+		FeCarry (t); FeCarry (t);
+		// t is in [0, 2^255), make it canonical: (t + 19) + (2^255 - 19) mod 2^255 if t >= p
+		t.v[0] += 19;
+		FeCarry (t);
+		t.v[0] += (1ULL << 51) - 19;
+		t.v[1] += (1ULL << 51) - 1;
+		t.v[2] += (1ULL << 51) - 1;
+		t.v[3] += (1ULL << 51) - 1;
+		t.v[4] += (1ULL << 51) - 1;
+		t.v[1] += t.v[0] >> 51; t.v[0] &= MASK51;
+		t.v[2] += t.v[1] >> 51; t.v[1] &= MASK51;
+		t.v[3] += t.v[2] >> 51; t.v[2] &= MASK51;
+		t.v[4] += t.v[3] >> 51; t.v[3] &= MASK51;
+		t.v[4] &= MASK51; // drop 2^255
+		Store64 (buf, t.v[0] | (t.v[1] << 51));
+		Store64 (buf + 8, (t.v[1] >> 13) | (t.v[2] << 38));
+		Store64 (buf + 16, (t.v[2] >> 26) | (t.v[3] << 25));
+		Store64 (buf + 24, (t.v[3] >> 39) | (t.v[4] << 12));
+	}
+
+	static bool FeIsNegative (const fe& a)
+	{
+		uint8_t buf[32];
+		FeToBytes (buf, a);
+		return buf[0] & 1;
+	}
+
+	static bool FeIsZero (const fe& a)
+	{
+		uint8_t buf[32], r = 0;
+		FeToBytes (buf, a);
+		for (int i = 0; i < 32; i++) r |= buf[i];
+		return !r;
+	}
+
+	static inline void FeCMov (fe& r, const fe& a, uint64_t b) // r = a if b == 1, constant time
+	{
+		uint64_t mask = -b;
+		for (int i = 0; i < 5; i++) r.v[i] ^= (r.v[i] ^ a.v[i]) & mask;
+	}
+
+	static inline void FeCSwap (fe& a, fe& b, uint64_t swap) // constant time
+	{
+		uint64_t mask = -swap;
+		for (int i = 0; i < 5; i++)
 		{
-			Bi256[i][0] = Bi256Carry; // first point
-			for (int j = 1; j < 128; j++)
-				Bi256[i][j] = Sum (Bi256[i][j-1], Bi256[i][0], ctx); // (256+j+1)^i*B
-			Bi256Carry = Bi256[i][127];
-			for (int j = 0; j < 128; j++) // add first point 128 more times
-				Bi256Carry = Sum (Bi256Carry, Bi256[i][0], ctx);
+			uint64_t x = (a.v[i] ^ b.v[i]) & mask;
+			a.v[i] ^= x; b.v[i] ^= x;
 		}
+	}
+
+	// group operations, twisted Edwards curve -x^2+y^2 = 1+d*x^2*y^2
+	struct EDDSACompletedPoint { fe x, y, z, t; }; // x/z, y/t
+	struct EDDSAProjectivePoint { fe x, y, z; };
+	struct EDDSACachedPoint { fe yplusx, yminusx, z, t2d; };
+
+	static void PointZero (EDDSAPoint& p) { FeZero (p.x); FeOne (p.y); FeOne (p.z); FeZero (p.t); }
+	static void PointZero (EDDSAProjectivePoint& p) { FeZero (p.x); FeOne (p.y); FeOne (p.z); }
+	static void PointZero (EDDSAPrecomputedPoint& p) { FeOne (p.yplusx); FeOne (p.yminusx); FeZero (p.xy2d); }
 
-		BN_CTX_free (ctx);
+	static void ToProjective (EDDSAProjectivePoint& r, const EDDSACompletedPoint& p)
+	{
+		FeMul (r.x, p.x, p.t);
+		FeMul (r.y, p.y, p.z);
+		FeMul (r.z, p.z, p.t);
 	}
 
-	Ed25519::Ed25519 (const Ed25519& other): q (BN_dup (other.q)), l (BN_dup (other.l)),
-		d (BN_dup (other.d)), I (BN_dup (other.I)), two_252_2 (BN_dup (other.two_252_2)),
-		Bi256Carry (other.Bi256Carry)
+	static void ToExtended (EDDSAPoint& r, const EDDSACompletedPoint& p)
 	{
-		for (int i = 0; i < 32; i++)
-			for (int j = 0; j < 128; j++)
-				Bi256[i][j] = other.Bi256[i][j];
+		FeMul (r.x, p.x, p.t);
+		FeMul (r.y, p.y, p.z);
+		FeMul (r.z, p.z, p.t);
+		FeMul (r.t, p.x, p.y);
 	}
 
-	Ed25519::~Ed25519 ()
+	static void ToCached (EDDSACachedPoint& r, const EDDSAPoint& p, const fe& d2)
 	{
-		BN_free (q);
-		BN_free (l);
-		BN_free (d);
-		BN_free (I);
-		BN_free (two_252_2);
+		FeAdd (r.yplusx, p.y, p.x);
+		FeSub (r.yminusx, p.y, p.x);
+		r.z = p.z;
+		FeMul (r.t2d, p.t, d2);
 	}
 
+	static void Double (EDDSACompletedPoint& r, const EDDSAProjectivePoint& p)
+	{
+		fe t0;
+		FeSq (r.x, p.x);
+		FeSq (r.z, p.y);
+		FeSq (r.t, p.z); FeAdd (r.t, r.t, r.t);
+		FeAdd (r.y, p.x, p.y);
+		FeSq (t0, r.y);
+		FeAdd (r.y, r.z, r.x);
+		FeSub (r.z, r.z, r.x);
+		FeSub (r.x, t0, r.y);
+		FeSub (r.t, r.t, r.z);
+	}
 
-	EDDSAPoint Ed25519::GeneratePublicKey (const uint8_t * expandedPrivateKey, BN_CTX * ctx) const
+	static void Double (EDDSACompletedPoint& r, const EDDSAPoint& p)
 	{
-		return MulB (expandedPrivateKey, ctx); // left half of expanded key, considered as Little Endian
+		EDDSAProjectivePoint q { p.x, p.y, p.z };
+		Double (r, q);
 	}
 
-	EDDSAPoint Ed25519::DecodePublicKey (const uint8_t * buf, BN_CTX * ctx) const
+	static void Add (EDDSACompletedPoint& r, const EDDSAPoint& p, const EDDSACachedPoint& q, bool sub = false)
 	{
-		return DecodePoint (buf, ctx);
+		fe t0;
+		FeAdd (r.x, p.y, p.x);
+		FeSub (r.y, p.y, p.x);
+		FeMul (r.z, r.x, sub ? q.yminusx : q.yplusx);
+		FeMul (r.y, r.y, sub ? q.yplusx : q.yminusx);
+		FeMul (r.t, q.t2d, p.t);
+		FeMul (r.x, p.z, q.z);
+		FeAdd (t0, r.x, r.x);
+		FeSub (r.x, r.z, r.y);
+		FeAdd (r.y, r.z, r.y);
+		if (sub)
+		{
+			FeSub (r.z, t0, r.t);
+			FeAdd (r.t, t0, r.t);
+		}
+		else
+		{
+			FeAdd (r.z, t0, r.t);
+			FeSub (r.t, t0, r.t);
+		}
+	}
+
+	static void Add (EDDSACompletedPoint& r, const EDDSAPoint& p, const EDDSAPrecomputedPoint& q, bool sub = false)
+	{
+		fe t0;
+		FeAdd (r.x, p.y, p.x);
+		FeSub (r.y, p.y, p.x);
+		FeMul (r.z, r.x, sub ? q.yminusx : q.yplusx);
+		FeMul (r.y, r.y, sub ? q.yplusx : q.yminusx);
+		FeMul (r.t, q.xy2d, p.t);
+		FeAdd (t0, p.z, p.z);
+		FeSub (r.x, r.z, r.y);
+		FeAdd (r.y, r.z, r.y);
+		if (sub)
+		{
+			FeSub (r.z, t0, r.t);
+			FeAdd (r.t, t0, r.t);
+		}
+		else
+		{
+			FeAdd (r.z, t0, r.t);
+			FeSub (r.t, t0, r.t);
+		}
 	}
 
-	void Ed25519::EncodePublicKey (const EDDSAPoint& publicKey, uint8_t * buf, BN_CTX * ctx) const
+	static bool IsSmallOrder (const EDDSACompletedPoint& p) // 8*p is zero point
 	{
-		EncodePoint (Normalize (publicKey, ctx), buf);
+		EDDSAProjectivePoint q;
+		EDDSACompletedPoint r = p;
+		for (int i = 0; i < 3; i++)
+		{
+			ToProjective (q, r);
+			Double (r, q);
+		}
+		ToProjective (q, r);
+		fe diff;
+		FeSub (diff, q.y, q.z);
+		return FeIsZero (q.x) && FeIsZero (diff);
+	}
+
+	// scalars mod l = 2^252 + 27742317777372353535851937790883648493
+	static const uint64_t L[4] = { 0x5812631a5cf5d3edULL, 0x14def9dea2f79cd6ULL, 0, 0x1000000000000000ULL };
+
+	static const uint64_t MU[5] = { 0xed9ce5a30a2c131bULL, 0x2106215d086329a7ULL, 0xffffffffffffffebULL, 0xffffffffffffffffULL, 0xf }; // 2^512/l
+
+	static inline uint64_t SubScalar (uint64_t * r, const uint64_t * a, const uint64_t * b, int numLimbs) // r = a - b, returns borrow
+	{
+		uint64_t borrow = 0;
+		for (int j = 0; j < numLimbs; j++)
+		{
+			uint64_t d = a[j] - b[j];
+			uint64_t b1 = a[j] < b[j];
+			r[j] = d - borrow;
+			borrow = b1 | (d < borrow);
+		}
+		return borrow;
+	}
+
+	static void ReduceScalar (const uint64_t * n, uint8_t * out) // n is 8 limbs little endian, Barrett reduction, constant time
+	{
+		// q = ((n >> 192)*mu) >> 320
+		uint64_t q[10] = { 0 };
+		for (int i = 0; i < 5; i++)
+		{
+			uint64_t carry = 0;
+			for (int j = 0; j < 5; j++)
+			{
+				uint128 t = Mul64 (n[i + 3], MU[j]);
+				Add128 (t, q[i + j]);
+				Add128 (t, carry);
+				q[i + j] = Lo64 (t);
+				carry = Hi64 (t);
+			}
+			q[i + 5] = carry;
+		}
+		// r = n - q*l mod 2^320
+		uint64_t ql[5] = { 0 }, r[5], t[5];
+		const uint64_t * q3 = q + 5;
+		for (int i = 0; i < 5; i++)
+		{
+			uint64_t carry = 0;
+			for (int j = 0; i + j < 5 && j < 4; j++)
+			{
+				uint128 m = Mul64 (q3[i], L[j]);
+				Add128 (m, ql[i + j]);
+				Add128 (m, carry);
+				ql[i + j] = Lo64 (m);
+				carry = Hi64 (m);
+			}
+			if (i + 4 < 5) ql[i + 4] += carry;
+		}
+		SubScalar (r, n, ql, 5);
+		// r < 3*l, subtract l at most twice
+		const uint64_t l5[5] = { L[0], L[1], L[2], L[3], 0 };
+		for (int k = 0; k < 2; k++)
+		{
+			uint64_t mask = SubScalar (t, r, l5, 5) - 1; // all ones if r >= l
+			for (int j = 0; j < 5; j++) r[j] = (t[j] & mask) | (r[j] & ~mask);
+		}
+		for (int j = 0; j < 4; j++) Store64 (out + 8*j, r[j]);
+	}
+
+	static void ReduceScalar64 (const uint8_t * buf, uint8_t * out) // 64 bytes Little Endian
+	{
+		uint64_t n[8];
+		for (int i = 0; i < 8; i++) n[i] = Load64 (buf + 8*i);
+		ReduceScalar (n, out);
+	}
+
+	static void MulAddScalar (const uint8_t * a, const uint8_t * b, const uint8_t * c, uint8_t * out) // (a*b + c) % l
+	{
+		uint64_t x[4], y[4], n[8];
+		for (int i = 0; i < 4; i++)
+		{
+			x[i] = Load64 (a + 8*i); y[i] = Load64 (b + 8*i);
+			n[i] = Load64 (c + 8*i); n[i + 4] = 0;
+		}
+		for (int i = 0; i < 4; i++)
+		{
+			uint64_t carry = 0;
+			for (int j = 0; j < 4; j++)
+			{
+				uint128 t = Mul64 (x[i], y[j]);
+				Add128 (t, n[i + j]);
+				Add128 (t, carry);
+				n[i + j] = Lo64 (t);
+				carry = Hi64 (t);
+			}
+			for (int k = i + 4; k < 8 && carry; k++)
+			{
+				n[k] += carry;
+				carry = n[k] < carry;
+			}
+		}
+		ReduceScalar (n, out);
+	}
+
+	Ed25519::Ed25519 ()
+	{
+		// d = -121665*inv(121666)
+		fe t; FeZero (t); t.v[0] = 121666;
+		FeInvert (t, t);
+		FeMulSmall (d, t, 121665);
+		FeNeg (d, d);
+		FeAdd (d2, d, d);
+		// I = sqrt(-1) = 2^((p-1)/4) = 2^(2^253-5)
+		fe two; FeZero (two); two.v[0] = 2;
+		fe t1; FePow2523 (t1, two); // 2^(2^252-3)
+		FeSq (t1, t1); // 2^(2^253-6)
+		FeMul (I, t1, two);
+
+		// B, y = 4/5
+		static const uint8_t encodedB[32] =
+		{
+			0x58, 0x66, 0x66, 0x66, 0x66, 0x66, 0x66, 0x66, 0x66, 0x66, 0x66, 0x66, 0x66, 0x66, 0x66, 0x66,
+			0x66, 0x66, 0x66, 0x66, 0x66, 0x66, 0x66, 0x66, 0x66, 0x66, 0x66, 0x66, 0x66, 0x66, 0x66, 0x66
+		};
+		EDDSAPoint B;
+		DecodePoint (encodedB, B);
+
+		// precalculate Bi16 table
+		EDDSAPoint Bi = B;
+		EDDSACompletedPoint r;
+		for (int i = 0; i < 32; i++)
+		{
+			EDDSACachedPoint Bic; ToCached (Bic, Bi, d2);
+			EDDSAPoint p = Bi;
+			for (int j = 0; j < 8; j++)
+			{
+				ToPrecomputed (p, Bi16[i][j]);
+				Add (r, p, Bic); ToExtended (p, r);
+			}
+			// 256*Bi
+			for (int j = 0; j < 8; j++)
+			{
+				Double (r, Bi); ToExtended (Bi, r);
+			}
+		}
+		// odd multiples of B
+		Double (r, B);
+		EDDSAPoint B2; ToExtended (B2, r);
+		EDDSACachedPoint B2c; ToCached (B2c, B2, d2);
+		EDDSAPoint p = B;
+		for (int j = 0; j < 8; j++)
+		{
+			ToPrecomputed (p, BOdd[j]);
+			Add (r, p, B2c); ToExtended (p, r);
+		}
+	}
+
+	EDDSAPoint Ed25519::GeneratePublicKey (const uint8_t * expandedPrivateKey) const
+	{
+		return MulB (expandedPrivateKey); // left half of expanded key, considered as Little Endian
+	}
+
+	EDDSAPoint Ed25519::DecodePublicKey (const uint8_t * buf) const
+	{
+		EDDSAPoint p;
+		if (!DecodePoint (buf, p))
+			LogPrint (eLogError, "Decoded point is not on 25519");
+		return p;
+	}
+
+	void Ed25519::EncodePublicKey (const EDDSAPoint& publicKey, uint8_t * buf) const
+	{
+		EncodePoint (publicKey, buf);
 	}
 
 	bool Ed25519::Verify (const EDDSAPoint& publicKey, const uint8_t * digest, const uint8_t * signature) const
 	{
-		BN_CTX * ctx = BN_CTX_new ();
-		BIGNUM * h = DecodeBN<64> (digest);
 		// signature 0..31 - R, 32..63 - S
-		// B*S = R + PK*h => R = B*S - PK*h
-		// we don't decode R, but encode (B*S - PK*h)
-		auto Bs = MulB (signature + EDDSA25519_SIGNATURE_LENGTH/2, ctx); // B*S;
-		BN_mod (h, h, l, ctx); // public key is multiple of B, but B%l = 0
-		auto PKh = Mul (publicKey, h, ctx); // PK*h
-		uint8_t diff[32];
-		EncodePoint (Normalize (Sum (Bs, -PKh, ctx), ctx), diff); // Bs - PKh encoded
-		bool passed = !memcmp (signature, diff, 32); // R
-		BN_free (h);
-		BN_CTX_free (ctx);
+		// 8*(B*S - PK*h - R) = 0, cofactored as VerifyCombined, so small order components
+		// of R and PK give the same result one by one and in batch.
+		// Cofactorless B*S - PK*h = R was checked before, it rejects signatures with such components
+		// which this one accepts. Honest signers never produce them, forgery is not easier
+		bool passed = false;
+		EDDSAPoint R;
+		if (!(signature[EDDSA25519_SIGNATURE_LENGTH - 1] & 0xE0) && // S < 2^253
+			DecodePoint (signature, R) && IsCanonical (signature, R))
+		{
+			uint8_t h[32];
+			ReduceScalar64 (digest, h); // public key is multiple of B, but B*l = 0
+			EDDSAPoint negPK = publicKey;
+			FeNeg (negPK.x, publicKey.x); FeNeg (negPK.t, publicKey.t);
+			auto p = DoubleMulVarTime (h, negPK, signature + EDDSA25519_SIGNATURE_LENGTH/2); // Bs - PKh
+			FeNeg (R.x, R.x); FeNeg (R.t, R.t);
+			EDDSACachedPoint negR; ToCached (negR, R, d2);
+			EDDSACompletedPoint r; Add (r, p, negR);
+			passed = IsSmallOrder (r);
+		}
 		if (!passed)
 			LogPrint (eLogError, "25519 signature verification failed");
 		return passed;
@@ -124,7 +555,6 @@ namespace crypto
 	void Ed25519::Sign (const uint8_t * expandedPrivateKey, const uint8_t * publicKeyEncoded, const uint8_t * buf, size_t len,
 		uint8_t * signature) const
 	{
-		BN_CTX * bnCtx = BN_CTX_new ();
 		// calculate r
 		SHA512_CTX ctx;
 		SHA512_Init (&ctx);
@@ -132,361 +562,360 @@ namespace crypto
 		SHA512_Update (&ctx, buf, len); // data
 		uint8_t digest[64];
 		SHA512_Final (digest, &ctx);
-		BIGNUM * r = DecodeBN<32> (digest); // DecodeBN<64> (digest); // for test vectors
+		uint8_t r[32];
+		ReduceScalar64 (digest, r);
 		// calculate R
 		uint8_t R[EDDSA25519_SIGNATURE_LENGTH/2]; // we must use separate buffer because signature might be inside buf
-		EncodePoint (Normalize (MulB (digest, bnCtx), bnCtx), R); // EncodePoint (Mul (B, r, bnCtx), R); // for test vectors
+		EncodePoint (MulB (r), R);
 		// calculate S
 		SHA512_Init (&ctx);
 		SHA512_Update (&ctx, R, EDDSA25519_SIGNATURE_LENGTH/2); // R
 		SHA512_Update (&ctx, publicKeyEncoded, EDDSA25519_PUBLIC_KEY_LENGTH); // public key
 		SHA512_Update (&ctx, buf, len); // data
 		SHA512_Final (digest, &ctx);
-		BIGNUM * h = DecodeBN<64> (digest);
+		uint8_t h[32];
+		ReduceScalar64 (digest, h);
 		// S = (r + h*a) % l
-		BIGNUM * a = DecodeBN<EDDSA25519_PRIVATE_KEY_LENGTH> (expandedPrivateKey); // left half of expanded key
-		BN_mod_mul (h, h, a, l, bnCtx); // %l
-		BN_mod_add (h, h, r, l, bnCtx); // %l
 		memcpy (signature, R, EDDSA25519_SIGNATURE_LENGTH/2);
-		EncodeBN (h, signature + EDDSA25519_SIGNATURE_LENGTH/2, EDDSA25519_SIGNATURE_LENGTH/2); // S
-		BN_free (r); BN_free (h); BN_free (a);
-		BN_CTX_free (bnCtx);
+		MulAddScalar (h, expandedPrivateKey, r, signature + EDDSA25519_SIGNATURE_LENGTH/2); // left half of expanded key
 	}
 
-	EDDSAPoint Ed25519::Sum (const EDDSAPoint& p1, const EDDSAPoint& p2, BN_CTX * ctx) const
+	void Ed25519::SelectB (EDDSAPrecomputedPoint& p, int pos, int8_t b) const
 	{
-		// x3 = (x1*y2+y1*x2)*(z1*z2-d*t1*t2)
-		// y3 = (y1*y2+x1*x2)*(z1*z2+d*t1*t2)
-		// z3 = (z1*z2-d*t1*t2)*(z1*z2+d*t1*t2)
-		// t3 = (y1*y2+x1*x2)*(x1*y2+y1*x2)
-		BIGNUM * x3 = BN_new (), * y3 = BN_new (), * z3 = BN_new (), * t3 = BN_new ();
-
-		BN_mul (x3, p1.x, p2.x, ctx); // A = x1*x2
-		BN_mul (y3, p1.y, p2.y, ctx); // B = y1*y2
-
-		BN_CTX_start (ctx);
-		BIGNUM * t1 = p1.t, * t2 = p2.t;
-		if (!t1) { t1 = BN_CTX_get (ctx); BN_mul (t1, p1.x, p1.y, ctx); }
-		if (!t2) { t2 = BN_CTX_get (ctx); BN_mul (t2, p2.x, p2.y, ctx); }
-		BN_mul (t3, t1, t2, ctx);
-		BN_mul (t3, t3, d, ctx);  // C = d*t1*t2
-
-		if (p1.z)
-		{
-			if (p2.z)
-				BN_mul (z3, p1.z, p2.z, ctx); // D = z1*z2
-			else
-				BN_copy (z3, p1.z); // D = z1
-		}
-		else
+		uint8_t negative = ((uint8_t)b) >> 7;
+		uint8_t babs = b - ((-negative & b) << 1);
+		PointZero (p);
+		for (int j = 0; j < 8; j++)
 		{
-			if (p2.z)
-				BN_copy (z3, p2.z); // D = z2
-			else
-				BN_one (z3); // D = 1
+			uint64_t eq = ((uint32_t)(babs ^ (j + 1)) - 1) >> 31; // 1 if babs == j + 1
+			FeCMov (p.yplusx, Bi16[pos][j].yplusx, eq);
+			FeCMov (p.yminusx, Bi16[pos][j].yminusx, eq);
+			FeCMov (p.xy2d, Bi16[pos][j].xy2d, eq);
 		}
-
-		BIGNUM * E = BN_CTX_get (ctx), * F = BN_CTX_get (ctx), * G = BN_CTX_get (ctx), * H = BN_CTX_get (ctx);
-		BN_add (E, p1.x, p1.y);
-		BN_add (F, p2.x, p2.y);
-		BN_mul (E, E, F, ctx); // (x1 + y1)*(x2 + y2)
-		BN_sub (E, E, x3);
-		BN_sub (E, E, y3); // E = (x1 + y1)*(x2 + y2) - A - B
-		BN_sub (F, z3, t3); // F = D - C
-		BN_add (G, z3, t3); // G = D + C
-		BN_add (H, y3, x3); // H = B + A
-
-		BN_mod_mul (x3, E, F, q, ctx); // x3 = E*F
-		BN_mod_mul (y3, G, H, q, ctx); // y3 = G*H
-		BN_mod_mul (z3, F, G, q, ctx); // z3 = F*G
-		BN_mod_mul (t3, E, H, q, ctx); // t3 = E*H
-
-		BN_CTX_end (ctx);
-
-		return EDDSAPoint {x3, y3, z3, t3};
+		// -p is (y-x, y+x, -2dxy)
+		FeCSwap (p.yplusx, p.yminusx, negative);
+		fe negxy2d; FeNeg (negxy2d, p.xy2d);
+		FeCMov (p.xy2d, negxy2d, negative);
 	}
 
-	void Ed25519::Double (EDDSAPoint& p, BN_CTX * ctx) const
+	EDDSAPoint Ed25519::MulB (const uint8_t * e) const
 	{
-		BN_CTX_start (ctx);
-		BIGNUM * x2 = BN_CTX_get (ctx), * y2 = BN_CTX_get (ctx), * z2 = BN_CTX_get (ctx), * t2 = BN_CTX_get (ctx);
-
-		BN_sqr (x2, p.x, ctx); // x2 = A = x^2
-		BN_sqr (y2, p.y, ctx); // y2 = B = y^2
-		if (p.t)
-			BN_sqr (t2, p.t, ctx); // t2 = t^2
-		else
+		// signed radix 16 digits, -8..8
+		int8_t digits[64];
+		for (int i = 0; i < 32; i++)
 		{
-			BN_mul (t2, p.x, p.y, ctx); // t = x*y
-			BN_sqr (t2, t2, ctx);  // t2 = t^2
+			digits[2*i] = e[i] & 15;
+			digits[2*i + 1] = (e[i] >> 4) & 15;
 		}
-		BN_mul (t2, t2, d, ctx);  // t2 = C = d*t^2
-		if (p.z)
-			BN_sqr (z2, p.z, ctx); // z2 = D = z^2
-		else
-			BN_one (z2); // z2 = 1
-
-		BIGNUM * E = BN_CTX_get (ctx), * F = BN_CTX_get (ctx), * G = BN_CTX_get (ctx), * H = BN_CTX_get (ctx);
-		// E = (x+y)*(x+y)-A-B = x^2+y^2+2xy-A-B = 2xy
-		BN_mul (E, p.x, p.y, ctx);
-		BN_lshift1 (E, E);	// E =2*x*y
-		BN_sub (F, z2, t2); // F = D - C
-		BN_add (G, z2, t2); // G = D + C
-		BN_add (H, y2, x2); // H = B + A
-
-		BN_mod_mul (p.x, E, F, q, ctx); // x2 = E*F
-		BN_mod_mul (p.y, G, H, q, ctx); // y2 = G*H
-		if (!p.z) p.z = BN_new ();
-		BN_mod_mul (p.z, F, G, q, ctx); // z2 = F*G
-		if (!p.t) p.t = BN_new ();
-		BN_mod_mul (p.t, E, H, q, ctx); // t2 = E*H
-
-		BN_CTX_end (ctx);
-	}
+		int8_t carry = 0;
+		for (int i = 0; i < 63; i++)
+		{
+			digits[i] += carry;
+			carry = (digits[i] + 8) >> 4;
+			digits[i] -= carry << 4;
+		}
+		digits[63] += carry;
 
-	EDDSAPoint Ed25519::Mul (const EDDSAPoint& p, const BIGNUM * e, BN_CTX * ctx) const
-	{
-		BIGNUM * zero = BN_new (), * one = BN_new ();
-		BN_zero (zero); BN_one (one);
-		EDDSAPoint res {zero, one};
-		if (!BN_is_zero (e))
+		EDDSAPoint res; PointZero (res);
+		EDDSACompletedPoint r;
+		EDDSAPrecomputedPoint p;
+		for (int i = 1; i < 64; i += 2)
 		{
-			int bitCount = BN_num_bits (e);
-			for (int i = bitCount - 1; i >= 0; i--)
-			{
-				Double (res, ctx);
-				if (BN_is_bit_set (e, i)) res = Sum (res, p, ctx);
-			}
+			SelectB (p, i/2, digits[i]);
+			Add (r, res, p); ToExtended (res, r);
+		}
+		// multiply by 16
+		EDDSAProjectivePoint s;
+		Double (r, res); ToProjective (s, r);
+		Double (r, s); ToProjective (s, r);
+		Double (r, s); ToProjective (s, r);
+		Double (r, s); ToExtended (res, r);
+		for (int i = 0; i < 64; i += 2)
+		{
+			SelectB (p, i/2, digits[i]);
+			Add (r, res, p); ToExtended (res, r);
 		}
 		return res;
 	}
 
-	EDDSAPoint Ed25519::MulB (const uint8_t * e, BN_CTX * ctx) const // B*e, e is 32 bytes Little Endian
+	static void Slide (int8_t * r, const uint8_t * a) // signed sliding window, odd digits -15..15
 	{
-		BIGNUM * zero = BN_new (), * one = BN_new ();
-		BN_zero (zero); BN_one (one);
-		EDDSAPoint res {zero, one};
-		bool carry = false;
-		for (int i = 0; i < 32; i++)
+		for (int i = 0; i < 256; i++)
+			r[i] = 1 & (a[i >> 3] >> (i & 7));
+		for (int i = 0; i < 256; i++)
 		{
-			uint8_t x = e[i];
-			if (carry)
+			if (!r[i]) continue;
+			for (int b = 1; b <= 6 && i + b < 256; b++)
 			{
-				if (x < 255)
+				if (!r[i + b]) continue;
+				if (r[i] + (r[i + b] << b) <= 15)
 				{
-					x++;
-					carry = false;
+					r[i] += r[i + b] << b;
+					r[i + b] = 0;
 				}
-				else
-					x = 0;
-			}
-			if (x > 0)
-			{
-				if (x <= 128)
-					res = Sum (res, Bi256[i][x-1], ctx);
-				else
+				else if (r[i] - (r[i + b] << b) >= -15)
 				{
-					res = Sum (res, -Bi256[i][255-x], ctx); // -Bi[256-x]
-					carry = true;
+					r[i] -= r[i + b] << b;
+					for (int k = i + b; k < 256; k++)
+					{
+						if (!r[k])
+						{
+							r[k] = 1;
+							break;
+						}
+						r[k] = 0;
+					}
 				}
+				else
+					break;
 			}
 		}
-		if (carry) res = Sum (res, Bi256Carry, ctx);
-		return res;
 	}
 
-	EDDSAPoint Ed25519::Normalize (const EDDSAPoint& p, BN_CTX * ctx) const
+	static void OddMultiples (const EDDSAPoint& A, EDDSACachedPoint * Ai, const fe& d2) // Ai[i] = (2*i+1)*A, i = 0..7
 	{
-		if (p.z)
+		EDDSACompletedPoint r;
+		EDDSAPoint A2, u;
+		ToCached (Ai[0], A, d2);
+		Double (r, A); ToExtended (A2, r);
+		for (int i = 1; i < 8; i++)
 		{
-			BIGNUM * x = BN_new (), * y = BN_new ();
-			BN_mod_inverse (y, p.z, q, ctx);
-			BN_mod_mul (x, p.x, y, q, ctx); // x = x/z
-			BN_mod_mul (y, p.y, y, q, ctx); // y = y/z
-			return  EDDSAPoint{x, y};
+			Add (r, A2, Ai[i - 1]); ToExtended (u, r);
+			ToCached (Ai[i], u, d2);
 		}
-		else
-			return EDDSAPoint{BN_dup (p.x), BN_dup (p.y)};
-	}
-
-	bool Ed25519::IsOnCurve (const EDDSAPoint& p, BN_CTX * ctx) const
-	{
-		BN_CTX_start (ctx);
-		BIGNUM * x2 = BN_CTX_get (ctx), * y2 = BN_CTX_get (ctx), * tmp = BN_CTX_get (ctx);
-		BN_sqr (x2, p.x, ctx); // x^2
-		BN_sqr (y2, p.y, ctx); // y^2
-		// y^2 - x^2 - 1 - d*x^2*y^2
-		BN_mul (tmp, d, x2, ctx);
-		BN_mul (tmp, tmp, y2, ctx);
-		BN_sub (tmp, y2, tmp);
-		BN_sub (tmp, tmp, x2);
-		BN_sub_word (tmp, 1);
-		BN_mod (tmp, tmp, q, ctx); // % q
-		bool ret = BN_is_zero (tmp);
-		BN_CTX_end (ctx);
-		return ret;
 	}
 
-	BIGNUM * Ed25519::RecoverX (const BIGNUM * y, BN_CTX * ctx) const
-	{
-		BN_CTX_start (ctx);
-		BIGNUM * y2 = BN_CTX_get (ctx), * xx = BN_CTX_get (ctx);
-		BN_sqr (y2, y, ctx); // y^2
-		// xx = (y^2 -1)*inv(d*y^2 +1)
-		BN_mul (xx, d, y2, ctx);
-		BN_add_word (xx, 1);
-		BN_mod_inverse (xx, xx, q, ctx);
-		BN_sub_word (y2, 1);
-		BN_mul (xx, y2, xx, ctx);
-		// x = srqt(xx) = xx^(2^252-2)
-		BIGNUM * x = BN_new ();
-		BN_mod_exp (x, xx, two_252_2, q, ctx);
-		// check (x^2 -xx) % q
-		BN_sqr (y2, x, ctx);
-		BN_mod_sub (y2, y2, xx, q, ctx);
-		if (!BN_is_zero (y2))
-			BN_mod_mul (x, x, I, q, ctx);
-		if (BN_is_odd (x))
-			BN_sub (x, q, x);
-		BN_CTX_end (ctx);
-		return x;
-	}
-
-	EDDSAPoint Ed25519::DecodePoint (const uint8_t * buf, BN_CTX * ctx) const
-	{
-		// buf is 32 bytes Little Endian, convert it to Big Endian
-		uint8_t buf1[EDDSA25519_PUBLIC_KEY_LENGTH];
-		for (size_t i = 0; i < EDDSA25519_PUBLIC_KEY_LENGTH/2; i++) // invert bytes
-		{
-			buf1[i] = buf[EDDSA25519_PUBLIC_KEY_LENGTH -1 - i];
-			buf1[EDDSA25519_PUBLIC_KEY_LENGTH -1 - i] = buf[i];
+	EDDSAPoint Ed25519::DoubleMulVarTime (const uint8_t * a, const EDDSAPoint& A, const uint8_t * b) const
+	{
+		int8_t aslide[256], bslide[256];
+		Slide (aslide, a);
+		Slide (bslide, b);
+		EDDSACachedPoint Ai[8];
+		OddMultiples (A, Ai, d2);
+
+		EDDSACompletedPoint r;
+		EDDSAPoint u;
+		EDDSAProjectivePoint res; PointZero (res);
+		int i = 255;
+		while (i >= 0 && !aslide[i] && !bslide[i]) i--;
+		for (; i >= 0; i--)
+		{
+			Double (r, res);
+			if (aslide[i])
+			{
+				ToExtended (u, r);
+				Add (r, u, Ai[(aslide[i] > 0 ? aslide[i] : -aslide[i])/2], aslide[i] < 0);
+			}
+			if (bslide[i])
+			{
+				ToExtended (u, r);
+				Add (r, u, BOdd[(bslide[i] > 0 ? bslide[i] : -bslide[i])/2], bslide[i] < 0);
+			}
+			ToProjective (res, r);
 		}
-		bool isHighestBitSet = buf1[0] & 0x80;
-		if (isHighestBitSet)
-			buf1[0] &= 0x7f; // clear highest bit
-		BIGNUM * y = BN_new ();
-		BN_bin2bn (buf1, EDDSA25519_PUBLIC_KEY_LENGTH, y);
-		BIGNUM * x = RecoverX (y, ctx);
-		if (BN_is_bit_set (x, 0) != isHighestBitSet)
-			BN_sub (x, q, x); // x = q - x
-		BIGNUM * z = BN_new (), * t = BN_new ();
-		BN_one (z); BN_mod_mul (t, x, y, q, ctx); // pre-calculate t
-		EDDSAPoint p {x, y, z, t};
-		if (!IsOnCurve (p, ctx))
-			LogPrint (eLogError, "Decoded point is not on 25519");
-		return p;
+		EDDSAPoint ret;
+		FeMul (ret.x, res.x, res.z); FeMul (ret.y, res.y, res.z);
+		FeSq (ret.z, res.z); FeMul (ret.t, res.x, res.y); // extended, x*y = z*t
+		return ret;
 	}
 
-	void Ed25519::EncodePoint (const EDDSAPoint& p, uint8_t * buf) const
+	void Ed25519::VerifyBatch (EDDSAVerification * verifications, size_t num) const
 	{
-		EncodeBN (p.y, buf,EDDSA25519_PUBLIC_KEY_LENGTH);
-		if (BN_is_bit_set (p.x, 0)) // highest bit
-			buf[EDDSA25519_PUBLIC_KEY_LENGTH - 1] |= 0x80; // set highest bit
+		for (size_t i = 0; i < num; i += EDDSA25519_MAX_BATCH_SIZE)
+			VerifyBisect (verifications + i, std::min (num - i, EDDSA25519_MAX_BATCH_SIZE));
 	}
 
-	template<int len>
-	BIGNUM * Ed25519::DecodeBN (const uint8_t * buf) const
+	void Ed25519::VerifyBisect (EDDSAVerification * verifications, size_t num) const
 	{
-		// buf is Little Endian convert it to Big Endian
-		uint8_t buf1[len];
-		for (size_t i = 0; i < len/2; i++) // invert bytes
+		if (num < EDDSA25519_MIN_BATCH_SIZE)
 		{
-			buf1[i] = buf[len -1 - i];
-			buf1[len -1 - i] = buf[i];
+			for (size_t i = 0; i < num; i++)
+				verifications[i].result = Verify (*verifications[i].publicKey, verifications[i].digest, verifications[i].signature);
+		}
+		else if (VerifyCombined (verifications, num))
+		{
+			for (size_t i = 0; i < num; i++)
+				verifications[i].result = true;
+		}
+		else
+		{
+			// at least one is invalid, find it
+			VerifyBisect (verifications, num/2);
+			VerifyBisect (verifications + num/2, num - num/2);
 		}
-		BIGNUM * res = BN_new ();
-		BN_bin2bn (buf1, len, res);
-		return res;
 	}
 
-	void Ed25519::EncodeBN (const BIGNUM * bn, uint8_t * buf, size_t len) const
+	bool Ed25519::VerifyCombined (const EDDSAVerification * verifications, size_t num) const
 	{
-		bn2buf (bn, buf, len);
-		// To Little Endian
-		for (size_t i = 0; i < len/2; i++) // invert bytes
+		// 8*(sum (z_i*S_i)*B - sum (z_i*R_i) - sum (z_i*h_i*A_i)) = 0 for random 128 bits z_i
+		// cofactored with canonical R only, the same as Verify checks one by one
+		// Straus' method, all points share doublings
+		size_t numPoints = 2*num;
+		std::vector<EDDSACachedPoint> multiples (numPoints*8);
+		std::vector<int8_t> slides (numPoints*256);
+		int8_t bslide[256];
+		uint8_t z[32], h[32], zh[32], s[32], zero[32];
+		memset (z, 0, 32); memset (s, 0, 32); memset (zero, 0, 32);
+		EDDSAPoint p;
+		for (size_t i = 0; i < num; i++)
 		{
-			uint8_t tmp = buf[i];
-			buf[i] = buf[len -1 - i];
-			buf[len -1 - i] = tmp;
+			auto& v = verifications[i];
+			if (v.signature[EDDSA25519_SIGNATURE_LENGTH - 1] & 0xE0) return false; // S >= 2^253
+			if (!DecodePoint (v.signature, p) || !IsCanonical (v.signature, p)) return false; // R
+			RAND_bytes (z, 16);
+			// -R_i*z_i
+			FeNeg (p.x, p.x); FeNeg (p.t, p.t);
+			OddMultiples (p, multiples.data () + 2*i*8, d2);
+			Slide (slides.data () + 2*i*256, z);
+			// -A_i*z_i*h_i
+			p = *v.publicKey;
+			FeNeg (p.x, p.x); FeNeg (p.t, p.t);
+			OddMultiples (p, multiples.data () + (2*i + 1)*8, d2);
+			ReduceScalar64 (v.digest, h);
+			MulAddScalar (z, h, zero, zh);
+			Slide (slides.data () + (2*i + 1)*256, zh);
+			// sum (z_i*S_i)
+			MulAddScalar (z, v.signature + EDDSA25519_SIGNATURE_LENGTH/2, s, s);
 		}
-	}
+		Slide (bslide, s);
 
-	BIGNUM * Ed25519::ScalarMul (const BIGNUM * u, const BIGNUM * k, BN_CTX * ctx) const
-	{
-		BN_CTX_start (ctx);
-		auto x1 = BN_CTX_get (ctx); BN_copy (x1, u);
-		auto x2 = BN_CTX_get (ctx); BN_one (x2);
-		auto z2 = BN_CTX_get (ctx); BN_zero (z2);
-		auto x3 = BN_CTX_get (ctx); BN_copy (x3, u);
-		auto z3 = BN_CTX_get (ctx); BN_one (z3);
-		auto c121666 = BN_CTX_get (ctx); BN_set_word (c121666, 121666);
-		auto tmp0 = BN_CTX_get (ctx); auto tmp1 = BN_CTX_get (ctx);
-		unsigned int swap = 0;
-		auto bits = BN_num_bits (k);
-		while(bits)
+		EDDSACompletedPoint r;
+		EDDSAProjectivePoint res; PointZero (res);
+		for (int i = 255; i >= 0; i--)
 		{
-			--bits;
-			auto k_t = BN_is_bit_set(k, bits) ? 1 : 0;
-			swap ^= k_t;
-			if (swap) 
+			Double (r, res);
+			for (size_t j = 0; j < numPoints; j++)
 			{
-				std::swap (x2, x3);
-				std::swap (z2, z3);
+				int8_t d = slides[j*256 + i];
+				if (d)
+				{
+					ToExtended (p, r);
+					Add (r, p, multiples[j*8 + (d > 0 ? d : -d)/2], d < 0);
+				}
 			}
-			swap = k_t;
-			BN_mod_sub(tmp0, x3, z3, q, ctx);
-			BN_mod_sub(tmp1, x2, z2, q, ctx);
-			BN_mod_add(x2, x2, z2, q, ctx);
-			BN_mod_add(z2, x3, z3, q, ctx);
-			BN_mod_mul(z3, tmp0, x2, q, ctx);
-			BN_mod_mul(z2, z2, tmp1, q, ctx);
-			BN_mod_sqr(tmp0, tmp1, q, ctx);
-			BN_mod_sqr(tmp1, x2, q, ctx);
-			BN_mod_add(x3, z3, z2, q, ctx);
-			BN_mod_sub(z2, z3, z2, q, ctx);
-			BN_mod_mul(x2, tmp1, tmp0, q, ctx);
-			BN_mod_sub(tmp1, tmp1, tmp0, q, ctx);
-			BN_mod_sqr(z2, z2, q, ctx);
-			BN_mod_mul(z3, tmp1, c121666, q, ctx);
-			BN_mod_sqr(x3, x3, q, ctx);
-			BN_mod_add(tmp0, tmp0, z3, q, ctx);
-			BN_mod_mul(z3, x1, z2, q, ctx);
-			BN_mod_mul(z2, tmp1, tmp0, q, ctx);
+			if (bslide[i])
+			{
+				ToExtended (p, r);
+				Add (r, p, BOdd[(bslide[i] > 0 ? bslide[i] : -bslide[i])/2], bslide[i] < 0);
+			}
+			ToProjective (res, r);
 		}
-		if (swap) 
+		return IsSmallOrder (r);
+	}
+
+	bool Ed25519::DecodePoint (const uint8_t * buf, EDDSAPoint& p) const
+	{
+		fe u, v, v3, vxx, check;
+		FeFromBytes (p.y, buf);
+		FeOne (p.z);
+		FeSq (u, p.y);
+		FeMul (v, u, d);
+		FeSub (u, u, p.z); // u = y^2 - 1
+		FeAdd (v, v, p.z); // v = d*y^2 + 1
+		// x = u*v^3*(u*v^7)^((p-5)/8)
+		FeSq (v3, v); FeMul (v3, v3, v); // v^3
+		FeSq (p.x, v3); FeMul (p.x, p.x, v); FeMul (p.x, p.x, u); // u*v^7
+		FePow2523 (p.x, p.x);
+		FeMul (p.x, p.x, v3); FeMul (p.x, p.x, u);
+
+		bool ret = true;
+		FeSq (vxx, p.x); FeMul (vxx, vxx, v);
+		FeSub (check, vxx, u);
+		if (!FeIsZero (check))
 		{
-			std::swap (x2, x3);
-			std::swap (z2, z3);
+			FeAdd (check, vxx, u);
+			if (!FeIsZero (check)) ret = false;
+			FeMul (p.x, p.x, I);
 		}
-		BN_mod_inverse (z2, z2, q, ctx);
-		BIGNUM * res =  BN_new (); // not from ctx
-		BN_mod_mul(res, x2, z2, q, ctx);
-		BN_CTX_end (ctx);
-		return res;
+		if (FeIsNegative (p.x) != (bool)(buf[31] >> 7))
+			FeNeg (p.x, p.x);
+		FeMul (p.t, p.x, p.y);
+		return ret;
+	}
+
+	bool Ed25519::IsCanonical (const uint8_t * buf, const EDDSAPoint& p) const
+	{
+		// Verify compares encoded R, so y must be less than 2^255 - 19 and -0 is not allowed
+		if (FeIsZero (p.x) && (buf[31] & 0x80)) return false;
+		if ((buf[31] & 0x7F) != 0x7F) return true;
+		for (int i = 30; i > 0; i--)
+			if (buf[i] != 0xFF) return true;
+		return buf[0] < 0xED;
+	}
+
+	void Ed25519::EncodePoint (const EDDSAPoint& p, uint8_t * buf) const
+	{
+		fe recip, x, y;
+		FeInvert (recip, p.z);
+		FeMul (x, p.x, recip);
+		FeMul (y, p.y, recip);
+		FeToBytes (buf, y);
+		if (FeIsNegative (x)) // highest bit
+			buf[EDDSA25519_PUBLIC_KEY_LENGTH - 1] |= 0x80; // set highest bit
+	}
+
+	void Ed25519::ToPrecomputed (const EDDSAPoint& p, EDDSAPrecomputedPoint& pre) const
+	{
+		fe recip, x, y;
+		FeInvert (recip, p.z);
+		FeMul (x, p.x, recip);
+		FeMul (y, p.y, recip);
+		FeAdd (pre.yplusx, y, x);
+		FeSub (pre.yminusx, y, x);
+		FeMul (pre.xy2d, x, y);
+		FeMul (pre.xy2d, pre.xy2d, d2);
 	}
 
-	void Ed25519::ScalarMul (const uint8_t * p, const  uint8_t * e, uint8_t * buf, BN_CTX * ctx) const
+	void Ed25519::ScalarMul (const uint8_t * p, const  uint8_t * e, uint8_t * buf) const
 	{
-		BIGNUM * p1 = DecodeBN<32> (p);
 		uint8_t k[32];
 		memcpy (k, e, 32);
 		k[0] &= 248; k[31] &= 127; k[31] |= 64;
-		BIGNUM * n = DecodeBN<32> (k);
-		BIGNUM * q1 = ScalarMul (p1, n, ctx);
-		EncodeBN (q1, buf, 32);
-		BN_free (p1); BN_free (n); BN_free (q1);
+		// Montgomery ladder, RFC 7748
+		fe x1, x2, z2, x3, z3, a, aa, b, bb, c, dd, e1, da, cb;
+		FeFromBytes (x1, p);
+		FeOne (x2); FeZero (z2);
+		x3 = x1; FeOne (z3);
+		uint64_t swap = 0;
+		for (int t = 254; t >= 0; t--)
+		{
+			uint64_t k_t = (k[t >> 3] >> (t & 7)) & 1;
+			swap ^= k_t;
+			FeCSwap (x2, x3, swap);
+			FeCSwap (z2, z3, swap);
+			swap = k_t;
+			FeAdd (a, x2, z2); FeSq (aa, a);
+			FeSub (b, x2, z2); FeSq (bb, b);
+			FeSub (e1, aa, bb);
+			FeAdd (c, x3, z3);
+			FeSub (dd, x3, z3);
+			FeMul (da, dd, a);
+			FeMul (cb, c, b);
+			FeAdd (x3, da, cb); FeSq (x3, x3);
+			FeSub (z3, da, cb); FeSq (z3, z3); FeMul (z3, z3, x1);
+			FeMul (x2, aa, bb);
+			FeMulSmall (z2, e1, 121665); FeAdd (z2, z2, aa); FeMul (z2, z2, e1);
+		}
+		FeCSwap (x2, x3, swap);
+		FeCSwap (z2, z3, swap);
+		FeInvert (z2, z2);
+		FeMul (x2, x2, z2);
+		FeToBytes (buf, x2);
 	}
 
-	void Ed25519::ScalarMulB (const  uint8_t * e, uint8_t * buf, BN_CTX * ctx) const
+	void Ed25519::ScalarMulB (const  uint8_t * e, uint8_t * buf) const
 	{
-		BIGNUM *p1 = BN_new (); BN_set_word (p1, 9);
 		uint8_t k[32];
 		memcpy (k, e, 32);
 		k[0] &= 248; k[31] &= 127; k[31] |= 64;
-		BIGNUM * n = DecodeBN<32> (k);
-		BIGNUM * q1 = ScalarMul (p1, n, ctx);
-		EncodeBN (q1, buf, 32);
-		BN_free (p1); BN_free (n); BN_free (q1);
+		// B*k on Edwards curve, then u = (1 + y)/(1 - y) = (z + y)/(z - y)
+		auto p = MulB (k);
+		fe n, dn;
+		FeAdd (n, p.z, p.y);
+		FeSub (dn, p.z, p.y);
+		FeInvert (dn, dn);
+		FeMul (n, n, dn);
+		FeToBytes (buf, n);
 	}
 
 	void Ed25519::ExpandPrivateKey (const uint8_t * key, uint8_t * expandedKey)
@@ -512,4 +941,3 @@ namespace crypto
 	}
 }
 }
-
@@ -1,118 +1,79 @@
 #ifndef ED25519_H__
 #define ED25519_H__
 
+#include <inttypes.h>
 #include <memory>
-#include <openssl/bn.h>
 
 namespace i2p
 {
 namespace crypto
 {
+	struct EDDSAFieldElement // GF(2^255-19), five 51-bit limbs
+	{
+		uint64_t v[5];
+	};
+
 	struct EDDSAPoint
 	{
-		BIGNUM * x {nullptr};
-		BIGNUM * y {nullptr};
-		BIGNUM * z {nullptr};
-		BIGNUM * t {nullptr}; // projective coordinates
-
-		EDDSAPoint () {}
-		EDDSAPoint (const EDDSAPoint& other)   { *this = other; }
-		EDDSAPoint (EDDSAPoint&& other)        { *this = std::move (other); }
-		EDDSAPoint (BIGNUM * x1, BIGNUM * y1, BIGNUM * z1 = nullptr, BIGNUM * t1 = nullptr)
-			: x(x1)
-			, y(y1)
-			, z(z1)
-			, t(t1)
-		{}
-		~EDDSAPoint () { BN_free (x); BN_free (y); BN_free(z); BN_free(t); }
-
-		EDDSAPoint& operator=(EDDSAPoint&& other)
-		{
-			if (this != &other)
-			{
-				BN_free (x); x = other.x; other.x = nullptr;
-				BN_free (y); y = other.y; other.y = nullptr;
-				BN_free (z); z = other.z; other.z = nullptr;
-				BN_free (t); t = other.t; other.t = nullptr;
-			}
-			return *this;
-		}
-
-		EDDSAPoint& operator=(const EDDSAPoint& other)
-		{
-			if (this != &other)
-			{
-				BN_free (x); x = other.x ? BN_dup (other.x) : nullptr;
-				BN_free (y); y = other.y ? BN_dup (other.y) : nullptr;
-				BN_free (z); z = other.z ? BN_dup (other.z) : nullptr;
-				BN_free (t); t = other.t ? BN_dup (other.t) : nullptr;
-			}
-			return *this;
-		}
-
-		EDDSAPoint operator-() const
-		{
-			BIGNUM * x1 = NULL, * y1 = NULL, * z1 = NULL, * t1 = NULL;
-			if (x) { x1 = BN_dup (x); BN_set_negative (x1, !BN_is_negative (x)); };
-			if (y) y1 = BN_dup (y);
-			if (z) z1 = BN_dup (z);
-			if (t) { t1 = BN_dup (t); BN_set_negative (t1, !BN_is_negative (t)); };
-			return EDDSAPoint {x1, y1, z1, t1};
-		}
+		EDDSAFieldElement x, y, z, t; // extended coordinates, x/z, y/z, t = x*y/z
+	};
+
+	struct EDDSAPrecomputedPoint
+	{
+		EDDSAFieldElement yplusx, yminusx, xy2d; // affine, y+x, y-x, 2*d*x*y
 	};
 
 	const size_t EDDSA25519_PUBLIC_KEY_LENGTH = 32;
 	const size_t EDDSA25519_SIGNATURE_LENGTH = 64;
 	const size_t EDDSA25519_PRIVATE_KEY_LENGTH = 32;
+	const size_t EDDSA25519_MIN_BATCH_SIZE = 4; // smaller batches are verified one by one
+	const size_t EDDSA25519_MAX_BATCH_SIZE = 64; // signatures per multi-scalar multiplication
+
+	struct EDDSAVerification
+	{
+		const EDDSAPoint * publicKey;
+		uint8_t digest[64]; // SHA512(R, A, M)
+		uint8_t signature[EDDSA25519_SIGNATURE_LENGTH]; // R, S
+		bool result;
+	};
+
 	class Ed25519
 	{
 		public:
 
 			Ed25519 ();
-			Ed25519 (const Ed25519& other);
-			~Ed25519 ();
 
-			EDDSAPoint GeneratePublicKey (const uint8_t * expandedPrivateKey, BN_CTX * ctx) const;
-			EDDSAPoint DecodePublicKey (const uint8_t * buf, BN_CTX * ctx) const;
-			void EncodePublicKey (const EDDSAPoint& publicKey, uint8_t * buf, BN_CTX * ctx) const;
-			void ScalarMul (const uint8_t * p, const  uint8_t * e, uint8_t * buf, BN_CTX * ctx) const; // p is point, e is number for x25519
-			void ScalarMulB (const  uint8_t * e, uint8_t * buf, BN_CTX * ctx) const;
+			EDDSAPoint GeneratePublicKey (const uint8_t * expandedPrivateKey) const;
+			EDDSAPoint DecodePublicKey (const uint8_t * buf) const;
+			void EncodePublicKey (const EDDSAPoint& publicKey, uint8_t * buf) const;
+			void ScalarMul (const uint8_t * p, const  uint8_t * e, uint8_t * buf) const; // p is point, e is number for x25519
+			void ScalarMulB (const  uint8_t * e, uint8_t * buf) const;
 
-			bool Verify (const EDDSAPoint& publicKey, const uint8_t * digest, const uint8_t * signature) const;
+			bool Verify (const EDDSAPoint& publicKey, const uint8_t * digest, const uint8_t * signature) const; // cofactored, canonical R
+			void VerifyBatch (EDDSAVerification * verifications, size_t num) const; // sets result of every verification
 			void Sign (const uint8_t * expandedPrivateKey, const uint8_t * publicKeyEncoded, const uint8_t * buf, size_t len, uint8_t * signature) const;
 
 			static void ExpandPrivateKey (const uint8_t * key, uint8_t * expandedKey); // key - 32 bytes, expandedKey - 64 bytes
 
 		private:
 
-			EDDSAPoint Sum (const EDDSAPoint& p1, const EDDSAPoint& p2, BN_CTX * ctx) const;
-			void Double (EDDSAPoint& p, BN_CTX * ctx) const;
-			EDDSAPoint Mul (const EDDSAPoint& p, const BIGNUM * e, BN_CTX * ctx) const;
-			EDDSAPoint MulB (const uint8_t * e, BN_CTX * ctx) const; // B*e, e is 32 bytes Little Endian
-			EDDSAPoint Normalize (const EDDSAPoint& p, BN_CTX * ctx) const;
-			
-			bool IsOnCurve (const EDDSAPoint& p, BN_CTX * ctx) const;	
-			BIGNUM * RecoverX (const BIGNUM * y, BN_CTX * ctx) const;
-			EDDSAPoint DecodePoint (const uint8_t * buf, BN_CTX * ctx) const;
-			void EncodePoint (const EDDSAPoint& p, uint8_t * buf) const;
+			EDDSAPoint MulB (const uint8_t * e) const; // B*e, e is 32 bytes Little Endian, e[31] <= 127, constant time
+			EDDSAPoint DoubleMulVarTime (const uint8_t * a, const EDDSAPoint& A, const uint8_t * b) const; // a*A + b*B
+			bool VerifyCombined (const EDDSAVerification * verifications, size_t num) const; // random linear combination is zero
+			void VerifyBisect (EDDSAVerification * verifications, size_t num) const;
+			void SelectB (EDDSAPrecomputedPoint& p, int pos, int8_t b) const; // b*(256^pos)*B, constant time
 
-			template<int len>
-			BIGNUM * DecodeBN (const uint8_t * buf) const;
-			void EncodeBN (const BIGNUM * bn, uint8_t * buf, size_t len) const;
-
-			// for x25519
-			BIGNUM * ScalarMul (const BIGNUM * p, const BIGNUM * e, BN_CTX * ctx) const; 
+			bool DecodePoint (const uint8_t * buf, EDDSAPoint& p) const;
+			bool IsCanonical (const uint8_t * buf, const EDDSAPoint& p) const; // encoding of decoded p is buf
+			void EncodePoint (const EDDSAPoint& p, uint8_t * buf) const;
+			void ToPrecomputed (const EDDSAPoint& p, EDDSAPrecomputedPoint& pre) const;
 
 		private:
 
-			BIGNUM * q, * l, * d, * I;
-			// transient values
-			BIGNUM * two_252_2; // 2^252-2
-			EDDSAPoint Bi256[32][128]; // per byte, Bi256[i][j] = (256+j+1)^i*B, we don't store zeroes
-			// if j > 128 we use 256 - j and carry 1 to next byte
-			// Bi256[0][0] = B, base point
-			EDDSAPoint Bi256Carry; // Bi256[32][0]
-	};		
+			EDDSAFieldElement d, d2, I; // d, 2*d, sqrt(-1)
+			EDDSAPrecomputedPoint Bi16[32][8]; // Bi16[i][j] = (j+1)*256^i*B for signed radix 16
+			EDDSAPrecomputedPoint BOdd[8]; // BOdd[j] = (2*j+1)*B for sliding window
+	};
 
 	std::unique_ptr<Ed25519>& GetEd25519 ();
 
@@ -183,6 +183,20 @@ namespace fs {
     boost::filesystem::remove(path);
   }
 
+  uint32_t HashedStorage::GetLastUpdateTime() const {
+    uint32_t lastUpdateTime = 0;
+    boost::system::error_code ec;
+    boost::filesystem::directory_iterator it(root, ec), end;
+    for ( ; !ec && it != end; it.increment(ec)) {
+      if (!boost::filesystem::is_directory(it->status()))
+        continue;
+      auto t = boost::filesystem::last_write_time(it->path(), ec);
+      if (!ec && (uint32_t)t > lastUpdateTime)
+        lastUpdateTime = t;
+    }
+    return lastUpdateTime;
+  }
+
   void HashedStorage::Traverse(std::vector<std::string> & files) {
     Iterate([&files] (const std::string & fname) {
         files.push_back(fname);
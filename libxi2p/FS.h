@@ -62,6 +62,8 @@ namespace fs {
       void Traverse(std::vector<std::string> & files);
       /** visit every file in this storage with a visitor */
       void Iterate(FilenameVisitor v);
+      /** latest modification time of hashed directories, changes when file is added or removed */
+      uint32_t GetLastUpdateTime() const;
   };
 
   /** @brief Returns current application name, default 'i2pd' */
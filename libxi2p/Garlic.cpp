@@ -392,7 +392,8 @@ namespace garlic
 		return size;
 	}
 
-	GarlicDestination::GarlicDestination (): m_NumTags (32) // 32 tags by default
+	GarlicDestination::GarlicDestination (): m_NumTags (32), // 32 tags by default
+		m_Tags (INCOMING_TAGS_EXPIRATION_TIMEOUT)
 	{
 		m_Ctx = BN_CTX_new ();
 	}
@@ -406,14 +407,14 @@ namespace garlic
 	{
 		m_Sessions.clear ();
 		m_DeliveryStatusSessions.clear ();
-		m_Tags.clear ();
+		m_Tags.Clear ();
 	}
 	void GarlicDestination::AddSessionKey (const uint8_t * key, const uint8_t * tag)
 	{
 		if (key)
 		{
 			uint32_t ts = i2p::util::GetSecondsSinceEpoch ();
-			m_Tags[SessionTag(tag, ts)] = std::make_shared<AESDecryption>(key);
+			m_Tags.Insert (tag, 1, std::make_shared<AESDecryption>(key), ts);
 		}
 	}
 
@@ -433,12 +434,10 @@ namespace garlic
 			return;
 		}
 		buf += 4; // length
-		auto it = m_Tags.find (SessionTag(buf));
-		if (it != m_Tags.end ())
+		auto decryption = m_Tags.Take (buf); // tag might be used only once
+		if (decryption)
 		{
 			// tag found. Use AES
-			auto decryption = it->second;
-			m_Tags.erase (it); // tag might be used only once
 			if (length >= 32)
 			{
 				uint8_t iv[32]; // IV is first 16 bytes
@@ -480,9 +479,7 @@ namespace garlic
 				LogPrint (eLogError, "Garlic: Tag count ", tagCount, " exceeds length ", len);
 				return ;
 			}
-			uint32_t ts = i2p::util::GetSecondsSinceEpoch ();
-			for (int i = 0; i < tagCount; i++)
-				m_Tags[SessionTag(buf + i*32, ts)] = decryption;
+			m_Tags.Insert (buf, tagCount, decryption, i2p::util::GetSecondsSinceEpoch ());
 		}
 		buf += tagCount*32;
 		len -= tagCount*32;
@@ -659,17 +656,7 @@ namespace garlic
 	{
 		// incoming
 		uint32_t ts = i2p::util::GetSecondsSinceEpoch ();
-		int numExpiredTags = 0;
-		for (auto it = m_Tags.begin (); it != m_Tags.end ();)
-		{
-			if (ts > it->first.creationTime + INCOMING_TAGS_EXPIRATION_TIMEOUT)
-			{
-				numExpiredTags++;
-				it = m_Tags.erase (it);
-			}
-			else
-				++it;
-		}
+		int numExpiredTags = m_Tags.Expire (ts);
 		if (numExpiredTags > 0)
 			LogPrint (eLogDebug, "Garlic: ", numExpiredTags, " tags expired for ", GetIdentHash().ToBase64 ());
 
@@ -753,21 +740,21 @@ namespace garlic
 
 	void GarlicDestination::SaveTags ()
 	{
-		if (m_Tags.empty ()) return;
+		if (m_Tags.IsEmpty ()) return;
 		std::string ident = GetIdentHash().ToBase32();
 		std::string path  = i2p::fs::DataDirPath("tags", (ident + ".tags"));
 		std::ofstream f (path, std::ofstream::binary | std::ofstream::out | std::ofstream::trunc);
 		uint32_t ts = i2p::util::GetSecondsSinceEpoch ();
 		// 4 bytes timestamp, 32 bytes tag, 32 bytes key
-		for (auto it: m_Tags)
-		{
-			if (ts < it.first.creationTime + INCOMING_TAGS_EXPIRATION_TIMEOUT)
+		m_Tags.Visit ([&f, ts](const uint8_t * tag, uint32_t creationTime, const std::shared_ptr<AESDecryption>& decryption)
 			{
-				f.write ((char *)&it.first.creationTime, 4);
-				f.write ((char *)it.first.data (), 32);
-				f.write ((char *)it.second->GetKey ().data (), 32);
-			}
-		}
+				if (ts < creationTime + INCOMING_TAGS_EXPIRATION_TIMEOUT)
+				{
+					f.write ((char *)&creationTime, 4);
+					f.write ((char *)tag, 32);
+					f.write ((char *)decryption->GetKey ().data (), 32);
+				}
+			});
 	}
 
 	void GarlicDestination::LoadTags ()
@@ -781,7 +768,7 @@ namespace garlic
 			std::ifstream f (path, std::ifstream::binary);
 			if (f)
 			{
-				std::map<i2p::crypto::AESKey, std::shared_ptr<AESDecryption> > keys;
+				std::map<i2p::crypto::AESKey, std::vector<SessionTag> > keys; // tags of same key share decryption
 				// 4 bytes timestamp, 32 bytes tag, 32 bytes key
 				while (!f.eof ())
 				{
@@ -794,19 +781,21 @@ namespace garlic
 						f.read ((char *)key, 32);
 					}
 					else
+					{
 						f.seekg (64, std::ios::cur); // skip
+						continue;
+					}
 					if (f.eof ()) break;
-
-					std::shared_ptr<AESDecryption> decryption;
-					auto it = keys.find (key);
-					if (it != keys.end ())
-						decryption = it->second;
-					else
-						decryption = std::make_shared<AESDecryption>(key);
-					m_Tags.insert (std::make_pair (SessionTag (tag, ts), decryption));
+					keys[key].push_back (SessionTag (tag, t));
+				}
+				for (auto& it: keys)
+				{
+					auto decryption = std::make_shared<AESDecryption>(it.first);
+					for (auto& tag: it.second)
+						m_Tags.Insert (tag, 1, decryption, tag.creationTime);
 				}
-				if (!m_Tags.empty ())
-					LogPrint (eLogInfo, m_Tags.size (), " loaded for ", ident);
+				if (!m_Tags.IsEmpty ())
+					LogPrint (eLogInfo, m_Tags.GetSize (), " loaded for ", ident);
 			}
 		}
 		i2p::fs::Remove (path);
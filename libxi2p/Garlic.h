@@ -13,6 +13,7 @@
 #include "LeaseSet.h"
 #include "Queue.h"
 #include "Identity.h"
+#include "TagsTable.h"
 
 namespace i2p
 {
@@ -214,7 +215,7 @@ namespace garlic
 			std::mutex m_SessionsMutex;
 			std::map<i2p::data::IdentHash, GarlicRoutingSessionPtr> m_Sessions;
 			// incoming
-			std::map<SessionTag, std::shared_ptr<AESDecryption> > m_Tags;
+			TagsTable<AESDecryption> m_Tags;
 			// DeliveryStatus
 			std::mutex m_DeliveryStatusSessionsMutex;
 			std::map<uint32_t, GarlicRoutingSessionPtr> m_DeliveryStatusSessions; // msgID -> session
@@ -222,7 +223,7 @@ namespace garlic
 		public:
 
 			// for HTTP only
-			size_t GetNumIncomingTags () const { return m_Tags.size (); }
+			size_t GetNumIncomingTags () const { return m_Tags.GetSize (); }
 			const decltype(m_Sessions)& GetSessions () const { return m_Sessions; };
 	};
 
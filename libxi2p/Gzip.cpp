@@ -8,8 +8,10 @@
 
 #include <inttypes.h>
 #include <string.h> /* memset */
+#include <algorithm>
 #include <iostream>
 #include "Log.h"
+#include "I2PEndian.h"
 #include "Gzip.h"
 
 namespace i2p
@@ -17,6 +19,10 @@ namespace i2p
 namespace data
 {
 	const size_t GZIP_CHUNK_SIZE = 16384;
+	const size_t GZIP_HEADER_SIZE = 10;
+	const size_t GZIP_TRAILER_SIZE = 8; // CRC32 and size
+	const size_t DEFLATE_STORED_BLOCK_HEADER_SIZE = 5;
+	const size_t DEFLATE_MAX_STORED_BLOCK_SIZE = 65535;
 
 	GzipInflator::GzipInflator (): m_IsDirty (false)
 	{
@@ -80,7 +86,7 @@ namespace data
 		delete[] buf;
 	}
 
-	GzipDeflator::GzipDeflator (): m_IsDirty (false)
+	GzipDeflator::GzipDeflator (): m_IsDirty (false), m_CompressionLevel (Z_DEFAULT_COMPRESSION)
 	{
 		memset (&m_Deflator, 0, sizeof (m_Deflator));
 		deflateInit2 (&m_Deflator, Z_DEFAULT_COMPRESSION, Z_DEFLATED, 15 + 16, 8, Z_DEFAULT_STRATEGY); // 15 + 16 sets gzip
@@ -94,6 +100,7 @@ namespace data
 	void GzipDeflator::SetCompressionLevel (int level)
 	{
 		deflateParams (&m_Deflator, level, Z_DEFAULT_STRATEGY);
+		m_CompressionLevel = level;
 	}
 
 	size_t GzipDeflator::Deflate (const uint8_t * in, size_t inLen, uint8_t * out, size_t outLen)
@@ -111,5 +118,68 @@ namespace data
 		LogPrint (eLogError, "Gzip: Deflate error ", err);
 		return 0;
 	}
+
+	size_t GzipDeflator::Deflate (const std::vector<std::pair<const uint8_t *, size_t> >& in, uint8_t * out, size_t outLen)
+	{
+		if (m_CompressionLevel == Z_NO_COMPRESSION)
+			return Store (in, out, outLen); // zlib would copy through its window
+		if (m_IsDirty) deflateReset (&m_Deflator);
+		m_IsDirty = true;
+		m_Deflator.next_out = out;
+		m_Deflator.avail_out = outLen;
+		int err = Z_OK;
+		for (size_t i = 0; i < in.size () || !i; i++)
+		{
+			bool isLast = i + 1 >= in.size ();
+			if (!isLast && !in[i].second) continue; // no progress is an error for zlib
+			m_Deflator.next_in = i < in.size () ? const_cast<uint8_t *>(in[i].first) : nullptr;
+			m_Deflator.avail_in = i < in.size () ? in[i].second : 0;
+			err = deflate (&m_Deflator, isLast ? Z_FINISH : Z_NO_FLUSH);
+			if (err != Z_OK || m_Deflator.avail_in) break;
+		}
+		if (err == Z_STREAM_END)
+			return outLen - m_Deflator.avail_out;
+		// else
+		LogPrint (eLogError, "Gzip: Deflate error ", err);
+		return 0;
+	}
+
+	size_t GzipDeflator::Store (const std::vector<std::pair<const uint8_t *, size_t> >& in, uint8_t * out, size_t outLen)
+	{
+		size_t len = 0;
+		for (const auto& it: in) len += it.second;
+		size_t numBlocks = len ? (len + DEFLATE_MAX_STORED_BLOCK_SIZE - 1)/DEFLATE_MAX_STORED_BLOCK_SIZE : 1;
+		size_t size = GZIP_HEADER_SIZE + numBlocks*DEFLATE_STORED_BLOCK_HEADER_SIZE + len + GZIP_TRAILER_SIZE;
+		if (size > outLen)
+		{
+			LogPrint (eLogError, "Gzip: Output buffer is too small for ", len, " bytes");
+			return 0;
+		}
+		static const uint8_t header[GZIP_HEADER_SIZE] = { 0x1F, 0x8B, Z_DEFLATED, 0, 0, 0, 0, 0, 0, 0xFF };
+		memcpy (out, header, GZIP_HEADER_SIZE);
+		uint8_t * p = out + GZIP_HEADER_SIZE;
+		uLong crc = crc32 (0, Z_NULL, 0);
+		size_t ind = 0, offset = 0; // in in
+		for (size_t remaining = len; numBlocks > 0; numBlocks--)
+		{
+			uint16_t blockLen = std::min (remaining, DEFLATE_MAX_STORED_BLOCK_SIZE);
+			remaining -= blockLen;
+			*p = (numBlocks == 1) ? 1 : 0; // BFINAL, BTYPE = 00
+			htole16buf (p + 1, blockLen);
+			htole16buf (p + 3, (uint16_t)~blockLen);
+			p += DEFLATE_STORED_BLOCK_HEADER_SIZE;
+			while (blockLen > 0)
+			{
+				size_t l = std::min ((size_t)blockLen, in[ind].second - offset);
+				memcpy (p, in[ind].first + offset, l);
+				crc = crc32 (crc, p, l);
+				p += l; offset += l; blockLen -= l;
+				if (offset >= in[ind].second) { ind++; offset = 0; }
+			}
+		}
+		htole32buf (p, crc);
+		htole32buf (p + 4, len);
+		return size;
+	}
 } // data
 } // i2p
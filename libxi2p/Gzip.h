@@ -2,6 +2,7 @@
 #define GZIP_H__
 
 #include <zlib.h>
+#include <vector>
 
 namespace i2p {
 namespace data {
@@ -32,11 +33,18 @@ namespace data {
 
 			void SetCompressionLevel (int level);
 			size_t Deflate (const uint8_t * in, size_t inLen, uint8_t * out, size_t outLen);
+			/** gathers @a in, copied once to stored blocks without compression */
+			size_t Deflate (const std::vector<std::pair<const uint8_t *, size_t> >& in, uint8_t * out, size_t outLen);
+
+		private:
+
+			size_t Store (const std::vector<std::pair<const uint8_t *, size_t> >& in, uint8_t * out, size_t outLen);
 
 		private:
 
 			z_stream m_Deflator;
 			bool m_IsDirty;
+			int m_CompressionLevel;
 	};
 } // data
 } // i2p
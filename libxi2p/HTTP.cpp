@@ -431,6 +431,107 @@ namespace http {
     return ss.str();
   }
 
+	bool IsHeaderName (const std::string& header, const char * name)
+	{
+		size_t len = strlen (name);
+		if (header.length () != len) return false;
+		for (size_t i = 0; i < len; i++)
+			if (tolower (header[i]) != tolower (name[i])) return false;
+		return true;
+	}
+
+	void HTTPBodyTracker::SetLength (uint64_t length)
+	{
+		m_IsChunked = false;
+		m_Remaining = length;
+		m_State = length > 0 ? eData : eComplete;
+	}
+
+	void HTTPBodyTracker::SetChunked ()
+	{
+		m_IsChunked = true;
+		m_Remaining = 0;
+		m_NumDigits = 0;
+		m_State = eChunkSize;
+	}
+
+	size_t HTTPBodyTracker::Consume (const uint8_t * buf, size_t len)
+	{
+		size_t offset = 0;
+		while (offset < len)
+		{
+			switch (m_State)
+			{
+				case eComplete:
+					return offset;
+				case eUntilClose:
+					return len;
+				case eData:
+				{
+					size_t l = len - offset;
+					if (l > m_Remaining) l = m_Remaining;
+					offset += l; m_Remaining -= l;
+					if (!m_Remaining) m_State = m_IsChunked ? eChunkEnd : eComplete;
+					break;
+				}
+				case eChunkSize:
+				{
+					char c = buf[offset++];
+					int digit = -1;
+					if (c >= '0' && c <= '9') digit = c - '0';
+					else if (c >= 'a' && c <= 'f') digit = c - 'a' + 10;
+					else if (c >= 'A' && c <= 'F') digit = c - 'A' + 10;
+					if (digit >= 0)
+					{
+						if (++m_NumDigits > 15) { m_State = eUntilClose; break; } // too long
+						m_Remaining = (m_Remaining << 4) | digit;
+					}
+					else if (!m_NumDigits)
+						m_State = eUntilClose; // size is expected
+					else if (c == '\n')
+					{
+						m_NumDigits = 0;
+						if (m_Remaining) m_State = eData;
+						else { m_LineLength = 0; m_State = eTrailer; } // last chunk
+					}
+					else if (c == ';' || c == ' ' || c == '\t' || c == '\r')
+						m_State = eChunkExtension;
+					else
+						m_State = eUntilClose;
+					break;
+				}
+				case eChunkExtension:
+					if (buf[offset++] == '\n')
+					{
+						m_NumDigits = 0;
+						if (m_Remaining) m_State = eData;
+						else { m_LineLength = 0; m_State = eTrailer; }
+					}
+					break;
+				case eChunkEnd:
+				{
+					char c = buf[offset++];
+					if (c == '\n') m_State = eChunkSize;
+					else if (c != '\r') m_State = eUntilClose;
+					break;
+				}
+				case eTrailer:
+				{
+					char c = buf[offset++];
+					if (c == '\n')
+					{
+						if (!m_LineLength) m_State = eComplete; // empty line
+						m_LineLength = 0;
+					}
+					else if (c != '\r')
+						m_LineLength++;
+					break;
+				}
+			}
+		}
+		return offset;
+	}
+
   const char * HTTPCodeToStatus(int code) {
     const char *ptr;
     switch (code) {
@@ -10,6 +10,7 @@
 #define HTTP_H__
 
 #include <cstring>
+#include <inttypes.h>
 #include <map>
 #include <list>
 #include <sstream>
@@ -144,6 +145,56 @@ namespace http
     bool is_gzipped(bool includingI2PGzip = true) const;
   };
 
+  /** @brief Case insensitive comparison of header name */
+  bool IsHeaderName (const std::string& header, const char * name);
+
+  /** @brief Returns value of header, case insensitive, empty string if not found */
+  template<typename Headers>
+  std::string FindHeader (const Headers& headers, const char * name)
+  {
+    for (const auto& it: headers)
+      if (IsHeaderName (it.first, name)) return it.second;
+    return "";
+  }
+
+  /**
+   * @brief Finds where message body ends in data as it arrives, to reuse connection for next message
+   * @note Body is framed by Content-Length or chunked Transfer-Encoding, otherwise it lasts until close
+   */
+	class HTTPBodyTracker
+	{
+		public:
+
+			HTTPBodyTracker (): m_State (eComplete), m_IsChunked (false), m_Remaining (0), m_NumDigits (0), m_LineLength (0) {};
+
+			void SetLength (uint64_t length);
+			void SetChunked ();
+			void SetUntilClose () { m_State = eUntilClose; };
+
+			/** @return number of bytes from @a buf which belong to body, less than @a len if body is complete */
+			size_t Consume (const uint8_t * buf, size_t len);
+			bool IsComplete () const { return m_State == eComplete; };
+			bool IsUntilClose () const { return m_State == eUntilClose; }; // also if chunks are malformed
+
+		private:
+
+			enum State
+			{
+				eData = 0,
+				eChunkSize,
+				eChunkExtension,
+				eChunkEnd, // CRLF after chunk data
+				eTrailer,
+				eComplete,
+				eUntilClose
+			};
+
+			State m_State;
+			bool m_IsChunked;
+			uint64_t m_Remaining; // of current chunk or whole body
+			int m_NumDigits, m_LineLength;
+	};
+
   /**
    * @brief returns HTTP status string by integer code
    * @param code HTTP code [100, 599]
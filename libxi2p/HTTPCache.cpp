@@ -0,0 +1,255 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <algorithm>
+#include "HTTPCache.h"
+
+namespace i2p
+{
+namespace http
+{
+	int64_t ParseHTTPDate (const std::string& date)
+	{
+		static const char * months[] = { "Jan", "Feb", "Mar", "Apr", "May", "Jun", "Jul", "Aug", "Sep", "Oct", "Nov", "Dec" };
+		char month[4];
+		int day, year, hour, minute, second;
+		if (sscanf (date.c_str (), "%*[a-zA-Z], %d %3s %d %d:%d:%d GMT", &day, month, &year, &hour, &minute, &second) != 6)
+			return -1;
+		int mon = 0;
+		while (mon < 12 && strcmp (month, months[mon])) mon++;
+		if (mon >= 12 || day < 1 || day > 31 || year < 1970 || hour > 23 || minute > 59 || second > 60)
+			return -1;
+		// days since epoch of civil date
+		mon++;
+		int y = year - (mon <= 2);
+		int era = y/400, yoe = y - era*400;
+		int doy = (153*(mon + (mon > 2 ? -3 : 9)) + 2)/5 + day - 1;
+		int64_t days = (int64_t)era*146097 + yoe*365 + yoe/4 - yoe/100 + doy - 719468;
+		return days*86400 + hour*3600 + minute*60 + second;
+	}
+
+	static std::map<std::string, std::string> ParseCacheControl (const std::string& value)
+	{
+		std::map<std::string, std::string> directives;
+		size_t pos = 0;
+		while (pos < value.length ())
+		{
+			auto comma = value.find (',', pos);
+			if (comma == std::string::npos) comma = value.length ();
+			auto directive = value.substr (pos, comma - pos);
+			pos = comma + 1;
+			directive.erase (std::remove_if (directive.begin (), directive.end (), ::isspace), directive.end ());
+			if (directive.empty ()) continue;
+			auto eq = directive.find ('=');
+			auto name = directive.substr (0, eq);
+			std::transform (name.begin (), name.end (), name.begin (), ::tolower);
+			std::string v;
+			if (eq != std::string::npos)
+			{
+				v = directive.substr (eq + 1);
+				v.erase (std::remove (v.begin (), v.end (), '"'), v.end ());
+			}
+			directives[name] = v;
+		}
+		return directives;
+	}
+
+	static std::string UpdateHeader (const std::string& header, const char * name, const std::string& value)
+	{
+		std::string out;
+		size_t pos = 0, eol;
+		while ((eol = header.find (CRLF, pos)) != std::string::npos && eol != pos) // until empty line
+		{
+			auto colon = header.find (':', pos);
+			if (!pos || colon > eol || !IsHeaderName (header.substr (pos, colon - pos), name))
+				out.append (header, pos, eol + 2 - pos);
+			pos = eol + 2;
+		}
+		if (!value.empty ())
+			out.append (name).append (": ").append (value).append (CRLF);
+		out += CRLF;
+		return out;
+	}
+
+	std::string HTTPCacheEntry::GetHeader (uint64_t ts) const
+	{
+		return UpdateHeader (header, "Age", std::to_string (age + (int64_t)(ts - responseTime)));
+	}
+
+	HTTPCache::HTTPCache (size_t maxSize):
+		m_MaxSize (maxSize), m_Size (0), m_NumHits (0), m_NumMisses (0), m_NumRevalidated (0)
+	{
+	}
+
+	std::string HTTPCache::GetKey (const std::string& host, int port, const HTTPReq& req)
+	{
+		if (req.method != "GET") return "";
+		for (auto name: { "range", "authorization", "cookie", "if-none-match", "if-modified-since", "if-match", "if-unmodified-since", "if-range" })
+			if (!FindHeader (req.headers, name).empty ()) return ""; // for client's own cache, session or partial
+		// Vary: Accept-Encoding only is stored
+		return host + ":" + std::to_string (port) + req.uri + "\n" + FindHeader (req.headers, "accept-encoding");
+	}
+
+	bool HTTPCache::IsRevalidationRequested (const HTTPReq& req)
+	{
+		auto directives = ParseCacheControl (FindHeader (req.headers, "cache-control"));
+		if (directives.count ("no-cache")) return true;
+		auto it = directives.find ("max-age");
+		if (it != directives.end () && !atoll (it->second.c_str ())) return true;
+		return FindHeader (req.headers, "pragma").find ("no-cache") != std::string::npos;
+	}
+
+	void HTTPCache::AddConditionalHeaders (HTTPReq& req, const HTTPCacheEntry& entry)
+	{
+		if (!entry.etag.empty ()) req.AddHeader ("If-None-Match", entry.etag);
+		if (!entry.lastModified.empty ()) req.AddHeader ("If-Modified-Since", entry.lastModified);
+	}
+
+	std::shared_ptr<const HTTPCacheEntry> HTTPCache::Lookup (const std::string& key)
+	{
+		std::unique_lock<std::mutex> l(m_Mutex);
+		auto it = m_Entries.find (key);
+		if (it == m_Entries.end ()) return nullptr;
+		m_LRU.splice (m_LRU.begin (), m_LRU, it->second.lru);
+		return it->second.entry;
+	}
+
+	void HTTPCache::SetFreshness (HTTPCacheEntry& entry, const HTTPRes& res, uint64_t ts) const
+	{
+		entry.responseTime = ts;
+		entry.etag = FindHeader (res.headers, "etag");
+		entry.lastModified = FindHeader (res.headers, "last-modified");
+		auto age = FindHeader (res.headers, "age");
+		entry.age = age.empty () ? 0 : atoll (age.c_str ());
+		auto directives = ParseCacheControl (FindHeader (res.headers, "cache-control"));
+		entry.noCache = directives.count ("no-cache") || FindHeader (res.headers, "pragma").find ("no-cache") != std::string::npos;
+		entry.lifetime = 0;
+		auto it = directives.find ("s-maxage");
+		if (it == directives.end ()) it = directives.find ("max-age");
+		if (it != directives.end ())
+			entry.lifetime = atoll (it->second.c_str ());
+		else
+		{
+			int64_t date = ParseHTTPDate (FindHeader (res.headers, "date"));
+			if (date < 0) date = ts;
+			auto expires = FindHeader (res.headers, "expires");
+			if (!expires.empty ())
+			{
+				auto e = ParseHTTPDate (expires);
+				if (e > date) entry.lifetime = e - date; // invalid means expired
+			}
+			else if (!entry.lastModified.empty ())
+			{
+				// heuristic, 10% of time since modification
+				auto lastModified = ParseHTTPDate (entry.lastModified);
+				if (lastModified >= 0 && lastModified < date)
+					entry.lifetime = std::min ((date - lastModified)/10, HTTP_CACHE_MAX_HEURISTIC_LIFETIME);
+			}
+		}
+	}
+
+	bool HTTPCache::IsStorable (const HTTPRes& res, size_t size) const
+	{
+		switch (res.code)
+		{
+			case 200: case 203: case 204: case 300: case 301: case 308: case 404: case 410:
+				break;
+			default:
+				return false;
+		}
+		if (size > std::min (HTTP_CACHE_MAX_ENTRY_SIZE, m_MaxSize/4)) return false;
+		auto directives = ParseCacheControl (FindHeader (res.headers, "cache-control"));
+		if (directives.count ("no-store") || directives.count ("private")) return false;
+		if (!FindHeader (res.headers, "set-cookie").empty ()) return false; // for this user only
+		auto vary = FindHeader (res.headers, "vary");
+		vary.erase (std::remove_if (vary.begin (), vary.end (), ::isspace), vary.end ());
+		if (!vary.empty () && !IsHeaderName (vary, "accept-encoding")) return false;
+		HTTPCacheEntry entry;
+		SetFreshness (entry, res, 0);
+		return (entry.lifetime > entry.age && !entry.noCache) || entry.HasValidators ();
+	}
+
+	void HTTPCache::Insert (const std::string& key, const HTTPRes& res, const std::string& header, const std::string& body, uint64_t ts)
+	{
+		auto entry = std::make_shared<HTTPCacheEntry> ();
+		entry->header = header;
+		entry->body = body;
+		SetFreshness (*entry, res, ts);
+		Insert (key, entry);
+	}
+
+	std::shared_ptr<const HTTPCacheEntry> HTTPCache::Revalidate (const std::string& key, std::shared_ptr<const HTTPCacheEntry> entry,
+		const HTTPRes& res, uint64_t ts)
+	{
+		// headers of 304 replace stored ones
+		auto updated = std::make_shared<HTTPCacheEntry> (*entry);
+		for (auto name: { "Date", "Expires", "Cache-Control", "ETag", "Last-Modified", "Age" })
+		{
+			auto value = FindHeader (res.headers, name);
+			if (!value.empty () || !strcmp (name, "Age"))
+				updated->header = UpdateHeader (updated->header, name, value);
+		}
+		HTTPRes merged;
+		if (merged.parse (updated->header) <= 0) return entry; // still valid, served as is
+		SetFreshness (*updated, merged, ts);
+		Insert (key, updated);
+		m_NumRevalidated++;
+		return updated;
+	}
+
+	void HTTPCache::Insert (const std::string& key, std::shared_ptr<HTTPCacheEntry> entry)
+	{
+		if (entry->GetSize () > std::min (HTTP_CACHE_MAX_ENTRY_SIZE, m_MaxSize/4)) return;
+		std::unique_lock<std::mutex> l(m_Mutex);
+		auto it = m_Entries.find (key);
+		if (it != m_Entries.end ())
+		{
+			m_Size -= it->second.entry->GetSize ();
+			m_LRU.erase (it->second.lru);
+			m_Entries.erase (it);
+		}
+		m_LRU.push_front (key);
+		m_Entries[key] = Item{ entry, m_LRU.begin () };
+		m_Size += entry->GetSize ();
+		while (m_Size > m_MaxSize && !m_LRU.empty ())
+		{
+			// least recently used
+			auto oldest = m_Entries.find (m_LRU.back ());
+			m_Size -= oldest->second.entry->GetSize ();
+			m_Entries.erase (oldest);
+			m_LRU.pop_back ();
+		}
+	}
+
+	void HTTPCache::Invalidate (const std::string& host, int port, const HTTPReq& req)
+	{
+		// same URI as GET, without headers which keep it from cache
+		HTTPReq get;
+		get.method = "GET";
+		get.uri = req.uri;
+		auto encoding = FindHeader (req.headers, "accept-encoding");
+		if (!encoding.empty ()) get.AddHeader ("Accept-Encoding", encoding);
+		auto key = GetKey (host, port, get);
+		std::unique_lock<std::mutex> l(m_Mutex);
+		auto it = m_Entries.find (key);
+		if (it != m_Entries.end ())
+		{
+			m_Size -= it->second.entry->GetSize ();
+			m_LRU.erase (it->second.lru);
+			m_Entries.erase (it);
+		}
+	}
+
+	size_t HTTPCache::GetSize () const
+	{
+		std::unique_lock<std::mutex> l(m_Mutex);
+		return m_Size;
+	}
+
+	size_t HTTPCache::GetNumEntries () const
+	{
+		std::unique_lock<std::mutex> l(m_Mutex);
+		return m_Entries.size ();
+	}
+}
+}
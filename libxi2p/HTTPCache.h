@@ -0,0 +1,98 @@
+#ifndef HTTP_CACHE_H__
+#define HTTP_CACHE_H__
+
+#include <inttypes.h>
+#include <string>
+#include <list>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <atomic>
+#include <unordered_map>
+#include "HTTP.h"
+
+namespace i2p
+{
+namespace http
+{
+	const size_t HTTP_CACHE_DEFAULT_SIZE = 32*1024*1024; // in bytes
+	const size_t HTTP_CACHE_MAX_ENTRY_SIZE = 4*1024*1024; // in bytes, or quarter of cache if less
+	const int64_t HTTP_CACHE_MAX_HEURISTIC_LIFETIME = 86400; // in seconds
+
+	/** @brief Parses RFC 1123 date, like "Sun, 06 Nov 1994 08:49:37 GMT", returns -1 if invalid */
+	int64_t ParseHTTPDate (const std::string& date);
+
+	struct HTTPCacheEntry
+	{
+		std::string header; // raw response header with end of header mark
+		std::string body; // as received, chunked if header says so
+		std::string etag, lastModified; // validators
+		uint64_t responseTime; // in seconds
+		int64_t age, lifetime; // initial age and freshness lifetime in seconds
+		bool noCache; // revalidate every time
+
+		size_t GetSize () const { return header.length () + body.length (); };
+		bool IsFresh (uint64_t ts) const { return !noCache && age + (int64_t)(ts - responseTime) < lifetime; };
+		bool HasValidators () const { return !etag.empty () || !lastModified.empty (); };
+		std::string GetHeader (uint64_t ts) const; // with current Age
+	};
+
+	/**
+	 * @brief Shared cache of HTTP responses (RFC 7234) for GET requests, bounded by size, least recently used go first.
+	 * Freshness comes from Cache-Control s-maxage/max-age, Expires or 10% of Last-Modified age.
+	 * Stale entries with ETag or Last-Modified are revalidated by conditional request
+	 */
+	class HTTPCache
+	{
+		public:
+
+			HTTPCache (size_t maxSize = HTTP_CACHE_DEFAULT_SIZE);
+
+			/** @brief Returns cache key of request to host, empty if it can't be served from cache */
+			static std::string GetKey (const std::string& host, int port, const HTTPReq& req);
+			/** @brief Reload of browser, cached response must be revalidated */
+			static bool IsRevalidationRequested (const HTTPReq& req);
+			/** @brief Adds If-None-Match and If-Modified-Since of entry to request */
+			static void AddConditionalHeaders (HTTPReq& req, const HTTPCacheEntry& entry);
+
+			std::shared_ptr<const HTTPCacheEntry> Lookup (const std::string& key); // becomes most recent, fresh or stale
+			bool IsStorable (const HTTPRes& res, size_t size) const; // size of header and body if known
+			void Insert (const std::string& key, const HTTPRes& res, const std::string& header, const std::string& body, uint64_t ts);
+			/** @brief Updates entry from 304 response and stores it again, even if evicted meanwhile. Returns updated one */
+			std::shared_ptr<const HTTPCacheEntry> Revalidate (const std::string& key, std::shared_ptr<const HTTPCacheEntry> entry,
+				const HTTPRes& res, uint64_t ts);
+			void Invalidate (const std::string& host, int port, const HTTPReq& req); // by POST, PUT or DELETE to same URI
+
+			size_t GetSize () const;
+			size_t GetMaxSize () const { return m_MaxSize; };
+			size_t GetNumEntries () const;
+			uint64_t GetNumHits () const { return m_NumHits; };
+			uint64_t GetNumMisses () const { return m_NumMisses; };
+			uint64_t GetNumRevalidated () const { return m_NumRevalidated; };
+			void OnHit () { m_NumHits++; }; // served without request
+			void OnMiss () { m_NumMisses++; };
+
+		private:
+
+			void Insert (const std::string& key, std::shared_ptr<HTTPCacheEntry> entry);
+			void SetFreshness (HTTPCacheEntry& entry, const HTTPRes& res, uint64_t ts) const;
+
+		private:
+
+			typedef std::list<std::string> LRUList; // most recent first
+			struct Item
+			{
+				std::shared_ptr<const HTTPCacheEntry> entry;
+				LRUList::iterator lru;
+			};
+
+			size_t m_MaxSize, m_Size;
+			mutable std::mutex m_Mutex;
+			std::unordered_map<std::string, Item> m_Entries;
+			LRUList m_LRU;
+			std::atomic<uint64_t> m_NumHits, m_NumMisses, m_NumRevalidated; // updated by proxy handlers without lock
+	};
+}
+}
+
+#endif
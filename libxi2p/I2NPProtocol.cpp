@@ -1,5 +1,8 @@
 #include <string.h>
 #include <atomic>
+#include <mutex>
+#include <vector>
+#include <algorithm>
 #include "Base.h"
 #include "Log.h"
 #include "Crypto.h"
@@ -17,21 +20,220 @@ using namespace i2p::transport;
 
 namespace i2p
 {
+	const size_t I2NP_TUNNEL_MESSAGE_SIZE = i2p::tunnel::TUNNEL_DATA_MSG_SIZE + I2NP_HEADER_SIZE + 34; // reserved for alignment and NTCP 16 + 6 + 12
+	// number of buffers moved between thread cache and shared list at once, thread cache holds up to twice as many
+	const size_t I2NP_MESSAGES_POOL_BATCH_SIZE[eNumI2NPMessageSizeClasses] = { 256, 64, 8 };
+	const size_t I2NP_MESSAGES_POOL_MAX_SHARED_SIZE[eNumI2NPMessageSizeClasses] = { 8192, 2048, 128 };
+
+	static I2NPMessage * CreateI2NPMessageBuffer (I2NPMessageSizeClass sizeClass)
+	{
+		switch (sizeClass)
+		{
+			case eI2NPMessageSizeTunnel:
+				return new I2NPMessageBuffer<I2NP_TUNNEL_MESSAGE_SIZE>();
+			case eI2NPMessageSizeShort:
+				return new I2NPMessageBuffer<I2NP_MAX_SHORT_MESSAGE_SIZE>();
+			default:
+				return new I2NPMessageBuffer<I2NP_MAX_MESSAGE_SIZE>();
+		}
+	}
+
+	static void DeleteI2NPMessageBuffer (I2NPMessageSizeClass sizeClass, I2NPMessage * msg)
+	{
+		// I2NPMessage doesn't have virtual destructor
+		switch (sizeClass)
+		{
+			case eI2NPMessageSizeTunnel:
+				delete static_cast<I2NPMessageBuffer<I2NP_TUNNEL_MESSAGE_SIZE> *>(msg);
+			break;
+			case eI2NPMessageSizeShort:
+				delete static_cast<I2NPMessageBuffer<I2NP_MAX_SHORT_MESSAGE_SIZE> *>(msg);
+			break;
+			default:
+				delete static_cast<I2NPMessageBuffer<I2NP_MAX_MESSAGE_SIZE> *>(msg);
+		}
+	}
+
+	class I2NPMessagesPool
+	{
+		typedef std::vector<I2NPMessage *> FreeList;
+
+		struct ThreadCache
+		{
+			FreeList msgs[eNumI2NPMessageSizeClasses];
+		};
+
+		struct ThreadCacheHolder
+		{
+			~ThreadCacheHolder ()
+			{
+				// thread exits, return buffers to shared list
+				auto cache = t_Cache;
+				t_Cache = nullptr;
+				t_IsCacheReleased = true;
+				if (cache)
+				{
+					for (int i = 0; i < eNumI2NPMessageSizeClasses; i++)
+						GetPool ().ReturnShared ((I2NPMessageSizeClass)i, cache->msgs[i], cache->msgs[i].size ());
+					delete cache;
+				}
+			}
+		};
+
+		public:
+
+			static I2NPMessagesPool& GetPool ()
+			{
+				// never deleted, since messages might be released by static objects at exit
+				static I2NPMessagesPool * pool = new I2NPMessagesPool ();
+				return *pool;
+			}
+
+			std::shared_ptr<I2NPMessage> Acquire (I2NPMessageSizeClass sizeClass)
+			{
+				auto& stats = m_Stats[sizeClass];
+				stats.numAcquired.fetch_add (1, std::memory_order_relaxed);
+				I2NPMessage * msg = nullptr;
+				auto cache = GetThreadCache ();
+				if (cache)
+				{
+					auto& msgs = cache->msgs[sizeClass];
+					if (msgs.empty ()) TakeShared (sizeClass, msgs, I2NP_MESSAGES_POOL_BATCH_SIZE[sizeClass]);
+					if (!msgs.empty ())
+					{
+						msg = msgs.back ();
+						msgs.pop_back ();
+					}
+				}
+				else
+				{
+					FreeList msgs;
+					TakeShared (sizeClass, msgs, 1);
+					if (!msgs.empty ()) msg = msgs.back ();
+				}
+				if (msg)
+				{
+					stats.numHits.fetch_add (1, std::memory_order_relaxed);
+					msg->offset = 2; msg->len = I2NP_HEADER_SIZE + 2; // reserve 2 bytes for NTCP header
+				}
+				else
+					msg = CreateI2NPMessageBuffer (sizeClass);
+				if (sizeClass == eI2NPMessageSizeTunnel) msg->Align (12);
+				return std::shared_ptr<I2NPMessage>(msg,
+					[sizeClass](I2NPMessage * m) { GetPool ().Release (sizeClass, m); });
+			}
+
+			void Release (I2NPMessageSizeClass sizeClass, I2NPMessage * msg)
+			{
+				msg->from = nullptr;
+				auto cache = GetThreadCache ();
+				if (cache)
+				{
+					auto& msgs = cache->msgs[sizeClass];
+					msgs.push_back (msg);
+					// message might come from another thread, move half of cache to shared list if full
+					auto batchSize = I2NP_MESSAGES_POOL_BATCH_SIZE[sizeClass];
+					if (msgs.size () >= 2*batchSize) ReturnShared (sizeClass, msgs, batchSize);
+				}
+				else
+				{
+					FreeList msgs{ msg };
+					ReturnShared (sizeClass, msgs, 1);
+				}
+			}
+
+			I2NPMessagesPoolStats GetStats (I2NPMessageSizeClass sizeClass)
+			{
+				I2NPMessagesPoolStats stats;
+				stats.numAcquired = m_Stats[sizeClass].numAcquired.load (std::memory_order_relaxed);
+				stats.numHits = m_Stats[sizeClass].numHits.load (std::memory_order_relaxed);
+				std::unique_lock<std::mutex> l(m_SharedMutex);
+				stats.numShared = m_Shared[sizeClass].size ();
+				return stats;
+			}
+
+		private:
+
+			ThreadCache * GetThreadCache ()
+			{
+				if (!t_Cache && !t_IsCacheReleased)
+				{
+					static thread_local ThreadCacheHolder holder;
+					t_Cache = new ThreadCache ();
+					for (int i = 0; i < eNumI2NPMessageSizeClasses; i++)
+						t_Cache->msgs[i].reserve (2*I2NP_MESSAGES_POOL_BATCH_SIZE[i]);
+				}
+				return t_Cache;
+			}
+
+			void TakeShared (I2NPMessageSizeClass sizeClass, FreeList& msgs, size_t num)
+			{
+				std::unique_lock<std::mutex> l(m_SharedMutex);
+				auto& shared = m_Shared[sizeClass];
+				if (num > shared.size ()) num = shared.size ();
+				msgs.insert (msgs.end (), shared.end () - num, shared.end ());
+				shared.resize (shared.size () - num);
+			}
+
+			void ReturnShared (I2NPMessageSizeClass sizeClass, FreeList& msgs, size_t num)
+			{
+				// returns last num buffers from msgs
+				size_t numExcessive = 0;
+				{
+					std::unique_lock<std::mutex> l(m_SharedMutex);
+					auto& shared = m_Shared[sizeClass];
+					auto maxSize = I2NP_MESSAGES_POOL_MAX_SHARED_SIZE[sizeClass];
+					size_t numToShare = shared.size () + num <= maxSize ? num : maxSize - std::min (maxSize, shared.size ());
+					shared.insert (shared.end (), msgs.end () - numToShare, msgs.end ());
+					numExcessive = num - numToShare;
+				}
+				msgs.resize (msgs.size () - num + numExcessive);
+				// delete what doesn't fit outside of lock
+				for (size_t i = 0; i < numExcessive; i++)
+				{
+					DeleteI2NPMessageBuffer (sizeClass, msgs.back ());
+					msgs.pop_back ();
+				}
+			}
+
+		private:
+
+			struct Stats
+			{
+				std::atomic<uint64_t> numAcquired, numHits;
+				Stats (): numAcquired (0), numHits (0) {};
+			};
+
+			I2NPMessagesPool () {};
+
+			std::mutex m_SharedMutex;
+			FreeList m_Shared[eNumI2NPMessageSizeClasses];
+			Stats m_Stats[eNumI2NPMessageSizeClasses];
+
+			static thread_local ThreadCache * t_Cache;
+			static thread_local bool t_IsCacheReleased;
+	};
+	thread_local I2NPMessagesPool::ThreadCache * I2NPMessagesPool::t_Cache = nullptr;
+	thread_local bool I2NPMessagesPool::t_IsCacheReleased = false;
+
 	std::shared_ptr<I2NPMessage> NewI2NPMessage ()
 	{
-		return std::make_shared<I2NPMessageBuffer<I2NP_MAX_MESSAGE_SIZE> >();
+		return I2NPMessagesPool::GetPool ().Acquire (eI2NPMessageSizeFull);
 	}
 
 	std::shared_ptr<I2NPMessage> NewI2NPShortMessage ()
 	{
-		return std::make_shared<I2NPMessageBuffer<I2NP_MAX_SHORT_MESSAGE_SIZE> >();
+		return I2NPMessagesPool::GetPool ().Acquire (eI2NPMessageSizeShort);
 	}
 
 	std::shared_ptr<I2NPMessage> NewI2NPTunnelMessage ()
 	{
-		auto msg = new I2NPMessageBuffer<i2p::tunnel::TUNNEL_DATA_MSG_SIZE + I2NP_HEADER_SIZE + 34>(); // reserved for alignment and NTCP 16 + 6 + 12
-		msg->Align (12);
-		return std::shared_ptr<I2NPMessage>(msg);
+		return I2NPMessagesPool::GetPool ().Acquire (eI2NPMessageSizeTunnel);
+	}
+
+	I2NPMessagesPoolStats GetI2NPMessagesPoolStats (I2NPMessageSizeClass sizeClass)
+	{
+		return I2NPMessagesPool::GetPool ().GetStats (sizeClass);
 	}
 
 	std::shared_ptr<I2NPMessage> NewI2NPMessage (size_t len)
@@ -318,60 +520,90 @@ namespace i2p
 		}
 	}
 
-	bool HandleBuildRequestRecords (int num, uint8_t * records, uint8_t * clearText)
+	static int FindBuildRequestRecord (int num, const uint8_t * records)
 	{
 		for (int i = 0; i < num; i++)
+			if (!memcmp (records + i*TUNNEL_BUILD_RECORD_SIZE + BUILD_REQUEST_RECORD_TO_PEER_OFFSET,
+				(const uint8_t *)i2p::context.GetRouterInfo ().GetIdentHash (), 16))
+				return i;
+		return -1;
+	}
+
+	static void DecryptBuildRequestRecord (const uint8_t * record, uint8_t * clearText)
+	{
+		BN_CTX * ctx = BN_CTX_new ();
+		i2p::context.DecryptTunnelBuildRecord (record + BUILD_REQUEST_RECORD_ENCRYPTED_OFFSET, clearText, ctx);
+		BN_CTX_free (ctx);
+	}
+
+	static void HandleBuildRequestRecord (int num, uint8_t * records, int index, const uint8_t * clearText)
+	{
+		uint8_t * record = records + index*TUNNEL_BUILD_RECORD_SIZE;
+		// replace record to reply
+		if (i2p::context.AcceptsTunnels () &&
+			i2p::tunnel::tunnels.GetTransitTunnels ().size () <= g_MaxNumTransitTunnels &&
+			!i2p::transport::transports.IsBandwidthExceeded () &&
+			!i2p::transport::transports.IsTransitBandwidthExceeded ())
 		{
-			uint8_t * record = records + i*TUNNEL_BUILD_RECORD_SIZE;
-			if (!memcmp (record + BUILD_REQUEST_RECORD_TO_PEER_OFFSET, (const uint8_t *)i2p::context.GetRouterInfo ().GetIdentHash (), 16))
-			{
-				LogPrint (eLogDebug, "I2NP: Build request record ", i, " is ours");
-				BN_CTX * ctx = BN_CTX_new ();
-				i2p::context.DecryptTunnelBuildRecord (record + BUILD_REQUEST_RECORD_ENCRYPTED_OFFSET, clearText, ctx);
-				BN_CTX_free (ctx);
-				// replace record to reply
-				if (i2p::context.AcceptsTunnels () &&
-					i2p::tunnel::tunnels.GetTransitTunnels ().size () <= g_MaxNumTransitTunnels &&
-					!i2p::transport::transports.IsBandwidthExceeded () &&
-					!i2p::transport::transports.IsTransitBandwidthExceeded ())
-				{
-					auto transitTunnel = i2p::tunnel::CreateTransitTunnel (
-							bufbe32toh (clearText + BUILD_REQUEST_RECORD_RECEIVE_TUNNEL_OFFSET),
-							clearText + BUILD_REQUEST_RECORD_NEXT_IDENT_OFFSET,
-						    bufbe32toh (clearText + BUILD_REQUEST_RECORD_NEXT_TUNNEL_OFFSET),
-							clearText + BUILD_REQUEST_RECORD_LAYER_KEY_OFFSET,
-						    clearText + BUILD_REQUEST_RECORD_IV_KEY_OFFSET,
-							clearText[BUILD_REQUEST_RECORD_FLAG_OFFSET] & 0x80,
-						    clearText[BUILD_REQUEST_RECORD_FLAG_OFFSET ] & 0x40);
-					i2p::tunnel::tunnels.AddTransitTunnel (transitTunnel);
-					record[BUILD_RESPONSE_RECORD_RET_OFFSET] = 0;
-				}
-				else
-					record[BUILD_RESPONSE_RECORD_RET_OFFSET] = 30; // always reject with bandwidth reason (30)
-
-				//TODO: fill filler
-				SHA256 (record + BUILD_RESPONSE_RECORD_PADDING_OFFSET, BUILD_RESPONSE_RECORD_PADDING_SIZE + 1, // + 1 byte of ret
-					record + BUILD_RESPONSE_RECORD_HASH_OFFSET);
-				// encrypt reply
-				i2p::crypto::CBCEncryption encryption;
-				for (int j = 0; j < num; j++)
-				{
-					encryption.SetKey (clearText + BUILD_REQUEST_RECORD_REPLY_KEY_OFFSET);
-					encryption.SetIV (clearText + BUILD_REQUEST_RECORD_REPLY_IV_OFFSET);
-					uint8_t * reply = records + j*TUNNEL_BUILD_RECORD_SIZE;
-					encryption.Encrypt(reply, TUNNEL_BUILD_RECORD_SIZE, reply);
-				}
-				return true;
-			}
+			auto transitTunnel = i2p::tunnel::CreateTransitTunnel (
+					bufbe32toh (clearText + BUILD_REQUEST_RECORD_RECEIVE_TUNNEL_OFFSET),
+					clearText + BUILD_REQUEST_RECORD_NEXT_IDENT_OFFSET,
+				    bufbe32toh (clearText + BUILD_REQUEST_RECORD_NEXT_TUNNEL_OFFSET),
+					clearText + BUILD_REQUEST_RECORD_LAYER_KEY_OFFSET,
+				    clearText + BUILD_REQUEST_RECORD_IV_KEY_OFFSET,
+					clearText[BUILD_REQUEST_RECORD_FLAG_OFFSET] & 0x80,
+				    clearText[BUILD_REQUEST_RECORD_FLAG_OFFSET ] & 0x40);
+			i2p::tunnel::tunnels.AddTransitTunnel (transitTunnel);
+			record[BUILD_RESPONSE_RECORD_RET_OFFSET] = 0;
+		}
+		else
+			record[BUILD_RESPONSE_RECORD_RET_OFFSET] = 30; // always reject with bandwidth reason (30)
+
+		//TODO: fill filler
+		SHA256 (record + BUILD_RESPONSE_RECORD_PADDING_OFFSET, BUILD_RESPONSE_RECORD_PADDING_SIZE + 1, // + 1 byte of ret
+			record + BUILD_RESPONSE_RECORD_HASH_OFFSET);
+		// encrypt reply
+		i2p::crypto::CBCEncryption encryption;
+		for (int j = 0; j < num; j++)
+		{
+			encryption.SetKey (clearText + BUILD_REQUEST_RECORD_REPLY_KEY_OFFSET);
+			encryption.SetIV (clearText + BUILD_REQUEST_RECORD_REPLY_IV_OFFSET);
+			uint8_t * reply = records + j*TUNNEL_BUILD_RECORD_SIZE;
+			encryption.Encrypt(reply, TUNNEL_BUILD_RECORD_SIZE, reply);
 		}
-		return false;
+	}
+
+	bool HandleBuildRequestRecords (int num, uint8_t * records, uint8_t * clearText)
+	{
+		int i = FindBuildRequestRecord (num, records);
+		if (i < 0) return false;
+		LogPrint (eLogDebug, "I2NP: Build request record ", i, " is ours");
+		DecryptBuildRequestRecord (records + i*TUNNEL_BUILD_RECORD_SIZE, clearText);
+		HandleBuildRequestRecord (num, records, i, clearText);
+		return true;
+	}
+
+	static void SendBuildRequest (bool isVariable, const uint8_t * buf, size_t len, const uint8_t * clearText)
+	{
+		if (clearText[BUILD_REQUEST_RECORD_FLAG_OFFSET] & 0x40) // we are endpoint of outboud tunnel
+		{
+			// so we send it to reply tunnel
+			transports.SendMessage (clearText + BUILD_REQUEST_RECORD_NEXT_IDENT_OFFSET,
+				CreateTunnelGatewayMsg (bufbe32toh (clearText + BUILD_REQUEST_RECORD_NEXT_TUNNEL_OFFSET),
+					isVariable ? eI2NPVariableTunnelBuildReply : eI2NPTunnelBuildReply, buf, len,
+				    bufbe32toh (clearText + BUILD_REQUEST_RECORD_SEND_MSG_ID_OFFSET)));
+		}
+		else
+			transports.SendMessage (clearText + BUILD_REQUEST_RECORD_NEXT_IDENT_OFFSET,
+				CreateI2NPMessage (isVariable ? eI2NPVariableTunnelBuild : eI2NPTunnelBuild, buf, len,
+					bufbe32toh (clearText + BUILD_REQUEST_RECORD_SEND_MSG_ID_OFFSET)));
 	}
 
 	void HandleVariableTunnelBuildMsg (uint32_t replyMsgID, uint8_t * buf, size_t len)
 	{
 		int num = buf[0];
 		LogPrint (eLogDebug, "I2NP: VariableTunnelBuild ", num, " records");
-		if (len < num*BUILD_REQUEST_RECORD_CLEAR_TEXT_SIZE + 1)
+		if (len < num*TUNNEL_BUILD_RECORD_SIZE + 1)
 		{
 			LogPrint (eLogError, "VaribleTunnelBuild message of ", num, " records is too short ", len);
 			return;
@@ -398,53 +630,72 @@ namespace i2p
 		{
 			uint8_t clearText[BUILD_REQUEST_RECORD_CLEAR_TEXT_SIZE];
 			if (HandleBuildRequestRecords (num, buf + 1, clearText))
-			{
-				if (clearText[BUILD_REQUEST_RECORD_FLAG_OFFSET] & 0x40) // we are endpoint of outboud tunnel
-				{
-					// so we send it to reply tunnel
-					transports.SendMessage (clearText + BUILD_REQUEST_RECORD_NEXT_IDENT_OFFSET,
-						CreateTunnelGatewayMsg (bufbe32toh (clearText + BUILD_REQUEST_RECORD_NEXT_TUNNEL_OFFSET),
-							eI2NPVariableTunnelBuildReply, buf, len,
-						    bufbe32toh (clearText + BUILD_REQUEST_RECORD_SEND_MSG_ID_OFFSET)));
-				}
-				else
-					transports.SendMessage (clearText + BUILD_REQUEST_RECORD_NEXT_IDENT_OFFSET,
-						CreateI2NPMessage (eI2NPVariableTunnelBuild, buf, len,
-							bufbe32toh (clearText + BUILD_REQUEST_RECORD_SEND_MSG_ID_OFFSET)));
-			}
+				SendBuildRequest (true, buf, len, clearText);
 		}
 	}
 
 	void HandleTunnelBuildMsg (uint8_t * buf, size_t len)
 	{
-		if (len < NUM_TUNNEL_BUILD_RECORDS*BUILD_REQUEST_RECORD_CLEAR_TEXT_SIZE)
+		if (len < NUM_TUNNEL_BUILD_RECORDS*TUNNEL_BUILD_RECORD_SIZE)
 		{
 			LogPrint (eLogError, "TunnelBuild message is too short ", len);
 			return;
 		}
 		uint8_t clearText[BUILD_REQUEST_RECORD_CLEAR_TEXT_SIZE];
 		if (HandleBuildRequestRecords (NUM_TUNNEL_BUILD_RECORDS, buf, clearText))
+			SendBuildRequest (false, buf, len, clearText);
+	}
+
+	static uint8_t * GetBuildRequestRecords (std::shared_ptr<I2NPMessage> msg, int& num, size_t& len)
+	{
+		uint8_t * buf = msg->GetPayload ();
+		len = std::min ((size_t)msg->GetSize (), msg->GetPayloadLength ());
+		if (msg->GetTypeID () == eI2NPVariableTunnelBuild)
 		{
-			if (clearText[BUILD_REQUEST_RECORD_FLAG_OFFSET] & 0x40) // we are endpoint of outbound tunnel
-			{
-				// so we send it to reply tunnel
-				transports.SendMessage (clearText + BUILD_REQUEST_RECORD_NEXT_IDENT_OFFSET,
-					CreateTunnelGatewayMsg (bufbe32toh (clearText + BUILD_REQUEST_RECORD_NEXT_TUNNEL_OFFSET),
-						eI2NPTunnelBuildReply, buf, len,
-					    bufbe32toh (clearText + BUILD_REQUEST_RECORD_SEND_MSG_ID_OFFSET)));
-			}
-			else
-				transports.SendMessage (clearText + BUILD_REQUEST_RECORD_NEXT_IDENT_OFFSET,
-					CreateI2NPMessage (eI2NPTunnelBuild, buf, len,
-						bufbe32toh (clearText + BUILD_REQUEST_RECORD_SEND_MSG_ID_OFFSET)));
+			num = len > 0 ? buf[0] : 0;
+			if (len < num*TUNNEL_BUILD_RECORD_SIZE + 1) return nullptr;
+			return buf + 1;
 		}
+		num = NUM_TUNNEL_BUILD_RECORDS;
+		if (len < NUM_TUNNEL_BUILD_RECORDS*TUNNEL_BUILD_RECORD_SIZE) return nullptr;
+		return buf;
+	}
+
+	int FindBuildRequestRecord (std::shared_ptr<I2NPMessage> msg)
+	{
+		int num; size_t len;
+		auto records = GetBuildRequestRecords (msg, num, len);
+		if (!records)
+		{
+			LogPrint (eLogError, "I2NP: TunnelBuild message of ", num, " records is too short ", len);
+			return -1;
+		}
+		return FindBuildRequestRecord (num, records);
+	}
+
+	void DecryptBuildRequestRecord (std::shared_ptr<I2NPMessage> msg, int index, uint8_t * clearText)
+	{
+		int num; size_t len;
+		auto records = GetBuildRequestRecords (msg, num, len);
+		if (records && index < num)
+			DecryptBuildRequestRecord (records + index*TUNNEL_BUILD_RECORD_SIZE, clearText);
+	}
+
+	void HandleDecryptedBuildRequest (std::shared_ptr<I2NPMessage> msg, int index, const uint8_t * clearText)
+	{
+		int num; size_t len;
+		auto records = GetBuildRequestRecords (msg, num, len);
+		if (!records || index >= num) return;
+		LogPrint (eLogDebug, "I2NP: Build request record ", index, " is ours");
+		HandleBuildRequestRecord (num, records, index, clearText);
+		SendBuildRequest (msg->GetTypeID () == eI2NPVariableTunnelBuild, msg->GetPayload (), len, clearText);
 	}
 
 	void HandleVariableTunnelBuildReplyMsg (uint32_t replyMsgID, uint8_t * buf, size_t len)
 	{
 		int num = buf[0];
 		LogPrint (eLogDebug, "I2NP: VariableTunnelBuildReplyMsg of ", num, " records replyMsgID=", replyMsgID);
-		if (len < num*BUILD_REQUEST_RECORD_CLEAR_TEXT_SIZE + 1)
+		if (len < num*TUNNEL_BUILD_RECORD_SIZE + 1)
 		{
 			LogPrint (eLogError, "VaribleTunnelBuildReply message of ", num, " records is too short ", len);
 			return;
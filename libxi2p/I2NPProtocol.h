@@ -228,10 +228,26 @@ namespace tunnel
 		uint8_t m_Buffer[sz + 32]; // 16 alignment + 16 padding
 	};
 
+	// message buffers are taken from per-thread caches backed by a shared free list
+	enum I2NPMessageSizeClass
+	{
+		eI2NPMessageSizeTunnel = 0, // TunnelData
+		eI2NPMessageSizeShort, // I2NP_MAX_SHORT_MESSAGE_SIZE
+		eI2NPMessageSizeFull, // I2NP_MAX_MESSAGE_SIZE
+		eNumI2NPMessageSizeClasses
+	};
+
+	struct I2NPMessagesPoolStats
+	{
+		uint64_t numAcquired, numHits; // hit means buffer was reused rather than allocated
+		size_t numShared; // buffers in shared free list
+	};
+
 	std::shared_ptr<I2NPMessage> NewI2NPMessage ();
 	std::shared_ptr<I2NPMessage> NewI2NPShortMessage ();
 	std::shared_ptr<I2NPMessage> NewI2NPTunnelMessage ();
 	std::shared_ptr<I2NPMessage> NewI2NPMessage (size_t len);
+	I2NPMessagesPoolStats GetI2NPMessagesPoolStats (I2NPMessageSizeClass sizeClass);
 
 	std::shared_ptr<I2NPMessage> CreateI2NPMessage (I2NPMessageType msgType, const uint8_t * buf, size_t len, uint32_t replyMsgID = 0);
 	std::shared_ptr<I2NPMessage> CreateI2NPMessage (const uint8_t * buf, size_t len, std::shared_ptr<i2p::tunnel::InboundTunnel> from = nullptr);
@@ -251,6 +267,9 @@ namespace tunnel
 	bool IsRouterInfoMsg (std::shared_ptr<I2NPMessage> msg);
 
 	bool HandleBuildRequestRecords (int num, uint8_t * records, uint8_t * clearText);
+	int FindBuildRequestRecord (std::shared_ptr<I2NPMessage> msg); // index of our record in (Variable)TunnelBuild, -1 if not found
+	void DecryptBuildRequestRecord (std::shared_ptr<I2NPMessage> msg, int index, uint8_t * clearText); // can be called from any thread
+	void HandleDecryptedBuildRequest (std::shared_ptr<I2NPMessage> msg, int index, const uint8_t * clearText); // tunnels thread only
 	void HandleVariableTunnelBuildMsg (uint32_t replyMsgID, uint8_t * buf, size_t len);
 	void HandleVariableTunnelBuildReplyMsg (uint32_t replyMsgID, uint8_t * buf, size_t len);
 	void HandleTunnelBuildMsg (uint8_t * buf, size_t len);
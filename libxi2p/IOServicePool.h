@@ -0,0 +1,121 @@
+#ifndef IO_SERVICE_POOL_H__
+#define IO_SERVICE_POOL_H__
+
+#include <inttypes.h>
+#include <vector>
+#include <memory>
+#include <thread>
+#include <atomic>
+#include <functional>
+#include <boost/asio.hpp>
+#include "Tag.h"
+#include "Log.h"
+
+namespace i2p
+{
+namespace util
+{
+	// io_service per thread. Everything belonging to a session uses the same io_service,
+	// so session handlers never run concurrently and don't need locks
+	class IOServicePool
+	{
+		struct Worker
+		{
+			Worker (): work (service), thread (nullptr) {};
+
+			boost::asio::io_service service;
+			boost::asio::io_service::work work;
+			std::thread * thread;
+		};
+
+		public:
+
+			IOServicePool (const char * name): m_Name (name), m_IsRunning (false), m_NextWorker (0) {};
+			~IOServicePool () { Stop (); };
+
+			void Start (int numThreads)
+			{
+				if (m_IsRunning || numThreads <= 0) return;
+				m_IsRunning = true;
+				if (m_Workers.empty ())
+					for (int i = 0; i < numThreads; i++)
+						m_Workers.push_back (std::make_shared<Worker> ());
+				for (auto& it: m_Workers)
+				{
+					it->service.reset (); // if restarted
+					it->thread = new std::thread (std::bind (&IOServicePool::Run, this, it));
+				}
+				LogPrint (eLogInfo, m_Name, ": ", m_Workers.size (), " io_service threads started");
+			}
+
+			void Stop ()
+			{
+				if (!m_IsRunning) return;
+				m_IsRunning = false;
+				for (auto& it: m_Workers)
+					it->service.stop ();
+				// services are kept until destruction, sockets of remaining sessions refer to them
+				for (auto& it: m_Workers)
+				{
+					it->thread->join ();
+					delete it->thread;
+					it->thread = nullptr;
+				}
+			}
+
+			bool IsRunning () const { return m_IsRunning; };
+			size_t GetNumThreads () const { return m_IsRunning ? m_Workers.size () : 0; };
+
+			boost::asio::io_service& GetService (const i2p::data::Tag<32>& ident) // same router always gets the same one
+			{
+				return m_Workers[ident.GetLL ()[0] % m_Workers.size ()]->service;
+			}
+
+			boost::asio::io_service& GetNextService () // for incoming connections, router is not known yet
+			{
+				return m_Workers[m_NextWorker.fetch_add (1, std::memory_order_relaxed) % m_Workers.size ()]->service;
+			}
+
+			bool IsServiceThread (const boost::asio::io_service& service) const // called from handler of service
+			{
+				for (auto& it: m_Workers)
+					if (&it->service == &service)
+						return it->thread && it->thread->get_id () == std::this_thread::get_id ();
+				return false;
+			}
+
+			bool IsPoolThread () const // called from handler of any service
+			{
+				for (auto& it: m_Workers)
+					if (it->thread && it->thread->get_id () == std::this_thread::get_id ()) return true;
+				return false;
+			}
+
+		private:
+
+			void Run (std::shared_ptr<Worker> worker)
+			{
+				while (m_IsRunning)
+				{
+					try
+					{
+						worker->service.run ();
+					}
+					catch (std::exception& ex)
+					{
+						LogPrint (eLogError, m_Name, ": runtime exception: ", ex.what ());
+					}
+				}
+			}
+
+		private:
+
+			const char * m_Name;
+			std::atomic<bool> m_IsRunning;
+			std::vector<std::shared_ptr<Worker> > m_Workers;
+			std::atomic<size_t> m_NextWorker;
+	};
+}
+}
+
+#endif
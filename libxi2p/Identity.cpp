@@ -448,6 +448,35 @@ namespace data
 		m_Verifier = nullptr;
 	}
 
+	size_t BatchVerifier::Add (std::shared_ptr<const IdentityEx> identity, const uint8_t * buf, size_t len, const uint8_t * signature)
+	{
+		size_t index = m_Results.size ();
+		if (!identity->m_Verifier) identity->CreateVerifier ();
+		if (identity->m_Verifier && identity->GetSigningKeyType () == SIGNING_KEY_TYPE_EDDSA_SHA512_ED25519)
+		{
+			i2p::crypto::EDDSAVerification verification;
+			static_cast<const i2p::crypto::EDDSA25519Verifier *>(identity->m_Verifier.get ())->CreateVerification (buf, len, signature, verification);
+			m_Verifications.push_back (verification);
+			m_Indices.push_back (index);
+			m_Identities.push_back (identity);
+			m_Results.push_back (false);
+		}
+		else
+			m_Results.push_back (identity->Verify (buf, len, signature));
+		return index;
+	}
+
+	void BatchVerifier::Verify ()
+	{
+		if (m_Verifications.empty ()) return;
+		i2p::crypto::GetEd25519 ()->VerifyBatch (m_Verifications.data (), m_Verifications.size ());
+		for (size_t i = 0; i < m_Verifications.size (); i++)
+			m_Results[m_Indices[i]] = m_Verifications[i].result;
+		m_Verifications.clear ();
+		m_Indices.clear ();
+		m_Identities.clear ();
+	}
+
 	std::shared_ptr<i2p::crypto::CryptoKeyEncryptor> IdentityEx::CreateEncryptor (const uint8_t * key) const
 	{
 		if (!key) key = GetEncryptionPublicKey (); // use publicKey
@@ -5,6 +5,7 @@
 #include <string.h>
 #include <string>
 #include <memory>
+#include <vector>
 #include <atomic>
 #include "Base.h"
 #include "Signature.h"
@@ -113,6 +114,7 @@ namespace data
 
 		private:
 
+			friend class BatchVerifier;
 			void CreateVerifier () const;
 			void UpdateVerifier (i2p::crypto::Verifier * verifier) const;
 
@@ -126,6 +128,23 @@ namespace data
 			uint8_t * m_ExtendedBuffer;
 	};
 
+	class BatchVerifier // EdDSA signatures are verified together, others one by one
+	{
+		public:
+
+			size_t Add (std::shared_ptr<const IdentityEx> identity, const uint8_t * buf, size_t len, const uint8_t * signature); // returns index
+			void Verify ();
+			bool IsVerified (size_t index) const { return m_Results[index]; };
+			size_t GetNumSignatures () const { return m_Results.size (); };
+
+		private:
+
+			std::vector<std::shared_ptr<const IdentityEx> > m_Identities; // keep verifiers
+			std::vector<bool> m_Results;
+			std::vector<size_t> m_Indices; // of EdDSA verifications
+			std::vector<i2p::crypto::EDDSAVerification> m_Verifications;
+	};
+
 	class PrivateKeys // for eepsites
 	{
 		public:
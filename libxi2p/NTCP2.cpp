@@ -19,13 +19,11 @@ namespace transport
 {
 	NTCP2Establisher::NTCP2Establisher () 
 	{ 
-		m_Ctx = BN_CTX_new (); 
 		CreateEphemeralKey ();
 	}
 
 	NTCP2Establisher::~NTCP2Establisher () 
 	{ 
-		BN_CTX_free (m_Ctx); 
 	}
 
 	void NTCP2Establisher::MixKey (const uint8_t * inputKeyMaterial, uint8_t * derived)
@@ -67,7 +65,7 @@ namespace transport
 		SHA256_Final (m_H, &ctx);
 		// x25519 between rs and priv
 		uint8_t inputKeyMaterial[32];
-		i2p::crypto::GetEd25519 ()->ScalarMul (rs, priv, inputKeyMaterial, m_Ctx); // rs*priv
+		i2p::crypto::GetEd25519 ()->ScalarMul (rs, priv, inputKeyMaterial); // rs*priv
 		MixKey (inputKeyMaterial, m_K);
 	}
 
@@ -104,47 +102,50 @@ namespace transport
 
 		// x25519 between remote pub and priv
 		uint8_t inputKeyMaterial[32];
-		i2p::crypto::GetEd25519 ()->ScalarMul (GetRemotePub (), GetPriv (), inputKeyMaterial, m_Ctx); 
+		i2p::crypto::GetEd25519 ()->ScalarMul (GetRemotePub (), GetPriv (), inputKeyMaterial); 
 		MixKey (inputKeyMaterial, m_K);
 	}
 
 	void NTCP2Establisher::KDF3Alice ()
 	{
 		uint8_t inputKeyMaterial[32];
-		i2p::crypto::GetEd25519 ()->ScalarMul (GetRemotePub (), i2p::context.GetNTCP2StaticPrivateKey (), inputKeyMaterial, m_Ctx); 
+		i2p::crypto::GetEd25519 ()->ScalarMul (GetRemotePub (), i2p::context.GetNTCP2StaticPrivateKey (), inputKeyMaterial); 
 		MixKey (inputKeyMaterial, m_K);
 	}
 
 	void NTCP2Establisher::KDF3Bob ()
 	{
 		uint8_t inputKeyMaterial[32];
-		i2p::crypto::GetEd25519 ()->ScalarMul (m_RemoteStaticKey, m_EphemeralPrivateKey, inputKeyMaterial, m_Ctx); 
+		i2p::crypto::GetEd25519 ()->ScalarMul (m_RemoteStaticKey, m_EphemeralPrivateKey, inputKeyMaterial); 
 		MixKey (inputKeyMaterial, m_K);
 	}
 
 	void NTCP2Establisher::CreateEphemeralKey ()
 	{
 		RAND_bytes (m_EphemeralPrivateKey, 32);
-		i2p::crypto::GetEd25519 ()->ScalarMulB (m_EphemeralPrivateKey, m_EphemeralPublicKey, m_Ctx);
+		i2p::crypto::GetEd25519 ()->ScalarMulB (m_EphemeralPrivateKey, m_EphemeralPublicKey);
 	}
 
 	NTCP2Session::NTCP2Session (NTCP2Server& server, std::shared_ptr<const i2p::data::RouterInfo> in_RemoteRouter):
 		TransportSession (in_RemoteRouter, 30), 
-		m_Server (server), m_Socket (m_Server.GetService ()), 
+		m_Server (server), m_Service (server.GetSessionService (in_RemoteRouter)), m_Socket (m_Service),
 		m_IsEstablished (false), m_IsTerminated (false),
 		m_SessionRequestBuffer (nullptr), m_SessionCreatedBuffer (nullptr), m_SessionConfirmedBuffer (nullptr),
 		m_NextReceivedBuffer (nullptr), m_NextSendBuffer (nullptr),
 		m_ReceiveSequenceNumber (0), m_SendSequenceNumber (0), m_IsSending (false)
 	{
 		m_Establisher.reset (new NTCP2Establisher);
-		auto addr = in_RemoteRouter->GetNTCPAddress ();
-		if (addr->ntcp2)
+		if (in_RemoteRouter) // outgoing
 		{
-			memcpy (m_Establisher->m_RemoteStaticKey, addr->ntcp2->staticKey, 32);
-			memcpy (m_Establisher->m_IV, addr->ntcp2->iv, 16);
+			auto addr = in_RemoteRouter->GetNTCPAddress ();
+			if (addr && addr->ntcp2)
+			{
+				memcpy (m_Establisher->m_RemoteStaticKey, addr->ntcp2->staticKey, 32);
+				memcpy (m_Establisher->m_IV, addr->ntcp2->iv, 16);
+			}
+			else
+				LogPrint (eLogWarning, "NTCP2: Missing NTCP2 parameters");
 		}
-		else
-			LogPrint (eLogWarning, "NTCP2: Missing NTCP2 parameters"); 
 	}
 
 	NTCP2Session::~NTCP2Session ()
@@ -172,7 +173,7 @@ namespace transport
 
 	void NTCP2Session::Done ()
 	{
-		m_Server.GetService ().post (std::bind (&NTCP2Session::Terminate, shared_from_this ()));
+		m_Service.post (std::bind (&NTCP2Session::Terminate, shared_from_this ()));
 	}
 
 	void NTCP2Session::Established ()
@@ -748,7 +749,7 @@ namespace transport
 
 	void NTCP2Session::SendI2NPMessages (const std::vector<std::shared_ptr<I2NPMessage> >& msgs)
 	{
-		m_Server.GetService ().post (std::bind (&NTCP2Session::PostI2NPMessages, shared_from_this (), msgs));
+		m_Service.post (std::bind (&NTCP2Session::PostI2NPMessages, shared_from_this (), msgs));
 	}
 
 	void NTCP2Session::PostI2NPMessages (std::vector<std::shared_ptr<I2NPMessage> > msgs)
@@ -760,8 +761,9 @@ namespace transport
 			SendQueue ();		
 	}
 
-	NTCP2Server::NTCP2Server ():
-		m_IsRunning (false), m_Thread (nullptr), m_Work (m_Service)	
+	NTCP2Server::NTCP2Server (int ioThreads):
+		m_IsRunning (false), m_Thread (nullptr), m_Work (m_Service),
+		m_NumIOThreads (ioThreads), m_SessionServices ("NTCP2")
 	{
 	}
 
@@ -775,6 +777,7 @@ namespace transport
 		if (!m_IsRunning)
 		{
 			m_IsRunning = true;
+			m_SessionServices.Start (m_NumIOThreads);
 			m_Thread = new std::thread (std::bind (&NTCP2Server::Run, this));
 			auto& addresses = context.GetRouterInfo ().GetAddresses ();
 			for (const auto& address: addresses)
@@ -825,13 +828,16 @@ namespace transport
 	{
 		{
 			// we have to copy it because Terminate changes m_NTCP2Sessions
-			auto ntcpSessions = m_NTCP2Sessions;
+			auto ntcpSessions = GetNTCP2Sessions ();
 			for (auto& it: ntcpSessions)
 				it.second->Terminate ();
 			for (auto& it: m_PendingIncomingSessions)
 				it->Terminate ();
 		}
-		m_NTCP2Sessions.clear ();
+		{
+			std::unique_lock<std::mutex> l(m_NTCP2SessionsMutex);
+			m_NTCP2Sessions.clear ();
+		}
 
 		if (m_IsRunning)
 		{
@@ -843,6 +849,7 @@ namespace transport
 				delete m_Thread;
 				m_Thread = nullptr;
 			}
+			m_SessionServices.Stop ();
 		}
 	}
 
@@ -865,25 +872,30 @@ namespace transport
 	{
 		if (!session || !session->GetRemoteIdentity ()) return false;
 		auto& ident = session->GetRemoteIdentity ()->GetIdentHash ();
-		auto it = m_NTCP2Sessions.find (ident);
-		if (it != m_NTCP2Sessions.end ())
 		{
-			LogPrint (eLogWarning, "NTCP2: session to ", ident.ToBase64 (), " already exists");
-			session->Terminate();
-			return false;
+			std::unique_lock<std::mutex> l(m_NTCP2SessionsMutex);
+			if (m_NTCP2Sessions.insert (std::make_pair (ident, session)).second)
+				return true;
 		}
-		m_NTCP2Sessions.insert (std::make_pair (ident, session));
-		return true;
+		LogPrint (eLogWarning, "NTCP2: session to ", ident.ToBase64 (), " already exists");
+		session->Terminate();
+		return false;
 	}
 
 	void NTCP2Server::RemoveNTCP2Session (std::shared_ptr<NTCP2Session> session)
 	{
 		if (session && session->GetRemoteIdentity ())
-			m_NTCP2Sessions.erase (session->GetRemoteIdentity ()->GetIdentHash ());
+		{
+			std::unique_lock<std::mutex> l(m_NTCP2SessionsMutex);
+			auto it = m_NTCP2Sessions.find (session->GetRemoteIdentity ()->GetIdentHash ());
+			if (it != m_NTCP2Sessions.end () && it->second == session) // not a duplicate being terminated
+				m_NTCP2Sessions.erase (it);
+		}
 	}
 
 	std::shared_ptr<NTCP2Session> NTCP2Server::FindNTCP2Session (const i2p::data::IdentHash& ident)
 	{
+		std::unique_lock<std::mutex> l(m_NTCP2SessionsMutex);
 		auto it = m_NTCP2Sessions.find (ident);
 		if (it != m_NTCP2Sessions.end ())
 			return it->second;
@@ -893,7 +905,7 @@ namespace transport
 	void NTCP2Server::Connect(const boost::asio::ip::address & address, uint16_t port, std::shared_ptr<NTCP2Session> conn)
 	{
 		LogPrint (eLogDebug, "NTCP2: Connecting to ", address ,":",  port);
-		m_Service.post([this, address, port, conn]() 
+		conn->GetService ().post([this, address, port, conn]()
 			{
 				if (this->AddNTCP2Session (conn))
 				{
@@ -916,6 +928,12 @@ namespace transport
 		}
 	}
 
+	boost::asio::io_service& NTCP2Server::GetSessionService (std::shared_ptr<const i2p::data::RouterInfo> router)
+	{
+		if (!m_SessionServices.IsRunning ()) return m_Service;
+		return router ? m_SessionServices.GetService (router->GetIdentHash ()) : m_SessionServices.GetNextService ();
+	}
+
 	void NTCP2Server::HandleAccept (std::shared_ptr<NTCP2Session> conn, const boost::system::error_code& error)
 	{
 		if (!error)
@@ -927,7 +945,7 @@ namespace transport
 				LogPrint (eLogDebug, "NTCP2: Connected from ", ep);
 				if (conn)
 				{
-					conn->ServerLogin ();
+					conn->GetService ().post (std::bind (&NTCP2Session::ServerLogin, conn));
 				//	m_PendingIncomingSessions.push_back (conn);
 				}
 			}
@@ -954,7 +972,7 @@ namespace transport
 				LogPrint (eLogDebug, "NTCP2: Connected from ", ep);
 				if (conn)
 				{
-					conn->ServerLogin ();
+					conn->GetService ().post (std::bind (&NTCP2Session::ServerLogin, conn));
 				//	m_PendingIncomingSessions.push_back (conn);
 				}
 			}
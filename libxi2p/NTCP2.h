@@ -4,12 +4,14 @@
 #include <inttypes.h>
 #include <memory>
 #include <thread>
+#include <mutex>
 #include <list>
 #include <map>
 #include <openssl/bn.h>
 #include <boost/asio.hpp>
 #include "RouterInfo.h"
 #include "TransportSession.h"
+#include "IOServicePool.h"
 
 namespace i2p
 {
@@ -53,7 +55,6 @@ namespace transport
 		void CreateEphemeralKey ();
 
 
-		BN_CTX * m_Ctx;
 		uint8_t m_EphemeralPrivateKey[32], m_EphemeralPublicKey[32], m_RemoteEphemeralPublicKey[32]; // x25519
 		uint8_t m_RemoteStaticKey[32], m_IV[16], m_H[32] /*h*/, m_CK[33] /*ck*/, m_K[32] /*k*/;
 		uint16_t m3p2Len; 
@@ -70,6 +71,7 @@ namespace transport
 			void Done ();
 
 			boost::asio::ip::tcp::socket& GetSocket () { return m_Socket; };
+			boost::asio::io_service& GetService () { return m_Service; };
 
 			bool IsEstablished () const { return m_IsEstablished; };
 			bool IsTerminated () const { return m_IsTerminated; };
@@ -114,6 +116,7 @@ namespace transport
 		private:
 
 			NTCP2Server& m_Server;
+			boost::asio::io_service& m_Service; // session is bound to it
 			boost::asio::ip::tcp::socket m_Socket;
 			bool m_IsEstablished, m_IsTerminated;
 
@@ -138,7 +141,7 @@ namespace transport
 	{
 		public:
 
-			NTCP2Server ();
+			NTCP2Server (int ioThreads = 0);
 			~NTCP2Server ();
 
 			void Start ();
@@ -149,7 +152,8 @@ namespace transport
 			std::shared_ptr<NTCP2Session> FindNTCP2Session (const i2p::data::IdentHash& ident);
 
 			boost::asio::io_service& GetService () { return m_Service; };
-		
+			boost::asio::io_service& GetSessionService (std::shared_ptr<const i2p::data::RouterInfo> router); // incoming if router is null
+
 			void Connect(const boost::asio::ip::address & address, uint16_t port, std::shared_ptr<NTCP2Session> conn);
 
 		private:
@@ -166,14 +170,21 @@ namespace transport
 			std::thread * m_Thread;
 			boost::asio::io_service m_Service;
 			boost::asio::io_service::work m_Work;
+			int m_NumIOThreads; // 0 means sessions run on m_Thread
+			i2p::util::IOServicePool m_SessionServices;
 			std::unique_ptr<boost::asio::ip::tcp::acceptor> m_NTCP2Acceptor, m_NTCP2V6Acceptor;
-			std::map<i2p::data::IdentHash, std::shared_ptr<NTCP2Session> > m_NTCP2Sessions; 
+			mutable std::mutex m_NTCP2SessionsMutex;
+			std::map<i2p::data::IdentHash, std::shared_ptr<NTCP2Session> > m_NTCP2Sessions;
 			std::list<std::shared_ptr<NTCP2Session> > m_PendingIncomingSessions;
 
 		public:
 
 			// for HTTP/I2PControl
-			const decltype(m_NTCP2Sessions)& GetNTCP2Sessions () const { return m_NTCP2Sessions; };
+			decltype(m_NTCP2Sessions) GetNTCP2Sessions () const
+			{
+				std::unique_lock<std::mutex> l(m_NTCP2SessionsMutex);
+				return m_NTCP2Sessions;
+			}
 	};
 }
 }
@@ -32,7 +32,7 @@ namespace transport
 	
 	NTCPSession::NTCPSession (NTCPServer& server, std::shared_ptr<const i2p::data::RouterInfo> in_RemoteRouter):
 		TransportSession (in_RemoteRouter, NTCP_ESTABLISH_TIMEOUT),
-		m_Server (server), m_Socket (m_Server.GetService ()),
+		m_Server (server), m_Service (server.GetSessionService (in_RemoteRouter)), m_Socket (m_Service),
 		m_IsEstablished (false), m_IsTerminated (false),
 		m_ReceiveBufferOffset (0), m_NextMessage (nullptr), m_IsSending (false)
 	{
@@ -79,7 +79,7 @@ namespace transport
 
 	void NTCPSession::Done ()
 	{
-		m_Server.GetService ().post (std::bind (&NTCPSession::Terminate, shared_from_this ()));
+		m_Service.post (std::bind (&NTCPSession::Terminate, shared_from_this ()));
 	}
 
 	void NTCPSession::Terminate ()
@@ -113,7 +113,7 @@ namespace transport
 
 	boost::asio::io_service & NTCPSession::GetService()
 	{
-		return m_Server.GetService();
+		return m_Service;
 	}
 
 	void NTCPSession::ClientLogin ()
@@ -751,7 +751,7 @@ namespace transport
 
 	void NTCPSession::SendI2NPMessages (const std::vector<std::shared_ptr<I2NPMessage> >& msgs)
 	{
-		m_Server.GetService ().post (std::bind (&NTCPSession::PostI2NPMessages, shared_from_this (), msgs));
+		m_Service.post (std::bind (&NTCPSession::PostI2NPMessages, shared_from_this (), msgs));
 	}
 
 	void NTCPSession::PostI2NPMessages (std::vector<std::shared_ptr<I2NPMessage> > msgs)
@@ -775,9 +775,9 @@ namespace transport
 	}
 
 //-----------------------------------------
-	NTCPServer::NTCPServer (int workers):
+	NTCPServer::NTCPServer (int workers, int ioThreads):
 		m_IsRunning (false), m_Thread (nullptr), m_Work (m_Service),
-		m_TerminationTimer (m_Service), m_NTCPAcceptor (nullptr), m_NTCPV6Acceptor (nullptr),
+		m_NumIOThreads (ioThreads), m_SessionServices ("NTCP"), m_TerminationTimer (m_Service), m_NTCPAcceptor (nullptr), m_NTCPV6Acceptor (nullptr),
 		m_ProxyType(eNoProxy), m_Resolver(m_Service), m_ProxyEndpoint(nullptr),
 		m_SoftLimit(0), m_HardLimit(0)
 	{
@@ -795,6 +795,7 @@ namespace transport
 		if (!m_IsRunning)
 		{
 			m_IsRunning = true;
+			m_SessionServices.Start (m_NumIOThreads);
 			m_Thread = new std::thread (std::bind (&NTCPServer::Run, this));
 			// we are using a proxy, don't create any acceptors
 			if(UsingProxy())
@@ -865,13 +866,20 @@ namespace transport
 	{
 		{
 			// we have to copy it because Terminate changes m_NTCPSessions
-			auto ntcpSessions = m_NTCPSessions;
+			decltype(m_NTCPSessions) ntcpSessions;
+			{
+				std::unique_lock<std::mutex> l(m_NTCPSessionsMutex);
+				ntcpSessions = m_NTCPSessions;
+			}
 			for (auto& it: ntcpSessions)
 				it.second->Terminate ();
 			for (auto& it: m_PendingIncomingSessions)
 				it->Terminate ();
 		}
-		m_NTCPSessions.clear ();
+		{
+			std::unique_lock<std::mutex> l(m_NTCPSessionsMutex);
+			m_NTCPSessions.clear ();
+		}
 
 		if (m_IsRunning)
 		{
@@ -894,6 +902,7 @@ namespace transport
 				delete m_Thread;
 				m_Thread = nullptr;
 			}
+			m_SessionServices.Stop ();
 			if(m_ProxyEndpoint)
 			{
 				delete m_ProxyEndpoint;
@@ -922,31 +931,42 @@ namespace transport
 	{
 		if (!session || !session->GetRemoteIdentity ()) return false;
 		auto& ident = session->GetRemoteIdentity ()->GetIdentHash ();
-		auto it = m_NTCPSessions.find (ident);
-		if (it != m_NTCPSessions.end ())
 		{
-			LogPrint (eLogWarning, "NTCP: session to ", ident.ToBase64 (), " already exists");
-			session->Terminate();
-			return false;
+			std::unique_lock<std::mutex> l(m_NTCPSessionsMutex);
+			if (m_NTCPSessions.insert (std::pair<i2p::data::IdentHash, std::shared_ptr<NTCPSession> >(ident, session)).second)
+				return true;
 		}
-		m_NTCPSessions.insert (std::pair<i2p::data::IdentHash, std::shared_ptr<NTCPSession> >(ident, session));
-		return true;
+		LogPrint (eLogWarning, "NTCP: session to ", ident.ToBase64 (), " already exists");
+		session->Terminate();
+		return false;
 	}
 
 	void NTCPServer::RemoveNTCPSession (std::shared_ptr<NTCPSession> session)
 	{
 		if (session && session->GetRemoteIdentity ())
-			m_NTCPSessions.erase (session->GetRemoteIdentity ()->GetIdentHash ());
+		{
+			std::unique_lock<std::mutex> l(m_NTCPSessionsMutex);
+			auto it = m_NTCPSessions.find (session->GetRemoteIdentity ()->GetIdentHash ());
+			if (it != m_NTCPSessions.end () && it->second == session) // not a duplicate being terminated
+				m_NTCPSessions.erase (it);
+		}
 	}
 
 	std::shared_ptr<NTCPSession> NTCPServer::FindNTCPSession (const i2p::data::IdentHash& ident)
 	{
+		std::unique_lock<std::mutex> l(m_NTCPSessionsMutex);
 		auto it = m_NTCPSessions.find (ident);
 		if (it != m_NTCPSessions.end ())
 			return it->second;
 		return nullptr;
 	}
 
+	boost::asio::io_service& NTCPServer::GetSessionService (std::shared_ptr<const i2p::data::RouterInfo> router)
+	{
+		if (!m_SessionServices.IsRunning ()) return m_Service;
+		return router ? m_SessionServices.GetService (router->GetIdentHash ()) : m_SessionServices.GetNextService ();
+	}
+
 	void NTCPServer::HandleAccept (std::shared_ptr<NTCPSession> conn, const boost::system::error_code& error)
 	{
 		if (!error)
@@ -965,7 +985,7 @@ namespace transport
 				LogPrint (eLogDebug, "NTCP: Connected from ", ep);
 				if (conn)
 				{
-					conn->ServerLogin ();
+					conn->GetService ().post (std::bind (&NTCPSession::ServerLogin, conn));
 					m_PendingIncomingSessions.push_back (conn);
 				}
 			}
@@ -1001,7 +1021,7 @@ namespace transport
 				LogPrint (eLogDebug, "NTCP: Connected from ", ep);
 				if (conn)
 				{
-					conn->ServerLogin ();
+					conn->GetService ().post (std::bind (&NTCPSession::ServerLogin, conn));
 					m_PendingIncomingSessions.push_back (conn);
 				}
 			}
@@ -1020,11 +1040,11 @@ namespace transport
 	void NTCPServer::Connect(const boost::asio::ip::address & address, uint16_t port, std::shared_ptr<NTCPSession> conn)
 	{
 		LogPrint (eLogDebug, "NTCP: Connecting to ", address ,":",  port);
-		m_Service.post([=]() {
+		conn->GetService ().post([=]() {
 			if (this->AddNTCPSession (conn))
 			{
 
-				auto timer = std::make_shared<boost::asio::deadline_timer>(m_Service);
+				auto timer = std::make_shared<boost::asio::deadline_timer>(conn->GetService ());
 				timer->expires_from_now (boost::posix_time::seconds(NTCP_CONNECT_TIMEOUT));
 				timer->async_wait ([conn](const boost::system::error_code& ecode) {
 					if (ecode != boost::asio::error::operation_aborted)
@@ -1044,11 +1064,11 @@ namespace transport
 		{
 			return;
 		}
-		m_Service.post([=]() {
+		conn->GetService ().post([=]() {
 			if (this->AddNTCPSession (conn))
 			{
 
-				auto timer = std::make_shared<boost::asio::deadline_timer>(m_Service);
+				auto timer = std::make_shared<boost::asio::deadline_timer>(conn->GetService ());
 				auto timeout = NTCP_CONNECT_TIMEOUT * 5;
 				conn->SetTerminationTimeout(timeout * 2);
 				timer->expires_from_now (boost::posix_time::seconds(timeout));
@@ -1282,16 +1302,18 @@ namespace transport
 		{
 			auto ts = i2p::util::GetSecondsSinceEpoch ();
 			// established
+			std::unique_lock<std::mutex> l(m_NTCPSessionsMutex);
 			for (auto& it: m_NTCPSessions)
 				if (it.second->IsTerminationTimeoutExpired (ts))
 				{
 					auto session = it.second;
 					// Termniate modifies m_NTCPSession, so we postpone it
-					m_Service.post ([session] {
+					session->GetService ().post ([session] {
 							LogPrint (eLogDebug, "NTCP: No activity for ", session->GetTerminationTimeout (), " seconds");
 							session->Terminate ();
 					});
 				}
+			l.unlock ();
 			// pending
 			for (auto it = m_PendingIncomingSessions.begin (); it != m_PendingIncomingSessions.end ();)
 			{
@@ -1299,7 +1321,7 @@ namespace transport
 					it = m_PendingIncomingSessions.erase (it); // established or terminated
 				else if ((*it)->IsTerminationTimeoutExpired (ts))
 				{
-					(*it)->Terminate ();
+					(*it)->Done (); // in session's thread
 					it = m_PendingIncomingSessions.erase (it); // expired
 				}
 				else
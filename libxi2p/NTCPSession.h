@@ -13,6 +13,7 @@
 #include "I2NPProtocol.h"
 #include "TransportSession.h"
 #include "CryptoWorker.h"
+#include "IOServicePool.h"
 
 namespace i2p
 {
@@ -106,6 +107,7 @@ namespace transport
 		private:
 
 			NTCPServer& m_Server;
+			boost::asio::io_service& m_Service; // session is bound to it
 			boost::asio::ip::tcp::socket m_Socket;
 			bool m_IsEstablished, m_IsTerminated;
 
@@ -152,7 +154,7 @@ namespace transport
 			};
 
 
-			NTCPServer (int workers=4);
+			NTCPServer (int workers=4, int ioThreads=0);
 			~NTCPServer ();
 
 			void Start ();
@@ -172,6 +174,7 @@ namespace transport
 			void UseProxy(ProxyType proxy, const std::string & address, uint16_t port);
 
 			boost::asio::io_service& GetService () { return m_Service; };
+			boost::asio::io_service& GetSessionService (std::shared_ptr<const i2p::data::RouterInfo> router); // incoming if router is null
 
 			void SetSessionLimits(uint16_t softLimit, uint16_t hardLimit) { m_SoftLimit = softLimit; m_HardLimit = hardLimit; }
 			bool ShouldLimit() const { return ShouldHardLimit() || ShouldSoftLimit(); }
@@ -182,14 +185,19 @@ namespace transport
 		private:
 
 			/** @brief return true for hard limit */
-			bool ShouldHardLimit() const { return m_HardLimit && m_NTCPSessions.size() >= m_HardLimit; }
+			bool ShouldHardLimit() const { return m_HardLimit && GetNumSessions () >= m_HardLimit; }
 
 			/** @brief return true for probabalistic soft backoff */
 			bool ShouldSoftLimit() const
 			{
-				auto sessions = m_NTCPSessions.size();
+				auto sessions = GetNumSessions ();
 				return sessions && m_SoftLimit && m_SoftLimit < sessions && ( rand() % sessions ) <= m_SoftLimit;
 			}
+			size_t GetNumSessions () const // sessions are added and removed from other threads
+			{
+				std::unique_lock<std::mutex> l(m_NTCPSessionsMutex);
+				return m_NTCPSessions.size ();
+			}
 			void Run ();
 			void HandleAccept (std::shared_ptr<NTCPSession> conn, const boost::system::error_code& error);
 			void HandleAcceptV6 (std::shared_ptr<NTCPSession> conn, const boost::system::error_code& error);
@@ -209,9 +217,12 @@ namespace transport
 			std::thread * m_Thread;
 			boost::asio::io_service m_Service;
 			boost::asio::io_service::work m_Work;
+			int m_NumIOThreads; // 0 means sessions run on m_Thread
+			i2p::util::IOServicePool m_SessionServices;
 			boost::asio::deadline_timer m_TerminationTimer;
 			boost::asio::ip::tcp::acceptor * m_NTCPAcceptor, * m_NTCPV6Acceptor;
-			std::map<i2p::data::IdentHash, std::shared_ptr<NTCPSession> > m_NTCPSessions; // access from m_Thread only
+			mutable std::mutex m_NTCPSessionsMutex;
+			std::map<i2p::data::IdentHash, std::shared_ptr<NTCPSession> > m_NTCPSessions;
 			std::list<std::shared_ptr<NTCPSession> > m_PendingIncomingSessions;
 
 			ProxyType m_ProxyType;
@@ -226,7 +237,11 @@ namespace transport
 		public:
 
 			// for HTTP/I2PControl
-			const decltype(m_NTCPSessions)& GetNTCPSessions () const { return m_NTCPSessions; };
+			decltype(m_NTCPSessions) GetNTCPSessions () const
+			{
+				std::unique_lock<std::mutex> l(m_NTCPSessionsMutex);
+				return m_NTCPSessions;
+			}
 	};
 }
 }
@@ -1,6 +1,8 @@
 #include <string.h>
 #include <fstream>
 #include <vector>
+#include <atomic>
+#include <algorithm>
 #include <boost/asio.hpp>
 #include <stdexcept>
 
@@ -25,8 +27,26 @@ namespace data
 {
 	NetDb netdb;
 
+	template<typename Function>
+	static void RunParallel (size_t num, int numThreads, Function f) // f (i) for i from 0 to num - 1, current thread is one of them
+	{
+		std::atomic<size_t> next (0);
+		auto worker = [&next, num, &f]()
+		{
+			size_t i;
+			while ((i = next++) < num) f (i);
+		};
+		std::vector<std::thread> threads;
+		for (int i = 1; i < numThreads && (size_t)i < num; i++)
+			threads.emplace_back (worker);
+		worker ();
+		for (auto& it: threads) it.join ();
+	}
+
 	NetDb::NetDb (): m_IsRunning (false), m_Thread (nullptr), m_Reseeder (nullptr), m_Storage("netDb", "r", "routerInfo-", "dat"), m_FloodfillBootstrap(nullptr), m_HiddenMode(false)
 	{
+		m_NumLoadThreads = 1;
+		m_LoadStats = m_ReseedStats = NetDbLoadStats{ 0, 0, 0 };
 	}
 
 	NetDb::~NetDb ()
@@ -41,6 +61,8 @@ namespace data
 		m_Storage.Init(i2p::data::GetBase64SubstitutionTable(), 64);
 		InitProfilesStorage ();
 		m_Families.LoadCertificates ();
+		uint16_t numLoadThreads; i2p::config::GetOption("limits.netdbthreads", numLoadThreads);
+		m_NumLoadThreads = numLoadThreads ? numLoadThreads : std::max (std::thread::hardware_concurrency (), 1U);
 		Load ();
 
                 uint16_t threshold; i2p::config::GetOption("reseed.threshold", threshold);
@@ -55,11 +77,6 @@ namespace data
 	{
 		if (m_IsRunning)
 		{
-			for (auto& it: m_RouterInfos)
-				it.second->SaveProfile ();
-			DeleteObsoleteProfiles ();
-			m_RouterInfos.clear ();
-			m_Floodfills.clear ();
 			if (m_Thread)
 			{
 				m_IsRunning = false;
@@ -68,6 +85,13 @@ namespace data
 				delete m_Thread;
 				m_Thread = 0;
 			}
+			SaveSnapshot (true); // routers don't change anymore
+			m_Snapshot.Close ();
+			for (auto& it: m_RouterInfos)
+				it.second->SaveProfile ();
+			DeleteObsoleteProfiles ();
+			ClearRouterInfos ();
+			m_Floodfills.Clear ();
 			m_LeaseSets.clear();
 			m_Requests.Stop ();
 		}
@@ -76,6 +100,7 @@ namespace data
 	void NetDb::Run ()
 	{
 		uint32_t lastSave = 0, lastPublish = 0, lastExploratory = 0, lastManageRequest = 0, lastDestinationCleanup = 0;
+		uint32_t lastSnapshot = i2p::util::GetSecondsSinceEpoch ();
 		while (m_IsRunning)
 		{
 			try
@@ -83,14 +108,20 @@ namespace data
 				auto msg = m_Queue.GetNextWithTimeout (15000); // 15 sec
 				if (msg)
 				{
-					int numMsgs = 0;
-					while (msg)
+					std::vector<std::shared_ptr<const I2NPMessage> > msgs;
+					msgs.push_back (msg);
+					m_Queue.Get (msgs, 101);
+					std::vector<bool> verified;
+					std::vector<std::vector<uint8_t> > routerInfos;
+					VerifyDatabaseStoreMsgs (msgs, routerInfos, verified);
+					for (size_t i = 0; i < msgs.size (); i++)
 					{
+						msg = msgs[i];
 						LogPrint(eLogDebug, "NetDb: got request with type ", (int) msg->GetTypeID ());
 						switch (msg->GetTypeID ())
 						{
 							case eI2NPDatabaseStore:
-								HandleDatabaseStoreMsg (msg);
+								HandleDatabaseStoreMsg (msg, verified[i], &routerInfos[i]);
 							break;
 							case eI2NPDatabaseSearchReply:
 								HandleDatabaseSearchReplyMsg (msg);
@@ -102,9 +133,6 @@ namespace data
 								LogPrint (eLogError, "NetDb: unexpected message type ", (int) msg->GetTypeID ());
 								//i2p::HandleI2NPMessage (msg);
 						}
-						if (numMsgs > 100) break;
-						msg = m_Queue.Get ();
-						numMsgs++;
 					}
 				}
 				if (!m_IsRunning) break;
@@ -121,6 +149,11 @@ namespace data
 					{
 						SaveUpdated ();
 						ManageLeaseSets ();
+						if (ts - lastSnapshot >= NETDB_SNAPSHOT_INTERVAL) // for fast start after crash
+						{
+							SaveSnapshot (false);
+							lastSnapshot = ts;
+						}
 					}
 					lastSave = ts;
 				}
@@ -176,7 +209,81 @@ namespace data
     m_HiddenMode = hide;
   }
 
-	bool NetDb::AddRouterInfo (const IdentHash& ident, const uint8_t * buf, int len)
+	void NetDb::AddRouterInfos (const std::vector<std::vector<uint8_t> >& routerInfos)
+	{
+		auto start = i2p::util::GetMillisecondsSinceEpoch ();
+		// parse and verify by chunks, each one is batch
+		std::vector<std::shared_ptr<RouterInfo> > routers (routerInfos.size ());
+		size_t numChunks = (routerInfos.size () + NETDB_LOAD_CHUNK_SIZE - 1)/NETDB_LOAD_CHUNK_SIZE;
+		RunParallel (numChunks, m_NumLoadThreads, [this, &routerInfos, &routers](size_t chunk)
+			{
+				size_t first = chunk*NETDB_LOAD_CHUNK_SIZE, last = std::min (first + NETDB_LOAD_CHUNK_SIZE, routerInfos.size ());
+				BatchVerifier batch;
+				std::vector<int> indices;
+				std::vector<IdentHash> idents (last - first);
+				for (size_t i = first; i < last; i++)
+					indices.push_back (AddRouterInfoSignature (batch, routerInfos[i].data (), routerInfos[i].size (), idents[i - first]));
+				batch.Verify ();
+				for (size_t i = first; i < last; i++)
+				{
+					const auto& buf = routerInfos[i];
+					int ind = indices[i - first];
+					if (ind < 0 || batch.IsVerified (ind))
+					{
+						auto r = std::make_shared<RouterInfo> (buf.data (), buf.size (), ind < 0); // verify separately if not in batch
+						if (!r->IsUnreachable ()) routers[i] = r;
+					}
+					else
+						LogPrint (eLogError, "NetDb: RouterInfo signature verification failed: ", idents[i - first].ToBase64 ());
+				}
+			});
+		// new ones at once, known ones are updated if newer
+		std::vector<std::shared_ptr<RouterInfo> > added, known;
+		{
+			std::unique_lock<std::mutex> l(m_RouterInfosMutex);
+			std::unique_lock<std::mutex> l1(m_FloodfillsMutex);
+			for (auto& r: routers)
+			{
+				if (!r) continue;
+				if (!m_RouterInfos.insert ({r->GetIdentHash (), r}).second)
+				{
+					known.push_back (r);
+					continue;
+				}
+				IndexRouter (r);
+				if (r->IsFloodfill () && r->IsReachable ()) // floodfill must be reachable
+					m_Floodfills.Insert (r->GetIdentHash (), r);
+				added.push_back (r);
+			}
+		}
+		for (auto& r: added)
+			m_Requests.RequestComplete (r->GetIdentHash (), r);
+		for (auto& r: known)
+			AddRouterInfo (r->GetIdentHash (), r->GetBuffer (), r->GetBufferLen (), false);
+		NetDbLoadStats stats{ (int)added.size (), m_NumLoadThreads, i2p::util::GetMillisecondsSinceEpoch () - start };
+		{
+			std::unique_lock<std::mutex> l(m_StatsMutex);
+			m_ReseedStats = stats;
+		}
+		LogPrint (eLogInfo, "NetDb: ", added.size (), " of ", routerInfos.size (), " routers added in ", stats.duration,
+			" ms, ", stats.GetRate (), " RIs/sec by ", m_NumLoadThreads, " threads");
+	}
+
+	int NetDb::AddRouterInfoSignature (BatchVerifier& batch, const uint8_t * buf, size_t len, IdentHash& ident) const
+	{
+		auto identity = std::make_shared<IdentityEx>();
+		size_t identityLen = identity->FromBuffer (buf, len);
+		if (!identityLen || identity->IsRSA ()) return -1; // RSA signatures are rejected by RouterInfo
+		if (ident.IsZero ())
+			ident = identity->GetIdentHash ();
+		else if (ident != identity->GetIdentHash ())
+			return -1; // existing RouterInfo would verify it with another identity
+		size_t signatureLen = identity->GetSignatureLen ();
+		if (identityLen + signatureLen >= len) return -1;
+		return batch.Add (identity, buf, len - signatureLen, buf + len - signatureLen);
+	}
+
+	bool NetDb::AddRouterInfo (const IdentHash& ident, const uint8_t * buf, int len, bool verifySignature)
 	{
 		bool updated = true;
 		auto r = FindRouter (ident);
@@ -184,9 +291,19 @@ namespace data
 		{
 			if (r->IsNewer (buf, len))
 			{
-				r->Update (buf, len);
+				r->Update (buf, len, verifySignature);
 				LogPrint (eLogInfo, "NetDb: RouterInfo updated: ", ident.ToBase64());
-				// TODO: check if floodfill has been changed
+				{
+					std::unique_lock<std::mutex> l(m_RouterInfosMutex);
+					if (m_RouterInfos.count (ident)) IndexRouter (r); // caps might have been changed
+				}
+				{
+					std::unique_lock<std::mutex> l(m_FloodfillsMutex);
+					if (r->IsFloodfill () && r->IsReachable ())
+						m_Floodfills.Insert (ident, r);
+					else
+						m_Floodfills.Erase (ident);
+				}
 			}
 			else
 			{
@@ -196,13 +313,14 @@ namespace data
 		}
 		else
 		{
-			r = std::make_shared<RouterInfo> (buf, len);
+			r = std::make_shared<RouterInfo> (buf, len, verifySignature);
 			if (!r->IsUnreachable ())
 			{
 				bool inserted = false;
 				{
 					std::unique_lock<std::mutex> l(m_RouterInfosMutex);
 					inserted = m_RouterInfos.insert ({r->GetIdentHash (), r}).second;
+					if (inserted) IndexRouter (r);
 				}
 				if (inserted)
 				{
@@ -210,7 +328,7 @@ namespace data
 					if (r->IsFloodfill () && r->IsReachable ()) // floodfill must be reachable
 					{
 						std::unique_lock<std::mutex> l(m_FloodfillsMutex);
-						m_Floodfills.push_back (r);
+						m_Floodfills.Insert (r->GetIdentHash (), r);
 					}
 				}
 				else
@@ -360,26 +478,153 @@ namespace data
 		i2p::transport::transports.SendMessages(ih, requests);
 	}
 
-	bool NetDb::LoadRouterInfo (const std::string & path)
+	std::shared_ptr<RouterInfo> NetDb::LoadRouterInfo (const std::string & path)
 	{
 		auto r = std::make_shared<RouterInfo>(path);
+		if (!CheckLoadedRouterInfo (r))
+		{
+			LogPrint(eLogWarning, "NetDb: RI from ", path, " is invalid. Delete");
+			i2p::fs::Remove(path);
+			return nullptr;
+		}
+		return r;
+	}
+
+	std::shared_ptr<RouterInfo> NetDb::LoadRouterInfo (const NetDbSnapshotRecord& record)
+	{
+		// signatures were verified when routers came to netDb
+		auto r = std::make_shared<RouterInfo>(record.buf, record.len, !(record.flags & eNetDbSnapshotVerified));
+		bool updated = record.flags & eNetDbSnapshotUpdated;
+		r->SetUpdated (updated); // saved to file by SaveUpdated if not yet
+		if (!updated) r->SetFullPath (m_Storage.Path (record.ident.ToBase64 ()));
+		if (!r->GetRouterIdentity () || r->GetIdentHash () != record.ident || !CheckLoadedRouterInfo (r, updated))
+		{
+			m_Storage.Remove (record.ident.ToBase64 ());
+			return nullptr;
+		}
+		return r;
+	}
+
+	bool NetDb::CheckLoadedRouterInfo (std::shared_ptr<RouterInfo> r, bool keepBuffer) const
+	{
 		if (r->GetRouterIdentity () && !r->IsUnreachable () &&
 				(!r->UsesIntroducer () || m_LastLoad < r->GetTimestamp () + NETDB_INTRODUCEE_EXPIRATION_TIMEOUT*1000LL)) // 1 hour
 		{
-			r->DeleteBuffer ();
+			if (!keepBuffer) r->DeleteBuffer ();
 			r->ClearProperties (); // properties are not used for regular routers
-			m_RouterInfos[r->GetIdentHash ()] = r;
+			return true;
+		}
+		return false;
+	}
+
+	void NetDb::MergeLoadedRouterInfos (const std::vector<std::shared_ptr<RouterInfo> >& routers)
+	{
+		std::unique_lock<std::mutex> l(m_RouterInfosMutex);
+		std::unique_lock<std::mutex> l1(m_FloodfillsMutex);
+		for (auto& r: routers)
+		{
+			if (!r) continue; // invalid
+			auto& router = m_RouterInfos[r->GetIdentHash ()];
+			if (router) UnindexRouter (router.get ());
+			router = r;
+			IndexRouter (r);
 			if (r->IsFloodfill () && r->IsReachable ()) // floodfill must be reachable
-				m_Floodfills.push_back (r);
+				m_Floodfills.Insert (r->GetIdentHash (), r); // replaces previous object
+			else
+				m_Floodfills.Erase (r->GetIdentHash ());
 		}
-		else
+	}
+
+	bool NetDb::LoadSnapshot (std::vector<std::shared_ptr<RouterInfo> >& routers)
+	{
+		auto path = i2p::fs::DataDirPath (NETDB_SNAPSHOT_FILE);
+		if (!m_Snapshot.Open (path))
 		{
-			LogPrint(eLogWarning, "NetDb: RI from ", path, " is invalid. Delete");
-			i2p::fs::Remove(path);
+			if (i2p::fs::Exists (path))
+				LogPrint (eLogWarning, "NetDb: snapshot ", path, " is malformed");
+			return false;
+		}
+		if (m_Snapshot.GetCreationTime () < m_Storage.GetLastUpdateTime ())
+		{
+			// routers have been added or deleted after, by us before crash or by other program
+			LogPrint (eLogInfo, "NetDb: snapshot is older than ", m_Storage.GetName (), ", loading files");
+			m_Snapshot.Close ();
+			i2p::fs::Remove (path);
+			return false;
 		}
+		// clean one must not be trusted after files change from now. Records stay mapped until next snapshot
+		i2p::fs::Remove (path);
+		auto& records = m_Snapshot.GetRecords ();
+		bool clean = m_Snapshot.IsClean ();
+		auto creationTime = m_Snapshot.GetCreationTime ();
+		routers.resize (records.size ());
+		RunParallel (records.size (), m_NumLoadThreads, [this, &records, &routers, clean, creationTime](size_t i)
+			{
+				if (!clean)
+				{
+					// saved while running, file might have been rewritten by SaveUpdated after it
+					auto path = m_Storage.Path (records[i].ident.ToBase64 ());
+					if (i2p::fs::GetLastUpdateTime (path) >= creationTime)
+					{
+						routers[i] = LoadRouterInfo (path);
+						return;
+					}
+				}
+				routers[i] = LoadRouterInfo (records[i]);
+			});
+		LogPrint (eLogInfo, "NetDb: ", records.size (), " routers from snapshot ", path);
 		return true;
 	}
 
+	void NetDb::SaveSnapshot (bool clean)
+	{
+		std::vector<std::shared_ptr<RouterInfo> > routers;
+		{
+			std::unique_lock<std::mutex> l(m_RouterInfosMutex);
+			routers.reserve (m_RouterInfos.size ());
+			for (const auto& it: m_RouterInfos)
+				routers.push_back (it.second);
+		}
+		std::vector<NetDbSnapshotRecord> records;
+		std::vector<std::vector<uint8_t> > buffers; // read from files
+		records.reserve (routers.size ());
+		for (const auto& r: routers)
+		{
+			if (r->IsUnreachable ()) continue;
+			const auto& ident = r->GetIdentHash ();
+			NetDbSnapshotRecord record{ ident, r->GetTimestamp (), eNetDbSnapshotVerified, r->GetBuffer (), (size_t)r->GetBufferLen () };
+			if (r->IsUpdated ()) record.flags |= eNetDbSnapshotUpdated;
+			if (!record.buf)
+			{
+				auto saved = m_Snapshot.Find (ident);
+				if (saved && saved->timestamp == record.timestamp)
+				{
+					// same as in last snapshot
+					record.buf = saved->buf;
+					record.len = saved->len;
+				}
+				else
+				{
+					std::ifstream f (m_Storage.Path (r->GetIdentHashBase64 ()), std::ifstream::binary);
+					if (!f) continue;
+					buffers.emplace_back (MAX_RI_BUFFER_SIZE);
+					f.read ((char *)buffers.back ().data (), MAX_RI_BUFFER_SIZE);
+					record.buf = buffers.back ().data ();
+					record.len = f.gcount ();
+				}
+			}
+			records.push_back (record);
+		}
+		auto path = i2p::fs::DataDirPath (NETDB_SNAPSHOT_FILE);
+		if (NetDbSnapshot::Save (path, records, i2p::util::GetSecondsSinceEpoch (), clean))
+		{
+			LogPrint (eLogDebug, "NetDb: ", clean ? "clean " : "", "snapshot of ", records.size (), " routers saved");
+			m_Snapshot.Open (path); // records point to previous one until here
+		}
+		else
+			LogPrint (eLogError, "NetDb: can't save snapshot to ", path);
+	}
+
 	void NetDb::VisitLeaseSets(LeaseSetVisitor v)
 	{
 		std::unique_lock<std::mutex> lock(m_LeaseSetsMutex);
@@ -405,38 +650,13 @@ namespace data
 	size_t NetDb::VisitRandomRouterInfos(RouterInfoFilter filter, RouterInfoVisitor v, size_t n)
 	{
 		std::vector<std::shared_ptr<const RouterInfo> > found;
-		const size_t max_iters_per_cyle = 3;
-		size_t iters = max_iters_per_cyle;
-		while(n > 0)
 		{
 			std::unique_lock<std::mutex> lock(m_RouterInfosMutex);
-			uint32_t idx = rand () % m_RouterInfos.size ();
-			uint32_t i = 0;
-			for (const auto & it : m_RouterInfos) {
-				if(i >= idx) // are we at the random start point?
-				{
-					// yes, check if we want this one
-					if(filter(it.second))
-					{
-						// we have a match
-						--n;
-						found.push_back(it.second);
-						// reset max iterations per cycle
-						iters = max_iters_per_cyle;
-						break;
-					}
-				}
-				else // not there yet
-					++i;
-			}
-			// we have enough
-			if(n == 0) break;
-			--iters;
-			// have we tried enough this cycle ?
-			if(!iters) {
-				// yes let's try the next cycle
-				--n;
-				iters = max_iters_per_cyle;
+			for (size_t i = 0; i < n; i++)
+			{
+				auto r = m_RouterIndexes[eRouterIndexAll].GetRandom (filter);
+				if (!r) break; // nothing matches
+				found.push_back (r);
 			}
 		}
 		// visit the ones we found
@@ -451,16 +671,31 @@ namespace data
 	void NetDb::Load ()
 	{
 		// make sure we cleanup netDb from previous attempts
-		m_RouterInfos.clear ();
-		m_Floodfills.clear ();
+		ClearRouterInfos ();
+		m_Floodfills.Clear ();
 
 		m_LastLoad = i2p::util::GetSecondsSinceEpoch();
-		std::vector<std::string> files;
-		m_Storage.Traverse(files);
-		for (const auto& path : files)
-			LoadRouterInfo(path);
+		auto start = i2p::util::GetMillisecondsSinceEpoch ();
+		std::vector<std::shared_ptr<RouterInfo> > routers;
+		if (!LoadSnapshot (routers))
+		{
+			std::vector<std::string> files;
+			m_Storage.Traverse(files);
+			routers.resize (files.size ());
+			RunParallel (files.size (), m_NumLoadThreads, [this, &files, &routers](size_t i)
+				{
+					routers[i] = LoadRouterInfo (files[i]);
+				});
+		}
+		MergeLoadedRouterInfos (routers);
 
-		LogPrint (eLogInfo, "NetDb: ", m_RouterInfos.size(), " routers loaded (", m_Floodfills.size (), " floodfils)");
+		NetDbLoadStats stats{ (int)m_RouterInfos.size (), m_NumLoadThreads, i2p::util::GetMillisecondsSinceEpoch () - start };
+		{
+			std::unique_lock<std::mutex> l(m_StatsMutex);
+			m_LoadStats = stats;
+		}
+		LogPrint (eLogInfo, "NetDb: ", m_RouterInfos.size(), " routers loaded (", m_Floodfills.GetSize (), " floodfils) in ",
+			stats.duration, " ms, ", stats.GetRate (), " RIs/sec by ", m_NumLoadThreads, " threads");
 	}
 
 	void NetDb::SaveUpdated ()
@@ -520,6 +755,7 @@ namespace data
 					if (it->second->IsUnreachable ())
 					{
 						it->second->SaveProfile ();
+						UnindexRouter (it->second.get ());
 						it = m_RouterInfos.erase (it);
 						continue;
 					}
@@ -529,11 +765,7 @@ namespace data
 			// clean up expired floodfiils
 			{
 				std::unique_lock<std::mutex> l(m_FloodfillsMutex);
-				for (auto it = m_Floodfills.begin (); it != m_Floodfills.end ();)
-					if ((*it)->IsUnreachable ())
-						it = m_Floodfills.erase (it);
-					else
-						++it;
+				m_Floodfills.EraseIf ([](std::shared_ptr<const RouterInfo> r) { return r->IsUnreachable (); });
 			}
 		}
 	}
@@ -572,7 +804,40 @@ namespace data
 	}
 
 
-	void NetDb::HandleDatabaseStoreMsg (std::shared_ptr<const I2NPMessage> m)
+	void NetDb::VerifyDatabaseStoreMsgs (const std::vector<std::shared_ptr<const I2NPMessage> >& msgs,
+		std::vector<std::vector<uint8_t> >& routerInfos, std::vector<bool>& verified)
+	{
+		// verify RouterInfo signatures of all DatabaseStore messages at once
+		BatchVerifier batch;
+		std::vector<int> indices (msgs.size (), -1);
+		routerInfos.resize (msgs.size ());
+		uint8_t uncompressed[2048];
+		for (size_t i = 0; i < msgs.size (); i++)
+		{
+			auto m = msgs[i];
+			if (m->GetTypeID () != eI2NPDatabaseStore) continue;
+			const uint8_t * buf = m->GetPayload ();
+			size_t len = m->GetSize ();
+			if (len < DATABASE_STORE_HEADER_SIZE || buf[DATABASE_STORE_TYPE_OFFSET]) continue; // RouterInfo only
+			size_t offset = DATABASE_STORE_HEADER_SIZE;
+			if (bufbe32toh (buf + DATABASE_STORE_REPLY_TOKEN_OFFSET)) offset += 36; // tunnelID + gateway
+			if (offset + 2 > len) continue;
+			size_t size = bufbe16toh (buf + offset);
+			offset += 2;
+			if (size > 2048 || size > len - offset) continue;
+			size_t uncompressedSize = m_Inflator.Inflate (buf + offset, size, uncompressed, 2048);
+			if (!uncompressedSize || uncompressedSize >= 2048) continue;
+			routerInfos[i].assign (uncompressed, uncompressed + uncompressedSize); // kept for HandleDatabaseStoreMsg
+			IdentHash ident (buf + DATABASE_STORE_KEY_OFFSET);
+			indices[i] = AddRouterInfoSignature (batch, routerInfos[i].data (), uncompressedSize, ident);
+		}
+		batch.Verify ();
+		verified.resize (msgs.size ());
+		for (size_t i = 0; i < msgs.size (); i++)
+			verified[i] = indices[i] >= 0 && batch.IsVerified (indices[i]);
+	}
+
+	void NetDb::HandleDatabaseStoreMsg (std::shared_ptr<const I2NPMessage> m, bool verified, const std::vector<uint8_t> * routerInfo)
 	{
 		const uint8_t * buf = m->GetPayload ();
 		size_t len = m->GetSize ();
@@ -626,14 +891,19 @@ namespace data
 				LogPrint (eLogError, "NetDb: invalid RouterInfo length ", (int)size);
 				return;
 			}
-			uint8_t uncompressed[2048];
-			size_t uncompressedSize = m_Inflator.Inflate (buf + offset, size, uncompressed, 2048);
-			if (uncompressedSize && uncompressedSize < 2048)
-				updated = AddRouterInfo (ident, uncompressed, uncompressedSize);
+			if (routerInfo && !routerInfo->empty ()) // already inflated by VerifyDatabaseStoreMsgs
+				updated = AddRouterInfo (ident, routerInfo->data (), routerInfo->size (), !verified);
 			else
 			{
-				LogPrint (eLogInfo, "NetDb: decompression failed ", uncompressedSize);
-				return;
+				uint8_t uncompressed[2048];
+				size_t uncompressedSize = m_Inflator.Inflate (buf + offset, size, uncompressed, 2048);
+				if (uncompressedSize && uncompressedSize < 2048)
+					updated = AddRouterInfo (ident, uncompressed, uncompressedSize, !verified);
+				else
+				{
+					LogPrint (eLogInfo, "NetDb: decompression failed ", uncompressedSize);
+					return;
+				}
 			}
 		}
 
@@ -991,7 +1261,7 @@ namespace data
 			[v4only](std::shared_ptr<const RouterInfo> router)->bool
 			{
 				return !router->IsHidden () && router->IsPeerTesting () && router->IsSSU (v4only);
-			});
+			}, v4only ? eRouterIndexPeerTestingV4 : eRouterIndexPeerTesting);
 	}
 
 	std::shared_ptr<const RouterInfo> NetDb::GetRandomIntroducer () const
@@ -1000,7 +1270,7 @@ namespace data
 			[](std::shared_ptr<const RouterInfo> router)->bool
 			{
 				return !router->IsHidden () && router->IsIntroducer ();
-			});
+			}, eRouterIndexIntroducer);
 	}
 
 	std::shared_ptr<const RouterInfo> NetDb::GetHighBandwidthRandomRouter (std::shared_ptr<const RouterInfo> compatibleWith) const
@@ -1009,35 +1279,47 @@ namespace data
 			[compatibleWith](std::shared_ptr<const RouterInfo> router)->bool
 			{
 				return !router->IsHidden () && router != compatibleWith &&
-					router->IsCompatible (*compatibleWith) &&
-					(router->GetCaps () & RouterInfo::eHighBandwidth);
-			});
+					router->IsCompatible (*compatibleWith);
+			}, eRouterIndexHighBandwidth);
 	}
 
 	template<typename Filter>
-	std::shared_ptr<const RouterInfo> NetDb::GetRandomRouter (Filter filter) const
+	std::shared_ptr<const RouterInfo> NetDb::GetRandomRouter (Filter filter, RouterIndexType index) const
 	{
-		if (m_RouterInfos.empty())
-			return 0;
-		uint32_t ind = rand () % m_RouterInfos.size ();
-		for (int j = 0; j < 2; j++)
-		{
-			uint32_t i = 0;
-			std::unique_lock<std::mutex> l(m_RouterInfosMutex);
-			for (const auto& it: m_RouterInfos)
+		std::unique_lock<std::mutex> l(m_RouterInfosMutex);
+		return m_RouterIndexes[index].GetRandom (
+			[&filter](std::shared_ptr<const RouterInfo> router)->bool
 			{
-				if (i >= ind)
-				{
-					if (!it.second->IsUnreachable () && filter (it.second))
-						return it.second;
-				}
-				else
-					i++;
-			}
-			// we couldn't find anything, try second pass
-			ind = 0;
-		}
-		return nullptr; // seems we have too few routers
+				return !router->IsUnreachable () && filter (router);
+			});
+	}
+
+	void NetDb::IndexRouter (std::shared_ptr<RouterInfo> r)
+	{
+		bool isIndexed[eNumRouterIndexes];
+		isIndexed[eRouterIndexAll] = true;
+		isIndexed[eRouterIndexHighBandwidth] = r->IsHighBandwidth ();
+		isIndexed[eRouterIndexIntroducer] = r->IsIntroducer ();
+		isIndexed[eRouterIndexPeerTestingV4] = r->IsPeerTesting () && r->IsSSU (true);
+		isIndexed[eRouterIndexPeerTesting] = r->IsPeerTesting () && r->IsSSU (false);
+		for (int i = 0; i < eNumRouterIndexes; i++)
+			if (isIndexed[i])
+				m_RouterIndexes[i].Insert (r);
+			else
+				m_RouterIndexes[i].Erase (r.get ());
+	}
+
+	void NetDb::UnindexRouter (const RouterInfo * r)
+	{
+		for (auto& it: m_RouterIndexes)
+			it.Erase (r);
+	}
+
+	void NetDb::ClearRouterInfos ()
+	{
+		m_RouterInfos.clear ();
+		for (auto& it: m_RouterIndexes)
+			it.Clear ();
 	}
 
 	void NetDb::PostI2NPMsg (std::shared_ptr<const I2NPMessage> msg)
@@ -1049,77 +1331,39 @@ namespace data
 		const std::set<IdentHash>& excluded, bool closeThanUsOnly) const
 	{
 		std::shared_ptr<const RouterInfo> r;
-		XORMetric minMetric;
 		IdentHash destKey = CreateRoutingKey (destination);
-		if (closeThanUsOnly)
-			minMetric = destKey ^ i2p::context.GetIdentHash ();
-		else
-			minMetric.SetMax ();
+		XORMetric ourMetric;
+		if (closeThanUsOnly) ourMetric = destKey ^ i2p::context.GetIdentHash ();
 		std::unique_lock<std::mutex> l(m_FloodfillsMutex);
-		for (const auto& it: m_Floodfills)
-		{
-			if (!it->IsUnreachable ())
+		m_Floodfills.VisitClosest (destKey,
+			[&](std::shared_ptr<const RouterInfo> ff)->bool
 			{
-				XORMetric m = destKey ^ it->GetIdentHash ();
-				if (m < minMetric && !excluded.count (it->GetIdentHash ()))
-				{
-					minMetric = m;
-					r = it;
-				}
-			}
-		}
+				if (closeThanUsOnly && !((destKey ^ ff->GetIdentHash ()) < ourMetric)) return false; // rest are farther
+				if (ff->IsUnreachable () || excluded.count (ff->GetIdentHash ())) return true;
+				r = ff;
+				return false;
+			});
 		return r;
 	}
 
 	std::vector<IdentHash> NetDb::GetClosestFloodfills (const IdentHash& destination, size_t num,
 		std::set<IdentHash>& excluded, bool closeThanUsOnly) const
 	{
-		struct Sorted
-		{
-			std::shared_ptr<const RouterInfo> r;
-			XORMetric metric;
-			bool operator< (const Sorted& other) const { return metric < other.metric; };
-		};
-
-		std::set<Sorted> sorted;
+		std::vector<IdentHash> res;
+		if (!num) return res;
 		IdentHash destKey = CreateRoutingKey (destination);
 		XORMetric ourMetric;
 		if (closeThanUsOnly) ourMetric = destKey ^ i2p::context.GetIdentHash ();
-		{
-			std::unique_lock<std::mutex> l(m_FloodfillsMutex);
-			for (const auto& it: m_Floodfills)
-			{
-				if (!it->IsUnreachable ())
-				{
-					XORMetric m = destKey ^ it->GetIdentHash ();
-					if (closeThanUsOnly && ourMetric < m) continue;
-					if (sorted.size () < num)
-						sorted.insert ({it, m});
-					else if (m < sorted.rbegin ()->metric)
-					{
-						sorted.insert ({it, m});
-						sorted.erase (std::prev (sorted.end ()));
-					}
-				}
-			}
-		}
-
-		std::vector<IdentHash> res;
-		size_t i = 0;
-		for (const auto& it: sorted)
-		{
-			if (i < num)
+		std::unique_lock<std::mutex> l(m_FloodfillsMutex);
+		m_Floodfills.VisitClosest (destKey,
+			[&](std::shared_ptr<const RouterInfo> ff)->bool
 			{
-				const auto& ident = it.r->GetIdentHash ();
-				if (!excluded.count (ident))
-				{
+				const auto& ident = ff->GetIdentHash ();
+				if (closeThanUsOnly && ourMetric < (destKey ^ ident)) return false; // rest are farther
+				if (!ff->IsUnreachable () && !excluded.count (ident))
 					res.push_back (ident);
-					i++;
-				}
-			}
-			else
-				break;
-		}
+				return res.size () < num;
+			});
 		return res;
 	}
 
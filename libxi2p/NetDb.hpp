@@ -5,6 +5,7 @@
 #include <set>
 #include <map>
 #include <list>
+#include <vector>
 #include <string>
 #include <thread>
 #include <mutex>
@@ -21,6 +22,9 @@
 #include "Reseed.h"
 #include "NetDbRequests.h"
 #include "Family.h"
+#include "RandomIndex.h"
+#include "XORIndex.h"
+#include "NetDbSnapshot.h"
 
 namespace i2p
 {
@@ -32,6 +36,28 @@ namespace data
 	const int NETDB_MIN_EXPIRATION_TIMEOUT = 90*60; // 1.5 hours
 	const int NETDB_MAX_EXPIRATION_TIMEOUT = 27*60*60; // 27 hours
 	const int NETDB_PUBLISH_INTERVAL = 60*40;
+	const int NETDB_SNAPSHOT_INTERVAL = 30*60; // in seconds, and at shutdown
+	const char NETDB_SNAPSHOT_FILE[] = "netDb.snapshot"; // in datadir
+	const size_t NETDB_LOAD_CHUNK_SIZE = 64; // RouterInfos verified in batch by worker thread
+
+	enum RouterIndexType // routers by caps, for random selection
+	{
+		eRouterIndexAll = 0,
+		eRouterIndexHighBandwidth,
+		eRouterIndexIntroducer,
+		eRouterIndexPeerTestingV4,
+		eRouterIndexPeerTesting, // v4 or v6
+		eNumRouterIndexes
+	};
+
+	struct NetDbLoadStats // of parallel load or reseed
+	{
+		int numRouters; // added
+		int numThreads;
+		uint64_t duration; // in milliseconds
+
+		int GetRate () const { return duration ? numRouters*1000LL/duration : numRouters; }; // routers per second
+	};
 
 	/** function for visiting a leaseset stored in a floodfill */
 	typedef std::function<void(const IdentHash, std::shared_ptr<LeaseSet>)> LeaseSetVisitor;
@@ -53,7 +79,8 @@ namespace data
 			void Stop ();
 
 			bool AddRouterInfo (const uint8_t * buf, int len);
-			bool AddRouterInfo (const IdentHash& ident, const uint8_t * buf, int len);
+			bool AddRouterInfo (const IdentHash& ident, const uint8_t * buf, int len, bool verifySignature = true);
+			void AddRouterInfos (const std::vector<std::vector<uint8_t> >& routerInfos); // parsed and verified by worker threads, in batch
 			bool AddLeaseSet (const IdentHash& ident, const uint8_t * buf, int len, std::shared_ptr<i2p::tunnel::InboundTunnel> from);
 			std::shared_ptr<RouterInfo> FindRouter (const IdentHash& ident) const;
 			std::shared_ptr<LeaseSet> FindLeaseSet (const IdentHash& destination) const;
@@ -62,7 +89,7 @@ namespace data
 			void RequestDestination (const IdentHash& destination, RequestedDestination::RequestComplete requestComplete = nullptr);
 		void RequestDestinationFrom (const IdentHash& destination, const IdentHash & from, bool exploritory, RequestedDestination::RequestComplete requestComplete = nullptr);
 
-			void HandleDatabaseStoreMsg (std::shared_ptr<const I2NPMessage> msg);
+			void HandleDatabaseStoreMsg (std::shared_ptr<const I2NPMessage> msg, bool verified = false, const std::vector<uint8_t> * routerInfo = nullptr);
 			void HandleDatabaseSearchReplyMsg (std::shared_ptr<const I2NPMessage> msg);
 			void HandleDatabaseLookupMsg (std::shared_ptr<const I2NPMessage> msg);
 
@@ -88,8 +115,10 @@ namespace data
 
 			// for web interface
 			int GetNumRouters () const { return m_RouterInfos.size (); };
-			int GetNumFloodfills () const { return m_Floodfills.size (); };
+			int GetNumFloodfills () const { return m_Floodfills.GetSize (); };
 			int GetNumLeaseSets () const { return m_LeaseSets.size (); };
+			NetDbLoadStats GetLoadStats () const { std::unique_lock<std::mutex> l(m_StatsMutex); return m_LoadStats; };
+			NetDbLoadStats GetReseedStats () const { std::unique_lock<std::mutex> l(m_StatsMutex); return m_ReseedStats; }; // last one
 
 			/** visit all lease sets we currently store */
 			void VisitLeaseSets(LeaseSetVisitor v);
@@ -100,23 +129,33 @@ namespace data
 			/** visit N random router that match using filter, then visit them with a visitor, return number of RouterInfos that were visited */
 			size_t VisitRandomRouterInfos(RouterInfoFilter f, RouterInfoVisitor v, size_t n);
 
-			void ClearRouterInfos () { m_RouterInfos.clear (); };
+			void ClearRouterInfos ();
 
 		private:
 
 			void Load ();
-			bool LoadRouterInfo (const std::string & path);
+			std::shared_ptr<RouterInfo> LoadRouterInfo (const std::string & path); // nullptr if invalid, file is deleted
+			std::shared_ptr<RouterInfo> LoadRouterInfo (const NetDbSnapshotRecord& record);
+			bool CheckLoadedRouterInfo (std::shared_ptr<RouterInfo> r, bool keepBuffer = false) const; // false if invalid or expired
+			void MergeLoadedRouterInfos (const std::vector<std::shared_ptr<RouterInfo> >& routers); // in one locked pass
+			bool LoadSnapshot (std::vector<std::shared_ptr<RouterInfo> >& routers); // false if missing or stale, files must be loaded
+			void SaveSnapshot (bool clean); // clean at shutdown, files don't change after it
 			void SaveUpdated ();
 			void Run (); // exploratory thread
 			void Explore (int numDestinations);
 			void Publish ();
 			void ManageLeaseSets ();
 			void ManageRequests ();
+			int AddRouterInfoSignature (BatchVerifier& batch, const uint8_t * buf, size_t len, IdentHash& ident) const; // returns index in batch or -1, non-zero ident must match
+			void VerifyDatabaseStoreMsgs (const std::vector<std::shared_ptr<const I2NPMessage> >& msgs,
+				std::vector<std::vector<uint8_t> >& routerInfos, std::vector<bool>& verified); // routerInfos are inflated
 
 		void ReseedFromFloodfill(const RouterInfo & ri, int numRouters=40, int numFloodfills=20);
 
     	template<typename Filter>
-        std::shared_ptr<const RouterInfo> GetRandomRouter (Filter filter) const;
+        std::shared_ptr<const RouterInfo> GetRandomRouter (Filter filter, RouterIndexType index = eRouterIndexAll) const;
+			void IndexRouter (std::shared_ptr<RouterInfo> r); // by current caps, m_RouterInfosMutex must be locked
+			void UnindexRouter (const RouterInfo * r);
 
 		private:
 
@@ -124,11 +163,15 @@ namespace data
 			std::map<IdentHash, std::shared_ptr<LeaseSet> > m_LeaseSets;
 			mutable std::mutex m_RouterInfosMutex;
 			std::map<IdentHash, std::shared_ptr<RouterInfo> > m_RouterInfos;
+			RandomIndex<RouterInfo> m_RouterIndexes[eNumRouterIndexes]; // protected by m_RouterInfosMutex
 			mutable std::mutex m_FloodfillsMutex;
-			std::list<std::shared_ptr<RouterInfo> > m_Floodfills;
+			XORIndex<RouterInfo> m_Floodfills; // by ident hash, metric is ident hash to routing key of destination
 
 			bool m_IsRunning;
 			uint64_t m_LastLoad;
+			int m_NumLoadThreads; // parse and verify RouterInfos at load and reseed
+			mutable std::mutex m_StatsMutex;
+			NetDbLoadStats m_LoadStats, m_ReseedStats; // written by reseed thread, read by web interface
 			std::thread * m_Thread;
 			i2p::util::Queue<std::shared_ptr<const I2NPMessage> > m_Queue; // of I2NPDatabaseStoreMsg
 
@@ -136,6 +179,7 @@ namespace data
 			Reseeder * m_Reseeder;
 			Families m_Families;
 			i2p::fs::HashedStorage m_Storage;
+			NetDbSnapshot m_Snapshot; // last saved or loaded, records are reused for routers without buffer
 
 			friend class NetDbRequests;
 			NetDbRequests m_Requests;
@@ -0,0 +1,172 @@
+#include <string.h>
+#include <fstream>
+#include <algorithm>
+#include <boost/filesystem.hpp>
+#ifndef _WIN32
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#endif
+#include "I2PEndian.h"
+#include "NetDbSnapshot.h"
+
+namespace i2p
+{
+namespace data
+{
+	NetDbSnapshot::NetDbSnapshot (): m_Data (nullptr), m_Size (0), m_CreationTime (0), m_Flags (0)
+	{
+	}
+
+	NetDbSnapshot::~NetDbSnapshot ()
+	{
+		Close ();
+	}
+
+	bool NetDbSnapshot::Open (const std::string& path)
+	{
+		Close ();
+#ifdef _WIN32
+		std::ifstream f (path, std::ifstream::binary);
+		if (!f) return false;
+		f.seekg (0, std::ios::end);
+		m_Buffer.resize (f.tellg ());
+		f.seekg (0, std::ios::beg);
+		if (m_Buffer.empty () || !f.read ((char *)m_Buffer.data (), m_Buffer.size ()))
+		{
+			m_Buffer.clear ();
+			return false;
+		}
+		m_Data = m_Buffer.data ();
+		m_Size = m_Buffer.size ();
+#else
+		int fd = open (path.c_str (), O_RDONLY);
+		if (fd < 0) return false;
+		struct stat st;
+		if (fstat (fd, &st) < 0 || st.st_size < (off_t)NETDB_SNAPSHOT_HEADER_SIZE)
+		{
+			close (fd);
+			return false;
+		}
+		void * data = mmap (nullptr, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+		close (fd); // mapping stays
+		if (data == MAP_FAILED) return false;
+		madvise (data, st.st_size, MADV_WILLNEED); // read sequentially at once
+		m_Data = (const uint8_t *)data;
+		m_Size = st.st_size;
+#endif
+		if (!Parse ())
+		{
+			Close ();
+			return false;
+		}
+		return true;
+	}
+
+	void NetDbSnapshot::Close ()
+	{
+		m_Records.clear ();
+		m_CreationTime = 0;
+		m_Flags = 0;
+		if (!m_Data) return;
+#ifdef _WIN32
+		std::vector<uint8_t> ().swap (m_Buffer);
+#else
+		munmap ((void *)m_Data, m_Size);
+#endif
+		m_Data = nullptr;
+		m_Size = 0;
+	}
+
+	bool NetDbSnapshot::Parse ()
+	{
+		if (m_Size < NETDB_SNAPSHOT_HEADER_SIZE || memcmp (m_Data, NETDB_SNAPSHOT_MAGIC, 8) ||
+			bufbe32toh (m_Data + 8) != NETDB_SNAPSHOT_VERSION)
+			return false;
+		uint32_t numRecords = bufbe32toh (m_Data + 12);
+		m_CreationTime = bufbe64toh (m_Data + 16);
+		m_Flags = bufbe32toh (m_Data + 24);
+		if (numRecords > (m_Size - NETDB_SNAPSHOT_HEADER_SIZE)/NETDB_SNAPSHOT_RECORD_HEADER_SIZE) return false;
+		m_Records.resize (numRecords);
+		size_t offset = NETDB_SNAPSHOT_HEADER_SIZE;
+		for (uint32_t i = 0; i < numRecords; i++)
+		{
+			if (offset + NETDB_SNAPSHOT_RECORD_HEADER_SIZE > m_Size) return false;
+			auto& record = m_Records[i];
+			const uint8_t * buf = m_Data + offset;
+			record.ident = Tag<32> (buf);
+			if (i > 0 && !(m_Records[i - 1].ident < record.ident)) return false; // must be sorted
+			record.timestamp = bufbe64toh (buf + 32);
+			record.flags = buf[40];
+			record.len = bufbe16toh (buf + 41);
+			offset += NETDB_SNAPSHOT_RECORD_HEADER_SIZE;
+			if (!record.len || record.len > NETDB_SNAPSHOT_MAX_BUFFER_SIZE || offset + record.len > m_Size) return false;
+			record.buf = m_Data + offset;
+			offset += record.len;
+		}
+		return offset == m_Size; // truncated or garbage otherwise
+	}
+
+	const NetDbSnapshotRecord * NetDbSnapshot::Find (const Tag<32>& ident) const
+	{
+		auto it = std::lower_bound (m_Records.begin (), m_Records.end (), ident,
+			[](const NetDbSnapshotRecord& r, const Tag<32>& id) { return r.ident < id; });
+		if (it == m_Records.end () || it->ident != ident) return nullptr;
+		return &*it;
+	}
+
+	bool NetDbSnapshot::Save (const std::string& path, std::vector<NetDbSnapshotRecord> records, uint64_t ts, bool clean)
+	{
+		records.erase (std::remove_if (records.begin (), records.end (),
+			[](const NetDbSnapshotRecord& r) { return !r.buf || !r.len || r.len > NETDB_SNAPSHOT_MAX_BUFFER_SIZE; }), records.end ());
+		std::sort (records.begin (), records.end (),
+			[](const NetDbSnapshotRecord& r1, const NetDbSnapshotRecord& r2) { return r1.ident < r2.ident; });
+		records.erase (std::unique (records.begin (), records.end (),
+			[](const NetDbSnapshotRecord& r1, const NetDbSnapshotRecord& r2) { return r1.ident == r2.ident; }), records.end ());
+		std::string tmp = path + ".tmp";
+		{
+			std::ofstream f (tmp, std::ofstream::binary | std::ofstream::out | std::ofstream::trunc);
+			if (!f.is_open ()) return false;
+			uint8_t header[NETDB_SNAPSHOT_HEADER_SIZE];
+			memcpy (header, NETDB_SNAPSHOT_MAGIC, 8);
+			htobe32buf (header + 8, NETDB_SNAPSHOT_VERSION);
+			htobe32buf (header + 12, records.size ());
+			htobe64buf (header + 16, ts);
+			htobe32buf (header + 24, clean ? eNetDbSnapshotClean : 0);
+			f.write ((char *)header, NETDB_SNAPSHOT_HEADER_SIZE);
+			for (const auto& it: records)
+			{
+				uint8_t recordHeader[NETDB_SNAPSHOT_RECORD_HEADER_SIZE];
+				memcpy (recordHeader, it.ident, 32);
+				htobe64buf (recordHeader + 32, it.timestamp);
+				recordHeader[40] = it.flags;
+				htobe16buf (recordHeader + 41, it.len);
+				f.write ((char *)recordHeader, NETDB_SNAPSHOT_RECORD_HEADER_SIZE);
+				f.write ((const char *)it.buf, it.len);
+			}
+			f.flush ();
+			if (!f) return false;
+		}
+		boost::system::error_code ec;
+#ifndef _WIN32
+		// on disk before rename, otherwise crash may leave renamed but empty file
+		int fd = open (tmp.c_str (), O_WRONLY);
+		bool synced = fd >= 0 && !fsync (fd);
+		if (fd >= 0) close (fd);
+		if (!synced)
+		{
+			boost::filesystem::remove (tmp, ec);
+			return false;
+		}
+#endif
+		boost::filesystem::rename (tmp, path, ec);
+		if (ec)
+		{
+			boost::filesystem::remove (tmp, ec);
+			return false;
+		}
+		return true;
+	}
+}
+}
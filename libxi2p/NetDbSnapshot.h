@@ -0,0 +1,80 @@
+#ifndef NETDB_SNAPSHOT_H__
+#define NETDB_SNAPSHOT_H__
+
+#include <inttypes.h>
+#include <string>
+#include <vector>
+#include "Tag.h"
+
+namespace i2p
+{
+namespace data
+{
+	const char NETDB_SNAPSHOT_MAGIC[] = "i2pdndbs"; // 8 bytes
+	const uint32_t NETDB_SNAPSHOT_VERSION = 2;
+	const size_t NETDB_SNAPSHOT_HEADER_SIZE = 28; // magic 8, version 4, number of records 4, creation time 8, flags 4
+	const size_t NETDB_SNAPSHOT_RECORD_HEADER_SIZE = 43; // ident 32, timestamp 8, flags 1, length 2
+	const size_t NETDB_SNAPSHOT_MAX_BUFFER_SIZE = 2048; // same as RouterInfo
+
+	enum NetDbSnapshotHeaderFlags
+	{
+		eNetDbSnapshotClean = 0x01 // saved at shutdown, files haven't changed after it
+	};
+
+	enum NetDbSnapshotFlags
+	{
+		eNetDbSnapshotVerified = 0x01, // signature has been checked
+		eNetDbSnapshotUpdated = 0x02 // not saved to file yet
+	};
+
+	struct NetDbSnapshotRecord
+	{
+		Tag<32> ident;
+		uint64_t timestamp; // of RouterInfo, in milliseconds
+		uint8_t flags;
+		const uint8_t * buf; // points to mapped file if opened
+		size_t len;
+	};
+
+	/**
+	 * @brief Single file of RouterInfo buffers with flags, sorted by ident.
+	 * Mapped to memory and checked at startup instead of reading file per router
+	 */
+	class NetDbSnapshot
+	{
+		public:
+
+			NetDbSnapshot ();
+			~NetDbSnapshot ();
+
+			bool Open (const std::string& path); // false if missing or malformed
+			void Close ();
+			bool IsOpen () const { return m_Data; };
+
+			uint64_t GetCreationTime () const { return m_CreationTime; }; // in seconds
+			bool IsClean () const { return m_Flags & eNetDbSnapshotClean; };
+			const std::vector<NetDbSnapshotRecord>& GetRecords () const { return m_Records; };
+			const NetDbSnapshotRecord * Find (const Tag<32>& ident) const;
+
+			/** @brief Writes to temporary file, syncs and renames it, so existing snapshot is either old or new */
+			static bool Save (const std::string& path, std::vector<NetDbSnapshotRecord> records, uint64_t ts, bool clean);
+
+		private:
+
+			bool Parse ();
+
+		private:
+
+			const uint8_t * m_Data;
+			size_t m_Size;
+#ifdef _WIN32
+			std::vector<uint8_t> m_Buffer; // no mapping, read at once
+#endif
+			uint64_t m_CreationTime;
+			uint32_t m_Flags;
+			std::vector<NetDbSnapshotRecord> m_Records;
+	};
+}
+}
+
+#endif
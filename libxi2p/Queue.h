@@ -1,10 +1,14 @@
 #ifndef QUEUE_H__
 #define QUEUE_H__
 
-#include <queue>
+#include <inttypes.h>
+#include <deque>
 #include <vector>
+#include <memory>
+#include <atomic>
 #include <mutex>
 #include <thread>
+#include <chrono>
 #include <condition_variable>
 #include <functional>
 #include <utility>
@@ -13,16 +17,29 @@ namespace i2p
 {
 namespace util
 {
-	template<typename Element>
+	const size_t QUEUE_CACHE_LINE_SIZE = 64;
+	const int QUEUE_NUM_SPINS_BEFORE_WAIT = 16;
+
+	// bounded lock-free ring of Capacity elements (power of 2), producers never block.
+	// If ring is full elements go to overflow list until consumer drains it.
+	// Consumers sleep only if queue is empty, producers don't touch mutex unless someone sleeps
+	template<typename Element, size_t Capacity = 4096>
 	class Queue
 	{
 		public:
 
+			Queue (): m_Cells (new Cell[Capacity]), m_EnqueuePos (0), m_DequeuePos (0),
+				m_OverflowSize (0), m_NumWaiters (0)
+			{
+				static_assert (Capacity >= 2 && !(Capacity & (Capacity - 1)), "Queue capacity must be power of 2");
+				for (size_t i = 0; i < Capacity; i++)
+					m_Cells[i].sequence.store (i, std::memory_order_relaxed);
+			}
+
 			void Put (Element e)
 			{
-				std::unique_lock<std::mutex>  l(m_QueueMutex);
-				m_Queue.push (std::move(e));
-				m_NonEmpty.notify_one ();
+				Push (std::move (e));
+				Notify (false);
 			}
 
 			template<template<typename, typename...>class Container, typename... R>
@@ -30,93 +47,258 @@ namespace util
 			{
 				if (!vec.empty ())
 				{
-					std::unique_lock<std::mutex>  l(m_QueueMutex);
 					for (const auto& it: vec)
-						m_Queue.push (std::move(it));
-					m_NonEmpty.notify_one ();
+						Push (it);
+					Notify (true);
 				}
 			}
 
 			Element GetNext ()
 			{
-				std::unique_lock<std::mutex> l(m_QueueMutex);
-				auto el = GetNonThreadSafe ();
+				auto el = Get ();
 				if (!el)
 				{
-					m_NonEmpty.wait (l);
-					el = GetNonThreadSafe ();
+					WaitNonEmpty (-1);
+					el = Get ();
 				}
 				return el;
 			}
 
 			Element GetNextWithTimeout (int usec)
 			{
-				std::unique_lock<std::mutex> l(m_QueueMutex);
-				auto el = GetNonThreadSafe ();
+				auto el = Get ();
 				if (!el)
 				{
-					m_NonEmpty.wait_for (l, std::chrono::milliseconds (usec));
-					el = GetNonThreadSafe ();
+					WaitNonEmpty (usec);
+					el = Get ();
+				}
+				return el;
+			}
+
+			/** @brief Doesn't wait while isReady () is true, it's checked under lock of WakeUp.
+			 * Set state of isReady by another thread before WakeUp, and the wake up isn't lost */
+			Element GetNextWithTimeout (int msec, const std::function<bool ()>& isReady)
+			{
+				auto el = Get ();
+				if (!el)
+				{
+					WaitNonEmpty (msec, &isReady);
+					el = Get ();
 				}
 				return el;
 			}
 
 			void Wait ()
 			{
-				std::unique_lock<std::mutex> l(m_QueueMutex);
-				m_NonEmpty.wait (l);
+				WaitNonEmpty (-1);
 			}
 
 			bool Wait (int sec, int usec)
 			{
-				std::unique_lock<std::mutex> l(m_QueueMutex);
-				return m_NonEmpty.wait_for (l, std::chrono::seconds (sec) + std::chrono::milliseconds (usec)) != std::cv_status::timeout;
+				return WaitNonEmpty (sec*1000 + usec);
 			}
 
 			bool IsEmpty ()
 			{
-				std::unique_lock<std::mutex> l(m_QueueMutex);
-				return m_Queue.empty ();
+				return !GetSize ();
 			}
 
 			int GetSize ()
 			{
-				std::unique_lock<std::mutex> l(m_QueueMutex);
-				return m_Queue.size ();
+				size_t dequeuePos = m_DequeuePos.load (std::memory_order_relaxed);
+				size_t enqueuePos = m_EnqueuePos.load (std::memory_order_relaxed);
+				return (enqueuePos > dequeuePos ? enqueuePos - dequeuePos : 0) +
+					m_OverflowSize.load (std::memory_order_relaxed);
 			}
 
-			void WakeUp () { m_NonEmpty.notify_all (); };
+			void WakeUp ()
+			{
+				std::unique_lock<std::mutex> l(m_WaitMutex);
+				m_NonEmpty.notify_all ();
+			}
 
 			Element Get ()
 			{
-				std::unique_lock<std::mutex> l(m_QueueMutex);
-				return GetNonThreadSafe ();
+				Element el = nullptr;
+				if (!Pop (el) && m_OverflowSize.load (std::memory_order_acquire) > 0 && Refill ())
+					Pop (el);
+				return el;
+			}
+
+			size_t Get (std::vector<Element>& elements, size_t maxNum) // appends up to maxNum elements, returns number of them
+			{
+				size_t num = PopBatch (elements, maxNum);
+				if (num < maxNum && m_OverflowSize.load (std::memory_order_acquire) > 0 && Refill ())
+					num += PopBatch (elements, maxNum - num);
+				return num;
 			}
 
-			Element Peek ()
+			Element Peek () // consumer thread only
 			{
-				std::unique_lock<std::mutex> l(m_QueueMutex);
-				return GetNonThreadSafe (true);
+				size_t pos = m_DequeuePos.load (std::memory_order_relaxed);
+				auto& cell = m_Cells[pos & (Capacity - 1)];
+				if (cell.sequence.load (std::memory_order_acquire) == pos + 1)
+					return cell.data;
+				std::unique_lock<std::mutex> l(m_OverflowMutex);
+				return m_Overflow.empty () ? nullptr : m_Overflow.front ();
 			}
 
 		private:
 
-			Element GetNonThreadSafe (bool peek = false)
+			struct Cell
 			{
-				if (!m_Queue.empty ())
+				std::atomic<size_t> sequence; // == position if free, position + 1 if contains element
+				Element data;
+			};
+
+			void Push (Element e)
+			{
+				if (m_OverflowSize.load (std::memory_order_acquire) > 0 || !TryPush (e))
+				{
+					// ring is full, new elements go after overflow to keep order
+					std::unique_lock<std::mutex> l(m_OverflowMutex);
+					m_Overflow.push_back (std::move (e));
+					m_OverflowSize.fetch_add (1, std::memory_order_release);
+				}
+			}
+
+			bool TryPush (Element& e) // moves e if succeeded, false if ring is full
+			{
+				size_t pos = m_EnqueuePos.load (std::memory_order_relaxed);
+				for (;;)
+				{
+					auto& cell = m_Cells[pos & (Capacity - 1)];
+					intptr_t diff = (intptr_t)cell.sequence.load (std::memory_order_acquire) - (intptr_t)pos;
+					if (!diff)
+					{
+						if (m_EnqueuePos.compare_exchange_weak (pos, pos + 1, std::memory_order_relaxed))
+						{
+							cell.data = std::move (e);
+							cell.sequence.store (pos + 1, std::memory_order_release);
+							return true;
+						}
+					}
+					else if (diff < 0)
+						return false;
+					else
+						pos = m_EnqueuePos.load (std::memory_order_relaxed);
+				}
+			}
+
+			bool Refill () // move overflow to ring with one lock, returns false if nothing moved
+			{
+				std::unique_lock<std::mutex> l(m_OverflowMutex);
+				size_t num = 0;
+				while (!m_Overflow.empty () && TryPush (m_Overflow.front ()))
+				{
+					m_Overflow.pop_front ();
+					num++;
+				}
+				if (num) m_OverflowSize.fetch_sub (num, std::memory_order_release);
+				return num > 0;
+			}
+
+			bool Pop (Element& el)
+			{
+				size_t pos = m_DequeuePos.load (std::memory_order_relaxed);
+				for (;;)
+				{
+					auto& cell = m_Cells[pos & (Capacity - 1)];
+					intptr_t diff = (intptr_t)cell.sequence.load (std::memory_order_acquire) - (intptr_t)(pos + 1);
+					if (!diff)
+					{
+						if (m_DequeuePos.compare_exchange_weak (pos, pos + 1, std::memory_order_relaxed))
+						{
+							el = std::move (cell.data);
+							cell.data = nullptr;
+							cell.sequence.store (pos + Capacity, std::memory_order_release);
+							return true;
+						}
+					}
+					else if (diff < 0)
+						return false; // empty
+					else
+						pos = m_DequeuePos.load (std::memory_order_relaxed);
+				}
+			}
+
+			size_t PopBatch (std::vector<Element>& elements, size_t maxNum)
+			{
+				size_t pos = m_DequeuePos.load (std::memory_order_relaxed);
+				for (;;)
+				{
+					// claim all published cells with one CAS
+					size_t num = 0;
+					while (num < maxNum && num < Capacity &&
+						m_Cells[(pos + num) & (Capacity - 1)].sequence.load (std::memory_order_acquire) == pos + num + 1)
+						num++;
+					if (!num) return 0;
+					if (m_DequeuePos.compare_exchange_weak (pos, pos + num, std::memory_order_relaxed))
+					{
+						for (size_t i = 0; i < num; i++)
+						{
+							auto& cell = m_Cells[(pos + i) & (Capacity - 1)];
+							elements.push_back (std::move (cell.data));
+							cell.data = nullptr;
+							cell.sequence.store (pos + i + Capacity, std::memory_order_release);
+						}
+						return num;
+					}
+				}
+			}
+
+			void Notify (bool all)
+			{
+				// pairs with fence in WaitNonEmpty, either consumer sees new element or we see the consumer
+				std::atomic_thread_fence (std::memory_order_seq_cst);
+				if (m_NumWaiters.load (std::memory_order_relaxed) > 0)
+				{
+					std::unique_lock<std::mutex> l(m_WaitMutex);
+					if (all)
+						m_NonEmpty.notify_all ();
+					else
+						m_NonEmpty.notify_one ();
+				}
+			}
+
+			bool WaitNonEmpty (int msec, const std::function<bool ()> * isReady = nullptr) // negative msec means without timeout, returns false if timed out
+			{
+				// producer is likely in the middle of Put, let it finish before going to sleep
+				for (int i = 0; i < QUEUE_NUM_SPINS_BEFORE_WAIT; i++)
+				{
+					if (!IsEmpty () || (isReady && (*isReady) ())) return true;
+					std::this_thread::yield ();
+				}
+				bool notified = true;
+				m_NumWaiters.fetch_add (1, std::memory_order_relaxed);
+				std::atomic_thread_fence (std::memory_order_seq_cst);
 				{
-					auto el = m_Queue.front ();
-					if (!peek)
-						m_Queue.pop ();
-					return el;
+					std::unique_lock<std::mutex> l(m_WaitMutex);
+					if (IsEmpty () && !(isReady && (*isReady) ()))
+					{
+						if (msec < 0)
+							m_NonEmpty.wait (l);
+						else
+							notified = m_NonEmpty.wait_for (l, std::chrono::milliseconds (msec)) != std::cv_status::timeout;
+					}
 				}
-				return nullptr;
+				m_NumWaiters.fetch_sub (1, std::memory_order_relaxed);
+				return notified;
 			}
 
 		private:
 
-			std::queue<Element> m_Queue;
-			std::mutex m_QueueMutex;
+			std::unique_ptr<Cell[]> m_Cells;
+			char m_Padding0[QUEUE_CACHE_LINE_SIZE];
+			std::atomic<size_t> m_EnqueuePos;
+			char m_Padding1[QUEUE_CACHE_LINE_SIZE];
+			std::atomic<size_t> m_DequeuePos;
+			char m_Padding2[QUEUE_CACHE_LINE_SIZE];
+			std::atomic<size_t> m_OverflowSize;
+			std::atomic<int> m_NumWaiters;
+			std::mutex m_OverflowMutex;
+			std::deque<Element> m_Overflow;
+			std::mutex m_WaitMutex;
 			std::condition_variable m_NonEmpty;
 	};
 }
@@ -0,0 +1,80 @@
+#ifndef RANDOM_INDEX_H__
+#define RANDOM_INDEX_H__
+
+#include <stdlib.h>
+#include <vector>
+#include <memory>
+#include <unordered_map>
+
+namespace i2p
+{
+namespace data
+{
+	const int RANDOM_INDEX_NUM_SAMPLES = 16; // before walk through all
+
+	/**
+	 * @brief Unordered set of objects with O(1) insert, erase and uniform random pick.
+	 * Objects are kept in vector, erased one is replaced by last. Not thread safe, owner locks it
+	 */
+	template<typename T>
+	class RandomIndex
+	{
+		public:
+
+			bool Insert (std::shared_ptr<T> item)
+			{
+				if (!m_Positions.emplace (item.get (), m_Items.size ()).second) return false; // already there
+				m_Items.push_back (item);
+				return true;
+			}
+
+			bool Erase (const T * item)
+			{
+				auto it = m_Positions.find (item);
+				if (it == m_Positions.end ()) return false;
+				auto pos = it->second;
+				m_Positions.erase (it);
+				if (pos + 1 < m_Items.size ())
+				{
+					m_Items[pos] = m_Items.back ();
+					m_Positions[m_Items[pos].get ()] = pos;
+				}
+				m_Items.pop_back ();
+				return true;
+			}
+
+			bool Contains (const T * item) const { return m_Positions.count (item); };
+			size_t GetSize () const { return m_Items.size (); };
+			bool IsEmpty () const { return m_Items.empty (); };
+			void Clear () { m_Items.clear (); m_Positions.clear (); };
+
+			template<typename Filter>
+			std::shared_ptr<T> GetRandom (Filter filter) const
+			{
+				size_t size = m_Items.size ();
+				if (!size) return nullptr;
+				// most of objects usually pass filter
+				for (int i = 0; i < RANDOM_INDEX_NUM_SAMPLES; i++)
+				{
+					auto& item = m_Items[rand () % size];
+					if (filter (item)) return item;
+				}
+				// few do, walk from random position
+				size_t start = rand () % size;
+				for (size_t i = 0; i < size; i++)
+				{
+					auto& item = m_Items[(start + i) % size];
+					if (filter (item)) return item;
+				}
+				return nullptr;
+			}
+
+		private:
+
+			std::vector<std::shared_ptr<T> > m_Items;
+			std::unordered_map<const T *, size_t> m_Positions;
+	};
+}
+}
+
+#endif
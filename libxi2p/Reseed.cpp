@@ -261,6 +261,7 @@ namespace data
 	int Reseeder::ProcessZIPStream (std::istream& s, uint64_t contentLength)
 	{
 		int numFiles = 0;
+		std::vector<std::vector<uint8_t> > routerInfos; // added at once to verify signatures in batch
 		size_t contentPos = s.tellg ();
 		while (!s.eof ())
 		{
@@ -292,7 +293,7 @@ namespace data
 				if ( fileNameLength > 255 ) {
 					// too big
 					LogPrint(eLogError, "Reseed: SU3 fileNameLength too large: ", fileNameLength);
-					return numFiles;
+					break;
 				}
 				s.read ((char *)&extraFieldLength, 2);
 				extraFieldLength = le16toh (extraFieldLength);
@@ -307,7 +308,7 @@ namespace data
 					if (!FindZipDataDescriptor (s))
 					{
 						LogPrint (eLogError, "Reseed: SU3 archive data descriptor not found");
-						return numFiles;
+						break;
 					}
 					s.read ((char *)&crc_32, 4);
 					crc_32 = le32toh (crc_32);
@@ -345,7 +346,7 @@ namespace data
 						uncompressedSize -= inflator.avail_out;
 						if (crc32 (0, uncompressed, uncompressedSize) == crc_32)
 						{
-							i2p::data::netdb.AddRouterInfo (uncompressed, uncompressedSize);
+							routerInfos.emplace_back (uncompressed, uncompressed + uncompressedSize);
 							numFiles++;
 						}
 						else
@@ -358,7 +359,7 @@ namespace data
 				}
 				else // no compression
 				{
-					i2p::data::netdb.AddRouterInfo (compressed, compressedSize);
+					routerInfos.emplace_back (compressed, compressed + compressedSize);
 					numFiles++;
 				}
 				delete[] compressed;
@@ -375,6 +376,7 @@ namespace data
 			if (end - contentPos >= contentLength)
 				break; // we are beyond contentLength
 		}
+		i2p::data::netdb.AddRouterInfos (routerInfos);
 		if (numFiles) // check if  routers are not outdated
 		{
 			auto ts = i2p::util::GetMillisecondsSinceEpoch ();
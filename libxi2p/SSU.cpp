@@ -19,7 +19,8 @@ namespace transport
 		m_EndpointV6 (addr, port), m_Socket (m_ReceiversService, m_Endpoint),
 		m_SocketV6 (m_ReceiversServiceV6), m_IntroducersUpdateTimer (m_Service),
 		m_PeerTestsCleanupTimer (m_Service), m_TerminationTimer (m_Service),
-		m_TerminationTimerV6 (m_ServiceV6)
+		m_TerminationTimerV6 (m_ServiceV6), m_BatchSize (0), m_IsGSO (false),
+		m_IsWaitingWritable (false), m_IsWaitingWritableV6 (false)
 	{
 		OpenSocketV6 ();
 	}
@@ -32,7 +33,9 @@ namespace transport
 		m_Endpoint (boost::asio::ip::udp::v4 (), port), m_EndpointV6 (boost::asio::ip::udp::v6 (), port),
 		m_Socket (m_ReceiversService), m_SocketV6 (m_ReceiversServiceV6),
 		m_IntroducersUpdateTimer (m_Service), m_PeerTestsCleanupTimer (m_Service),
-		m_TerminationTimer (m_Service), m_TerminationTimerV6 (m_ServiceV6)
+		m_TerminationTimer (m_Service), m_TerminationTimerV6 (m_ServiceV6),
+		m_BatchSize (0), m_IsGSO (false),
+		m_IsWaitingWritable (false), m_IsWaitingWritableV6 (false)
 	{
 		OpenSocket ();
 		if (context.SupportsV6 ())
@@ -41,6 +44,23 @@ namespace transport
 
 	SSUServer::~SSUServer ()
 	{
+		m_PacketsPool.ReleaseMt (m_ReceiveBuffers);
+		m_PacketsPool.ReleaseMt (m_ReceiveBuffersV6);
+		m_PacketsPool.ReleaseMt (m_SendQueue);
+		m_PacketsPool.ReleaseMt (m_SendQueueV6);
+	}
+
+	void SSUServer::SetBatchSize (int batchSize, bool gso)
+	{
+#if defined(__linux__)
+		m_BatchSize = std::min (batchSize, SSU_MAX_BATCH_SIZE);
+		m_IsGSO = gso && m_BatchSize > 1;
+		if (m_BatchSize > 1)
+			LogPrint (eLogInfo, "SSU: up to ", m_BatchSize, " datagrams per recvmmsg/sendmmsg", m_IsGSO ? ", UDP GSO" : "");
+#else
+		if (batchSize > 1)
+			LogPrint (eLogInfo, "SSU: batched UDP I/O is supported on Linux only");
+#endif
 	}
 
 	void SSUServer::OpenSocket ()
@@ -84,6 +104,9 @@ namespace transport
 	void SSUServer::Stop ()
 	{
 		DeleteAllSessions ();
+		// SessionDestroyed messages are queued, threads won't be able to send them
+		FlushSendQueue (false);
+		FlushSendQueue (true);
 		m_IsRunning = false;
 		m_TerminationTimer.cancel ();
 		m_TerminationTimerV6.cancel ();
@@ -204,22 +227,125 @@ namespace transport
 
 	void SSUServer::Send (const uint8_t * buf, size_t len, const boost::asio::ip::udp::endpoint& to)
 	{
-		if (to.protocol () == boost::asio::ip::udp::v4())
+		bool isV4 = to.protocol () == boost::asio::ip::udp::v4();
+		if (m_BatchSize > 1 && len <= sizeof (SSUPacket::buf))
+		{
+			// sendmmsg after current handler or when batch is full
+			auto packet = m_PacketsPool.AcquireMt ();
+			memcpy (packet->buf, buf, len);
+			packet->len = len;
+			packet->from = to;
+			bool isFirst, isFull, isDropped = false;
+			{
+				std::unique_lock<std::mutex> l(isV4 ? m_SendQueueMutex : m_SendQueueMutexV6);
+				auto& queue = isV4 ? m_SendQueue : m_SendQueueV6;
+				isFirst = queue.empty ();
+				if (queue.size () < SSU_MAX_SEND_QUEUE_SIZE)
+					queue.push_back (packet);
+				else
+					isDropped = true; // still waiting for send buffer
+				isFull = (int)queue.size () >= m_BatchSize;
+			}
+			if (isDropped)
+			{
+				m_PacketsPool.ReleaseMt (packet);
+				LogPrint (eLogDebug, "SSU: send queue is full, datagram to ", to, " dropped");
+			}
+			else if (isFull)
+				FlushSendQueue (!isV4);
+			else if (isFirst)
+				(isV4 ? m_Service : m_ServiceV6).post (std::bind (&SSUServer::FlushSendQueue, this, !isV4));
+			return;
+		}
+		if (isV4)
 			m_Socket.send_to (boost::asio::buffer (buf, len), to);
 		else
 			m_SocketV6.send_to (boost::asio::buffer (buf, len), to);
 	}
 
+	void SSUServer::FlushSendQueue (bool v6)
+	{
+		std::vector<SSUPacket *> packets;
+		{
+			std::unique_lock<std::mutex> l(v6 ? m_SendQueueMutexV6 : m_SendQueueMutex);
+			if (v6 ? m_IsWaitingWritableV6 : m_IsWaitingWritable) return; // will be sent by HandleWritable
+			packets.swap (v6 ? m_SendQueueV6 : m_SendQueue);
+		}
+		if (packets.empty ()) return;
+#if defined(__linux__)
+		auto& socket = v6 ? m_SocketV6 : m_Socket;
+		size_t numSent = 0;
+		while (numSent < packets.size ())
+		{
+			size_t num = std::min (packets.size () - numSent, (size_t)SSU_MAX_BATCH_SIZE);
+			size_t n = SendDatagrams (socket.native_handle (), packets.data () + numSent, num, m_IsGSO);
+			numSent += n;
+			if (n < num) break; // send buffer is full
+		}
+		if (numSent < packets.size ())
+		{
+			// put the rest back before newer ones and don't block this thread, send them once socket is writable
+			{
+				std::unique_lock<std::mutex> l(v6 ? m_SendQueueMutexV6 : m_SendQueueMutex);
+				auto& queue = v6 ? m_SendQueueV6 : m_SendQueue;
+				queue.insert (queue.begin (), packets.begin () + numSent, packets.end ());
+				(v6 ? m_IsWaitingWritableV6 : m_IsWaitingWritable) = true;
+			}
+			packets.resize (numSent);
+			(v6 ? m_ReceiversServiceV6 : m_ReceiversService).post (std::bind (&SSUServer::WaitWritable, this, v6));
+		}
+#endif
+		m_PacketsPool.ReleaseMt (packets);
+	}
+
+#if defined(__linux__)
+	void SSUServer::WaitWritable (bool v6)
+	{
+		// socket's operations are initiated by its own thread
+		auto& socket = v6 ? m_SocketV6 : m_Socket;
+#if BOOST_VERSION >= 106600
+		socket.async_wait (boost::asio::ip::udp::socket::wait_write,
+			std::bind (&SSUServer::HandleWritable, this, std::placeholders::_1, v6));
+#else
+		socket.async_send (boost::asio::null_buffers (),
+			std::bind (&SSUServer::HandleWritable, this, std::placeholders::_1, v6));
+#endif
+	}
+
+	void SSUServer::HandleWritable (const boost::system::error_code& ecode, bool v6)
+	{
+		{
+			std::unique_lock<std::mutex> l(v6 ? m_SendQueueMutexV6 : m_SendQueueMutex);
+			(v6 ? m_IsWaitingWritableV6 : m_IsWaitingWritable) = false;
+		}
+		if (ecode != boost::asio::error::operation_aborted)
+			FlushSendQueue (v6);
+	}
+
+	void SSUServer::ReceiveBatch (boost::asio::ip::udp::socket& socket, std::vector<SSUPacket *>& preallocated,
+		std::vector<SSUPacket *>& packets, size_t mtu)
+	{
+		// read datagrams already waiting in socket's buffer with one syscall
+		if ((int)packets.size () >= m_BatchSize) return;
+		size_t num = m_BatchSize - packets.size ();
+		while (preallocated.size () < num)
+			preallocated.push_back (m_PacketsPool.AcquireMt ());
+		size_t r = ReceiveDatagrams (socket.native_handle (), preallocated.data (), num, mtu);
+		packets.insert (packets.end (), preallocated.begin (), preallocated.begin () + r);
+		preallocated.erase (preallocated.begin (), preallocated.begin () + r);
+	}
+#endif
+
 	void SSUServer::Receive ()
 	{
-		SSUPacket * packet = new SSUPacket ();
+		SSUPacket * packet = m_PacketsPool.AcquireMt ();
 		m_Socket.async_receive_from (boost::asio::buffer (packet->buf, SSU_MTU_V4), packet->from,
 			std::bind (&SSUServer::HandleReceivedFrom, this, std::placeholders::_1, std::placeholders::_2, packet));
 	}
 
 	void SSUServer::ReceiveV6 ()
 	{
-		SSUPacket * packet = new SSUPacket ();
+		SSUPacket * packet = m_PacketsPool.AcquireMt ();
 		m_SocketV6.async_receive_from (boost::asio::buffer (packet->buf, SSU_MTU_V6), packet->from,
 			std::bind (&SSUServer::HandleReceivedFromV6, this, std::placeholders::_1, std::placeholders::_2, packet));
 	}
@@ -232,25 +358,32 @@ namespace transport
 			std::vector<SSUPacket *> packets;
 			packets.push_back (packet);
 
-			boost::system::error_code ec;
-			size_t moreBytes = m_Socket.available(ec);
-			if (!ec)
+#if defined(__linux__)
+			if (m_BatchSize > 1)
+				ReceiveBatch (m_Socket, m_ReceiveBuffers, packets, SSU_MTU_V4);
+			else
+#endif
 			{
-				while (moreBytes && packets.size () < 25)
+				boost::system::error_code ec;
+				size_t moreBytes = m_Socket.available(ec);
+				if (!ec)
 				{
-					packet = new SSUPacket ();
-					packet->len = m_Socket.receive_from (boost::asio::buffer (packet->buf, SSU_MTU_V4), packet->from, 0, ec);
-					if (!ec)
-					{
-						packets.push_back (packet);
-						moreBytes = m_Socket.available(ec);
-						if (ec) break;
-					}
-					else
+					while (moreBytes && packets.size () < SSU_DEFAULT_BATCH_SIZE)
 					{
-						LogPrint (eLogError, "SSU: receive_from error: ", ec.message ());
-						delete packet;
-						break;
+						packet = m_PacketsPool.AcquireMt ();
+						packet->len = m_Socket.receive_from (boost::asio::buffer (packet->buf, SSU_MTU_V4), packet->from, 0, ec);
+						if (!ec)
+						{
+							packets.push_back (packet);
+							moreBytes = m_Socket.available(ec);
+							if (ec) break;
+						}
+						else
+						{
+							LogPrint (eLogError, "SSU: receive_from error: ", ec.message ());
+							m_PacketsPool.ReleaseMt (packet);
+							break;
+						}
 					}
 				}
 			}
@@ -260,7 +393,7 @@ namespace transport
 		}
 		else
 		{
-			delete packet;
+			m_PacketsPool.ReleaseMt (packet);
 			if (ecode != boost::asio::error::operation_aborted)
 			{
 				LogPrint (eLogError, "SSU: receive error: ", ecode.message ());
@@ -279,25 +412,32 @@ namespace transport
 			std::vector<SSUPacket *> packets;
 			packets.push_back (packet);
 
-			boost::system::error_code ec;
-			size_t moreBytes = m_SocketV6.available (ec);
-			if (!ec)
+#if defined(__linux__)
+			if (m_BatchSize > 1)
+				ReceiveBatch (m_SocketV6, m_ReceiveBuffersV6, packets, SSU_MTU_V6);
+			else
+#endif
 			{
-				while (moreBytes && packets.size () < 25)
+				boost::system::error_code ec;
+				size_t moreBytes = m_SocketV6.available (ec);
+				if (!ec)
 				{
-					packet = new SSUPacket ();
-					packet->len = m_SocketV6.receive_from (boost::asio::buffer (packet->buf, SSU_MTU_V6), packet->from, 0, ec);
-					if (!ec)
+					while (moreBytes && packets.size () < SSU_DEFAULT_BATCH_SIZE)
 					{
-						packets.push_back (packet);
-						moreBytes = m_SocketV6.available(ec);
-						if (ec) break;
-					}
-					else
-					{
-						LogPrint (eLogError, "SSU: v6 receive_from error: ", ec.message ());
-						delete packet;
-						break;
+						packet = m_PacketsPool.AcquireMt ();
+						packet->len = m_SocketV6.receive_from (boost::asio::buffer (packet->buf, SSU_MTU_V6), packet->from, 0, ec);
+						if (!ec)
+						{
+							packets.push_back (packet);
+							moreBytes = m_SocketV6.available(ec);
+							if (ec) break;
+						}
+						else
+						{
+							LogPrint (eLogError, "SSU: v6 receive_from error: ", ec.message ());
+							m_PacketsPool.ReleaseMt (packet);
+							break;
+						}
 					}
 				}
 			}
@@ -307,7 +447,7 @@ namespace transport
 		}
 		else
 		{
-			delete packet;
+			m_PacketsPool.ReleaseMt (packet);
 			if (ecode != boost::asio::error::operation_aborted)
 			{
 				LogPrint (eLogError, "SSU: v6 receive error: ", ecode.message ());
@@ -348,9 +488,9 @@ namespace transport
 				if (session) session->FlushData ();
 				session = nullptr;
 			}
-			delete packet;
 		}
 		if (session) session->FlushData ();
+		m_PacketsPool.ReleaseMt (packets);
 	}
 
 	std::shared_ptr<SSUSession> SSUServer::FindSession (std::shared_ptr<const i2p::data::RouterInfo> router) const
@@ -8,13 +8,17 @@
 #include <set>
 #include <thread>
 #include <mutex>
+#include <atomic>
+#include <vector>
 #include <boost/asio.hpp>
 #include "Crypto.h"
 #include "I2PEndian.h"
 #include "Identity.h"
 #include "RouterInfo.h"
 #include "I2NPProtocol.h"
+#include "util.h"
 #include "SSUSession.h"
+#include "SSUBatch.h"
 
 namespace i2p
 {
@@ -27,13 +31,8 @@ namespace transport
 	const size_t SSU_MAX_NUM_INTRODUCERS = 3;
 	const size_t SSU_SOCKET_RECEIVE_BUFFER_SIZE = 0x1FFFF; // 128K
 	const size_t SSU_SOCKET_SEND_BUFFER_SIZE = 0x1FFFF; // 128K
-
-	struct SSUPacket
-	{
-		i2p::crypto::AESAlignedBuffer<SSU_MTU_V6 + 18> buf; // max MTU + iv + size
-		boost::asio::ip::udp::endpoint from;
-		size_t len;
-	};
+	const int SSU_DEFAULT_BATCH_SIZE = 25; // datagrams per receive without recvmmsg
+	const size_t SSU_MAX_SEND_QUEUE_SIZE = 1024; // datagrams waiting for socket's send buffer, dropped beyond
 
 	class SSUServer
 	{
@@ -59,6 +58,7 @@ namespace transport
 			boost::asio::io_service& GetServiceV6 () { return m_ServiceV6; };
 			const boost::asio::ip::udp::endpoint& GetEndpoint () const { return m_Endpoint; };
 			void Send (const uint8_t * buf, size_t len, const boost::asio::ip::udp::endpoint& to);
+			void SetBatchSize (int batchSize, bool gso); // before Start, 0 or 1 - one syscall per datagram
 			void AddRelay (uint32_t tag, std::shared_ptr<SSUSession> relay);
 			void RemoveRelay (uint32_t tag);
 			std::shared_ptr<SSUSession> FindRelaySession (uint32_t tag);
@@ -83,6 +83,13 @@ namespace transport
 			void HandleReceivedFromV6 (const boost::system::error_code& ecode, std::size_t bytes_transferred, SSUPacket * packet);
 			void HandleReceivedPackets (std::vector<SSUPacket *> packets,
 				std::map<boost::asio::ip::udp::endpoint, std::shared_ptr<SSUSession> >* sessions);
+			void FlushSendQueue (bool v6);
+#if defined(__linux__)
+			void ReceiveBatch (boost::asio::ip::udp::socket& socket, std::vector<SSUPacket *>& preallocated,
+				std::vector<SSUPacket *>& packets, size_t mtu);
+			void WaitWritable (bool v6); // socket's send buffer is full
+			void HandleWritable (const boost::system::error_code& ecode, bool v6);
+#endif
 
 			void CreateSessionThroughIntroducer (std::shared_ptr<const i2p::data::RouterInfo> router, bool peerTest = false);
 			template<typename Filter>
@@ -125,6 +132,13 @@ namespace transport
 			std::map<boost::asio::ip::udp::endpoint, std::shared_ptr<SSUSession> > m_Sessions, m_SessionsV6;
 			std::map<uint32_t, std::shared_ptr<SSUSession> > m_Relays; // we are introducer
 			std::map<uint32_t, PeerTest> m_PeerTests; // nonce -> creation time in milliseconds
+			int m_BatchSize;
+			std::atomic<bool> m_IsGSO;
+			i2p::util::MemoryPoolMt<SSUPacket> m_PacketsPool;
+			std::vector<SSUPacket *> m_ReceiveBuffers, m_ReceiveBuffersV6; // preallocated for recvmmsg, receivers threads only
+			std::mutex m_SendQueueMutex, m_SendQueueMutexV6;
+			std::vector<SSUPacket *> m_SendQueue, m_SendQueueV6; // outgoing datagrams waiting for flush
+			bool m_IsWaitingWritable, m_IsWaitingWritableV6; // under send queue's mutex
 
 		public:
 			// for HTTP only
@@ -0,0 +1,124 @@
+#if defined(__linux__)
+#include <string.h>
+#include <errno.h>
+#include <sys/socket.h>
+#include <netinet/in.h>
+#include <netinet/udp.h>
+#ifndef UDP_SEGMENT
+#define UDP_SEGMENT 103 // linux/udp.h, kernel 4.18+
+#endif
+#include "Log.h"
+#include "SSUBatch.h"
+
+namespace i2p
+{
+namespace transport
+{
+	size_t SendDatagrams (int fd, SSUPacket * const * packets, size_t num, std::atomic<bool>& gso)
+	{
+		mmsghdr msgs[SSU_MAX_BATCH_SIZE];
+		iovec iovs[SSU_MAX_BATCH_SIZE];
+		union
+		{
+			char buf[CMSG_SPACE(sizeof (uint16_t))];
+			cmsghdr align;
+		} controls[SSU_MAX_BATCH_SIZE];
+		size_t firstPackets[SSU_MAX_BATCH_SIZE]; // message -> index of its first packet
+		if (num > (size_t)SSU_MAX_BATCH_SIZE) num = SSU_MAX_BATCH_SIZE;
+		bool isGSO = gso;
+		size_t numMsgs = 0;
+		for (size_t i = 0; i < num; numMsgs++)
+		{
+			// with GSO consecutive datagrams of same size to same endpoint make one message,
+			// kernel splits it by segment size, only last one can be shorter
+			size_t len = packets[i]->len, n = 1;
+			if (isGSO && len > 0)
+				while (i + n < num && packets[i + n - 1]->len == len && packets[i + n]->len > 0 &&
+					packets[i + n]->len <= len && (n + 1)*len <= 0xFFFF - 64 && packets[i + n]->from == packets[i]->from)
+					n++;
+			auto& msg = msgs[numMsgs];
+			memset (&msg, 0, sizeof (msg));
+			msg.msg_hdr.msg_name = (void *)packets[i]->from.data ();
+			msg.msg_hdr.msg_namelen = packets[i]->from.size ();
+			msg.msg_hdr.msg_iov = iovs + i;
+			msg.msg_hdr.msg_iovlen = n;
+			for (size_t j = i; j < i + n; j++)
+			{
+				iovs[j].iov_base = packets[j]->buf;
+				iovs[j].iov_len = packets[j]->len;
+			}
+			if (n > 1)
+			{
+				msg.msg_hdr.msg_control = controls[numMsgs].buf;
+				msg.msg_hdr.msg_controllen = sizeof (controls[numMsgs].buf);
+				auto cmsg = CMSG_FIRSTHDR (&msg.msg_hdr);
+				cmsg->cmsg_level = IPPROTO_UDP;
+				cmsg->cmsg_type = UDP_SEGMENT;
+				cmsg->cmsg_len = CMSG_LEN (sizeof (uint16_t));
+				uint16_t segmentSize = len;
+				memcpy (CMSG_DATA (cmsg), &segmentSize, sizeof (segmentSize));
+			}
+			firstPackets[numMsgs] = i;
+			i += n;
+		}
+
+		size_t numSent = 0;
+		while (numSent < numMsgs)
+		{
+			int r = sendmmsg (fd, msgs + numSent, numMsgs - numSent, MSG_DONTWAIT); // asio may keep socket blocking
+			if (r > 0)
+			{
+				numSent += r;
+				continue;
+			}
+			if (!r || errno == EINTR) continue;
+			if (errno == EAGAIN || errno == EWOULDBLOCK)
+				return firstPackets[numSent]; // caller waits until socket is writable
+			if (isGSO && (errno == EIO || errno == EINVAL || errno == ENOPROTOOPT || errno == EOPNOTSUPP))
+			{
+				// not supported by kernel or network device, resend rest as separate datagrams
+				LogPrint (eLogWarning, "SSU: UDP GSO is not available: ", strerror (errno), ". Disabled");
+				gso = false;
+				size_t first = firstPackets[numSent];
+				return first + SendDatagrams (fd, packets + first, num - first, gso);
+			}
+			if (errno == EBADF || errno == ENOTSOCK) return num; // closed
+			LogPrint (eLogWarning, "SSU: sendmmsg to ", packets[firstPackets[numSent]]->from, " error: ", strerror (errno));
+			numSent++; // skip failed destination
+		}
+		return num;
+	}
+
+	size_t ReceiveDatagrams (int fd, SSUPacket * const * packets, size_t num, size_t mtu)
+	{
+		mmsghdr msgs[SSU_MAX_BATCH_SIZE];
+		iovec iovs[SSU_MAX_BATCH_SIZE];
+		if (num > (size_t)SSU_MAX_BATCH_SIZE) num = SSU_MAX_BATCH_SIZE;
+		memset (msgs, 0, num*sizeof (mmsghdr));
+		for (size_t i = 0; i < num; i++)
+		{
+			auto packet = packets[i];
+			iovs[i].iov_base = packet->buf;
+			iovs[i].iov_len = mtu;
+			msgs[i].msg_hdr.msg_name = packet->from.data ();
+			msgs[i].msg_hdr.msg_namelen = packet->from.capacity ();
+			msgs[i].msg_hdr.msg_iov = iovs + i;
+			msgs[i].msg_hdr.msg_iovlen = 1;
+		}
+		int r = recvmmsg (fd, msgs, num, MSG_DONTWAIT, nullptr);
+		if (r < 0)
+		{
+			if (errno != EAGAIN && errno != EWOULDBLOCK && errno != EINTR)
+				LogPrint (eLogError, "SSU: recvmmsg error: ", strerror (errno));
+			return 0;
+		}
+		for (int i = 0; i < r; i++)
+		{
+			packets[i]->len = msgs[i].msg_len;
+			packets[i]->from.resize (msgs[i].msg_hdr.msg_namelen);
+		}
+		return r;
+	}
+}
+}
+#endif
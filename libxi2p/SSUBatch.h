@@ -0,0 +1,36 @@
+#ifndef SSU_BATCH_H__
+#define SSU_BATCH_H__
+
+#include <inttypes.h>
+#include <stddef.h>
+#include <atomic>
+#include <boost/asio.hpp>
+#include "Crypto.h"
+#include "SSUData.h"
+
+namespace i2p
+{
+namespace transport
+{
+	const int SSU_MAX_BATCH_SIZE = 64; // datagrams per recvmmsg/sendmmsg, also max GSO segments
+
+	struct SSUPacket
+	{
+		i2p::crypto::AESAlignedBuffer<SSU_MTU_V6 + 18> buf; // max MTU + iv + size
+		boost::asio::ip::udp::endpoint from; // remote endpoint, destination for outgoing
+		size_t len;
+	};
+
+#if defined(__linux__)
+	// Sends up to SSU_MAX_BATCH_SIZE packets with sendmmsg, doesn't block.
+	// With gso consecutive datagrams of same size to same endpoint go as one message, gso is reset if not supported.
+	// Returns number of packets sent or dropped because of error, less than num if socket's send buffer is full
+	size_t SendDatagrams (int fd, SSUPacket * const * packets, size_t num, std::atomic<bool>& gso);
+	// Reads up to SSU_MAX_BATCH_SIZE datagrams already waiting in socket's buffer with recvmmsg, doesn't block.
+	// Sets len and from of first packets, returns number of them
+	size_t ReceiveDatagrams (int fd, SSUPacket * const * packets, size_t num, size_t mtu);
+#endif
+}
+}
+
+#endif
@@ -0,0 +1,81 @@
+#include <algorithm>
+#include "SSUCongestion.h"
+
+namespace i2p
+{
+namespace transport
+{
+	SSUCongestionControl::SSUCongestionControl ():
+		m_Window (SSU_INITIAL_WINDOW), m_SlowStartThreshold (SSU_MAX_WINDOW),
+		m_RTT (0, SSU_INITIAL_RTO, SSU_MIN_RTO, SSU_MAX_RTO), m_NumInFlight (0),
+		m_NextPacketNum (1), m_LastAckedPacketNum (0), m_RecoveryPacketNum (0),
+		m_TimeoutPacketNum (0),
+		m_Pacer (SSU_MAX_PACING_BURST),
+		m_NumRetransmits (0), m_NumLost (0), m_NumTimeouts (0)
+	{
+	}
+
+	uint32_t SSUCongestionControl::OnPacketSent (bool isRetransmit)
+	{
+		if (isRetransmit)
+			m_NumRetransmits++; // still counted in flight since first transmission
+		else
+			m_NumInFlight++;
+		if (m_RTT.IsMeasured ()) m_Pacer.OnPacketSent ();
+		return m_NextPacketNum++;
+	}
+
+	void SSUCongestionControl::OnPacketAcked (uint64_t ts, uint32_t packetNum, uint64_t sendTime, bool isRetransmitted)
+	{
+		if (m_NumInFlight > 0) m_NumInFlight--;
+		if (packetNum > m_LastAckedPacketNum) m_LastAckedPacketNum = packetNum;
+		if (!isRetransmitted && ts >= sendTime) // Karn's algorithm
+			m_RTT.AddSample (ts - sendTime);
+		if (packetNum <= m_RecoveryPacketNum) return; // sent before last reduction
+		if (m_Window < m_SlowStartThreshold)
+			m_Window += 1; // slow start
+		else
+			m_Window += 1/m_Window; // congestion avoidance
+		if (m_Window > SSU_MAX_WINDOW) m_Window = SSU_MAX_WINDOW;
+	}
+
+	bool SSUCongestionControl::IsLost (uint64_t ts, uint32_t packetNum, uint64_t sendTime) const
+	{
+		if (packetNum >= m_LastAckedPacketNum || !m_RTT.IsMeasured ()) return false;
+		double rtt = m_RTT.GetRTT ();
+		return ts >= sendTime + (uint64_t)(rtt + std::max (rtt/4, 1.0));
+	}
+
+	void SSUCongestionControl::OnPacketLost (uint32_t packetNum)
+	{
+		m_NumLost++;
+		if (packetNum <= m_RecoveryPacketNum) return; // already reduced for this window
+		m_SlowStartThreshold = std::max (m_Window/2, (double)SSU_MIN_WINDOW);
+		m_Window = m_SlowStartThreshold;
+		m_RecoveryPacketNum = m_NextPacketNum - 1;
+	}
+
+	void SSUCongestionControl::OnTimeout (uint32_t packetNum)
+	{
+		if (packetNum <= m_TimeoutPacketNum) return; // same timeout for packets sent before it
+		m_TimeoutPacketNum = m_NextPacketNum - 1;
+		m_NumTimeouts++;
+		m_SlowStartThreshold = std::max (m_Window/2, (double)SSU_MIN_WINDOW);
+		m_Window = SSU_MIN_WINDOW;
+		m_RecoveryPacketNum = m_NextPacketNum - 1;
+		m_RTT.BackOff ();
+	}
+
+	void SSUCongestionControl::OnPacketsDropped (int num)
+	{
+		m_NumInFlight -= std::min (num, m_NumInFlight);
+	}
+
+	int SSUCongestionControl::GetPacingDelay (uint64_t ts)
+	{
+		if (!m_RTT.IsMeasured ()) return 0; // window only until first RTT sample
+		double rate = (m_Window < m_SlowStartThreshold ? SSU_SLOW_START_PACING_GAIN : SSU_PACING_GAIN)*m_Window/m_RTT.GetRTT (); // packets per millisecond
+		return m_Pacer.GetDelay (ts, rate);
+	}
+}
+}
@@ -0,0 +1,64 @@
+#ifndef SSU_CONGESTION_H__
+#define SSU_CONGESTION_H__
+
+#include <inttypes.h>
+#include "Congestion.h"
+
+namespace i2p
+{
+namespace transport
+{
+	const int SSU_INITIAL_WINDOW = 8; // in packets
+	const int SSU_MIN_WINDOW = 2;
+	const int SSU_MAX_WINDOW = 192; // must be less than MAX_OUTGOING_WINDOW_SIZE
+	const int SSU_INITIAL_RTO = 1000; // in milliseconds
+	const int SSU_MIN_RTO = 300; // in milliseconds
+	const int SSU_MAX_RTO = 10000; // in milliseconds
+	const int SSU_MAX_PACING_BURST = 4; // in packets
+	const double SSU_SLOW_START_PACING_GAIN = 2.0;
+	const double SSU_PACING_GAIN = 1.25;
+
+	// Window based congestion control of SSU data packets (fragments).
+	// Window grows by slow start and additive increase, halves on loss once per window of packets (NewReno).
+	// RTO is computed by RFC 6298, lost packets are detected by later packets ACKed (RACK).
+	// Packets are paced at window/RTT rate
+	class SSUCongestionControl
+	{
+		public:
+
+			SSUCongestionControl ();
+
+			uint32_t OnPacketSent (bool isRetransmit); // returns packet number of this transmission
+			void OnPacketAcked (uint64_t ts, uint32_t packetNum, uint64_t sendTime, bool isRetransmitted);
+			bool IsLost (uint64_t ts, uint32_t packetNum, uint64_t sendTime) const; // sent before ACKed packet and reordering window passed
+			void OnPacketLost (uint32_t packetNum); // will be retransmitted
+			void OnTimeout (uint32_t packetNum); // retransmission timer of this packet expired
+			void OnPacketsDropped (int num); // not in flight anymore, given up
+
+			bool IsWindowFull () const { return m_NumInFlight >= (int)m_Window; };
+			int GetPacingDelay (uint64_t ts); // milliseconds until next packet can be sent, 0 if now
+
+			int GetWindowSize () const { return m_Window; };
+			int GetSlowStartThreshold () const { return m_SlowStartThreshold; };
+			int GetRTT () const { return m_RTT.GetRTT (); }; // smoothed, 0 if not measured yet
+			int GetRTO () const { return m_RTT.GetRTO (); };
+			int GetNumInFlight () const { return m_NumInFlight; };
+			uint64_t GetNumRetransmits () const { return m_NumRetransmits; };
+			uint64_t GetNumLost () const { return m_NumLost; };
+			uint64_t GetNumTimeouts () const { return m_NumTimeouts; };
+
+		private:
+
+			double m_Window, m_SlowStartThreshold; // in packets
+			i2p::util::RTOEstimator m_RTT;
+			int m_NumInFlight;
+			uint32_t m_NextPacketNum, m_LastAckedPacketNum;
+			uint32_t m_RecoveryPacketNum; // last packet sent before window reduction
+			uint32_t m_TimeoutPacketNum; // last packet sent before timeout
+			i2p::util::Pacer m_Pacer;
+			uint64_t m_NumRetransmits, m_NumLost, m_NumTimeouts;
+	};
+}
+}
+
+#endif
@@ -1,4 +1,5 @@
 #include <stdlib.h>
+#include <algorithm>
 #include <boost/bind.hpp>
 #include "Log.h"
 #include "Timestamp.h"
@@ -28,8 +29,9 @@ namespace transport
 	}
 
 	SSUData::SSUData (SSUSession& session):
-		m_Session (session), m_ResendTimer (session.GetService ()),
-		m_IncompleteMessagesCleanupTimer (session.GetService ()),
+		m_Session (session), m_NumQueuedFragments (0), m_ResendTimer (session.GetService ()),
+		m_IncompleteMessagesCleanupTimer (session.GetService ()), m_PacingTimer (session.GetService ()),
+		m_ResendTimerTime (0), m_IsPacingTimerScheduled (false),
 		m_MaxPacketSize (session.IsV6 () ? SSU_V6_MAX_PACKET_SIZE : SSU_V4_MAX_PACKET_SIZE),
 		m_PacketSize (m_MaxPacketSize), m_LastMessageReceivedTime (0)
 	{
@@ -48,9 +50,14 @@ namespace transport
 	{
 		m_ResendTimer.cancel ();
 		m_IncompleteMessagesCleanupTimer.cancel ();
+		m_PacingTimer.cancel ();
+		m_ResendTimerTime = 0;
 		m_IncompleteMessages.clear ();
 		m_SentMessages.clear ();
 		m_ReceivedMessages.clear ();
+		m_SendQueue.clear ();
+		m_ResendQueue.clear ();
+		m_NumQueuedFragments = 0;
 	}
 
 	void SSUData::AdjustPacketSize (std::shared_ptr<const i2p::data::RouterInfo> remoteRouter)
@@ -86,26 +93,53 @@ namespace transport
 			AdjustPacketSize (routerInfo);
 	}
 
-	void SSUData::ProcessSentMessageAck (uint32_t msgID)
+	void SSUData::ProcessSentMessageAck (uint32_t msgID, uint64_t ts)
 	{
 		auto it = m_SentMessages.find (msgID);
 		if (it != m_SentMessages.end ())
 		{
+			for (auto& f: it->second->fragments)
+				if (f) ProcessFragmentAck (*f, ts);
 			m_SentMessages.erase (it);
 			if (m_SentMessages.empty ())
+			{
 				m_ResendTimer.cancel ();
+				m_ResendTimerTime = 0;
+			}
 		}
 	}
 
+	void SSUData::ProcessFragmentAck (Fragment& fragment, uint64_t ts)
+	{
+		if (fragment.numSends > 0)
+			m_CongestionControl.OnPacketAcked (ts, fragment.packetNum, fragment.sendTime, fragment.numSends > 1);
+		else
+			m_NumQueuedFragments--; // its entry in send queue is stale now
+	}
+
+	void SSUData::DetectLostFragments (uint64_t ts)
+	{
+		// sent before ACKed fragments and not ACKed within reordering window
+		for (auto& it: m_SentMessages)
+			for (auto& f: it.second->fragments)
+				if (f && f->numSends > 0 && !f->isQueued && m_CongestionControl.IsLost (ts, f->packetNum, f->sendTime))
+				{
+					m_CongestionControl.OnPacketLost (f->packetNum);
+					f->isQueued = true;
+					m_ResendQueue.push_back (std::make_pair (it.first, f->fragmentNum));
+				}
+	}
+
 	void SSUData::ProcessAcks (uint8_t *& buf, uint8_t flag)
 	{
+		uint64_t ts = i2p::util::GetMillisecondsSinceEpoch ();
 		if (flag & DATA_FLAG_EXPLICIT_ACKS_INCLUDED)
 		{
 			// explicit ACKs
 			uint8_t numAcks =*buf;
 			buf++;
 			for (int i = 0; i < numAcks; i++)
-				ProcessSentMessageAck (bufbe32toh (buf+i*4));
+				ProcessSentMessageAck (bufbe32toh (buf+i*4), ts);
 			buf += numAcks*4;
 		}
 		if (flag & DATA_FLAG_ACK_BITFIELDS_INCLUDED)
@@ -135,8 +169,11 @@ namespace transport
 						{
 							if (bitfield & mask)
 							{
-								if (fragment < numSentFragments)
+								if (fragment < numSentFragments && it->second->fragments[fragment])
+								{
+									ProcessFragmentAck (*it->second->fragments[fragment], ts);
 									it->second->fragments[fragment].reset (nullptr);
+								}
 							}
 							fragment++;
 							mask <<= 1;
@@ -145,8 +182,13 @@ namespace transport
 					buf++;
 				}
 				while (isNonLast);
+				if (it != m_SentMessages.end () && std::all_of (it->second->fragments.begin (), it->second->fragments.end (),
+					[](const std::unique_ptr<Fragment>& f) { return !f; }))
+					m_SentMessages.erase (it); // all fragments ACKed, don't wait for explicit ACK
 			}
 		}
+		DetectLostFragments (ts);
+		SendFragments ();
 	}
 
 	void SSUData::ProcessFragments (uint8_t * buf)
@@ -304,14 +346,18 @@ namespace transport
 			LogPrint (eLogWarning, "SSU: message ", msgID, " already sent");
 			return;
 		}
-		if (m_SentMessages.empty ()) // schedule resend at first message only
-			ScheduleResend ();
+		if (m_NumQueuedFragments >= MAX_NUM_QUEUED_FRAGMENTS)
+		{
+			LogPrint (eLogWarning, "SSU: congestion window is full, message ", msgID, " dropped");
+			return;
+		}
 
 		auto ret = m_SentMessages.insert (std::make_pair (msgID, std::unique_ptr<SentMessage>(new SentMessage)));
 		std::unique_ptr<SentMessage>& sentMessage = ret.first->second;
 		if (ret.second)
 		{
-			sentMessage->nextResendTime = i2p::util::GetSecondsSinceEpoch () + RESEND_INTERVAL;
+			sentMessage->firstSendTime = 0;
+			sentMessage->nextResendTime = 0;
 			sentMessage->numResends = 0;
 		}
 		auto& fragments = sentMessage->fragments;
@@ -348,18 +394,13 @@ namespace transport
 			if (size & 0x0F) // make sure 16 bytes boundary
 				size = ((size >> 4) + 1) << 4; // (/16 + 1)*16
 			fragment->len = size;
+			fragment->isQueued = true;
 			fragments.push_back (std::unique_ptr<Fragment> (fragment));
 
 			// encrypt message with session key
 			m_Session.FillHeaderAndEncrypt (PAYLOAD_TYPE_DATA, buf, size);
-			try
-			{
-				m_Session.Send (buf, size);
-			}
-			catch (boost::system::system_error& ec)
-			{
-				LogPrint (eLogWarning, "SSU: Can't send data fragment ", ec.what ());
-			}
+			m_SendQueue.push_back (std::make_pair (msgID, fragmentNum));
+			m_NumQueuedFragments++;
 			if (!isLast)
 			{
 				len -= payloadSize;
@@ -369,6 +410,47 @@ namespace transport
 				len = 0;
 			fragmentNum++;
 		}
+		SendFragments ();
+	}
+
+	void SSUData::SendFragments ()
+	{
+		uint64_t ts = i2p::util::GetMillisecondsSinceEpoch ();
+		while (!m_ResendQueue.empty () || !m_SendQueue.empty ())
+		{
+			// retransmissions are in flight already, limited by pacing only
+			bool isResend = !m_ResendQueue.empty ();
+			if (!isResend && m_CongestionControl.IsWindowFull ()) break; // wait for ACKs
+			int delay = m_CongestionControl.GetPacingDelay (ts);
+			if (delay > 0)
+			{
+				SchedulePacing (delay);
+				break;
+			}
+			auto& queue = isResend ? m_ResendQueue : m_SendQueue;
+			auto next = queue.front ();
+			queue.pop_front ();
+			auto it = m_SentMessages.find (next.first);
+			if (it == m_SentMessages.end () || !it->second->fragments[next.second]) continue; // ACKed or deleted
+			auto& fragment = it->second->fragments[next.second];
+			fragment->isQueued = false;
+			if (!fragment->numSends) m_NumQueuedFragments--;
+			fragment->packetNum = m_CongestionControl.OnPacketSent (fragment->numSends > 0);
+			fragment->sendTime = ts;
+			fragment->numSends++;
+			try
+			{
+				m_Session.Send (fragment->buf, fragment->len);
+			}
+			catch (boost::system::system_error& ec)
+			{
+				LogPrint (eLogWarning, "SSU: Can't send data fragment ", ec.what ());
+			}
+			if (!it->second->firstSendTime) it->second->firstSendTime = ts;
+			it->second->nextResendTime = ts + m_CongestionControl.GetRTO ();
+			if (!m_ResendTimerTime || it->second->nextResendTime < m_ResendTimerTime)
+				ScheduleResend (it->second->nextResendTime);
+		}
 	}
 
 	void SSUData::SendMsgAck (uint32_t msgID)
@@ -417,10 +499,12 @@ namespace transport
 		m_Session.Send (buf, len);
 	}
 
-	void SSUData::ScheduleResend()
+	void SSUData::ScheduleResend (uint64_t resendTime)
 	{
 		m_ResendTimer.cancel ();
-		m_ResendTimer.expires_from_now (boost::posix_time::seconds(RESEND_INTERVAL));
+		m_ResendTimerTime = resendTime;
+		uint64_t ts = i2p::util::GetMillisecondsSinceEpoch ();
+		m_ResendTimer.expires_from_now (boost::posix_time::milliseconds(resendTime > ts ? resendTime - ts : 0));
 		auto s = m_Session.shared_from_this();
 		m_ResendTimer.async_wait ([s](const boost::system::error_code& ecode)
 			{ s->m_Data.HandleResendTimer (ecode); });
@@ -430,52 +514,77 @@ namespace transport
 	{
 		if (ecode != boost::asio::error::operation_aborted)
 		{
-			uint32_t ts = i2p::util::GetSecondsSinceEpoch ();
+			m_ResendTimerTime = 0;
+			uint64_t ts = i2p::util::GetMillisecondsSinceEpoch (), nextResendTime = 0;
 			int numResent = 0;
 			for (auto it = m_SentMessages.begin (); it != m_SentMessages.end ();)
 			{
-				if (ts >= it->second->nextResendTime)
+				auto& sentMessage = it->second;
+				if (sentMessage->nextResendTime && ts >= sentMessage->nextResendTime)
 				{
-					if (it->second->numResends < MAX_NUM_RESENDS)
+					// RTO might be much shorter than resend interval used to be, give up by time as well
+					if (sentMessage->numResends < MAX_NUM_RESENDS || ts < sentMessage->firstSendTime + MAX_RESEND_TIME*1000LL)
 					{
-						for (auto& f: it->second->fragments)
-							if (f)
+						for (auto& f: sentMessage->fragments)
+							if (f && f->numSends > 0 && !f->isQueued)
 							{
-								try
-								{
-									m_Session.Send (f->buf, f->len); // resend
-									numResent++;
-								}
-								catch (boost::system::system_error& ec)
-								{
-									LogPrint (eLogWarning, "SSU: Can't resend data fragment ", ec.what ());
-								}
+								m_CongestionControl.OnTimeout (f->packetNum);
+								f->isQueued = true;
+								m_ResendQueue.push_back (std::make_pair (it->first, f->fragmentNum));
+								numResent++;
 							}
-
-						it->second->numResends++;
-						it->second->nextResendTime += it->second->numResends*RESEND_INTERVAL;
-						++it;
+						sentMessage->numResends++;
+						sentMessage->nextResendTime = ts + m_CongestionControl.GetRTO (); // updated again when resent
 					}
 					else
 					{
-						LogPrint (eLogInfo, "SSU: message has not been ACKed after ", MAX_NUM_RESENDS, " attempts, deleted");
+						LogPrint (eLogInfo, "SSU: message has not been ACKed after ", sentMessage->numResends, " attempts, deleted");
+						int numInFlight = 0;
+						for (auto& f: sentMessage->fragments)
+							if (f)
+							{
+								if (f->numSends > 0)
+									numInFlight++;
+								else
+									m_NumQueuedFragments--;
+							}
+						m_CongestionControl.OnPacketsDropped (numInFlight);
 						it = m_SentMessages.erase (it);
+						continue;
 					}
 				}
-				else
-					++it;
+				if (sentMessage->nextResendTime && (!nextResendTime || sentMessage->nextResendTime < nextResendTime))
+					nextResendTime = sentMessage->nextResendTime;
+				++it;
 			}
-			if (m_SentMessages.empty ()) return; // nothing to resend
-			if (numResent < MAX_OUTGOING_WINDOW_SIZE)
-				ScheduleResend ();
-			else
+			if (numResent >= MAX_OUTGOING_WINDOW_SIZE)
 			{
 				LogPrint (eLogError, "SSU: resend window exceeds max size. Session terminated");
 				m_Session.Close ();
+				return;
 			}
+			if (nextResendTime) ScheduleResend (nextResendTime);
+			SendFragments ();
 		}
 	}
 
+	void SSUData::SchedulePacing (int delay)
+	{
+		if (m_IsPacingTimerScheduled) return;
+		m_IsPacingTimerScheduled = true;
+		m_PacingTimer.expires_from_now (boost::posix_time::milliseconds(delay));
+		auto s = m_Session.shared_from_this();
+		m_PacingTimer.async_wait ([s](const boost::system::error_code& ecode)
+			{ s->m_Data.HandlePacingTimer (ecode); });
+	}
+
+	void SSUData::HandlePacingTimer (const boost::system::error_code& ecode)
+	{
+		m_IsPacingTimerScheduled = false;
+		if (ecode != boost::asio::error::operation_aborted)
+			SendFragments ();
+	}
+
 	void SSUData::ScheduleIncompleteMessagesCleanup ()
 	{
 		m_IncompleteMessagesCleanupTimer.cancel ();
@@ -5,12 +5,14 @@
 #include <string.h>
 #include <map>
 #include <vector>
+#include <deque>
 #include <unordered_set>
 #include <memory>
 #include <boost/asio.hpp>
 #include "I2NPProtocol.h"
 #include "Identity.h"
 #include "RouterInfo.h"
+#include "SSUCongestion.h"
 
 namespace i2p
 {
@@ -28,12 +30,13 @@ namespace transport
 	const size_t UDP_HEADER_SIZE = 8;
 	const size_t SSU_V4_MAX_PACKET_SIZE = SSU_MTU_V4 - IPV4_HEADER_SIZE - UDP_HEADER_SIZE; // 1456
 	const size_t SSU_V6_MAX_PACKET_SIZE = SSU_MTU_V6 - IPV6_HEADER_SIZE - UDP_HEADER_SIZE; // 1440
-	const int RESEND_INTERVAL = 3; // in seconds
 	const int MAX_NUM_RESENDS = 5;
+	const int MAX_RESEND_TIME = 45; // in seconds, unACKed message is deleted after MAX_NUM_RESENDS and that time
 	const int DECAY_INTERVAL = 20; // in seconds
 	const int INCOMPLETE_MESSAGES_CLEANUP_TIMEOUT = 30; // in seconds
 	const unsigned int MAX_NUM_RECEIVED_MESSAGES = 1000; // how many msgID we store for duplicates check
 	const int MAX_OUTGOING_WINDOW_SIZE = 200; // how many unacked message we can store
+	const size_t MAX_NUM_QUEUED_FRAGMENTS = 1024; // waiting for congestion window
 	// data flags
 	const uint8_t DATA_FLAG_EXTENDED_DATA_INCLUDED = 0x02;
 	const uint8_t DATA_FLAG_WANT_REPLY = 0x04;
@@ -48,10 +51,16 @@ namespace transport
 		size_t len;
 		bool isLast;
 		uint8_t buf[SSU_V4_MAX_PACKET_SIZE + 18]; // use biggest
+		// outgoing fragments only
+		uint64_t sendTime; // of last transmission, in milliseconds
+		uint32_t packetNum; // of last transmission, 0 if not sent yet
+		int numSends;
+		bool isQueued; // waiting in send or resend queue
 
-		Fragment () = default;
+		Fragment (): sendTime (0), packetNum (0), numSends (0), isQueued (false) {};
 		Fragment (int n, const uint8_t * b, int l, bool last):
-			fragmentNum (n), len (l), isLast (last) { memcpy (buf, b, len); };
+			fragmentNum (n), len (l), isLast (last), sendTime (0), packetNum (0), numSends (0), isQueued (false)
+			{ memcpy (buf, b, len); };
 	};
 
 	struct FragmentCmp
@@ -76,7 +85,7 @@ namespace transport
 	struct SentMessage
 	{
 		std::vector<std::unique_ptr<Fragment> > fragments;
-		uint32_t nextResendTime; // in seconds
+		uint64_t firstSendTime, nextResendTime; // in milliseconds, 0 if nothing sent yet
 		int numResends;
 	};
 
@@ -98,16 +107,23 @@ namespace transport
 			void AdjustPacketSize (std::shared_ptr<const i2p::data::RouterInfo> remoteRouter);
 			void UpdatePacketSize (const i2p::data::IdentHash& remoteIdent);
 
+			const SSUCongestionControl& GetCongestionControl () const { return m_CongestionControl; };
+
 		private:
 
 			void SendMsgAck (uint32_t msgID);
 			void SendFragmentAck (uint32_t msgID, int fragmentNum);
 			void ProcessAcks (uint8_t *& buf, uint8_t flag);
 			void ProcessFragments (uint8_t * buf);
-			void ProcessSentMessageAck (uint32_t msgID);
+			void ProcessSentMessageAck (uint32_t msgID, uint64_t ts);
+			void ProcessFragmentAck (Fragment& fragment, uint64_t ts);
+			void DetectLostFragments (uint64_t ts);
+			void SendFragments (); // as congestion window and pacing allow
 
-			void ScheduleResend ();
+			void ScheduleResend (uint64_t resendTime);
 			void HandleResendTimer (const boost::system::error_code& ecode);
+			void SchedulePacing (int delay);
+			void HandlePacingTimer (const boost::system::error_code& ecode);
 
 			void ScheduleIncompleteMessagesCleanup ();
 			void HandleIncompleteMessagesCleanupTimer (const boost::system::error_code& ecode);
@@ -119,7 +135,12 @@ namespace transport
 			std::map<uint32_t, std::unique_ptr<IncompleteMessage> > m_IncompleteMessages;
 			std::map<uint32_t, std::unique_ptr<SentMessage> > m_SentMessages;
 			std::unordered_set<uint32_t> m_ReceivedMessages;
-			boost::asio::deadline_timer m_ResendTimer, m_IncompleteMessagesCleanupTimer;
+			std::deque<std::pair<uint32_t, int> > m_SendQueue, m_ResendQueue; // msgID, fragmentNum
+			size_t m_NumQueuedFragments; // not sent yet, m_SendQueue also has entries of ACKed or deleted messages
+			SSUCongestionControl m_CongestionControl;
+			boost::asio::deadline_timer m_ResendTimer, m_IncompleteMessagesCleanupTimer, m_PacingTimer;
+			uint64_t m_ResendTimerTime; // in milliseconds, 0 if not scheduled
+			bool m_IsPacingTimerScheduled;
 			int m_MaxPacketSize, m_PacketSize;
 			i2p::I2NPMessagesHandler m_Handler;
 			uint32_t m_LastMessageReceivedTime; // in second
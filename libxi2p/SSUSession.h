@@ -87,6 +87,7 @@ namespace transport
 			SessionState GetState () const  { return m_State; };
 			size_t GetNumSentBytes () const { return m_NumSentBytes; };
 			size_t GetNumReceivedBytes () const { return m_NumReceivedBytes; };
+			const SSUCongestionControl& GetCongestionControl () const { return m_Data.GetCongestionControl (); };
 
 			void SendKeepAlive ();
 			uint32_t GetRelayTag () const { return m_RelayTag; };
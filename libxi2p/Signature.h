@@ -368,10 +368,15 @@ namespace crypto
 
 			EDDSA25519Verifier (const uint8_t * signingKey);
 			bool Verify (const uint8_t * buf, size_t len, const uint8_t * signature) const;
+			void CreateVerification (const uint8_t * buf, size_t len, const uint8_t * signature, EDDSAVerification& verification) const; // for Ed25519::VerifyBatch
 
 			size_t GetPublicKeyLen () const { return EDDSA25519_PUBLIC_KEY_LENGTH; };
 			size_t GetSignatureLen () const { return EDDSA25519_SIGNATURE_LENGTH; };
 
+		private:
+
+			void CalculateDigest (const uint8_t * buf, size_t len, const uint8_t * signature, uint8_t * digest) const;
+
 		private:
 
 			EDDSAPoint m_PublicKey;
@@ -44,6 +44,35 @@ namespace stream
 		return offset;
 	}
 
+	size_t SendBufferQueue::Get (Packet * packet, size_t len)
+	{
+		size_t offset = 0;
+		while (!m_Buffers.empty () && offset < len && !packet->payloadBuffer)
+		{
+			auto nextBuffer = m_Buffers.front ();
+			auto rem = std::min (nextBuffer->GetRemainingSize (), len - offset);
+			if (nextBuffer->isCopy && rem >= MIN_REFERENCED_PAYLOAD_SIZE)
+			{
+				// refer to it, nothing can be appended after that
+				packet->payloadBuffer = nextBuffer;
+				packet->payloadRef = nextBuffer->GetRemaningBuffer ();
+				packet->payloadRefLen = rem;
+			}
+			else
+			{
+				// caller's buffer must be released by handler as soon as possible
+				memcpy (packet->buf + packet->len, nextBuffer->GetRemaningBuffer (), rem);
+				packet->len += rem;
+			}
+			nextBuffer->offset += rem;
+			offset += rem;
+			if (!nextBuffer->GetRemainingSize ())
+				m_Buffers.pop_front (); // delete it if not referred
+		}
+		m_Size -= offset;
+		return offset;
+	}
+
 	void SendBufferQueue::CleanUp ()
 	{
 		if (!m_Buffers.empty ())
@@ -60,22 +89,25 @@ namespace stream
 		m_SendStreamID (0), m_SequenceNumber (0), m_LastReceivedSequenceNumber (-1),
 		m_Status (eStreamStatusNew), m_IsAckSendScheduled (false), m_LocalDestination (local),
 		m_RemoteLeaseSet (remote), m_ReceiveTimer (m_Service), m_ResendTimer (m_Service),
-		m_AckSendTimer (m_Service),  m_NumSentBytes (0), m_NumReceivedBytes (0), m_Port (port),
-		m_WindowSize (MIN_WINDOW_SIZE), m_RTT (INITIAL_RTT), m_RTO (INITIAL_RTO),
+		m_AckSendTimer (m_Service), m_PacingTimer (m_Service), m_NumSentBytes (0), m_NumReceivedBytes (0), m_Port (port),
 		m_AckDelay (local.GetOwner ()->GetStreamingAckDelay ()),
-		m_LastWindowSizeIncreaseTime (0), m_NumResendAttempts (0)
+		m_CongestionControl (local.GetOwner ()->GetStreamingCongestionControl (), m_AckDelay),
+		m_IsPacingScheduled (false), m_NumResendAttempts (0)
 	{
 		RAND_bytes ((uint8_t *)&m_RecvStreamID, 4);
 		m_RemoteIdentity = remote->GetIdentity ();
+		if (m_LocalDestination.GetMetricsCache ().Load (m_RemoteIdentity->GetIdentHash (), m_CongestionControl, i2p::util::GetMillisecondsSinceEpoch ()))
+			LogPrint (eLogDebug, "Streaming: Outgoing stream starts with rtt=", m_CongestionControl.GetRTT (), " window=", m_CongestionControl.GetWindowSize ());
 	}
 
 	Stream::Stream (boost::asio::io_service& service, StreamingDestination& local):
 		m_Service (service), m_SendStreamID (0), m_SequenceNumber (0), m_LastReceivedSequenceNumber (-1),
 		m_Status (eStreamStatusNew), m_IsAckSendScheduled (false), m_LocalDestination (local),
 		m_ReceiveTimer (m_Service), m_ResendTimer (m_Service), m_AckSendTimer (m_Service),
-		m_NumSentBytes (0), m_NumReceivedBytes (0), m_Port (0),  m_WindowSize (MIN_WINDOW_SIZE),
-		m_RTT (INITIAL_RTT), m_RTO (INITIAL_RTO), m_AckDelay (local.GetOwner ()->GetStreamingAckDelay ()),
-		m_LastWindowSizeIncreaseTime (0), m_NumResendAttempts (0)
+		m_PacingTimer (m_Service), m_NumSentBytes (0), m_NumReceivedBytes (0), m_Port (0),
+		m_AckDelay (local.GetOwner ()->GetStreamingAckDelay ()),
+		m_CongestionControl (local.GetOwner ()->GetStreamingCongestionControl (), m_AckDelay),
+		m_IsPacingScheduled (false), m_NumResendAttempts (0)
 	{
 		RAND_bytes ((uint8_t *)&m_RecvStreamID, 4);
 	}
@@ -86,13 +118,26 @@ namespace stream
 		LogPrint (eLogDebug, "Streaming: Stream deleted");
 	}
 
-	void Stream::Terminate ()
+	void Stream::Terminate (bool deleteFromDestination)
 	{
+		m_IsAckSendScheduled = false; // ack handler doesn't check for abort
 		m_AckSendTimer.cancel ();
 		m_ReceiveTimer.cancel ();
 		m_ResendTimer.cancel ();
-		//CleanUp (); /* Need to recheck - broke working on windows */
-		m_LocalDestination.DeleteStream (shared_from_this ());
+		m_PacingTimer.cancel ();
+		if (m_RemoteIdentity)
+			m_LocalDestination.GetMetricsCache ().Save (m_RemoteIdentity->GetIdentHash (), m_CongestionControl, i2p::util::GetMillisecondsSinceEpoch ());
+		if (deleteFromDestination)
+		{
+			//CleanUp (); /* Need to recheck - broke working on windows */
+			m_LocalDestination.DeleteStream (shared_from_this ());
+		}
+		else
+		{
+			// destination is being stopped, stream might outlive it
+			m_Status = eStreamStatusTerminated;
+			CleanUp (); // return packets to destination's pool
+		}
 	}
 
 	void Stream::CleanUp ()
@@ -108,13 +153,11 @@ namespace stream
 			m_LocalDestination.DeletePacket (packet);
 		}
 
-		for (auto it: m_SentPackets)
-			m_LocalDestination.DeletePacket (it);
-		m_SentPackets.clear ();
+		while (!m_SentPackets.IsEmpty ())
+			m_LocalDestination.DeletePacket (m_SentPackets.Remove (m_SentPackets.GetFirstSeqn ()));
 
-		for (auto it: m_SavedPackets)
-			m_LocalDestination.DeletePacket (it);
-		m_SavedPackets.clear ();
+		while (!m_SavedPackets.IsEmpty ())
+			m_LocalDestination.DeletePacket (m_SavedPackets.Remove (m_SavedPackets.GetFirstSeqn ()));
 	}
 
 	void Stream::HandleNextPacket (Packet * packet)
@@ -143,17 +186,11 @@ namespace stream
 			ProcessPacket (packet);
 
 			// we should also try stored messages if any
-			for (auto it = m_SavedPackets.begin (); it != m_SavedPackets.end ();)
+			while (!m_SavedPackets.IsEmpty ())
 			{
-				if ((*it)->GetSeqn () == (uint32_t)(m_LastReceivedSequenceNumber + 1))
-				{
-					Packet * savedPacket = *it;
-					m_SavedPackets.erase (it++);
-
-					ProcessPacket (savedPacket);
-				}
-				else
-					break;
+				Packet * savedPacket = m_SavedPackets.Remove (m_LastReceivedSequenceNumber + 1);
+				if (!savedPacket) break;
+				ProcessPacket (savedPacket);
 			}
 
 			// schedule ack for last message
@@ -162,7 +199,7 @@ namespace stream
 				if (!m_IsAckSendScheduled)
 				{
 					m_IsAckSendScheduled = true;
-					auto ackTimeout = m_RTT/10;
+					auto ackTimeout = m_CongestionControl.GetRTT ()/10;
 					if (ackTimeout > m_AckDelay) ackTimeout = m_AckDelay;
 					m_AckSendTimer.expires_from_now (boost::posix_time::milliseconds(ackTimeout));
 					m_AckSendTimer.async_wait (std::bind (&Stream::HandleAckSendTimer,
@@ -211,7 +248,7 @@ namespace stream
 
 	void Stream::SavePacket (Packet * packet)
 	{
-		if (!m_SavedPackets.insert (packet).second)
+		if (!m_SavedPackets.Insert (packet)) // duplicate or too far ahead
 			m_LocalDestination.DeletePacket (packet);
 	}
 
@@ -239,7 +276,11 @@ namespace stream
 			}
 			optionData += m_RemoteIdentity->GetFullLen ();
 			if (!m_RemoteLeaseSet)
+			{
 				LogPrint (eLogDebug, "Streaming: Incoming stream from ", m_RemoteIdentity->GetIdentHash ().ToBase64 (), ", sSID=", m_SendStreamID, ", rSID=", m_RecvStreamID);
+				if (m_LocalDestination.GetMetricsCache ().Load (m_RemoteIdentity->GetIdentHash (), m_CongestionControl, i2p::util::GetMillisecondsSinceEpoch ()))
+					LogPrint (eLogDebug, "Streaming: Incoming stream starts with rtt=", m_CongestionControl.GetRTT (), " window=", m_CongestionControl.GetWindowSize ());
+			}
 		}
 
 		if (flags & PACKET_FLAG_MAX_PACKET_SIZE_INCLUDED)
@@ -300,7 +341,8 @@ namespace stream
 
 	void Stream::ProcessAck (Packet * packet)
 	{
-		bool acknowledged = false;
+		bool acknowledged = false, isFirstAcked = false;
+		int rtt = -1; // of last acknowledged packet
 		auto ts = i2p::util::GetMillisecondsSinceEpoch ();
 		uint32_t ackThrough = packet->GetAckThrough ();
 		if (ackThrough > m_SequenceNumber)
@@ -308,62 +350,58 @@ namespace stream
 			LogPrint (eLogError, "Streaming: Unexpected ackThrough=", ackThrough, " > seqn=", m_SequenceNumber);
 			return;
 		}
-		int nackCount = packet->GetNACKCount ();
-		for (auto it = m_SentPackets.begin (); it != m_SentPackets.end ();)
+		// NACKs are usually sorted already, walk them along with sent packets
+		int nackCount = packet->GetNACKCount (), nackIndex = 0;
+		uint32_t nacks[256];
+		for (int i = 0; i < nackCount; i++)
+			nacks[i] = packet->GetNACK (i);
+		std::sort (nacks, nacks + nackCount);
+		std::vector<Packet *> resendPackets;
+		for (uint32_t seqn = m_SentPackets.GetNextSeqn (0); seqn <= ackThrough && seqn < m_SentPackets.GetEndSeqn ();
+			seqn = m_SentPackets.GetNextSeqn (seqn + 1))
 		{
-			auto seqn = (*it)->GetSeqn ();
-			if (seqn <= ackThrough)
+			auto sentPacket = m_SentPackets.Get (seqn);
+			while (nackIndex < nackCount && nacks[nackIndex] < seqn) nackIndex++;
+			if (nackIndex < nackCount && nacks[nackIndex] == seqn)
 			{
-				if (nackCount > 0)
+				// NACKs sent before resent packet could arrive are for previous attempt
+				if (!sentPacket->numResends || ts >= sentPacket->sendTime + m_CongestionControl.GetRTT ())
+					sentPacket->numNacks++;
+				LogPrint (eLogDebug, "Streaming: Packet ", seqn, " NACK ", sentPacket->numNacks);
+				if (sentPacket->numNacks >= FAST_RETRANSMIT_NACK_THRESHOLD)
 				{
-					bool nacked = false;
-					for (int i = 0; i < nackCount; i++)
-						if (seqn == packet->GetNACK (i))
-						{
-							nacked = true;
-							break;
-						}
-					if (nacked)
-					{
-						LogPrint (eLogDebug, "Streaming: Packet ", seqn, " NACK");
-						++it;
-						continue;
-					}
+					// fast retransmit, later packets got through
+					m_CongestionControl.OnPacketLost (seqn, m_SequenceNumber);
+					sentPacket->sendTime = ts;
+					sentPacket->numResends++;
+					sentPacket->numNacks = 0;
+					resendPackets.push_back (sentPacket);
 				}
-				auto sentPacket = *it;
-				uint64_t rtt = ts - sentPacket->sendTime;
-				if(ts < sentPacket->sendTime)
-				{
-					LogPrint(eLogError, "Streaming: Packet ", seqn, "sent from the future, sendTime=", sentPacket->sendTime);
-					rtt = 1;
-				}
-				m_RTT = (m_RTT*seqn + rtt)/(seqn + 1);
-				m_RTO = m_RTT*1.5; // TODO: implement it better
-				LogPrint (eLogDebug, "Streaming: Packet ", seqn, " acknowledged rtt=", rtt, " sentTime=", sentPacket->sendTime);
-				m_SentPackets.erase (it++);
-				m_LocalDestination.DeletePacket (sentPacket);
-				acknowledged = true;
-				if (m_WindowSize < WINDOW_SIZE)
-					m_WindowSize++; // slow start
-				else
-				{
-					// linear growth
-					if (ts > m_LastWindowSizeIncreaseTime + m_RTT)
-					{
-						m_WindowSize++;
-						if (m_WindowSize > MAX_WINDOW_SIZE) m_WindowSize = MAX_WINDOW_SIZE;
-						m_LastWindowSizeIncreaseTime = ts;
-					}
-				}
-				if (!seqn && m_RoutingSession) // first message confirmed
-					m_RoutingSession->SetSharedRoutingPath (
-						std::make_shared<i2p::garlic::GarlicRoutingPath> (
-							i2p::garlic::GarlicRoutingPath{m_CurrentOutboundTunnel, m_CurrentRemoteLease, m_RTT, 0, 0}));
+				continue;
 			}
-			else
-				break;
+			if (ts < sentPacket->sendTime)
+				LogPrint(eLogError, "Streaming: Packet ", seqn, "sent from the future, sendTime=", sentPacket->sendTime);
+			else if (!sentPacket->numResends) // Karn's algorithm
+				rtt = ts - sentPacket->sendTime;
+			LogPrint (eLogDebug, "Streaming: Packet ", seqn, " acknowledged rtt=", ts - sentPacket->sendTime, " sentTime=", sentPacket->sendTime);
+			m_CongestionControl.OnPacketAcked (ts, seqn);
+			m_SentPackets.Remove (seqn);
+			m_LocalDestination.DeletePacket (sentPacket);
+			acknowledged = true;
+			if (!seqn) isFirstAcked = true;
+		}
+		if (rtt >= 0)
+			m_CongestionControl.UpdateRTT (rtt);
+		if (isFirstAcked && m_RoutingSession) // first message confirmed
+			m_RoutingSession->SetSharedRoutingPath (
+				std::make_shared<i2p::garlic::GarlicRoutingPath> (
+					i2p::garlic::GarlicRoutingPath{m_CurrentOutboundTunnel, m_CurrentRemoteLease, m_CongestionControl.GetRTT (), 0, 0}));
+		if (!resendPackets.empty ())
+		{
+			LogPrint (eLogDebug, "Streaming: Fast retransmit of ", resendPackets.size (), " packets, sSID=", m_SendStreamID);
+			SendPackets (resendPackets);
 		}
-		if (m_SentPackets.empty ())
+		if (m_SentPackets.IsEmpty ())
 			m_ResendTimer.cancel ();
 		if (acknowledged)
 		{
@@ -403,15 +441,26 @@ namespace stream
 
 	void Stream::SendBuffer ()
 	{
-		int numMsgs = m_WindowSize - m_SentPackets.size ();
+		if (m_Status == eStreamStatusTerminated) return; // destination is stopped
+		if (m_IsPacingScheduled) return; // will be sent by pacing timer
+		int numMsgs = m_CongestionControl.GetWindowSize () - m_SentPackets.GetSize ();
 		if (numMsgs <= 0) return; // window is full
 
 		bool isNoAck = m_LastReceivedSequenceNumber < 0; // first packet
+		auto ts = i2p::util::GetMillisecondsSinceEpoch ();
+		int pacingDelay = 0;
 		std::vector<Packet *> packets;
 		{
 			std::unique_lock<std::mutex> l(m_SendBufferMutex);
 			while ((m_Status == eStreamStatusNew) || (IsEstablished () && !m_SendBuffer.IsEmpty () && numMsgs > 0))
 			{
+				if (m_Status != eStreamStatusNew)
+				{
+					// oldest packet is still not ACKed, keep the rest in send buffer
+					if (!m_SentPackets.CanInsert (m_SequenceNumber)) break;
+					pacingDelay = m_CongestionControl.GetPacingDelay (ts);
+					if (pacingDelay > 0) break;
+				}
 				Packet * p = m_LocalDestination.NewPacket ();
 				uint8_t * packet = p->GetBuffer ();
 				// TODO: implement setters
@@ -429,7 +478,7 @@ namespace stream
 				size += 4; // ack Through
 				packet[size] = 0;
 				size++; // NACK count
-				packet[size] = m_RTO/1000;
+				packet[size] = m_CongestionControl.GetRTO ()/1000;
 				size++; // resend delay
 				if (m_Status == eStreamStatusNew)
 				{
@@ -461,26 +510,34 @@ namespace stream
 					size += 2; // flags
 					htobuf16 (packet + size, 0); // no options
 					size += 2; // options size
-					size += m_SendBuffer.Get(packet + size, STREAMING_MTU - size); // payload
+					p->len = size;
+					size += m_SendBuffer.Get (p, STREAMING_MTU - size); // payload
 				}
-				p->len = size;
+				p->len = size - p->payloadRefLen;
 				packets.push_back (p);
+				m_CongestionControl.OnPacketSent ();
 				numMsgs--;
 			}
 		}
 		if (packets.size () > 0)
 		{
-			if (m_SavedPackets.empty ()) // no NACKS
+			if (m_SavedPackets.IsEmpty ()) // no NACKS
 			{
 				m_IsAckSendScheduled = false;
 				m_AckSendTimer.cancel ();
 			}
-			bool isEmpty = m_SentPackets.empty ();
-			auto ts = i2p::util::GetMillisecondsSinceEpoch ();
-			for (auto& it: packets)
+			bool isEmpty = m_SentPackets.IsEmpty ();
+			for (auto it = packets.begin (); it != packets.end ();)
 			{
-				it->sendTime = ts;
-				m_SentPackets.insert (it);
+				(*it)->sendTime = ts;
+				if (!m_SentPackets.Insert (*it))
+				{
+					LogPrint (eLogError, "Streaming: Can't keep packet ", (*it)->GetSeqn (), " for resend, sSID=", m_SendStreamID);
+					m_LocalDestination.DeletePacket (*it);
+					it = packets.erase (it);
+				}
+				else
+					++it;
 			}
 			SendPackets (packets);
 			if (m_Status == eStreamStatusClosing && m_SendBuffer.IsEmpty ())
@@ -488,14 +545,21 @@ namespace stream
 			if (isEmpty)
 				ScheduleResend ();
 		}
+		if (pacingDelay > 0)
+		{
+			m_IsPacingScheduled = true;
+			m_PacingTimer.expires_from_now (boost::posix_time::milliseconds(pacingDelay));
+			m_PacingTimer.async_wait (std::bind (&Stream::HandlePacingTimer,
+				shared_from_this (), std::placeholders::_1));
+		}
 	}
 
 	void Stream::SendQuickAck ()
 	{
 		int32_t lastReceivedSeqn = m_LastReceivedSequenceNumber;
-		if (!m_SavedPackets.empty ())
+		if (!m_SavedPackets.IsEmpty ())
 		{
-			int32_t seqn = (*m_SavedPackets.rbegin ())->GetSeqn ();
+			int32_t seqn = m_SavedPackets.GetEndSeqn () - 1;
 			if (seqn > lastReceivedSeqn) lastReceivedSeqn = seqn;
 		}
 		if (lastReceivedSeqn < 0)
@@ -520,23 +584,18 @@ namespace stream
 		{
 			// fill NACKs
 			uint8_t * nacks = packet + size + 1;
-			auto nextSeqn = m_LastReceivedSequenceNumber + 1;
-			for (auto it: m_SavedPackets)
+			for (uint32_t seqn = m_LastReceivedSequenceNumber + 1; seqn < (uint32_t)lastReceivedSeqn; seqn++)
 			{
-				auto seqn = it->GetSeqn ();
-				if (numNacks + (seqn - nextSeqn) >= 256)
+				if (m_SavedPackets.Get (seqn)) continue;
+				if (numNacks == 255)
 				{
-					LogPrint (eLogError, "Streaming: Number of NACKs exceeds 256. seqn=", seqn, " nextSeqn=", nextSeqn);
-					htobe32buf (packet + 12, nextSeqn); // change ack Through
+					LogPrint (eLogError, "Streaming: Number of NACKs exceeds 256. seqn=", seqn);
+					htobe32buf (packet + 12, seqn); // change ack Through
 					break;
 				}
-				for (uint32_t i = nextSeqn; i < seqn; i++)
-				{
-					htobe32buf (nacks, i);
-					nacks += 4;
-					numNacks++;
-				}
-				nextSeqn = seqn + 1;
+				htobe32buf (nacks, seqn);
+				nacks += 4;
+				numNacks++;
 			}
 			packet[size] = numNacks;
 			size++; // NACK count
@@ -575,7 +634,7 @@ namespace stream
 				Terminate ();
 			break;
 			case eStreamStatusClosing:
-				if (m_SentPackets.empty () && m_SendBuffer.IsEmpty ()) // nothing to send
+				if (m_SentPackets.IsEmpty () && m_SendBuffer.IsEmpty ()) // nothing to send
 				{
 					m_Status = eStreamStatusClosed;
 					SendClose();
@@ -585,6 +644,9 @@ namespace stream
 				// already closed
 				Terminate ();
 			break;
+			case eStreamStatusTerminated:
+				// by stopped destination, nothing to send
+			break;
 			default:
 				LogPrint (eLogWarning, "Streaming: Unexpected stream status ", (int)m_Status, "sSID=", m_SendStreamID);
 		};
@@ -650,8 +712,13 @@ namespace stream
 				m_AckSendTimer.cancel ();
 			}
 			SendPackets (std::vector<Packet *> { packet });
-			bool isEmpty = m_SentPackets.empty ();
-			m_SentPackets.insert (packet);
+			bool isEmpty = m_SentPackets.IsEmpty ();
+			if (!m_SentPackets.Insert (packet))
+			{
+				LogPrint (eLogError, "Streaming: Can't keep packet ", packet->GetSeqn (), " for resend, sSID=", m_SendStreamID);
+				m_LocalDestination.DeletePacket (packet);
+				return false;
+			}
 			if (isEmpty)
 				ScheduleResend ();
 			return true;
@@ -671,6 +738,19 @@ namespace stream
 				return;
 			}
 		}
+		auto localDestination = m_LocalDestination.GetOwner ()->FindLocalDestination (m_RemoteLeaseSet->GetIdentHash ());
+		if (localDestination)
+		{
+			// on this router, no garlic and tunnels, nothing to gain from compression
+			std::vector<std::shared_ptr<I2NPMessage> > msgs;
+			for (auto it: packets)
+			{
+				msgs.push_back (m_LocalDestination.CreateDataMessage (it, m_Port, false));
+				m_NumSentBytes += it->GetFullLength ();
+			}
+			m_LocalDestination.GetOwner ()->DeliverLocally (localDestination, msgs);
+			return;
+		}
 		if (!m_RoutingSession || !m_RoutingSession->GetOwner ()) // expired and detached
 			m_RoutingSession = m_LocalDestination.GetOwner ()->GetRoutingSession (m_RemoteLeaseSet, true);
 		if (!m_CurrentOutboundTunnel && m_RoutingSession) // first message to send
@@ -681,8 +761,7 @@ namespace stream
 			{
 				m_CurrentOutboundTunnel = routingPath->outboundTunnel;
 				m_CurrentRemoteLease = routingPath->remoteLease;
-				m_RTT = routingPath->rtt;
-				m_RTO = m_RTT*1.5; // TODO: implement it better
+				m_CongestionControl.SetRTT (routingPath->rtt);
 			}
 		}
 		if (!m_CurrentOutboundTunnel || !m_CurrentOutboundTunnel->IsEstablished ())
@@ -702,14 +781,14 @@ namespace stream
 			std::vector<i2p::tunnel::TunnelMessageBlock> msgs;
 			for (auto it: packets)
 			{
-				auto msg = m_RoutingSession->WrapSingleMessage (m_LocalDestination.CreateDataMessage (it->GetBuffer (), it->GetLength (), m_Port));
+				auto msg = m_RoutingSession->WrapSingleMessage (m_LocalDestination.CreateDataMessage (it, m_Port));
 				msgs.push_back (i2p::tunnel::TunnelMessageBlock
 					{
 						i2p::tunnel::eDeliveryTypeTunnel,
 						m_CurrentRemoteLease->tunnelGateway, m_CurrentRemoteLease->tunnelID,
 						msg
 					});
-				m_NumSentBytes += it->GetLength ();
+				m_NumSentBytes += it->GetFullLength ();
 			}
 			m_CurrentOutboundTunnel->SendTunnelDataMsg (msgs);
 		}
@@ -749,9 +828,7 @@ namespace stream
 	void Stream::ScheduleResend ()
 	{
 		m_ResendTimer.cancel ();
-		// check for invalid value
-		if (m_RTO <= 0) m_RTO = INITIAL_RTO;
-		m_ResendTimer.expires_from_now (boost::posix_time::milliseconds(m_RTO));
+		m_ResendTimer.expires_from_now (boost::posix_time::milliseconds(m_CongestionControl.GetRTO ()));
 		m_ResendTimer.async_wait (std::bind (&Stream::HandleResendTimer,
 			shared_from_this (), std::placeholders::_1));
 	}
@@ -772,28 +849,26 @@ namespace stream
 			// collect packets to resend
 			auto ts = i2p::util::GetMillisecondsSinceEpoch ();
 			std::vector<Packet *> packets;
-			for (auto it : m_SentPackets)
-			{
-				if (ts >= it->sendTime + m_RTO)
+			m_SentPackets.ForEach ([this, ts, &packets](Packet * it)
 				{
-					it->sendTime = ts;
-					packets.push_back (it);
-				}
-			}
+					if (ts >= it->sendTime + m_CongestionControl.GetRTO ())
+					{
+						it->sendTime = ts;
+						it->numResends++;
+						it->numNacks = 0;
+						packets.push_back (it);
+					}
+				});
 
 			// select tunnels if necessary and send
 			if (packets.size () > 0)
 			{
 				m_NumResendAttempts++;
-				m_RTO *= 2;
+				m_CongestionControl.OnTimeout (m_SequenceNumber); // collapses window and backs off RTO
 				switch (m_NumResendAttempts)
 				{
-					case 1: // congesion avoidance
-						m_WindowSize /= 2;
-						if (m_WindowSize < MIN_WINDOW_SIZE) m_WindowSize = MIN_WINDOW_SIZE;
-					break;
 					case 2:
-						m_RTO = INITIAL_RTO; // drop RTO to initial upon tunnels pair change first time
+						m_CongestionControl.ResetRTO (); // drop RTO to initial upon tunnels pair change first time
 						// no break here
 					case 4:
 						if (m_RoutingSession) m_RoutingSession->SetSharedRoutingPath (nullptr);
@@ -839,6 +914,13 @@ namespace stream
 		}
 	}
 
+	void Stream::HandlePacingTimer (const boost::system::error_code& ecode)
+	{
+		m_IsPacingScheduled = false;
+		if (ecode != boost::asio::error::operation_aborted)
+			SendBuffer ();
+	}
+
 	void Stream::UpdateCurrentRemoteLease (bool expired)
 	{
 		if (!m_RemoteLeaseSet || m_RemoteLeaseSet->IsExpired ())
@@ -926,6 +1008,8 @@ namespace stream
 		m_PendingIncomingStreams.clear ();
 		{
 			std::unique_lock<std::mutex> l(m_StreamsMutex);
+			for (auto& it: m_Streams)
+				it.second->Terminate (false); // cancels timers, we clear m_Streams here
 			m_Streams.clear ();
 		}
 	}
@@ -1129,17 +1213,22 @@ namespace stream
 			DeletePacket (uncompressed);
 	}
 
-	std::shared_ptr<I2NPMessage> StreamingDestination::CreateDataMessage (const uint8_t * payload, size_t len, uint16_t toPort)
+	std::shared_ptr<I2NPMessage> StreamingDestination::CreateDataMessage (Packet * packet, uint16_t toPort, bool compress)
 	{
 		auto msg = NewI2NPShortMessage ();
-		if (!m_Gzip || len <= i2p::stream::COMPRESSION_THRESHOLD_SIZE)
+		// header and payload as is in packet, referenced part of payload is copied by gzip only
+		std::vector<std::pair<const uint8_t *, size_t> > payload;
+		payload.push_back (std::make_pair (packet->GetBuffer (), packet->GetLength ()));
+		if (packet->payloadRefLen)
+			payload.push_back (std::make_pair (packet->payloadRef, packet->payloadRefLen));
+		if (!m_Gzip || !compress || packet->GetFullLength () <= i2p::stream::COMPRESSION_THRESHOLD_SIZE)
 			m_Deflator.SetCompressionLevel (Z_NO_COMPRESSION);
 		else
 			m_Deflator.SetCompressionLevel (Z_DEFAULT_COMPRESSION);
 		uint8_t * buf = msg->GetPayload ();
 		buf += 4; // reserve for lengthlength
 		msg->len += 4;
-		size_t size = m_Deflator.Deflate (payload, len, buf, msg->maxLen - msg->len);
+		size_t size = m_Deflator.Deflate (payload, buf, msg->maxLen - msg->len);
 		if (size)
 		{
 			htobe32buf (msg->GetPayload (), size); // length
@@ -5,6 +5,8 @@
 #include <string>
 #include <map>
 #include <set>
+#include <vector>
+#include <algorithm>
 #include <queue>
 #include <functional>
 #include <memory>
@@ -18,6 +20,7 @@
 #include "Garlic.h"
 #include "Tunnel.h"
 #include "util.h" // MemoryPool
+#include "StreamingCongestion.h"
 
 namespace i2p
 {
@@ -43,25 +46,31 @@ namespace stream
 	const size_t MAX_PACKET_SIZE = 4096;
 	const size_t COMPRESSION_THRESHOLD_SIZE = 66;
 	const int MAX_NUM_RESEND_ATTEMPTS = 6;
-	const int WINDOW_SIZE = 6; // in messages
-	const int MIN_WINDOW_SIZE = 1;
-	const int MAX_WINDOW_SIZE = 128;
-	const int INITIAL_RTT = 8000; // in milliseconds
-	const int INITIAL_RTO = 9000; // in milliseconds
 	const int SYN_TIMEOUT = 200; // how long we wait for SYN after follow-on, in milliseconds
 	const size_t MAX_PENDING_INCOMING_BACKLOG = 128;
 	const int PENDING_INCOMING_TIMEOUT = 10; // in seconds
 	const int MAX_RECEIVE_TIMEOUT = 30; // in seconds
+	const size_t MIN_PACKET_RING_SIZE = 16;
+	const size_t MAX_PACKET_RING_SIZE = 4096; // range of sequence numbers kept by one ring
+	const size_t MIN_REFERENCED_PAYLOAD_SIZE = 256; // smaller parts of send buffers are copied to packet
 
+	struct SendBuffer;
 	struct Packet
 	{
 		size_t len, offset;
 		uint8_t buf[MAX_PACKET_SIZE];
 		uint64_t sendTime;
-
-		Packet (): len (0), offset (0), sendTime (0) {};
+		int numResends, numNacks;
+		// outgoing only, tail of payload stays in send buffer until packet is acknowledged
+		std::shared_ptr<SendBuffer> payloadBuffer;
+		const uint8_t * payloadRef;
+		size_t payloadRefLen;
+
+		Packet (): len (0), offset (0), sendTime (0), numResends (0), numNacks (0),
+			payloadRef (nullptr), payloadRefLen (0) {};
 		uint8_t * GetBuffer () { return buf + offset; };
 		size_t GetLength () const { return len - offset; };
+		size_t GetFullLength () const { return GetLength () + payloadRefLen; }; // with referenced payload
 
 		uint32_t GetSendStreamID () const { return bufbe32toh (buf); };
 		uint32_t GetReceiveStreamID () const { return bufbe32toh (buf + 4); };
@@ -79,12 +88,123 @@ namespace stream
 		bool IsNoAck () const { return GetFlags () & PACKET_FLAG_NO_ACK; };
 	};
 
-	struct PacketCmp
+	// packets indexed by sequence number, slot is seqn modulo size (power of 2).
+	// Covers sequence numbers from first to last kept, insert/get/remove are O(1)
+	class PacketRing
 	{
-		bool operator() (const Packet * p1, const Packet * p2) const
-		{
-			return p1->GetSeqn () < p2->GetSeqn ();
-		};
+		public:
+
+			PacketRing (): m_FirstSeqn (0), m_EndSeqn (0), m_NumPackets (0) {};
+
+			bool IsEmpty () const { return !m_NumPackets; };
+			size_t GetSize () const { return m_NumPackets; };
+			uint32_t GetFirstSeqn () const { return m_FirstSeqn; }; // lowest kept if not empty
+			uint32_t GetEndSeqn () const { return m_EndSeqn; }; // highest kept + 1 if not empty
+
+			Packet * Get (uint32_t seqn) const
+			{
+				if (seqn < m_FirstSeqn || seqn >= m_EndSeqn) return nullptr;
+				return m_Packets[seqn & (m_Packets.size () - 1)];
+			}
+
+			uint32_t GetNextSeqn (uint32_t seqn) const // lowest kept >= seqn, end if none
+			{
+				if (seqn < m_FirstSeqn) seqn = m_FirstSeqn;
+				size_t mask = m_Packets.size () - 1, wordSize = std::min (m_Packets.size (), (size_t)64);
+				while (seqn < m_EndSeqn)
+				{
+					// skip up to 64 empty slots at once
+					size_t ind = seqn & mask;
+					uint64_t bits = m_Occupied[ind >> 6] >> (ind & 63);
+					if (bits)
+					{
+						while (!(bits & 1)) { bits >>= 1; seqn++; }
+						return seqn;
+					}
+					seqn += wordSize - (ind & 63);
+				}
+				return m_EndSeqn;
+			}
+
+			bool CanInsert (uint32_t seqn) const // range of kept packets with seqn fits
+			{
+				if (!m_NumPackets) return true;
+				return std::max (m_EndSeqn, seqn + 1) - std::min (m_FirstSeqn, seqn) <= MAX_PACKET_RING_SIZE;
+			}
+
+			bool Insert (Packet * packet) // false if already there or too far from others
+			{
+				uint32_t seqn = packet->GetSeqn ();
+				if (m_NumPackets)
+				{
+					if (Get (seqn)) return false;
+					uint32_t first = std::min (m_FirstSeqn, seqn), end = std::max (m_EndSeqn, seqn + 1);
+					if (end - first > m_Packets.size () && !Resize (end - first)) return false;
+					m_FirstSeqn = first; m_EndSeqn = end;
+				}
+				else
+				{
+					if (m_Packets.empty ()) Resize (MIN_PACKET_RING_SIZE);
+					m_FirstSeqn = seqn; m_EndSeqn = seqn + 1;
+				}
+				size_t ind = seqn & (m_Packets.size () - 1);
+				m_Packets[ind] = packet;
+				m_Occupied[ind >> 6] |= (uint64_t)1 << (ind & 63);
+				m_NumPackets++;
+				return true;
+			}
+
+			Packet * Remove (uint32_t seqn) // returns nullptr if not found
+			{
+				auto packet = Get (seqn);
+				if (!packet) return nullptr;
+				size_t mask = m_Packets.size () - 1, ind = seqn & mask;
+				m_Packets[ind] = nullptr;
+				m_Occupied[ind >> 6] &= ~((uint64_t)1 << (ind & 63));
+				m_NumPackets--;
+				if (!m_NumPackets)
+					m_FirstSeqn = m_EndSeqn = 0;
+				else if (seqn == m_FirstSeqn)
+					m_FirstSeqn = GetNextSeqn (seqn + 1);
+				else if (seqn == m_EndSeqn - 1)
+					while (!m_Packets[(m_EndSeqn - 1) & mask]) m_EndSeqn--;
+				return packet;
+			}
+
+			template<typename Visitor>
+			void ForEach (Visitor v) const // in order of sequence numbers
+			{
+				for (uint32_t seqn = GetNextSeqn (m_FirstSeqn); seqn < m_EndSeqn; seqn = GetNextSeqn (seqn + 1))
+					v (m_Packets[seqn & (m_Packets.size () - 1)]);
+			}
+
+		private:
+
+			bool Resize (size_t range)
+			{
+				if (range > MAX_PACKET_RING_SIZE) return false;
+				size_t size = m_Packets.empty () ? MIN_PACKET_RING_SIZE : m_Packets.size ();
+				while (size < range) size <<= 1;
+				std::vector<Packet *> packets (size, nullptr);
+				std::vector<uint64_t> occupied ((size + 63)/64, 0);
+				if (m_NumPackets)
+					for (uint32_t seqn = m_FirstSeqn; seqn < m_EndSeqn; seqn++)
+					{
+						size_t ind = seqn & (size - 1);
+						packets[ind] = m_Packets[seqn & (m_Packets.size () - 1)];
+						if (packets[ind]) occupied[ind >> 6] |= (uint64_t)1 << (ind & 63);
+					}
+				m_Packets.swap (packets);
+				m_Occupied.swap (occupied);
+				return true;
+			}
+
+		private:
+
+			std::vector<Packet *> m_Packets;
+			std::vector<uint64_t> m_Occupied; // bit per slot
+			uint32_t m_FirstSeqn, m_EndSeqn;
+			size_t m_NumPackets;
 	};
 
 	typedef std::function<void (const boost::system::error_code& ecode)> SendHandler;
@@ -93,16 +213,22 @@ namespace stream
 		uint8_t * buf;
 		size_t len, offset;
 		SendHandler handler;
+		bool isCopy; // caller's buffer is used until handler is called if handler is set
 
 		SendBuffer (const uint8_t * b, size_t l, SendHandler h):
-			len(l), offset (0), handler(h)
+			len(l), offset (0), handler(h), isCopy (!h)
 		{
-			buf = new uint8_t[len];
-			memcpy (buf, b, len);
+			if (isCopy)
+			{
+				buf = new uint8_t[len];
+				memcpy (buf, b, len);
+			}
+			else
+				buf = const_cast<uint8_t *>(b);
 		}
 		~SendBuffer ()
 		{
-			delete[] buf;
+			if (isCopy) delete[] buf;
 			if (handler) handler(boost::system::error_code ());
 		}
 		size_t GetRemainingSize () const { return len - offset; };
@@ -119,6 +245,7 @@ namespace stream
 
 			void Add (const uint8_t * buf, size_t len, SendHandler handler);
 			size_t Get (uint8_t * buf, size_t len);
+			size_t Get (Packet * packet, size_t len); // appends to packet's payload, refers to copies instead of copying again
 			size_t GetSize () const { return m_Size; };
 			bool IsEmpty () const { return m_Buffers.empty (); };
 			void CleanUp ();
@@ -135,7 +262,8 @@ namespace stream
 		eStreamStatusOpen,
 		eStreamStatusReset,
 		eStreamStatusClosing,
-		eStreamStatusClosed
+		eStreamStatusClosed,
+		eStreamStatusTerminated // by stopped destination
 	};
 
 	class StreamingDestination;
@@ -162,7 +290,7 @@ namespace stream
 			void AsyncSend (const uint8_t * buf, size_t len, SendHandler handler);
 
 			template<typename Buffer, typename ReceiveHandler>
-			void AsyncReceive (const Buffer& buffer, ReceiveHandler handler, int timeout = 0);
+			void AsyncReceive (const Buffer& buffer, ReceiveHandler handler, int timeout = 0); // empty buffer to wait for data only
 			size_t ReadSome (uint8_t * buf, size_t len) { return ConcatenatePackets (buf, len); };
 
 			void AsyncClose() { m_Service.post(std::bind(&Stream::Close, shared_from_this())); };
@@ -173,14 +301,15 @@ namespace stream
 
 			size_t GetNumSentBytes () const { return m_NumSentBytes; };
 			size_t GetNumReceivedBytes () const { return m_NumReceivedBytes; };
-			size_t GetSendQueueSize () const { return m_SentPackets.size (); };
+			size_t GetSendQueueSize () const { return m_SentPackets.GetSize (); };
 			size_t GetReceiveQueueSize () const { return m_ReceiveQueue.size (); };
 			size_t GetSendBufferSize () const { return m_SendBuffer.GetSize (); };
-			int GetWindowSize () const { return m_WindowSize; };
-			int GetRTT () const { return m_RTT; };
+			int GetWindowSize () const { return m_CongestionControl.GetWindowSize (); };
+			int GetRTT () const { return m_CongestionControl.GetRTT (); };
+			const StreamingCongestionControl& GetCongestionControl () const { return m_CongestionControl; };
 
 			/** don't call me */
-			void Terminate ();
+			void Terminate (bool deleteFromDestination = true); // false from StreamingDestination::Stop only
 
 		private:
 
@@ -206,6 +335,7 @@ namespace stream
 			void ScheduleResend ();
 			void HandleResendTimer (const boost::system::error_code& ecode);
 			void HandleAckSendTimer (const boost::system::error_code& ecode);
+			void HandlePacingTimer (const boost::system::error_code& ecode);
 
 		private:
 
@@ -221,16 +351,17 @@ namespace stream
 			std::shared_ptr<const i2p::data::Lease> m_CurrentRemoteLease;
 			std::shared_ptr<i2p::tunnel::OutboundTunnel> m_CurrentOutboundTunnel;
 			std::queue<Packet *> m_ReceiveQueue;
-			std::set<Packet *, PacketCmp> m_SavedPackets;
-			std::set<Packet *, PacketCmp> m_SentPackets;
-			boost::asio::deadline_timer m_ReceiveTimer, m_ResendTimer, m_AckSendTimer;
+			PacketRing m_SavedPackets; // received out of order
+			PacketRing m_SentPackets; // not ACKed yet
+			boost::asio::deadline_timer m_ReceiveTimer, m_ResendTimer, m_AckSendTimer, m_PacingTimer;
 			size_t m_NumSentBytes, m_NumReceivedBytes;
 			uint16_t m_Port;
 
 			std::mutex m_SendBufferMutex;
 			SendBufferQueue m_SendBuffer;
-			int m_WindowSize, m_RTT, m_RTO, m_AckDelay;
-			uint64_t m_LastWindowSizeIncreaseTime;
+			int m_AckDelay;
+			StreamingCongestionControl m_CongestionControl;
+			bool m_IsPacingScheduled;
 			int m_NumResendAttempts;
 	};
 
@@ -258,7 +389,9 @@ namespace stream
 			uint16_t GetLocalPort () const { return m_LocalPort; };
 
 			void HandleDataMessagePayload (const uint8_t * buf, size_t len);
-			std::shared_ptr<I2NPMessage> CreateDataMessage (const uint8_t * payload, size_t len, uint16_t toPort);
+			std::shared_ptr<I2NPMessage> CreateDataMessage (Packet * packet, uint16_t toPort, bool compress = true);
+
+			StreamingMetricsCache<i2p::data::IdentHash>& GetMetricsCache () { return m_MetricsCache; };
 
 			Packet * NewPacket () { return m_PacketsPool.Acquire(); }
 			void DeletePacket (Packet * p) { return m_PacketsPool.Release(p); }
@@ -284,6 +417,7 @@ namespace stream
 			std::map<uint32_t, std::list<Packet *> > m_SavedPackets; // receiveStreamID->packets, arrived before SYN
 
 			i2p::util::MemoryPool<Packet> m_PacketsPool;
+			StreamingMetricsCache<i2p::data::IdentHash> m_MetricsCache; // remote ident -> RTT and window
 
 		public:
 
@@ -302,7 +436,7 @@ namespace stream
 		auto s = shared_from_this();
 		m_Service.post ([s, buffer, handler, timeout](void)
 		{
-			if (!s->m_ReceiveQueue.empty () || s->m_Status == eStreamStatusReset)
+			if (!s->m_ReceiveQueue.empty () || s->m_Status == eStreamStatusReset || s->m_Status == eStreamStatusTerminated)
 				s->HandleReceiveTimer (boost::asio::error::make_error_code (boost::asio::error::operation_aborted), buffer, handler, 0);
 			else
 			{
@@ -325,10 +459,12 @@ namespace stream
 		size_t received = ConcatenatePackets (boost::asio::buffer_cast<uint8_t *>(buffer), boost::asio::buffer_size(buffer));
 		if (received > 0)
 			handler (boost::system::error_code (), received);
+		else if (!boost::asio::buffer_size (buffer) && !m_ReceiveQueue.empty ())
+			handler (boost::system::error_code (), 0); // empty buffer, wait for data to read it by ReadSome
 		else if (ecode == boost::asio::error::operation_aborted)
 		{
 			// timeout not expired
-			if (m_Status == eStreamStatusReset)
+			if (m_Status == eStreamStatusReset || m_Status == eStreamStatusTerminated)
 				handler (boost::asio::error::make_error_code (boost::asio::error::connection_reset), 0);
 			else
 				handler (boost::asio::error::make_error_code (boost::asio::error::operation_aborted), 0);
@@ -0,0 +1,123 @@
+#include <math.h>
+#include <algorithm>
+#include "StreamingCongestion.h"
+
+namespace i2p
+{
+namespace stream
+{
+	StreamingCongestionControl::StreamingCongestionControl (StreamingCongestionControlType type, int ackDelay):
+		m_Type (type), m_Window (MIN_WINDOW_SIZE), m_SlowStartThreshold (MAX_WINDOW_SIZE),
+		m_RTT (INITIAL_RTT, INITIAL_RTO, MIN_RTO, MAX_RTO, ackDelay),
+		m_RecoverySeqn (0), m_IsTimedOut (false),
+		m_EpochStart (0), m_LastMaxWindow (0), m_OriginWindow (0), m_K (0), m_RenoWindow (0),
+		m_Pacer (MAX_PACING_BURST), m_NumLost (0), m_NumTimeouts (0)
+	{
+	}
+
+	void StreamingCongestionControl::SetRTT (int rtt)
+	{
+		if (m_RTT.IsMeasured () || rtt <= 0) return;
+		m_RTT.SetRTT (rtt, rtt/8.0, false);
+	}
+
+	void StreamingCongestionControl::SetMetrics (int rtt, int rttVar, int window, int slowStartThreshold)
+	{
+		if (rtt <= 0) return;
+		m_RTT.SetRTT (rtt, rttVar, true); // as if measured, samples of this stream will be smoothed into it
+		// path might be shared with other streams now, start from half of what it was (RFC 2861)
+		m_Window = std::min (std::max (window/2, MIN_WINDOW_SIZE), MAX_WINDOW_SIZE);
+		m_SlowStartThreshold = std::max (slowStartThreshold, 2*MIN_WINDOW_SIZE);
+	}
+
+	void StreamingCongestionControl::UpdateRTT (int rtt)
+	{
+		m_RTT.AddSample (rtt);
+	}
+
+	void StreamingCongestionControl::OnPacketAcked (uint64_t ts, uint32_t seqn)
+	{
+		m_IsTimedOut = false;
+		if (seqn < m_RecoverySeqn) return; // sent before last reduction
+		if (m_Window < m_SlowStartThreshold)
+			m_Window += 1; // slow start
+		else if (m_Type == eStreamingCongestionControlCubic)
+			IncreaseCubicWindow (ts);
+		else
+			m_Window += 1/m_Window; // Reno
+		if (m_Window > MAX_WINDOW_SIZE) m_Window = MAX_WINDOW_SIZE;
+	}
+
+	void StreamingCongestionControl::IncreaseCubicWindow (uint64_t ts)
+	{
+		if (!m_EpochStart)
+		{
+			// first ACK of congestion avoidance after reduction
+			m_EpochStart = ts;
+			if (m_Window < m_LastMaxWindow)
+			{
+				m_K = cbrt ((m_LastMaxWindow - m_Window)/CUBIC_C);
+				m_OriginWindow = m_LastMaxWindow;
+			}
+			else
+			{
+				m_K = 0;
+				m_OriginWindow = m_Window;
+			}
+			m_RenoWindow = m_Window;
+		}
+		double t = (ts + m_RTT.GetRTT () - m_EpochStart)/1000.0 - m_K; // in seconds, window we want in one RTT
+		double target = m_OriginWindow + CUBIC_C*t*t*t;
+		if (target > 1.5*m_Window) target = 1.5*m_Window;
+		// TCP-friendly region, grow at least as Reno with same average window would
+		m_RenoWindow += 3*(1 - CUBIC_BETA)/(1 + CUBIC_BETA)/m_Window;
+		if (target < m_RenoWindow) target = m_RenoWindow;
+		if (target > m_Window)
+			m_Window += (target - m_Window)/m_Window;
+	}
+
+	void StreamingCongestionControl::ReduceWindow ()
+	{
+		if (m_Type == eStreamingCongestionControlCubic)
+		{
+			// fast convergence, release bandwidth if window didn't reach previous maximum
+			m_LastMaxWindow = (m_Window < m_LastMaxWindow) ? m_Window*(1 + CUBIC_BETA)/2 : m_Window;
+			m_SlowStartThreshold = m_Window*CUBIC_BETA;
+			m_EpochStart = 0;
+		}
+		else
+			m_SlowStartThreshold = m_Window/2;
+		if (m_SlowStartThreshold < 2*MIN_WINDOW_SIZE) m_SlowStartThreshold = 2*MIN_WINDOW_SIZE;
+	}
+
+	void StreamingCongestionControl::OnPacketLost (uint32_t seqn, uint32_t nextSeqn)
+	{
+		m_NumLost++;
+		if (seqn < m_RecoverySeqn) return; // already reduced for this window
+		ReduceWindow ();
+		m_Window = m_SlowStartThreshold;
+		m_RecoverySeqn = nextSeqn;
+	}
+
+	void StreamingCongestionControl::OnTimeout (uint32_t nextSeqn)
+	{
+		m_NumTimeouts++;
+		if (!m_IsTimedOut)
+		{
+			// don't reduce threshold again until something is ACKed
+			ReduceWindow ();
+			m_IsTimedOut = true;
+		}
+		m_Window = MIN_WINDOW_SIZE;
+		m_RecoverySeqn = nextSeqn;
+		m_RTT.BackOff ();
+	}
+
+	int StreamingCongestionControl::GetPacingDelay (uint64_t ts)
+	{
+		if (!m_RTT.IsMeasured ()) return 0; // window only until first RTT sample
+		double rate = (m_Window < m_SlowStartThreshold ? SLOW_START_PACING_GAIN : PACING_GAIN)*m_Window/m_RTT.GetRTT (); // messages per millisecond
+		return m_Pacer.GetDelay (ts, rate);
+	}
+}
+}
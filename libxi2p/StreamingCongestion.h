@@ -0,0 +1,166 @@
+#ifndef STREAMING_CONGESTION_H__
+#define STREAMING_CONGESTION_H__
+
+#include <inttypes.h>
+#include <map>
+#include <mutex>
+#include "Congestion.h"
+
+namespace i2p
+{
+namespace stream
+{
+	const int WINDOW_SIZE = 6; // in messages
+	const int MIN_WINDOW_SIZE = 1;
+	const int MAX_WINDOW_SIZE = 128;
+	const int INITIAL_RTT = 8000; // in milliseconds
+	const int INITIAL_RTO = 9000; // in milliseconds
+	const int MIN_RTO = 100; // in milliseconds
+	const int MAX_RTO = 45000; // in milliseconds
+	const int FAST_RETRANSMIT_NACK_THRESHOLD = 3; // packet NACKed that many times is resent without waiting for RTO
+	const int MAX_PACING_BURST = 4; // in messages
+	const double SLOW_START_PACING_GAIN = 2.0;
+	const double PACING_GAIN = 1.25;
+	const double CUBIC_C = 0.4; // in messages per second^3
+	const double CUBIC_BETA = 0.7; // multiplicative decrease
+	const int STREAMING_METRICS_EXPIRATION_TIMEOUT = 600; // in seconds, tunnels are replaced by then
+	const size_t MAX_NUM_STREAMING_METRICS = 512; // remotes per streaming destination
+
+	enum StreamingCongestionControlType
+	{
+		eStreamingCongestionControlReno = 0,
+		eStreamingCongestionControlCubic
+	};
+
+	// Window of stream's messages in flight. Slow start, then either Reno's additive increase
+	// or CUBIC (RFC 8312) growth with TCP-friendly region. Window is reduced once per window of messages
+	// on fast retransmit (recovery point is sequence number) and collapses on RTO.
+	// RTO is computed by RFC 6298 plus remote's ACK delay, because later messages of ACKed range are
+	// the RTT samples but earlier ones might wait for delayed ACK that long. Messages are paced at window/RTT rate
+	class StreamingCongestionControl
+	{
+		public:
+
+			StreamingCongestionControl (StreamingCongestionControlType type, int ackDelay);
+
+			void SetRTT (int rtt); // known from shared routing path, until first sample
+			void SetMetrics (int rtt, int rttVar, int window, int slowStartThreshold); // from recent stream to same remote
+			void UpdateRTT (int rtt); // sample from message which was not resent
+			void ResetRTO () { m_RTT.SetRTO (INITIAL_RTO); }; // path has changed
+			void OnPacketAcked (uint64_t ts, uint32_t seqn);
+			void OnPacketLost (uint32_t seqn, uint32_t nextSeqn); // fast retransmit, nextSeqn is next to send
+			void OnTimeout (uint32_t nextSeqn); // retransmission timer expired
+			void OnPacketSent () { if (m_RTT.IsMeasured ()) m_Pacer.OnPacketSent (); };
+			int GetPacingDelay (uint64_t ts); // milliseconds until next message can be sent, 0 if now
+
+			StreamingCongestionControlType GetType () const { return m_Type; };
+			int GetWindowSize () const { return m_Window; };
+			int GetSlowStartThreshold () const { return m_SlowStartThreshold; };
+			int GetRTT () const { return m_RTT.GetRTT (); };
+			int GetRTTVar () const { return m_RTT.GetRTTVar (); };
+			int GetRTO () const { return m_RTT.GetRTO (); };
+			bool IsRTTMeasured () const { return m_RTT.IsMeasured (); };
+			uint64_t GetNumLost () const { return m_NumLost; };
+			uint64_t GetNumTimeouts () const { return m_NumTimeouts; };
+
+		private:
+
+			void IncreaseCubicWindow (uint64_t ts);
+			void ReduceWindow ();
+
+		private:
+
+			StreamingCongestionControlType m_Type;
+			double m_Window, m_SlowStartThreshold; // in messages
+			i2p::util::RTOEstimator m_RTT;
+			uint32_t m_RecoverySeqn; // first sequence number sent after last reduction
+			bool m_IsTimedOut; // no ACKs since last timeout
+			// CUBIC
+			uint64_t m_EpochStart; // 0 if congestion avoidance hasn't started since last reduction
+			double m_LastMaxWindow, m_OriginWindow, m_K, m_RenoWindow;
+			i2p::util::Pacer m_Pacer;
+			uint64_t m_NumLost, m_NumTimeouts;
+	};
+
+	struct StreamingMetrics
+	{
+		int rtt, rttVar, window, slowStartThreshold;
+		uint64_t updateTime; // in milliseconds
+	};
+
+	// what previous streams learned about remote destination, new streams start from it instead of
+	// INITIAL_RTT and MIN_WINDOW_SIZE. Entries expire, oldest is evicted if full
+	template<typename Key>
+	class StreamingMetricsCache
+	{
+		public:
+
+			void Save (const Key& remote, const StreamingCongestionControl& cc, uint64_t ts)
+			{
+				if (!cc.IsRTTMeasured ()) return; // nothing learned
+				std::unique_lock<std::mutex> l(m_MetricsMutex);
+				auto it = m_Metrics.find (remote);
+				if (it == m_Metrics.end ())
+				{
+					if (m_Metrics.size () >= MAX_NUM_STREAMING_METRICS) Evict (ts);
+					it = m_Metrics.emplace (remote, StreamingMetrics ()).first;
+				}
+				it->second = StreamingMetrics{ cc.GetRTT (), cc.GetRTTVar (), cc.GetWindowSize (),
+					cc.GetSlowStartThreshold (), ts };
+			}
+
+			bool Load (const Key& remote, StreamingCongestionControl& cc, uint64_t ts) // returns false if not known
+			{
+				if (cc.IsRTTMeasured ()) return false; // stream has its own already
+				std::unique_lock<std::mutex> l(m_MetricsMutex);
+				auto it = m_Metrics.find (remote);
+				if (it == m_Metrics.end ()) return false;
+				if (IsExpired (it->second, ts))
+				{
+					m_Metrics.erase (it);
+					return false;
+				}
+				cc.SetMetrics (it->second.rtt, it->second.rttVar, it->second.window, it->second.slowStartThreshold);
+				return true;
+			}
+
+			size_t GetNumMetrics () const
+			{
+				std::unique_lock<std::mutex> l(m_MetricsMutex);
+				return m_Metrics.size ();
+			}
+
+		private:
+
+			static bool IsExpired (const StreamingMetrics& metrics, uint64_t ts)
+			{
+				return ts > metrics.updateTime + STREAMING_METRICS_EXPIRATION_TIMEOUT*1000LL;
+			}
+
+			void Evict (uint64_t ts)
+			{
+				auto oldest = m_Metrics.end ();
+				for (auto it = m_Metrics.begin (); it != m_Metrics.end ();)
+				{
+					if (IsExpired (it->second, ts))
+						it = m_Metrics.erase (it);
+					else
+					{
+						if (oldest == m_Metrics.end () || it->second.updateTime < oldest->second.updateTime)
+							oldest = it;
+						++it;
+					}
+				}
+				if (m_Metrics.size () >= MAX_NUM_STREAMING_METRICS && oldest != m_Metrics.end ())
+					m_Metrics.erase (oldest);
+			}
+
+		private:
+
+			mutable std::mutex m_MetricsMutex;
+			std::map<Key, StreamingMetrics> m_Metrics;
+	};
+}
+}
+
+#endif
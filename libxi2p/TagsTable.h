@@ -0,0 +1,277 @@
+#ifndef TAGS_TABLE_H__
+#define TAGS_TABLE_H__
+
+#include <inttypes.h>
+#include <string.h>
+#include <vector>
+#include <memory>
+#include <algorithm>
+#include <openssl/rand.h>
+#include "Tag.h"
+
+namespace i2p
+{
+namespace garlic
+{
+	const int TAGS_TABLE_MIN_BITS = 6; // 64 slots
+	const uint32_t TAGS_TABLE_WHEEL_PERIOD = 16; // in seconds, timing wheel bucket
+
+	/**
+	 * @brief Incoming session tags, open addressing with linear probing by first 8 bytes of tag
+	 * (full compare on hit) and backward shift deletion. Objects are shared by all tags of a batch
+	 * with counter of tags. Tags expire by timing wheel of creation time buckets, no full walks. Not thread safe
+	 */
+	template<typename T>
+	class TagsTable
+	{
+		struct Entry
+		{
+			uint64_t prefix; // first 8 bytes of tag
+			uint32_t key; // index in m_Keys, 0 means empty
+			uint32_t creationTime; // seconds since epoch
+		};
+
+		struct Key
+		{
+			std::shared_ptr<T> object;
+			uint32_t numTags;
+		};
+
+		public:
+
+			TagsTable (uint32_t expirationTimeout):
+				m_ExpirationTimeout (expirationTimeout), m_Size (0), m_LastKey (0), m_NextPeriod (0),
+				m_Wheel (expirationTimeout/TAGS_TABLE_WHEEL_PERIOD + 2)
+			{
+				RAND_bytes ((uint8_t *)&m_Seed, sizeof (m_Seed)); // against flooding of chosen tags
+				m_Keys.resize (1); // 0 is reserved
+				Resize (TAGS_TABLE_MIN_BITS);
+			}
+
+			/** @brief Adds num tags of 32 bytes each, all of them share object */
+			void Insert (const uint8_t * tags, int num, std::shared_ptr<T> object, uint32_t ts)
+			{
+				if (num <= 0 || !object) return;
+				uint32_t key = m_LastKey;
+				if (!key || m_Keys[key].object != object) key = AddKey (object);
+				m_LastKey = key;
+				if (!m_NextPeriod) m_NextPeriod = ts/TAGS_TABLE_WHEEL_PERIOD;
+				for (int i = 0; i < num; i++)
+				{
+					if ((m_Size + 1)*4 > m_Entries.size ()*3) Resize (m_Bits + 1);
+					const uint8_t * tag = tags + i*32;
+					auto prefix = GetPrefix (tag);
+					size_t ind = Find (tag, prefix);
+					m_Keys[key].numTags++;
+					if (m_Entries[ind].key)
+					{
+						// same tag again, replace
+						ReleaseKey (m_Entries[ind].key);
+						m_Entries[ind].key = key;
+						m_Entries[ind].creationTime = ts;
+					}
+					else
+					{
+						m_Entries[ind] = Entry{ prefix, key, ts };
+						memcpy (m_Tags[ind], tag, 32);
+						m_Size++;
+					}
+					Schedule (prefix, ts);
+				}
+			}
+
+			/** @brief Removes tag and returns its object, tag might be used only once */
+			std::shared_ptr<T> Take (const uint8_t * tag)
+			{
+				size_t ind = Find (tag, GetPrefix (tag));
+				if (!m_Entries[ind].key) return nullptr;
+				auto object = m_Keys[m_Entries[ind].key].object;
+				Erase (ind);
+				return object;
+			}
+
+			/** @brief Removes tags older than expiration timeout from buckets passed since last call, returns number of them */
+			int Expire (uint32_t ts)
+			{
+				if (!m_NextPeriod || ts < m_ExpirationTimeout) return 0;
+				// all tags of buckets before lastPeriod are expired
+				uint64_t lastPeriod = (ts - m_ExpirationTimeout)/TAGS_TABLE_WHEEL_PERIOD;
+				if (lastPeriod > m_NextPeriod + m_Wheel.size ()) m_NextPeriod = lastPeriod - m_Wheel.size (); // each bucket once
+				int numExpired = 0;
+				std::vector<uint64_t> prefixes;
+				while (m_NextPeriod < lastPeriod)
+				{
+					uint64_t period = m_NextPeriod++;
+					prefixes.swap (m_Wheel[period % m_Wheel.size ()]);
+					std::sort (prefixes.begin (), prefixes.end ());
+					prefixes.erase (std::unique (prefixes.begin (), prefixes.end ()), prefixes.end ());
+					for (auto prefix: prefixes)
+						numExpired += Expire (prefix, period, ts);
+					prefixes.clear ();
+				}
+				if (m_Bits > TAGS_TABLE_MIN_BITS && m_Size*8 < m_Entries.size ())
+					Resize (m_Bits - 1);
+				return numExpired;
+			}
+
+			/** @brief Calls visitor (const uint8_t * tag, uint32_t creationTime, const std::shared_ptr<T>& object) for each tag */
+			template<typename Visitor>
+			void Visit (Visitor visitor) const
+			{
+				for (size_t i = 0; i < m_Entries.size (); i++)
+					if (m_Entries[i].key)
+						visitor ((const uint8_t *)m_Tags[i], m_Entries[i].creationTime, m_Keys[m_Entries[i].key].object);
+			}
+
+			size_t GetSize () const { return m_Size; };
+			bool IsEmpty () const { return !m_Size; };
+			size_t GetNumObjects () const { return m_Keys.size () - 1 - m_FreeKeys.size (); };
+
+			void Clear ()
+			{
+				m_Keys.resize (1);
+				m_FreeKeys.clear ();
+				m_LastKey = 0;
+				for (auto& it: m_Wheel) std::vector<uint64_t> ().swap (it);
+				m_NextPeriod = 0;
+				m_Size = 0;
+				Resize (TAGS_TABLE_MIN_BITS);
+			}
+
+		private:
+
+			static uint64_t GetPrefix (const uint8_t * tag)
+			{
+				uint64_t prefix;
+				memcpy (&prefix, tag, 8);
+				return prefix;
+			}
+
+			size_t GetHome (uint64_t prefix) const
+			{
+				return ((prefix ^ m_Seed)*0x9E3779B97F4A7C15ULL) >> (64 - m_Bits);
+			}
+
+			size_t Find (const uint8_t * tag, uint64_t prefix) const // slot of tag or empty slot to insert
+			{
+				size_t mask = m_Entries.size () - 1;
+				for (size_t i = GetHome (prefix);; i = (i + 1) & mask)
+				{
+					auto& entry = m_Entries[i];
+					if (!entry.key || (entry.prefix == prefix && !memcmp (m_Tags[i], tag, 32)))
+						return i;
+				}
+			}
+
+			void Erase (size_t ind)
+			{
+				ReleaseKey (m_Entries[ind].key);
+				m_Size--;
+				// shift following entries back unless their home is after the hole
+				size_t mask = m_Entries.size () - 1;
+				for (size_t i = (ind + 1) & mask; m_Entries[i].key; i = (i + 1) & mask)
+				{
+					size_t home = GetHome (m_Entries[i].prefix);
+					if (((i - home) & mask) >= ((i - ind) & mask))
+					{
+						m_Entries[ind] = m_Entries[i];
+						m_Tags[ind] = m_Tags[i];
+						ind = i;
+					}
+				}
+				m_Entries[ind].key = 0;
+			}
+
+			int Expire (uint64_t prefix, uint64_t period, uint32_t ts) // of bucket being passed
+			{
+				int numExpired = 0;
+				size_t mask = m_Entries.size () - 1;
+				size_t i = GetHome (prefix);
+				while (m_Entries[i].key)
+				{
+					auto& entry = m_Entries[i];
+					if (entry.prefix == prefix)
+					{
+						if (ts > entry.creationTime + m_ExpirationTimeout)
+						{
+							Erase (i);
+							numExpired++;
+							continue; // next one is shifted here
+						}
+						// not in later bucket if it's been passed already or the same bucket after wrap around
+						uint64_t p = entry.creationTime/TAGS_TABLE_WHEEL_PERIOD;
+						if (p < m_NextPeriod || (p != period && p % m_Wheel.size () == period % m_Wheel.size ()))
+							Schedule (prefix, entry.creationTime);
+					}
+					i = (i + 1) & mask;
+				}
+				return numExpired;
+			}
+
+			void Schedule (uint64_t prefix, uint32_t creationTime)
+			{
+				uint64_t period = creationTime/TAGS_TABLE_WHEEL_PERIOD;
+				if (period < m_NextPeriod) period = m_NextPeriod; // bucket has been passed already
+				m_Wheel[period % m_Wheel.size ()].push_back (prefix);
+			}
+
+			uint32_t AddKey (std::shared_ptr<T> object)
+			{
+				uint32_t key;
+				if (!m_FreeKeys.empty ())
+				{
+					key = m_FreeKeys.back ();
+					m_FreeKeys.pop_back ();
+				}
+				else
+				{
+					key = m_Keys.size ();
+					m_Keys.push_back (Key{});
+				}
+				m_Keys[key].object = object;
+				m_Keys[key].numTags = 0;
+				return key;
+			}
+
+			void ReleaseKey (uint32_t key)
+			{
+				if (--m_Keys[key].numTags) return;
+				m_Keys[key].object = nullptr; // last tag of batch
+				m_FreeKeys.push_back (key);
+				if (m_LastKey == key) m_LastKey = 0;
+			}
+
+			void Resize (int bits)
+			{
+				std::vector<Entry> entries ((size_t)1 << bits, Entry{ 0, 0, 0 });
+				std::vector<i2p::data::Tag<32> > tags ((size_t)1 << bits);
+				entries.swap (m_Entries);
+				tags.swap (m_Tags);
+				m_Bits = bits;
+				for (size_t i = 0; i < entries.size (); i++)
+					if (entries[i].key)
+					{
+						size_t ind = Find (tags[i], entries[i].prefix);
+						m_Entries[ind] = entries[i];
+						m_Tags[ind] = tags[i];
+					}
+			}
+
+		private:
+
+			uint32_t m_ExpirationTimeout;
+			uint64_t m_Seed;
+			int m_Bits;
+			size_t m_Size;
+			std::vector<Entry> m_Entries;
+			std::vector<i2p::data::Tag<32> > m_Tags; // same slots as m_Entries, touched on hit only
+			std::vector<Key> m_Keys;
+			std::vector<uint32_t> m_FreeKeys;
+			uint32_t m_LastKey; // of last insert, next batch usually has the same object
+			uint64_t m_NextPeriod; // first wheel bucket not passed yet, 0 if nothing inserted
+			std::vector<std::vector<uint64_t> > m_Wheel; // prefixes by creation time period
+	};
+}
+}
+
+#endif
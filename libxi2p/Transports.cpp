@@ -154,10 +154,13 @@ namespace transport
 		m_Thread = new std::thread (std::bind (&Transports::Run, this));
 		std::string ntcpproxy; i2p::config::GetOption("ntcpproxy", ntcpproxy);
 		i2p::http::URL proxyurl;
-		uint16_t softLimit, hardLimit, threads;
+		uint16_t softLimit, hardLimit, threads, ioThreads;
 		i2p::config::GetOption("limits.ntcpsoft", softLimit);
 		i2p::config::GetOption("limits.ntcphard", hardLimit);
 		i2p::config::GetOption("limits.ntcpthreads", threads);
+		i2p::config::GetOption("limits.ntcpiothreads", ioThreads);
+		uint16_t ssuBatch; i2p::config::GetOption("limits.ssubatch", ssuBatch);
+		bool ssuGSO; i2p::config::GetOption("limits.ssugso", ssuGSO);
 		if(softLimit > 0 && hardLimit > 0 && softLimit >= hardLimit)
 		{
 			LogPrint(eLogError, "ntcp soft limit must be less than ntcp hard limit");
@@ -169,7 +172,7 @@ namespace transport
 			{
 				if(proxyurl.schema == "socks" || proxyurl.schema == "http")
 				{
-					m_NTCPServer = new NTCPServer(threads);
+					m_NTCPServer = new NTCPServer(threads, ioThreads);
 					m_NTCPServer->SetSessionLimits(softLimit, hardLimit);
 					NTCPServer::ProxyType proxytype = NTCPServer::eSocksProxy;
 
@@ -196,7 +199,7 @@ namespace transport
 		bool ntcp2;  i2p::config::GetOption("ntcp2.enabled", ntcp2);
 		if (ntcp2)
 		{
-			m_NTCP2Server = new NTCP2Server ();
+			m_NTCP2Server = new NTCP2Server (ioThreads);
 			m_NTCP2Server->Start ();
 		}	
 
@@ -207,7 +210,7 @@ namespace transport
 			if (!address) continue;
 			if (m_NTCPServer == nullptr && enableNTCP)
 			{
-				m_NTCPServer = new NTCPServer (threads);
+				m_NTCPServer = new NTCPServer (threads, ioThreads);
 				m_NTCPServer->SetSessionLimits(softLimit, hardLimit);
 				m_NTCPServer->Start ();
 				if (!(m_NTCPServer->IsBoundV6() || m_NTCPServer->IsBoundV4())) {
@@ -227,6 +230,7 @@ namespace transport
 						m_SSUServer = new SSUServer (address->port);
 					else
 						m_SSUServer = new SSUServer (address->host, address->port);
+					m_SSUServer->SetBatchSize (ssuBatch, ssuGSO);
 					LogPrint (eLogInfo, "Transports: Start listening UDP port ", address->port);
 					try {
 						m_SSUServer->Start ();
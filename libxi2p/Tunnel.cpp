@@ -331,25 +331,170 @@ namespace tunnel
 		s << GetTunnelID () << ":me &#8658; ";
 	}
 
-	Tunnels tunnels;
+	void TunnelsShard::Start ()
+	{
+		m_IsRunning = true;
+		m_Thread = new std::thread (std::bind (&TunnelsShard::Run, this));
+	}
 
-	Tunnels::Tunnels (): m_IsRunning (false), m_Thread (nullptr),
-		m_NumSuccesiveTunnelCreations (0), m_NumFailedTunnelCreations (0)
+	void TunnelsShard::Stop ()
 	{
+		m_IsRunning = false;
+		m_Queue.WakeUp ();
+		if (m_Thread)
+		{
+			m_Thread->join ();
+			delete m_Thread;
+			m_Thread = 0;
+		}
 	}
 
-	Tunnels::~Tunnels ()
+	void TunnelsShard::Run ()
 	{
+		uint64_t lastTs = 0;
+		while (m_IsRunning)
+		{
+			try
+			{
+				auto msg = m_Queue.GetNextWithTimeout (1000); // 1 sec
+				if (msg)
+					tunnels.HandleTunnelMsgs (msg, m_Queue);
+
+				uint64_t ts = i2p::util::GetSecondsSinceEpoch ();
+				if (ts - lastTs >= 15) // cleanup tunnels every 15 seconds
+				{
+					CleanupTunnels ();
+					lastTs = ts;
+				}
+			}
+			catch (std::exception& ex)
+			{
+				LogPrint (eLogError, "Tunnel: worker runtime exception: ", ex.what ());
+			}
+		}
 	}
 
-	std::shared_ptr<TunnelBase> Tunnels::GetTunnel (uint32_t tunnelID)
+	std::shared_ptr<TunnelBase> TunnelsShard::GetTunnel (uint32_t tunnelID)
 	{
+		std::unique_lock<std::mutex> l(m_TunnelsMutex);
 		auto it = m_Tunnels.find(tunnelID);
 		if (it != m_Tunnels.end ())
 			return it->second;
 		return nullptr;
 	}
 
+	bool TunnelsShard::AddTunnel (std::shared_ptr<TunnelBase> tunnel)
+	{
+		std::unique_lock<std::mutex> l(m_TunnelsMutex);
+		return m_Tunnels.emplace (tunnel->GetTunnelID (), tunnel).second;
+	}
+
+	void TunnelsShard::ReplaceTunnel (std::shared_ptr<TunnelBase> tunnel)
+	{
+		std::unique_lock<std::mutex> l(m_TunnelsMutex);
+		m_Tunnels[tunnel->GetTunnelID ()] = tunnel;
+	}
+
+	void TunnelsShard::RemoveTunnel (uint32_t tunnelID)
+	{
+		std::unique_lock<std::mutex> l(m_TunnelsMutex);
+		m_Tunnels.erase (tunnelID);
+	}
+
+	void TunnelsShard::CleanupTunnels ()
+	{
+		std::vector<std::shared_ptr<TunnelBase> > shardTunnels;
+		{
+			std::unique_lock<std::mutex> l(m_TunnelsMutex);
+			shardTunnels.reserve (m_Tunnels.size ());
+			for (const auto& it: m_Tunnels)
+				shardTunnels.push_back (it.second);
+		}
+		// must be called from the thread handling these tunnels
+		for (auto& it: shardTunnels)
+			it->Cleanup ();
+	}
+
+	void TunnelBuildWorkers::Start (int numThreads)
+	{
+		m_IsRunning = true;
+		for (int i = 0; i < numThreads; i++)
+			m_Threads.push_back (new std::thread (std::bind (&TunnelBuildWorkers::Run, this)));
+	}
+
+	void TunnelBuildWorkers::Stop ()
+	{
+		m_IsRunning = false;
+		m_Queue.WakeUp ();
+		for (auto it: m_Threads)
+		{
+			it->join ();
+			delete it;
+		}
+		m_Threads.clear ();
+	}
+
+	bool TunnelBuildWorkers::PostBuildRequest (std::shared_ptr<I2NPMessage> msg, int index)
+	{
+		if (m_Queue.GetSize () >= MAX_NUM_PENDING_BUILD_REQUESTS)
+		{
+			// decryption would take longer than requester waits for reply
+			m_NumDropped++;
+			return false;
+		}
+		auto request = std::make_shared<TunnelBuildRequest> ();
+		request->msg = msg;
+		request->index = index;
+		m_Queue.Put (request);
+		return true;
+	}
+
+	void TunnelBuildWorkers::GetDecryptedBuildRequests (std::vector<std::shared_ptr<TunnelBuildRequest> >& requests)
+	{
+		std::unique_lock<std::mutex> l(m_DecryptedMutex);
+		requests.swap (m_Decrypted);
+	}
+
+	bool TunnelBuildWorkers::HasDecryptedBuildRequests ()
+	{
+		std::unique_lock<std::mutex> l(m_DecryptedMutex);
+		return !m_Decrypted.empty ();
+	}
+
+	void TunnelBuildWorkers::Run ()
+	{
+		while (m_IsRunning)
+		{
+			auto request = m_Queue.GetNextWithTimeout (1000); // 1 sec
+			if (request)
+			{
+				DecryptBuildRequestRecord (request->msg, request->index, request->clearText);
+				{
+					std::unique_lock<std::mutex> l(m_DecryptedMutex);
+					m_Decrypted.push_back (request);
+				}
+				tunnels.m_Queue.WakeUp (); // reply is sent from tunnels thread, it checks m_Decrypted before going to sleep
+			}
+		}
+	}
+
+	Tunnels tunnels;
+
+	Tunnels::Tunnels (): m_IsRunning (false), m_Thread (nullptr), m_NumWorkers (0),
+		m_NumSuccesiveTunnelCreations (0), m_NumFailedTunnelCreations (0)
+	{
+		m_Shards.emplace_back (new TunnelsShard ());
+	}
+
+	Tunnels::~Tunnels ()
+	{
+	}
+
+	std::shared_ptr<TunnelBase> Tunnels::GetTunnel (uint32_t tunnelID)
+	{
+		return GetShard (tunnelID).GetTunnel (tunnelID);
+	}
+
 	std::shared_ptr<InboundTunnel> Tunnels::GetPendingInboundTunnel (uint32_t replyMsgID)
 	{
 		return GetPendingTunnel (replyMsgID, m_PendingInboundTunnels);
@@ -437,7 +582,7 @@ namespace tunnel
 
 	void Tunnels::AddTransitTunnel (std::shared_ptr<TransitTunnel> tunnel)
 	{
-		if (m_Tunnels.emplace (tunnel->GetTunnelID (), tunnel).second)
+		if (GetShard (tunnel->GetTunnelID ()).AddTunnel (tunnel))
 			m_TransitTunnels.push_back (tunnel);
 		else
 			LogPrint (eLogError, "Tunnel: tunnel with id ", tunnel->GetTunnelID (), " already exists");
@@ -445,10 +590,31 @@ namespace tunnel
 
 	void Tunnels::Start ()
 	{
+		uint16_t numWorkers; i2p::config::GetOption("limits.tunnelthreads", numWorkers);
+		StartWorkers (numWorkers);
+		uint16_t numBuildThreads; i2p::config::GetOption("limits.buildthreads", numBuildThreads);
+		if (numBuildThreads > 0)
+			m_BuildWorkers.Start (numBuildThreads);
 		m_IsRunning = true;
 		m_Thread = new std::thread (std::bind (&Tunnels::Run, this));
 	}
 
+	void Tunnels::StartWorkers (int numWorkers)
+	{
+		if (numWorkers > 0)
+		{
+			// tunnels are distributed between shards by tunnelID
+			m_Shards.clear ();
+			for (int i = 0; i < numWorkers; i++)
+			{
+				m_Shards.emplace_back (new TunnelsShard ());
+				m_Shards.back ()->Start ();
+			}
+			LogPrint (eLogInfo, "Tunnel: ", numWorkers, " worker threads started");
+		}
+		m_NumWorkers = numWorkers;
+	}
+
 	void Tunnels::Stop ()
 	{
 		m_IsRunning = false;
@@ -459,6 +625,9 @@ namespace tunnel
 			delete m_Thread;
 			m_Thread = 0;
 		}
+		m_BuildWorkers.Stop ();
+		for (auto& it: m_Shards)
+			it->Stop ();
 	}
 
 	void Tunnels::Run ()
@@ -470,61 +639,11 @@ namespace tunnel
 		{
 			try
 			{
-				auto msg = m_Queue.GetNextWithTimeout (1000); // 1 sec
+				auto msg = m_Queue.GetNextWithTimeout (1000, // 1 sec
+					[this](void) { return m_BuildWorkers.HasDecryptedBuildRequests (); });
 				if (msg)
-				{
-					uint32_t prevTunnelID = 0, tunnelID = 0;
-					std::shared_ptr<TunnelBase> prevTunnel;
-					do
-					{
-						std::shared_ptr<TunnelBase> tunnel;
-						uint8_t typeID = msg->GetTypeID ();
-						switch (typeID)
-						{
-							case eI2NPTunnelData:
-							case eI2NPTunnelGateway:
-							{
-								tunnelID = bufbe32toh (msg->GetPayload ());
-								if (tunnelID == prevTunnelID)
-									tunnel = prevTunnel;
-								else if (prevTunnel)
-									prevTunnel->FlushTunnelDataMsgs ();
-
-								if (!tunnel)
-									tunnel = GetTunnel (tunnelID);
-								if (tunnel)
-								{
-									if (typeID == eI2NPTunnelData)
-										tunnel->HandleTunnelDataMsg (msg);
-									else // tunnel gateway assumed
-										HandleTunnelGatewayMsg (tunnel, msg);
-								}
-								else
-									LogPrint (eLogWarning, "Tunnel: tunnel not found, tunnelID=", tunnelID, " previousTunnelID=", prevTunnelID, " type=", (int)typeID);
-
-								break;
-							}
-							case eI2NPVariableTunnelBuild:
-							case eI2NPVariableTunnelBuildReply:
-							case eI2NPTunnelBuild:
-							case eI2NPTunnelBuildReply:
-								HandleI2NPMessage (msg->GetBuffer (), msg->GetLength ());
-							break;
-							default:
-								LogPrint (eLogWarning, "Tunnel: unexpected message type ", (int) typeID);
-						}
-
-						msg = m_Queue.Get ();
-						if (msg)
-						{
-							prevTunnelID = tunnelID;
-							prevTunnel = tunnel;
-						}
-						else if (tunnel)
-							tunnel->FlushTunnelDataMsgs ();
-					}
-					while (msg);
-				}
+					HandleTunnelMsgs (msg, m_Queue);
+				HandleDecryptedBuildRequests ();
 
 				uint64_t ts = i2p::util::GetSecondsSinceEpoch ();
 				if (ts - lastTs >= 15) // manage tunnels every 15 seconds
@@ -540,6 +659,66 @@ namespace tunnel
 		}
 	}
 
+	void Tunnels::HandleTunnelMsgs (std::shared_ptr<I2NPMessage> msg, i2p::util::Queue<std::shared_ptr<I2NPMessage> >& queue)
+	{
+		uint32_t prevTunnelID = 0, tunnelID = 0;
+		std::shared_ptr<TunnelBase> prevTunnel;
+		int numMsgs = 0;
+		do
+		{
+			std::shared_ptr<TunnelBase> tunnel;
+			uint8_t typeID = msg->GetTypeID ();
+			switch (typeID)
+			{
+				case eI2NPTunnelData:
+				case eI2NPTunnelGateway:
+				{
+					tunnelID = bufbe32toh (msg->GetPayload ());
+					if (tunnelID == prevTunnelID)
+						tunnel = prevTunnel;
+					else if (prevTunnel)
+						prevTunnel->FlushTunnelDataMsgs ();
+
+					if (!tunnel)
+						tunnel = GetTunnel (tunnelID);
+					if (tunnel)
+					{
+						if (typeID == eI2NPTunnelData)
+							tunnel->HandleTunnelDataMsg (msg);
+						else // tunnel gateway assumed
+							HandleTunnelGatewayMsg (tunnel, msg);
+					}
+					else
+						LogPrint (eLogWarning, "Tunnel: tunnel not found, tunnelID=", tunnelID, " previousTunnelID=", prevTunnelID, " type=", (int)typeID);
+
+					break;
+				}
+				case eI2NPVariableTunnelBuild:
+				case eI2NPTunnelBuild:
+					if (!PostBuildRequest (msg))
+						HandleI2NPMessage (msg->GetBuffer (), msg->GetLength ());
+				break;
+				case eI2NPVariableTunnelBuildReply:
+				case eI2NPTunnelBuildReply:
+					HandleI2NPMessage (msg->GetBuffer (), msg->GetLength ());
+				break;
+				default:
+					LogPrint (eLogWarning, "Tunnel: unexpected message type ", (int) typeID);
+			}
+
+			// rest stays in queue, caller comes back for it
+			msg = (++numMsgs < MAX_NUM_TUNNEL_MSGS_PER_DRAIN) ? queue.Get () : nullptr;
+			if (msg)
+			{
+				prevTunnelID = tunnelID;
+				prevTunnel = tunnel;
+			}
+			else if (tunnel)
+				tunnel->FlushTunnelDataMsgs ();
+		}
+		while (msg);
+	}
+
 	void Tunnels::HandleTunnelGatewayMsg (std::shared_ptr<TunnelBase> tunnel, std::shared_ptr<I2NPMessage> msg)
 	{
 		if (!tunnel)
@@ -567,6 +746,25 @@ namespace tunnel
 		tunnel->SendTunnelDataMsg (msg);
 	}
 
+	bool Tunnels::PostBuildRequest (std::shared_ptr<I2NPMessage> msg)
+	{
+		if (!m_BuildWorkers.IsRunning ()) return false;
+		if (msg->GetTypeID () == eI2NPVariableTunnelBuild && m_PendingInboundTunnels.count (msg->GetMsgID ()))
+			return false; // reply for our inbound tunnel
+		int index = FindBuildRequestRecord (msg);
+		if (index >= 0 && !m_BuildWorkers.PostBuildRequest (msg, index))
+			LogPrint (eLogWarning, "Tunnel: ", MAX_NUM_PENDING_BUILD_REQUESTS, " build requests are pending, request dropped");
+		return true;
+	}
+
+	void Tunnels::HandleDecryptedBuildRequests ()
+	{
+		std::vector<std::shared_ptr<TunnelBuildRequest> > requests;
+		m_BuildWorkers.GetDecryptedBuildRequests (requests);
+		for (auto& it: requests)
+			HandleDecryptedBuildRequest (it->msg, it->index, it->clearText);
+	}
+
 	void Tunnels::ManageTunnels ()
 	{
 		ManagePendingTunnels ();
@@ -715,7 +913,7 @@ namespace tunnel
 					auto pool = tunnel->GetTunnelPool ();
 					if (pool)
 						pool->TunnelExpired (tunnel);
-					m_Tunnels.erase (tunnel->GetTunnelID ());
+					GetShard (tunnel->GetTunnelID ()).RemoveTunnel (tunnel->GetTunnelID ());
 					it = m_InboundTunnels.erase (it);
 				}
 				else
@@ -735,7 +933,7 @@ namespace tunnel
 
 						if (ts + TUNNEL_EXPIRATION_THRESHOLD > tunnel->GetCreationTime () + TUNNEL_EXPIRATION_TIMEOUT)
 							tunnel->SetState (eTunnelStateExpiring);
-						else // we don't need to cleanup expiring tunnels
+						else if (!m_NumWorkers) // we don't need to cleanup expiring tunnels, workers cleanup their own
 							tunnel->Cleanup ();
 					}
 					it++;
@@ -786,12 +984,12 @@ namespace tunnel
 			if (ts > tunnel->GetCreationTime () + TUNNEL_EXPIRATION_TIMEOUT)
 			{
 				LogPrint (eLogDebug, "Tunnel: Transit tunnel with id ", tunnel->GetTunnelID (), " expired");
-				m_Tunnels.erase (tunnel->GetTunnelID ());
+				GetShard (tunnel->GetTunnelID ()).RemoveTunnel (tunnel->GetTunnelID ());
 				it = m_TransitTunnels.erase (it);
 			}
 			else
 			{
-				tunnel->Cleanup ();
+				if (!m_NumWorkers) tunnel->Cleanup (); // workers cleanup their own tunnels
 				it++;
 			}
 		}
@@ -812,12 +1010,29 @@ namespace tunnel
 
 	void Tunnels::PostTunnelData (std::shared_ptr<I2NPMessage> msg)
 	{
-		if (msg) m_Queue.Put (msg);
+		if (!msg) return;
+		if (m_NumWorkers > 0)
+		{
+			auto typeID = msg->GetTypeID ();
+			if (typeID == eI2NPTunnelData || typeID == eI2NPTunnelGateway)
+			{
+				// same tunnel always goes to the same worker to keep order
+				GetShard (bufbe32toh (msg->GetPayload ())).PostTunnelData (msg);
+				return;
+			}
+		}
+		m_Queue.Put (msg);
 	}
 
 	void Tunnels::PostTunnelData (const std::vector<std::shared_ptr<I2NPMessage> >& msgs)
 	{
-		m_Queue.Put (msgs);
+		if (m_NumWorkers > 0)
+		{
+			for (const auto& it: msgs)
+				PostTunnelData (it);
+		}
+		else
+			m_Queue.Put (msgs);
 	}
 
 	template<class TTunnel>
@@ -870,7 +1085,7 @@ namespace tunnel
 
 	void Tunnels::AddInboundTunnel (std::shared_ptr<InboundTunnel> newTunnel)
 	{
-		if (m_Tunnels.emplace (newTunnel->GetTunnelID (), newTunnel).second)
+		if (GetShard (newTunnel->GetTunnelID ()).AddTunnel (newTunnel))
 		{
 			m_InboundTunnels.push_back (newTunnel);
 			auto pool = newTunnel->GetTunnelPool ();
@@ -899,7 +1114,7 @@ namespace tunnel
 		auto inboundTunnel = std::make_shared<ZeroHopsInboundTunnel> ();
 		inboundTunnel->SetState (eTunnelStateEstablished);
 		m_InboundTunnels.push_back (inboundTunnel);
-		m_Tunnels[inboundTunnel->GetTunnelID ()] = inboundTunnel;
+		GetShard (inboundTunnel->GetTunnelID ()).ReplaceTunnel (inboundTunnel);
 		return inboundTunnel;
 	}
 
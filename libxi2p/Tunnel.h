@@ -8,6 +8,7 @@
 #include <vector>
 #include <string>
 #include <thread>
+#include <atomic>
 #include <mutex>
 #include <memory>
 #include "Queue.h"
@@ -212,14 +213,91 @@ namespace tunnel
 			size_t m_NumSentBytes;
 	};
 
+	// tunnels TunnelData and TunnelGateway messages of which are handled by the same thread
+	class TunnelsShard
+	{
+		public:
+
+			TunnelsShard (): m_IsRunning (false), m_Thread (nullptr) {};
+			~TunnelsShard () { Stop (); };
+			void Start ();
+			void Stop ();
+
+			std::shared_ptr<TunnelBase> GetTunnel (uint32_t tunnelID);
+			bool AddTunnel (std::shared_ptr<TunnelBase> tunnel); // false if already exists
+			void ReplaceTunnel (std::shared_ptr<TunnelBase> tunnel);
+			void RemoveTunnel (uint32_t tunnelID);
+			void CleanupTunnels ();
+
+			void PostTunnelData (std::shared_ptr<I2NPMessage> msg) { m_Queue.Put (msg); };
+			int GetQueueSize () { return m_Queue.GetSize (); };
+
+		private:
+
+			void Run ();
+
+		private:
+
+			bool m_IsRunning;
+			std::thread * m_Thread;
+			std::mutex m_TunnelsMutex;
+			std::unordered_map<uint32_t, std::shared_ptr<TunnelBase> > m_Tunnels; // tunnelID->tunnel known by this id
+			i2p::util::Queue<std::shared_ptr<I2NPMessage> > m_Queue;
+	};
+
+	const int MAX_NUM_PENDING_BUILD_REQUESTS = 128; // waiting for decryption, new requests are dropped above it
+	const int MAX_NUM_TUNNEL_MSGS_PER_DRAIN = MAX_NUM_PENDING_BUILD_REQUESTS; // then decrypted build requests and timers get their turn
+
+	struct TunnelBuildRequest
+	{
+		std::shared_ptr<I2NPMessage> msg;
+		int index; // of our record
+		uint8_t clearText[BUILD_REQUEST_RECORD_CLEAR_TEXT_SIZE];
+	};
+
+	// decrypt our build request records off the tunnels thread
+	class TunnelBuildWorkers
+	{
+		public:
+
+			TunnelBuildWorkers (): m_IsRunning (false), m_NumDropped (0) {};
+			~TunnelBuildWorkers () { Stop (); };
+			void Start (int numThreads);
+			void Stop ();
+			bool IsRunning () const { return m_IsRunning; };
+
+			bool PostBuildRequest (std::shared_ptr<I2NPMessage> msg, int index); // false if too many pending
+			void GetDecryptedBuildRequests (std::vector<std::shared_ptr<TunnelBuildRequest> >& requests);
+			bool HasDecryptedBuildRequests ();
+			int GetQueueSize () { return m_Queue.GetSize (); };
+			int GetNumDropped () const { return m_NumDropped; };
+
+		private:
+
+			void Run ();
+
+		private:
+
+			bool m_IsRunning;
+			std::vector<std::thread *> m_Threads;
+			i2p::util::Queue<std::shared_ptr<TunnelBuildRequest> > m_Queue;
+			std::mutex m_DecryptedMutex;
+			std::vector<std::shared_ptr<TunnelBuildRequest> > m_Decrypted; // tunnels thread doesn't wait for messages while not empty
+			std::atomic<int> m_NumDropped;
+	};
+
 	class Tunnels
 	{
+		friend class TunnelsShard;
+		friend class TunnelBuildWorkers;
+
 		public:
 
 			Tunnels ();
 			~Tunnels ();
 			void Start ();
 			void Stop ();
+			void StartWorkers (int numWorkers); // called by Start, TunnelData is handled by tunnels thread if 0
 
 			std::shared_ptr<InboundTunnel> GetPendingInboundTunnel (uint32_t replyMsgID);
 			std::shared_ptr<OutboundTunnel> GetPendingOutboundTunnel (uint32_t replyMsgID);
@@ -250,7 +328,11 @@ namespace tunnel
 			template<class TTunnel>
 			std::shared_ptr<TTunnel> GetPendingTunnel (uint32_t replyMsgID, const std::map<uint32_t, std::shared_ptr<TTunnel> >& pendingTunnels);
 
+			void HandleTunnelMsgs (std::shared_ptr<I2NPMessage> msg, i2p::util::Queue<std::shared_ptr<I2NPMessage> >& queue);
 			void HandleTunnelGatewayMsg (std::shared_ptr<TunnelBase> tunnel, std::shared_ptr<I2NPMessage> msg);
+			bool PostBuildRequest (std::shared_ptr<I2NPMessage> msg); // false if must be handled by tunnels thread
+			void HandleDecryptedBuildRequests ();
+			TunnelsShard& GetShard (uint32_t tunnelID) { return *m_Shards[tunnelID % m_Shards.size ()]; };
 
 			void Run ();
 			void ManageTunnels ();
@@ -274,7 +356,9 @@ namespace tunnel
 			std::list<std::shared_ptr<InboundTunnel> > m_InboundTunnels;
 			std::list<std::shared_ptr<OutboundTunnel> > m_OutboundTunnels;
 			std::list<std::shared_ptr<TransitTunnel> > m_TransitTunnels;
-			std::unordered_map<uint32_t, std::shared_ptr<TunnelBase> > m_Tunnels; // tunnelID->tunnel known by this id
+			std::vector<std::unique_ptr<TunnelsShard> > m_Shards; // by tunnelID, one per worker
+			std::atomic<int> m_NumWorkers; // 0 means TunnelData is handled by tunnels thread
+			TunnelBuildWorkers m_BuildWorkers;
 			std::mutex m_PoolsMutex;
 			std::list<std::shared_ptr<TunnelPool>> m_Pools;
 			std::shared_ptr<TunnelPool> m_ExploratoryPool;
@@ -294,7 +378,15 @@ namespace tunnel
 			size_t CountInboundTunnels() const;
 			size_t CountOutboundTunnels() const;
 
-			int GetQueueSize () { return m_Queue.GetSize (); };
+			int GetQueueSize ()
+			{
+				int size = m_Queue.GetSize ();
+				if (m_NumWorkers > 0)
+					for (auto& it: m_Shards) size += it->GetQueueSize ();
+				return size;
+			};
+			int GetBuildRequestsQueueSize () { return m_BuildWorkers.GetQueueSize (); };
+			int GetNumDroppedBuildRequests () const { return m_BuildWorkers.GetNumDropped (); };
 			int GetTunnelCreationSuccessRate () const // in percents
 			{
 				int totalNum = m_NumSuccesiveTunnelCreations + m_NumFailedTunnelCreations;
@@ -0,0 +1,99 @@
+#ifndef XOR_INDEX_H__
+#define XOR_INDEX_H__
+
+#include <inttypes.h>
+#include <vector>
+#include <memory>
+#include <utility>
+#include <algorithm>
+#include "Tag.h"
+
+namespace i2p
+{
+namespace data
+{
+	/**
+	 * @brief Objects sorted by 32 bytes hash, visited from closest to given key by XOR metric.
+	 * Sorted array is binary trie, objects with common prefix are contiguous and the half sharing
+	 * next bit with key is closer than the other one. O(log n) per visited object. Not thread safe
+	 */
+	template<typename T>
+	class XORIndex
+	{
+		typedef std::pair<Tag<32>, std::shared_ptr<T> > Item;
+
+		public:
+
+			bool Insert (const Tag<32>& hash, std::shared_ptr<T> item) // replaces existing one, returns false then
+			{
+				auto it = std::lower_bound (m_Items.begin (), m_Items.end (), hash,
+					[](const Item& item, const Tag<32>& h) { return item.first < h; });
+				if (it != m_Items.end () && it->first == hash)
+				{
+					it->second = item; // might be newer object of same router
+					return false;
+				}
+				m_Items.insert (it, Item (hash, item));
+				return true;
+			}
+
+			bool Erase (const Tag<32>& hash)
+			{
+				auto it = std::lower_bound (m_Items.begin (), m_Items.end (), hash,
+					[](const Item& item, const Tag<32>& h) { return item.first < h; });
+				if (it == m_Items.end () || it->first != hash) return false;
+				m_Items.erase (it);
+				return true;
+			}
+
+			template<typename Predicate>
+			size_t EraseIf (Predicate pred) // keeps order
+			{
+				auto it = std::remove_if (m_Items.begin (), m_Items.end (),
+					[&pred](const Item& item) { return pred (item.second); });
+				size_t num = m_Items.end () - it;
+				m_Items.erase (it, m_Items.end ());
+				return num;
+			}
+
+			size_t GetSize () const { return m_Items.size (); };
+			void Clear () { m_Items.clear (); };
+
+			/** @brief Calls visitor (std::shared_ptr<T>) in order of distance from key until it returns false */
+			template<typename Visitor>
+			void VisitClosest (const Tag<32>& key, Visitor visitor) const
+			{
+				VisitClosest (0, m_Items.size (), 0, key, visitor);
+			}
+
+		private:
+
+			template<typename Visitor>
+			bool VisitClosest (size_t lo, size_t hi, int bit, const Tag<32>& key, Visitor& visitor) const
+			{
+				if (lo >= hi) return true;
+				if (hi - lo == 1 || bit >= 256)
+				{
+					for (size_t i = lo; i < hi; i++)
+						if (!visitor (m_Items[i].second)) return false;
+					return true;
+				}
+				// items in range have the same first bits, those with next bit clear go first
+				int byte = bit >> 3;
+				uint8_t mask = 0x80 >> (bit & 7);
+				size_t mid = std::partition_point (m_Items.begin () + lo, m_Items.begin () + hi,
+					[byte, mask](const Item& item) { return !(item.first[byte] & mask); }) - m_Items.begin ();
+				if (key[byte] & mask)
+					return VisitClosest (mid, hi, bit + 1, key, visitor) && VisitClosest (lo, mid, bit + 1, key, visitor);
+				else
+					return VisitClosest (lo, mid, bit + 1, key, visitor) && VisitClosest (mid, hi, bit + 1, key, visitor);
+			}
+
+		private:
+
+			std::vector<Item> m_Items; // sorted by hash
+	};
+}
+}
+
+#endif
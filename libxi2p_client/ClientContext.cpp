@@ -35,6 +35,10 @@ namespace client
 
 	void ClientContext::Start ()
 	{
+		// destinations threads
+		uint16_t destinationThreads; i2p::config::GetOption("limits.destinationthreads", destinationThreads);
+		destinationServices.Start (destinationThreads);
+
 		// shared local destination
 		if (!m_SharedLocalDestination)
 			CreateNewSharedLocalDestination ();
@@ -182,6 +186,7 @@ namespace client
 			it.second->Stop ();
 		m_Destinations.clear ();
 		m_SharedLocalDestination = nullptr;
+		destinationServices.Stop ();
 	}
 
 	void ClientContext::ReloadConfig ()
@@ -378,6 +383,12 @@ namespace client
         return section.second.get (boost::property_tree::ptree::path_type (name, '/'), std::to_string (value));
 	}
 
+	template<typename Section>
+	std::string ClientContext::GetI2CPStringOption (const Section& section, const std::string& name, const std::string& value) const
+	{
+		return section.second.get (boost::property_tree::ptree::path_type (name, '/'), value);
+	}
+
 	template<typename Section>
 	void ClientContext::ReadI2CPOptions (const Section& section, std::map<std::string, std::string>& options) const
 	{
@@ -389,6 +400,8 @@ namespace client
 		options[I2CP_PARAM_MIN_TUNNEL_LATENCY] = GetI2CPOption(section, I2CP_PARAM_MIN_TUNNEL_LATENCY, DEFAULT_MIN_TUNNEL_LATENCY);
 		options[I2CP_PARAM_MAX_TUNNEL_LATENCY] = GetI2CPOption(section, I2CP_PARAM_MAX_TUNNEL_LATENCY, DEFAULT_MAX_TUNNEL_LATENCY);
 		options[I2CP_PARAM_STREAMING_INITIAL_ACK_DELAY] = GetI2CPOption(section, I2CP_PARAM_STREAMING_INITIAL_ACK_DELAY, DEFAULT_INITIAL_ACK_DELAY);
+		options[I2CP_PARAM_STREAMING_CONGESTION_CONTROL] = GetI2CPStringOption(section, I2CP_PARAM_STREAMING_CONGESTION_CONTROL, DEFAULT_STREAMING_CONGESTION_CONTROL);
+		options[I2CP_PARAM_LOCAL_DELIVERY] = GetI2CPStringOption(section, I2CP_PARAM_LOCAL_DELIVERY, DEFAULT_LOCAL_DELIVERY);
 	}
 
 	void ClientContext::ReadI2CPOptionsFromConfig (const std::string& prefix, std::map<std::string, std::string>& options) const
@@ -406,6 +419,8 @@ namespace client
 			options[I2CP_PARAM_MIN_TUNNEL_LATENCY] = value;
 		if (i2p::config::GetOption(prefix + I2CP_PARAM_MAX_TUNNEL_LATENCY, value))
 			options[I2CP_PARAM_MAX_TUNNEL_LATENCY] = value;
+		if (i2p::config::GetOption(prefix + I2CP_PARAM_LOCAL_DELIVERY, value))
+			options[I2CP_PARAM_LOCAL_DELIVERY] = value;
 	}
 
 	void ClientContext::ReadTunnels ()
@@ -641,6 +656,39 @@ namespace client
 						while (comma != std::string::npos);
 						serverTunnel->SetAccessList (idents);
 					}
+
+					// additional backends host:port,[IPv6]:port
+					std::string backends = section.second.get (I2P_SERVER_TUNNEL_BACKENDS, "");
+					if (backends.length () > 0)
+					{
+						size_t pos = 0, comma;
+						do
+						{
+							comma = backends.find (',', pos);
+							auto backend = backends.substr (pos, comma != std::string::npos ? comma - pos : std::string::npos);
+							auto colon = backend.rfind (':');
+							if (colon != std::string::npos && colon > 0)
+							{
+								auto host = backend.substr (0, colon);
+								if (host.length () > 2 && host[0] == '[' && host.back () == ']')
+									host = host.substr (1, host.length () - 2);
+								serverTunnel->AddBackend (host, std::stoi (backend.substr (colon + 1)));
+							}
+							else if (!backend.empty ())
+								LogPrint (eLogError, "Clients: Invalid backend ", backend, " in ", name);
+							pos = comma + 1;
+						}
+						while (comma != std::string::npos);
+					}
+					std::string balancing = section.second.get (I2P_SERVER_TUNNEL_BALANCING, "leastconn");
+					if (balancing == "roundrobin")
+						serverTunnel->SetBalancing (eI2PServerTunnelBalancingRoundRobin);
+					else if (balancing != "leastconn")
+						LogPrint (eLogWarning, "Clients: Unknown balancing ", balancing, " in ", name, ". Least connections is used");
+					// health checks by default if there is more than one backend
+					serverTunnel->SetHealthCheckInterval (section.second.get (I2P_SERVER_TUNNEL_HEALTH_CHECK_INTERVAL,
+						serverTunnel->GetBackends ().size () > 1 ? I2P_SERVER_TUNNEL_DEFAULT_HEALTH_CHECK_INTERVAL : 0));
+					serverTunnel->SetNumPreconnected (section.second.get (I2P_SERVER_TUNNEL_PRECONNECT, 0));
 					auto ins = m_ServerTunnels.insert (std::make_pair (
 							std::make_pair (localDestination->GetIdentHash (), inPort), 
 							serverTunnel));
@@ -658,6 +706,8 @@ namespace client
 							ins.first->second->SetLocalDestination (serverTunnel->GetLocalDestination ());
 						}
 						ins.first->second->isUpdated = true;
+						if (backends.length () > 0)
+							LogPrint (eLogInfo, "Clients: backends of ", name, " are read at start only, restart to change them");
 						LogPrint (eLogInfo, "Clients: I2P server tunnel for destination/port ",   m_AddressBook.ToAddress(localDestination->GetIdentHash ()), "/", inPort, " already exists");
 					}
 
@@ -49,6 +49,10 @@ namespace client
 	const char I2P_SERVER_TUNNEL_WEBIRC_PASSWORD[] = "webircpassword";
 	const char I2P_SERVER_TUNNEL_ADDRESS[] = "address";
 	const char I2P_SERVER_TUNNEL_ENABLE_UNIQUE_LOCAL[] = "enableuniquelocal";
+	const char I2P_SERVER_TUNNEL_BACKENDS[] = "backends";
+	const char I2P_SERVER_TUNNEL_BALANCING[] = "balancing";
+	const char I2P_SERVER_TUNNEL_HEALTH_CHECK_INTERVAL[] = "healthcheckinterval";
+	const char I2P_SERVER_TUNNEL_PRECONNECT[] = "preconnect";
 
 
 	class ClientContext
@@ -92,6 +96,8 @@ namespace client
 			template<typename Section, typename Type>
 			std::string GetI2CPOption (const Section& section, const std::string& name, const Type& value) const;
 			template<typename Section>
+			std::string GetI2CPStringOption (const Section& section, const std::string& name, const std::string& value) const; // GetI2CPOption with string default
+			template<typename Section>
 			void ReadI2CPOptions (const Section& section, std::map<std::string, std::string>& options) const; // for tunnels
 			void ReadI2CPOptionsFromConfig (const std::string& prefix, std::map<std::string, std::string>& options) const; // for HTTP and SOCKS proxy
 
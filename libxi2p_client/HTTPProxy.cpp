@@ -1,5 +1,6 @@
 #include <cstring>
 #include <cassert>
+#include <algorithm>
 #include <string>
 #include <atomic>
 #include <memory>
@@ -19,6 +20,7 @@
 #include "I2PTunnel.h"
 #include "Config.h"
 #include "HTTP.h"
+#include "Timestamp.h"
 
 namespace i2p {
 namespace proxy {
@@ -37,6 +39,37 @@ namespace proxy {
 		"</head>\r\n"
 	;
 
+	const size_t HTTP_PROXY_MAX_RESPONSE_HEADER_SIZE = 65536;
+
+	static std::string ToLower (std::string s)
+	{
+		std::transform (s.begin (), s.end (), s.begin (), ::tolower);
+		return s;
+	}
+
+	static bool IsPersistent (const std::string& version, const std::string& connection)
+	{
+		// HTTP/1.1 is persistent unless closed, HTTP/1.0 if asked
+		auto c = ToLower (connection);
+		if (c.find ("close") != std::string::npos) return false;
+		return version == "HTTP/1.1" || c.find ("keep-alive") != std::string::npos;
+	}
+
+	static std::string RewriteConnectionHeader (const std::string& header, bool keepAlive)
+	{
+		std::string out;
+		size_t pos = 0, eol;
+		while ((eol = header.find ("\r\n", pos)) != std::string::npos && eol != pos) // until empty line
+		{
+			auto name = ToLower (header.substr (pos, header.find (':', pos) - pos));
+			if (!pos || (name != "connection" && name != "keep-alive" && name != "proxy-connection"))
+				out.append (header, pos, eol + 2 - pos);
+			pos = eol + 2;
+		}
+		out += keepAlive ? "Connection: keep-alive\r\n\r\n" : "Connection: close\r\n\r\n";
+		return out;
+	}
+
 	bool str_rmatch(std::string & str, const char *suffix) {
 		auto pos = str.rfind (suffix);
 		if (pos == std::string::npos)
@@ -51,6 +84,7 @@ namespace proxy {
 		private:
 
 			bool HandleRequest();
+			void ProcessNextRequest();
 			void HandleSockRecv(const boost::system::error_code & ecode, std::size_t bytes_transfered);
 			void Terminate();
 			void AsyncSockRead();
@@ -58,6 +92,24 @@ namespace proxy {
 			void SanitizeHTTPRequest(i2p::http::HTTPReq & req);
 			void SentHTTPFailed(const boost::system::error_code & ecode);
 			void HandleStreamRequestComplete (std::shared_ptr<i2p::stream::Stream> stream);
+			/* keep-alive, request and response over idle or new stream */
+			bool IsExchangeable ();
+			void SendExchangeRequest ();
+			void HandleExchangeStreamRequestComplete (std::shared_ptr<i2p::stream::Stream> stream);
+			void StartExchange (std::shared_ptr<i2p::stream::Stream> stream);
+			void HandleExchangeSent (const boost::system::error_code & ecode);
+			void HandleRequestBodyRecv (const boost::system::error_code & ecode, std::size_t len);
+			void ExchangeStreamReceive ();
+			void HandleExchangeStreamReceive (const boost::system::error_code & ecode, std::size_t len);
+			void HandleExchangeStreamClosed (const boost::system::error_code & ecode);
+			void ProcessResponseHeader ();
+			void WriteResponse (const uint8_t * buf, size_t len);
+			void HandleResponseWritten (const boost::system::error_code & ecode);
+			void CompleteExchange ();
+			/* cache */
+			bool LookupCache (const std::string & host, uint16_t port); // true if response is sent from cache
+			void HandleCachedResponseWritten (const boost::system::error_code & ecode);
+			void CacheResponseBody (const uint8_t * buf, size_t len);
 			/* error helpers */
 			void GenericProxyError(const char *title, const char *description);
 			void GenericProxyInfo(const char *title, const char *description);
@@ -95,13 +147,34 @@ namespace proxy {
 		i2p::http::HTTPReq m_ClientRequest;
 		i2p::http::HTTPRes m_ClientResponse;
 		std::stringstream m_ClientRequestBuffer;
+			/* keep-alive */
+			HTTPProxy * m_Proxy;
+			bool m_IsExchange, m_IsClientKeepAlive, m_IsServerKeepAlive, m_IsHeadRequest;
+			bool m_IsStreamReused, m_IsRequestBodyStreamed, m_IsResponseHeaderParsed, m_IsResponseReceived;
+			int m_NumRequests; // on this client connection
+			uint64_t m_RequestBodyRemaining; // to read from client
+			std::shared_ptr<i2p::stream::Stream> m_Stream;
+			i2p::data::IdentHash m_StreamIdent;
+			int m_StreamPort;
+			std::string m_ResponseHeader, m_response_buf;
+			i2p::http::HTTPBodyTracker m_ResponseBody;
+			/* cache */
+			std::string m_CacheKey, m_CachedHeader, m_CachedBody;
+			std::shared_ptr<const i2p::http::HTTPCacheEntry> m_CachedEntry; // being revalidated
+			bool m_IsCaching;
+			i2p::http::HTTPRes m_CachedResponse;
+			uint8_t m_stream_chunk[8192];
 		public:
 
 			HTTPReqHandler(HTTPProxy * parent, std::shared_ptr<boost::asio::ip::tcp::socket> sock) :
 				I2PServiceHandler(parent), m_sock(sock),
 				m_proxysock(std::make_shared<boost::asio::ip::tcp::socket>(parent->GetService())),
 				m_proxy_resolver(parent->GetService()),
-				m_OutproxyUrl(parent->GetOutproxyURL()) {}
+				m_OutproxyUrl(parent->GetOutproxyURL()), m_Proxy (parent),
+				m_IsExchange (false), m_IsClientKeepAlive (false), m_IsServerKeepAlive (false), m_IsHeadRequest (false),
+				m_IsStreamReused (false), m_IsRequestBodyStreamed (false), m_IsResponseHeaderParsed (false),
+				m_IsResponseReceived (false), m_NumRequests (0), m_RequestBodyRemaining (0), m_StreamPort (0),
+				m_IsCaching (false) {}
 			~HTTPReqHandler() { Terminate(); }
 			void Handle () { AsyncSockRead(); } /* overload */
 	};
@@ -133,6 +206,11 @@ namespace proxy {
 				m_proxysock->close();
 			m_proxysock = nullptr;
 		}
+		if (m_Stream)
+		{
+			m_Stream->Close (); // response is not complete
+			m_Stream = nullptr;
+		}
 		Done(shared_from_this());
 	}
 
@@ -219,7 +297,7 @@ namespace proxy {
 		/* replace headers */
 		req.UpdateHeader("User-Agent", "MYOB/6.66 (AN/ON)");
 		/* add headers */
-		req.UpdateHeader("Connection", "close"); /* keep-alive conns not supported yet */
+		req.UpdateHeader("Connection", "close"); /* replaced if request goes over keep-alive stream */
 	}
 
 	/**
@@ -232,6 +310,9 @@ namespace proxy {
 	{
 		std::string b64;
 
+		/* might be next request of keep-alive connection */
+		m_ClientRequest = i2p::http::HTTPReq ();
+		m_RequestURL = i2p::http::URL ();
 		m_req_len = m_ClientRequest.parse(m_recv_buf);
 
 		if (m_req_len == 0)
@@ -298,6 +379,8 @@ namespace proxy {
 		}
 		else
 		{
+			m_IsClientKeepAlive = IsPersistent (m_ClientRequest.version, m_ClientRequest.GetHeader ("Connection") +
+				m_ClientRequest.GetHeader ("Proxy-Connection"));
 			SanitizeHTTPRequest(m_ClientRequest);
 
 			dest_host = m_RequestURL.host;
@@ -368,6 +451,29 @@ namespace proxy {
 
 		/* drop original request from recv buffer */
 		m_recv_buf.erase(0, m_req_len);
+		if (IsExchangeable ())
+		{
+			/* keep connection to server, pipelined requests stay in recv buffer */
+			m_ClientRequest.RemoveHeader ("Connection");
+			m_ClientRequest.RemoveHeader ("Keep-Alive");
+			m_ClientRequest.AddHeader ("Connection", "keep-alive");
+			m_IsHeadRequest = m_ClientRequest.method == "HEAD";
+			m_IsExchange = true;
+			m_Proxy->OnRequest (m_NumRequests++ > 0);
+			if (LookupCache (dest_host, dest_port))
+				return true; /* fresh response from cache */
+			m_send_buf = m_ClientRequest.to_string();
+			size_t bodyLen = std::min ((uint64_t)m_recv_buf.length (), m_RequestBodyRemaining);
+			m_send_buf.append (m_recv_buf, 0, bodyLen);
+			m_recv_buf.erase (0, bodyLen);
+			m_RequestBodyRemaining -= bodyLen;
+			m_IsRequestBodyStreamed = m_RequestBodyRemaining > 0;
+			m_StreamIdent = identHash;
+			m_StreamPort = dest_port;
+			LogPrint(eLogDebug, "HTTPProxy: request to ", dest_host, ":", dest_port, " on keep-alive connection");
+			SendExchangeRequest ();
+			return true;
+		}
 		/* build new buffer from modified request and data from original request */
 		m_send_buf = m_ClientRequest.to_string();
 		m_send_buf.append(m_recv_buf);
@@ -585,13 +691,347 @@ namespace proxy {
 		}
 
 		m_recv_buf.append(reinterpret_cast<const char *>(m_recv_chunk), len);
-		if (HandleRequest()) {
-			m_recv_buf.clear();
+		ProcessNextRequest();
+	}
+
+	void HTTPReqHandler::ProcessNextRequest()
+	{
+		if (!m_recv_buf.empty() && HandleRequest()) {
+			if (!m_IsExchange) m_recv_buf.clear();
 			return;
 		}
 		AsyncSockRead();
 	}
 
+	bool HTTPReqHandler::IsExchangeable ()
+	{
+		if (!m_Proxy->IsKeepAlive ()) return false;
+		/* we must know where request ends */
+		if (!i2p::http::FindHeader (m_ClientRequest.headers, "transfer-encoding").empty () ||
+			!i2p::http::FindHeader (m_ClientRequest.headers, "upgrade").empty ())
+			return false;
+		auto contentLength = i2p::http::FindHeader (m_ClientRequest.headers, "content-length");
+		m_RequestBodyRemaining = contentLength.empty () ? 0 : std::strtoull (contentLength.c_str (), nullptr, 10);
+		return true;
+	}
+
+	void HTTPReqHandler::SendExchangeRequest ()
+	{
+		auto stream = m_Proxy->GetIdleStream (m_StreamIdent, m_StreamPort);
+		m_IsStreamReused = stream != nullptr;
+		if (stream)
+			StartExchange (stream);
+		else
+			GetOwner()->CreateStream (std::bind (&HTTPReqHandler::HandleExchangeStreamRequestComplete,
+				shared_from_this(), std::placeholders::_1), m_StreamIdent, m_StreamPort);
+	}
+
+	void HTTPReqHandler::HandleExchangeStreamRequestComplete (std::shared_ptr<i2p::stream::Stream> stream)
+	{
+		if (!stream) {
+			LogPrint (eLogError, "HTTPProxy: error when creating the stream, check the previous warnings for more info");
+			GenericProxyError("Host is down", "Can't create connection to requested host, it may be down. Please try again later.");
+			return;
+		}
+		m_Proxy->OnStreamCreated ();
+		StartExchange (stream);
+	}
+
+	void HTTPReqHandler::StartExchange (std::shared_ptr<i2p::stream::Stream> stream)
+	{
+		if (Dead ())
+		{
+			stream->Close ();
+			return;
+		}
+		m_Stream = stream;
+		m_ResponseHeader.clear ();
+		m_IsResponseHeaderParsed = false;
+		m_IsResponseReceived = false;
+		m_IsServerKeepAlive = false;
+		m_Stream->AsyncSend (reinterpret_cast<const uint8_t *>(m_send_buf.data()), m_send_buf.length(),
+			std::bind (&HTTPReqHandler::HandleExchangeSent, shared_from_this(), std::placeholders::_1));
+		ExchangeStreamReceive ();
+	}
+
+	void HTTPReqHandler::HandleExchangeSent (const boost::system::error_code & ecode)
+	{
+		if (Dead () || !m_Stream) return;
+		if (ecode)
+		{
+			LogPrint (eLogDebug, "HTTPProxy: stream send error: ", ecode.message ()); // receive will fail too
+			return;
+		}
+		if (m_RequestBodyRemaining > 0)
+			m_sock->async_read_some (boost::asio::buffer (m_recv_chunk, std::min ((uint64_t)sizeof (m_recv_chunk), m_RequestBodyRemaining)),
+				std::bind (&HTTPReqHandler::HandleRequestBodyRecv, shared_from_this(), std::placeholders::_1, std::placeholders::_2));
+	}
+
+	void HTTPReqHandler::HandleRequestBodyRecv (const boost::system::error_code & ecode, std::size_t len)
+	{
+		if (Dead () || !m_Stream) return;
+		if (ecode)
+		{
+			LogPrint (eLogWarning, "HTTPProxy: sock recv got error: ", ecode);
+			Terminate ();
+			return;
+		}
+		m_RequestBodyRemaining -= len;
+		m_send_buf.assign (reinterpret_cast<const char *>(m_recv_chunk), len);
+		m_Stream->AsyncSend (reinterpret_cast<const uint8_t *>(m_send_buf.data()), m_send_buf.length(),
+			std::bind (&HTTPReqHandler::HandleExchangeSent, shared_from_this(), std::placeholders::_1));
+	}
+
+	void HTTPReqHandler::ExchangeStreamReceive ()
+	{
+		m_Stream->AsyncReceive (boost::asio::buffer (m_stream_chunk, sizeof (m_stream_chunk)),
+			std::bind (&HTTPReqHandler::HandleExchangeStreamReceive, shared_from_this(), std::placeholders::_1, std::placeholders::_2),
+			i2p::client::I2P_TUNNEL_CONNECTION_MAX_IDLE);
+	}
+
+	void HTTPReqHandler::HandleExchangeStreamReceive (const boost::system::error_code & ecode, std::size_t len)
+	{
+		if (Dead () || !m_Stream) return;
+		if (!len)
+		{
+			if (ecode)
+				HandleExchangeStreamClosed (ecode);
+			else
+				ExchangeStreamReceive ();
+			return;
+		}
+		m_IsResponseReceived = true;
+		if (!m_IsResponseHeaderParsed)
+		{
+			m_ResponseHeader.append (reinterpret_cast<const char *>(m_stream_chunk), len);
+			ProcessResponseHeader ();
+		}
+		else
+		{
+			size_t l = m_ResponseBody.Consume (m_stream_chunk, len);
+			if (l < len)
+			{
+				LogPrint (eLogWarning, "HTTPProxy: ", len - l, " bytes after end of response dropped");
+				m_IsServerKeepAlive = false;
+			}
+			CacheResponseBody (m_stream_chunk, l);
+			WriteResponse (m_stream_chunk, l);
+		}
+	}
+
+	void HTTPReqHandler::ProcessResponseHeader ()
+	{
+		i2p::http::HTTPRes res;
+		int len = res.parse (m_ResponseHeader);
+		if (!len)
+		{
+			if (m_ResponseHeader.length () > HTTP_PROXY_MAX_RESPONSE_HEADER_SIZE)
+				len = -1;
+			else
+			{
+				ExchangeStreamReceive (); // need more data
+				return;
+			}
+		}
+		m_IsResponseHeaderParsed = true;
+		if (len < 0)
+		{
+			/* not a valid response, pass it as is until stream is closed */
+			LogPrint (eLogWarning, "HTTPProxy: unable to parse response");
+			m_ResponseBody.SetUntilClose ();
+			m_IsClientKeepAlive = false;
+			m_response_buf.swap (m_ResponseHeader);
+			WriteResponse (reinterpret_cast<const uint8_t *>(m_response_buf.data ()), m_response_buf.length ());
+			return;
+		}
+		if (res.code >= 100 && res.code < 200 && res.code != 101)
+		{
+			/* interim response, final one follows */
+			m_response_buf = m_ResponseHeader.substr (0, len);
+			m_ResponseHeader.erase (0, len);
+			m_IsResponseHeaderParsed = false;
+			WriteResponse (reinterpret_cast<const uint8_t *>(m_response_buf.data ()), m_response_buf.length ());
+			return;
+		}
+		m_IsServerKeepAlive = IsPersistent (res.version, i2p::http::FindHeader (res.headers, "connection"));
+		auto contentLength = i2p::http::FindHeader (res.headers, "content-length");
+		if (m_IsHeadRequest || res.code == 204 || res.code == 304)
+			m_ResponseBody.SetLength (0);
+		else if (ToLower (i2p::http::FindHeader (res.headers, "transfer-encoding")).find ("chunked") != std::string::npos)
+			m_ResponseBody.SetChunked ();
+		else if (!contentLength.empty () && res.code != 101)
+			m_ResponseBody.SetLength (std::strtoull (contentLength.c_str (), nullptr, 10));
+		else
+			m_ResponseBody.SetUntilClose ();
+		if (m_ResponseBody.IsUntilClose ())
+		{
+			m_IsServerKeepAlive = false;
+			m_IsClientKeepAlive = false; // client must see end of body too
+		}
+		if (m_IsRequestBodyStreamed && m_RequestBodyRemaining > 0)
+			m_IsClientKeepAlive = false; // server didn't wait for whole request
+		size_t bodyLen = m_ResponseHeader.length () - len;
+		size_t l = m_ResponseBody.Consume (reinterpret_cast<const uint8_t *>(m_ResponseHeader.data ()) + len, bodyLen);
+		if (l < bodyLen) m_IsServerKeepAlive = false;
+		auto cache = m_Proxy->GetCache ();
+		if (m_CachedEntry && res.code == 304)
+		{
+			/* not modified since cached, client gets cached response, which we hold even if evicted */
+			auto ts = i2p::util::GetSecondsSinceEpoch ();
+			auto entry = cache->Revalidate (m_CacheKey, m_CachedEntry, res, ts);
+			m_response_buf = RewriteConnectionHeader (entry->GetHeader (ts), m_IsClientKeepAlive);
+			if (!m_IsHeadRequest) m_response_buf.append (entry->body);
+			m_CachedEntry = nullptr;
+			m_ResponseHeader.clear ();
+			WriteResponse (reinterpret_cast<const uint8_t *>(m_response_buf.data ()), m_response_buf.length ());
+			return;
+		}
+		m_CachedEntry = nullptr;
+		if (cache && !m_CacheKey.empty () && !m_ResponseBody.IsUntilClose () &&
+			cache->IsStorable (res, len + (contentLength.empty () ? 0 : std::strtoull (contentLength.c_str (), nullptr, 10))))
+		{
+			m_IsCaching = true;
+			m_CachedResponse = res;
+			m_CachedHeader = m_ResponseHeader.substr (0, len);
+			m_CachedBody.clear ();
+		}
+		m_response_buf = RewriteConnectionHeader (m_ResponseHeader.substr (0, len), m_IsClientKeepAlive);
+		m_response_buf.append (m_ResponseHeader, len, l);
+		CacheResponseBody (reinterpret_cast<const uint8_t *>(m_ResponseHeader.data ()) + len, l);
+		m_ResponseHeader.clear ();
+		WriteResponse (reinterpret_cast<const uint8_t *>(m_response_buf.data ()), m_response_buf.length ());
+	}
+
+	void HTTPReqHandler::WriteResponse (const uint8_t * buf, size_t len)
+	{
+		boost::asio::async_write (*m_sock, boost::asio::buffer (buf, len), boost::asio::transfer_all (),
+			std::bind (&HTTPReqHandler::HandleResponseWritten, shared_from_this (), std::placeholders::_1));
+	}
+
+	void HTTPReqHandler::HandleResponseWritten (const boost::system::error_code & ecode)
+	{
+		if (Dead () || !m_Stream) return;
+		if (ecode)
+		{
+			LogPrint (eLogDebug, "HTTPProxy: response write error: ", ecode.message ());
+			Terminate ();
+			return;
+		}
+		if (!m_IsResponseHeaderParsed)
+			ProcessResponseHeader (); // after interim response
+		else if (m_ResponseBody.IsComplete ())
+			CompleteExchange ();
+		else
+			ExchangeStreamReceive ();
+	}
+
+	void HTTPReqHandler::HandleExchangeStreamClosed (const boost::system::error_code & ecode)
+	{
+		m_Stream->Close ();
+		m_Stream = nullptr;
+		if (!m_IsResponseReceived && m_IsStreamReused && !m_IsRequestBodyStreamed)
+		{
+			/* closed by server while idle, try again with new stream */
+			LogPrint (eLogDebug, "HTTPProxy: reused stream is closed: ", ecode.message (), ". Try new one");
+			m_IsStreamReused = false;
+			GetOwner()->CreateStream (std::bind (&HTTPReqHandler::HandleExchangeStreamRequestComplete,
+				shared_from_this(), std::placeholders::_1), m_StreamIdent, m_StreamPort);
+			return;
+		}
+		if (!m_IsResponseHeaderParsed)
+		{
+			LogPrint (eLogError, "HTTPProxy: stream closed before response: ", ecode.message ());
+			GenericProxyError("Host is down", "Connection to requested host was closed without response. Please try again later.");
+			return;
+		}
+		if (!m_ResponseBody.IsUntilClose ())
+			LogPrint (eLogWarning, "HTTPProxy: stream closed before end of response: ", ecode.message ());
+		Terminate ();
+	}
+
+	bool HTTPReqHandler::LookupCache (const std::string & host, uint16_t port)
+	{
+		m_CacheKey.clear ();
+		m_CachedEntry = nullptr;
+		m_IsCaching = false;
+		auto cache = m_Proxy->GetCache ();
+		if (!cache) return false;
+		if (m_ClientRequest.method == "POST" || m_ClientRequest.method == "PUT" ||
+			m_ClientRequest.method == "DELETE" || m_ClientRequest.method == "PATCH")
+			cache->Invalidate (host, port, m_ClientRequest);
+		m_CacheKey = i2p::http::HTTPCache::GetKey (host, port, m_ClientRequest);
+		if (m_CacheKey.empty ()) return false;
+		auto entry = cache->Lookup (m_CacheKey);
+		if (!entry)
+		{
+			cache->OnMiss ();
+			return false;
+		}
+		auto ts = i2p::util::GetSecondsSinceEpoch ();
+		if (entry->IsFresh (ts) && !i2p::http::HTTPCache::IsRevalidationRequested (m_ClientRequest))
+		{
+			LogPrint (eLogDebug, "HTTPProxy: ", m_ClientRequest.uri, " from cache");
+			cache->OnHit ();
+			m_response_buf = RewriteConnectionHeader (entry->GetHeader (ts), m_IsClientKeepAlive);
+			m_response_buf.append (entry->body);
+			boost::asio::async_write (*m_sock, boost::asio::buffer (m_response_buf), boost::asio::transfer_all (),
+				std::bind (&HTTPReqHandler::HandleCachedResponseWritten, shared_from_this (), std::placeholders::_1));
+			return true;
+		}
+		if (entry->HasValidators ())
+		{
+			/* stale, ask if modified */
+			m_CachedEntry = entry;
+			i2p::http::HTTPCache::AddConditionalHeaders (m_ClientRequest, *entry);
+		}
+		else
+			cache->OnMiss ();
+		return false;
+	}
+
+	void HTTPReqHandler::HandleCachedResponseWritten (const boost::system::error_code & ecode)
+	{
+		if (Dead ()) return;
+		m_IsExchange = false;
+		if (ecode || !m_IsClientKeepAlive)
+			Terminate ();
+		else
+			ProcessNextRequest ();
+	}
+
+	void HTTPReqHandler::CacheResponseBody (const uint8_t * buf, size_t len)
+	{
+		if (!m_IsCaching) return;
+		if (m_CachedHeader.length () + m_CachedBody.length () + len > i2p::http::HTTP_CACHE_MAX_ENTRY_SIZE)
+		{
+			m_IsCaching = false; // too large
+			m_CachedBody.clear ();
+			return;
+		}
+		m_CachedBody.append (reinterpret_cast<const char *>(buf), len);
+	}
+
+	void HTTPReqHandler::CompleteExchange ()
+	{
+		if (m_IsCaching)
+		{
+			m_Proxy->GetCache ()->Insert (m_CacheKey, m_CachedResponse, m_CachedHeader, m_CachedBody, i2p::util::GetSecondsSinceEpoch ());
+			m_IsCaching = false;
+			m_CachedHeader.clear ();
+			m_CachedBody.clear ();
+		}
+		if (m_IsServerKeepAlive && !m_RequestBodyRemaining && m_Stream->IsOpen ())
+			m_Proxy->ReleaseStream (m_StreamIdent, m_StreamPort, m_Stream);
+		else
+			m_Stream->Close ();
+		m_Stream = nullptr;
+		m_IsExchange = false;
+		if (m_IsClientKeepAlive)
+			ProcessNextRequest ();
+		else
+			Terminate ();
+	}
+
 	void HTTPReqHandler::SentHTTPFailed(const boost::system::error_code & ecode)
 	{
 		if (ecode)
@@ -617,8 +1057,113 @@ namespace proxy {
 
 	HTTPProxy::HTTPProxy(const std::string& name, const std::string& address, int port, const std::string & outproxy, std::shared_ptr<i2p::client::ClientDestination> localDestination):
 		TCPIPAcceptor(address, port, localDestination ? localDestination : i2p::client::context.GetSharedLocalDestination ()),
-		m_Name (name), m_OutproxyUrl(outproxy)
+		m_Name (name), m_OutproxyUrl(outproxy), m_IsKeepAlive (false), m_IdleStreamsCleanupTimer (GetService ()),
+		m_NumRequests (0), m_NumClientConnectionsReused (0), m_NumStreamsCreated (0), m_NumStreamsReused (0)
+	{
+		i2p::config::GetOption("httpproxy.keepalive", m_IsKeepAlive);
+		bool cache; i2p::config::GetOption("httpproxy.cache", cache);
+		if (cache)
+		{
+			if (m_IsKeepAlive)
+			{
+				uint32_t cacheSize = 0; i2p::config::GetOption("httpproxy.cachesize", cacheSize);
+				m_Cache = std::make_shared<i2p::http::HTTPCache> (cacheSize*1024*1024LL);
+			}
+			else
+				LogPrint (eLogWarning, "HTTPProxy: cache requires keepalive");
+		}
+	}
+
+	void HTTPProxy::Start ()
+	{
+		TCPIPAcceptor::Start ();
+		if (m_IsKeepAlive) ScheduleIdleStreamsCleanup ();
+	}
+
+	void HTTPProxy::Stop ()
+	{
+		m_IdleStreamsCleanupTimer.cancel ();
+		{
+			std::unique_lock<std::mutex> l(m_IdleStreamsMutex);
+			for (auto& it: m_IdleStreams)
+				for (auto& s: it.second)
+					s.first->Close ();
+			m_IdleStreams.clear ();
+		}
+		TCPIPAcceptor::Stop ();
+	}
+
+	std::shared_ptr<i2p::stream::Stream> HTTPProxy::GetIdleStream (const i2p::data::IdentHash& ident, int port)
+	{
+		std::shared_ptr<i2p::stream::Stream> stream;
+		auto ts = i2p::util::GetSecondsSinceEpoch ();
+		std::unique_lock<std::mutex> l(m_IdleStreamsMutex);
+		auto it = m_IdleStreams.find (std::make_pair (ident, port));
+		if (it == m_IdleStreams.end ()) return nullptr;
+		while (!stream && !it->second.empty ())
+		{
+			auto s = it->second.back (); // most recent
+			it->second.pop_back ();
+			if (s.first->IsOpen () && !s.first->GetReceiveQueueSize () && ts < s.second + HTTP_PROXY_IDLE_STREAM_TIMEOUT)
+				stream = s.first;
+			else
+				s.first->Close ();
+		}
+		if (it->second.empty ()) m_IdleStreams.erase (it);
+		if (stream) m_NumStreamsReused++;
+		return stream;
+	}
+
+	void HTTPProxy::ReleaseStream (const i2p::data::IdentHash& ident, int port, std::shared_ptr<i2p::stream::Stream> stream)
+	{
+		std::unique_lock<std::mutex> l(m_IdleStreamsMutex);
+		auto& streams = m_IdleStreams[std::make_pair (ident, port)];
+		streams.push_back (std::make_pair (stream, i2p::util::GetSecondsSinceEpoch ()));
+		if (streams.size () > HTTP_PROXY_MAX_IDLE_STREAMS)
+		{
+			streams.front ().first->Close ();
+			streams.pop_front ();
+		}
+	}
+
+	size_t HTTPProxy::GetNumIdleStreams () const
 	{
+		size_t num = 0;
+		std::unique_lock<std::mutex> l(m_IdleStreamsMutex);
+		for (const auto& it: m_IdleStreams)
+			num += it.second.size ();
+		return num;
+	}
+
+	void HTTPProxy::ScheduleIdleStreamsCleanup ()
+	{
+		m_IdleStreamsCleanupTimer.expires_from_now (boost::posix_time::seconds (HTTP_PROXY_IDLE_STREAMS_CLEANUP_INTERVAL));
+		m_IdleStreamsCleanupTimer.async_wait (std::bind (&HTTPProxy::HandleIdleStreamsCleanupTimer, this, std::placeholders::_1));
+	}
+
+	void HTTPProxy::HandleIdleStreamsCleanupTimer (const boost::system::error_code& ecode)
+	{
+		if (ecode == boost::asio::error::operation_aborted) return;
+		auto ts = i2p::util::GetSecondsSinceEpoch ();
+		{
+			std::unique_lock<std::mutex> l(m_IdleStreamsMutex);
+			for (auto it = m_IdleStreams.begin (); it != m_IdleStreams.end ();)
+			{
+				for (auto s = it->second.begin (); s != it->second.end ();)
+					if (!s->first->IsOpen () || ts >= s->second + HTTP_PROXY_IDLE_STREAM_TIMEOUT)
+					{
+						s->first->Close ();
+						s = it->second.erase (s);
+					}
+					else
+						++s;
+				if (it->second.empty ())
+					it = m_IdleStreams.erase (it);
+				else
+					++it;
+			}
+		}
+		ScheduleIdleStreamsCleanup ();
 	}
 
 	std::shared_ptr<i2p::client::I2PServiceHandler> HTTPProxy::CreateHandler(std::shared_ptr<boost::asio::ip::tcp::socket> socket)
@@ -1,8 +1,18 @@
 #ifndef HTTP_PROXY_H__
 #define HTTP_PROXY_H__
 
+#include <atomic>
+#include <list>
+#include <map>
+#include <mutex>
+#include "HTTPCache.h"
+
 namespace i2p {
 namespace proxy {
+	const int HTTP_PROXY_IDLE_STREAM_TIMEOUT = 30; // in seconds, less than keep-alive timeout of usual servers
+	const int HTTP_PROXY_IDLE_STREAMS_CLEANUP_INTERVAL = 15; // in seconds
+	const size_t HTTP_PROXY_MAX_IDLE_STREAMS = 6; // per destination and port, as many as browser's connections per host
+
 	class HTTPProxy: public i2p::client::TCPIPAcceptor
 	{
 		public:
@@ -11,16 +21,45 @@ namespace proxy {
 				HTTPProxy(name, address, port, "", localDestination) {} ;
 			~HTTPProxy() {};
 
+			void Start ();
+			void Stop ();
+
 			std::string GetOutproxyURL() const { return m_OutproxyUrl; }
+			bool IsKeepAlive () const { return m_IsKeepAlive; };
+			std::shared_ptr<i2p::http::HTTPCache> GetCache () const { return m_Cache; }; // null if disabled
+
+			// streams to I2P sites which have completed response and can take next request
+			std::shared_ptr<i2p::stream::Stream> GetIdleStream (const i2p::data::IdentHash& ident, int port);
+			void ReleaseStream (const i2p::data::IdentHash& ident, int port, std::shared_ptr<i2p::stream::Stream> stream);
+			size_t GetNumIdleStreams () const;
+
+			// metrics
+			void OnRequest (bool isClientConnectionReused) { m_NumRequests++; if (isClientConnectionReused) m_NumClientConnectionsReused++; };
+			void OnStreamCreated () { m_NumStreamsCreated++; };
+			uint64_t GetNumRequests () const { return m_NumRequests; };
+			uint64_t GetNumClientConnectionsReused () const { return m_NumClientConnectionsReused; };
+			uint64_t GetNumStreamsCreated () const { return m_NumStreamsCreated; };
+			uint64_t GetNumStreamsReused () const { return m_NumStreamsReused; };
 
 		protected:
 			// Implements TCPIPAcceptor
 			std::shared_ptr<i2p::client::I2PServiceHandler> CreateHandler(std::shared_ptr<boost::asio::ip::tcp::socket> socket);
 			const char* GetName() { return m_Name.c_str (); }
 
+		private:
+
+			void ScheduleIdleStreamsCleanup ();
+			void HandleIdleStreamsCleanupTimer (const boost::system::error_code& ecode);
+
 		private:
 			std::string m_Name;
 			std::string m_OutproxyUrl;
+			bool m_IsKeepAlive;
+			std::shared_ptr<i2p::http::HTTPCache> m_Cache;
+			std::map<std::pair<i2p::data::IdentHash, int>, std::list<std::pair<std::shared_ptr<i2p::stream::Stream>, uint64_t> > > m_IdleStreams; // with release time
+			mutable std::mutex m_IdleStreamsMutex;
+			boost::asio::deadline_timer m_IdleStreamsCleanupTimer;
+			std::atomic<uint64_t> m_NumRequests, m_NumClientConnectionsReused, m_NumStreamsCreated, m_NumStreamsReused;
 	};
 } // http
 } // i2p
@@ -16,6 +16,7 @@ namespace client
 			m_ReadyTimer(m_LocalDestination->GetService()),
 			m_ReadyTimerTriggered(false),
 			m_ConnectTimeout(0),
+			m_BufferUsage (std::make_shared<I2PServiceBufferUsage> ()),
 			isUpdated (true)
 	{
 		m_LocalDestination->Acquire ();
@@ -25,6 +26,7 @@ namespace client
 		m_LocalDestination (i2p::client::context.CreateNewLocalDestination (false, kt)),
 		m_ReadyTimer(m_LocalDestination->GetService()),
 		m_ConnectTimeout(0),
+		m_BufferUsage (std::make_shared<I2PServiceBufferUsage> ()),
 		isUpdated (true)
 	{
 		m_LocalDestination->Acquire ();
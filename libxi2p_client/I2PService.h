@@ -13,6 +13,21 @@ namespace i2p
 {
 namespace client
 {
+	// memory taken by connection buffers of service, in bytes
+	struct I2PServiceBufferUsage
+	{
+		std::atomic<size_t> numBuffers, size, maxSize;
+
+		I2PServiceBufferUsage (): numBuffers (0), size (0), maxSize (0) {};
+		void Add (size_t len)
+		{
+			numBuffers++;
+			size_t s = (size += len), m = maxSize;
+			while (s > m && !maxSize.compare_exchange_weak (m, s));
+		}
+		void Remove (size_t len) { numBuffers--; size -= len; };
+	};
+
 	class I2PServiceHandler;
 	class I2PService : public std::enable_shared_from_this<I2PService>
 	{
@@ -57,6 +72,8 @@ namespace client
 
 			virtual const char* GetName() { return "Generic I2P Service"; }
 
+			std::shared_ptr<I2PServiceBufferUsage> GetBufferUsage () const { return m_BufferUsage; };
+
 		private:
 			void TriggerReadyCheckTimer();
 			void HandleReadyCheckTimer(const boost::system::error_code & ec);
@@ -69,6 +86,7 @@ namespace client
 			boost::asio::deadline_timer m_ReadyTimer;
             bool m_ReadyTimerTriggered;
 			uint32_t m_ConnectTimeout;
+			std::shared_ptr<I2PServiceBufferUsage> m_BufferUsage; // outlives service if connections do
 
             const size_t NEVER_TIMES_OUT = 0;
       
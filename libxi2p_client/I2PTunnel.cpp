@@ -1,6 +1,8 @@
 #include <cassert>
+#include <algorithm>
 #include "Base.h"
 #include "Log.h"
+#include "Timestamp.h"
 #include "Destination.h"
 #include "ClientContext.h"
 #include "I2PTunnel.h"
@@ -20,6 +22,85 @@ namespace client
 		}
 	}
 
+	I2PTunnelBuffer::I2PTunnelBuffer (std::shared_ptr<I2PTunnelBufferPool> pool, uint8_t * buf, size_t len,
+		std::shared_ptr<I2PServiceBufferUsage> usage):
+		m_Pool (pool), m_Buf (buf), m_Len (len), m_Usage (usage)
+	{
+		if (m_Usage) m_Usage->Add (m_Len);
+	}
+
+	I2PTunnelBuffer::~I2PTunnelBuffer ()
+	{
+		if (m_Usage) m_Usage->Remove (m_Len);
+		m_Pool->Release (m_Buf, m_Len);
+	}
+
+	std::shared_ptr<I2PTunnelBufferPool> I2PTunnelBufferPool::GetPool ()
+	{
+		// buffers keep it alive if destroyed after static objects
+		static std::shared_ptr<I2PTunnelBufferPool> pool (new I2PTunnelBufferPool ());
+		return pool;
+	}
+
+	I2PTunnelBufferPool::I2PTunnelBufferPool ():
+		m_Buffers (GetSizeClass (I2P_TUNNEL_CONNECTION_BUFFER_SIZE) + 1), m_PooledSize (0)
+	{
+	}
+
+	I2PTunnelBufferPool::~I2PTunnelBufferPool ()
+	{
+		for (auto& it: m_Buffers)
+			for (auto buf: it)
+				delete[] buf;
+	}
+
+	size_t I2PTunnelBufferPool::GetSizeClass (size_t len)
+	{
+		size_t sizeClass = 0;
+		for (size_t size = I2P_TUNNEL_CONNECTION_MIN_BUFFER_SIZE; size < len && size < I2P_TUNNEL_CONNECTION_BUFFER_SIZE; size <<= 1)
+			sizeClass++;
+		return sizeClass;
+	}
+
+	std::shared_ptr<I2PTunnelBuffer> I2PTunnelBufferPool::Acquire (size_t len, std::shared_ptr<I2PServiceBufferUsage> usage)
+	{
+		auto sizeClass = GetSizeClass (len);
+		size_t size = I2P_TUNNEL_CONNECTION_MIN_BUFFER_SIZE << sizeClass;
+		uint8_t * buf = nullptr;
+		{
+			std::unique_lock<std::mutex> l(m_Mutex);
+			auto& buffers = m_Buffers[sizeClass];
+			if (!buffers.empty ())
+			{
+				buf = buffers.back ();
+				buffers.pop_back ();
+				m_PooledSize -= size;
+			}
+		}
+		if (!buf) buf = new uint8_t[size];
+		return std::make_shared<I2PTunnelBuffer>(shared_from_this (), buf, size, usage);
+	}
+
+	void I2PTunnelBufferPool::Release (uint8_t * buf, size_t len)
+	{
+		{
+			std::unique_lock<std::mutex> l(m_Mutex);
+			if (m_PooledSize + len <= I2P_TUNNEL_MAX_POOLED_BUFFERS_SIZE)
+			{
+				m_Buffers[GetSizeClass (len)].push_back (buf);
+				m_PooledSize += len;
+				return;
+			}
+		}
+		delete[] buf; // too many are free already
+	}
+
+	size_t I2PTunnelBufferPool::GetPooledSize () const
+	{
+		std::unique_lock<std::mutex> l(m_Mutex);
+		return m_PooledSize;
+	}
+
 	I2PTunnelConnection::I2PTunnelConnection (I2PService * owner, std::shared_ptr<boost::asio::ip::tcp::socket> socket,
 		std::shared_ptr<const i2p::data::LeaseSet> leaseSet, int port):
 		I2PServiceHandler(owner), m_Socket (socket), m_RemoteEndpoint (socket->remote_endpoint ()),
@@ -44,6 +125,14 @@ namespace client
 
 	I2PTunnelConnection::~I2PTunnelConnection ()
 	{
+		if (m_Backend) m_Backend->numConnections--;
+	}
+
+	void I2PTunnelConnection::SetBackend (std::shared_ptr<I2PServerTunnelBackend> backend)
+	{
+		if (m_Backend) m_Backend->numConnections--;
+		m_Backend = backend;
+		if (m_Backend) m_Backend->numConnections++;
 	}
 
 	void I2PTunnelConnection::I2PConnect (const uint8_t * msg, size_t len)
@@ -53,7 +142,7 @@ namespace client
 			if (msg)
 				m_Stream->Send (msg, len); // connect and send
 			else
-				m_Stream->Send (m_Buffer, 0); // connect
+				m_Stream->Send (nullptr, 0); // connect
 		}
 		StreamReceive ();
 		Receive ();
@@ -98,9 +187,16 @@ namespace client
 		}
 	}
 
+	void I2PTunnelConnection::Connected ()
+	{
+		I2PTunnelSetSocketOptions (m_Socket);
+		HandleConnect (boost::system::error_code ());
+	}
+
 	void I2PTunnelConnection::Terminate ()
 	{
 		if (Kill()) return;
+		SetBackend (nullptr);
 		if (m_Stream)
 		{
 			m_Stream->Close ();
@@ -113,18 +209,43 @@ namespace client
 		Done(shared_from_this ());
 	}
 
+	std::shared_ptr<I2PTunnelBuffer> I2PTunnelConnection::AcquireBuffer (size_t len)
+	{
+		auto owner = GetOwner ();
+		return I2PTunnelBufferPool::GetPool ()->Acquire (len, owner ? owner->GetBufferUsage () : nullptr);
+	}
+
 	void I2PTunnelConnection::Receive ()
 	{
-		m_Socket->async_read_some (boost::asio::buffer(m_Buffer, I2P_TUNNEL_CONNECTION_BUFFER_SIZE),
-			std::bind(&I2PTunnelConnection::HandleReceived, shared_from_this (),
-			std::placeholders::_1, std::placeholders::_2));
+		// wait until readable without buffer
+		m_Socket->async_read_some (boost::asio::null_buffers (),
+			std::bind(&I2PTunnelConnection::HandleReadable, shared_from_this (), std::placeholders::_1));
+	}
+
+	void I2PTunnelConnection::HandleReadable (const boost::system::error_code& ecode)
+	{
+		if (ecode)
+		{
+			HandleReceived (ecode, 0);
+			return;
+		}
+		boost::system::error_code ec;
+		size_t available = m_Socket->available (ec);
+		m_Buffer = AcquireBuffer (available);
+		if (!ec && !m_Socket->non_blocking ()) m_Socket->non_blocking (true, ec); // in case of spurious readiness
+		size_t len = 0;
+		if (!ec) len = m_Socket->read_some (boost::asio::buffer (m_Buffer->GetBuffer (), m_Buffer->GetSize ()), ec);
+		HandleReceived (ec, len);
 	}
 
 	void I2PTunnelConnection::HandleReceived (const boost::system::error_code& ecode, std::size_t bytes_transferred)
 	{
 		if (ecode)
 		{
-			if (ecode != boost::asio::error::operation_aborted)
+			m_Buffer = nullptr;
+			if (ecode == boost::asio::error::would_block)
+				Receive ();
+			else if (ecode != boost::asio::error::operation_aborted)
 			{
 				LogPrint (eLogError, "I2PTunnel: read error: ", ecode.message ());
 				Terminate ();
@@ -135,15 +256,19 @@ namespace client
 			if (m_Stream)
 			{
 				auto s = shared_from_this ();
-				m_Stream->AsyncSend (m_Buffer, bytes_transferred,
-					[s](const boost::system::error_code& ecode)
+				auto buffer = m_Buffer; // referred by stream until handler is called
+				m_Stream->AsyncSend (buffer->GetBuffer (), bytes_transferred,
+					[s, buffer](const boost::system::error_code& ecode)
 					{
+						if (s->m_Buffer == buffer) s->m_Buffer = nullptr;
 						if (!ecode)
 							s->Receive ();
 						else
 							s->Terminate ();
 					});
 			}
+			else
+				m_Buffer = nullptr;
 		}
 	}
 
@@ -156,7 +281,10 @@ namespace client
 				Terminate ();
 		}
 		else
+		{
+			m_StreamBuffer = nullptr; // written
 			StreamReceive ();
+		}
 	}
 
 	void I2PTunnelConnection::StreamReceive ()
@@ -166,7 +294,8 @@ namespace client
 			if (m_Stream->GetStatus () == i2p::stream::eStreamStatusNew ||
 				m_Stream->GetStatus () == i2p::stream::eStreamStatusOpen) // regular
 			{
-				m_Stream->AsyncReceive (boost::asio::buffer (m_StreamBuffer, I2P_TUNNEL_CONNECTION_BUFFER_SIZE),
+				// wait for data without buffer
+				m_Stream->AsyncReceive (boost::asio::mutable_buffers_1 (nullptr, 0),
 					std::bind (&I2PTunnelConnection::HandleStreamReceive, shared_from_this (),
 						std::placeholders::_1, std::placeholders::_2),
 					I2P_TUNNEL_CONNECTION_MAX_IDLE);
@@ -174,11 +303,15 @@ namespace client
 			else // closed by peer
 			{
 				// get remaning data
-				auto len = m_Stream->ReadSome (m_StreamBuffer, I2P_TUNNEL_CONNECTION_BUFFER_SIZE);
+				m_StreamBuffer = AcquireBuffer (m_Stream->GetReceiveQueueSize ()*i2p::stream::STREAMING_MTU);
+				auto len = m_Stream->ReadSome (m_StreamBuffer->GetBuffer (), m_StreamBuffer->GetSize ());
 				if (len > 0) // still some data
-					Write (m_StreamBuffer, len);
+					Write (m_StreamBuffer->GetBuffer (), len);
 				else // no more data
+				{
+					m_StreamBuffer = nullptr;
 					Terminate ();
+				}
 			}
 		}
 	}
@@ -190,8 +323,8 @@ namespace client
 			if (ecode != boost::asio::error::operation_aborted)
 			{
 				LogPrint (eLogError, "I2PTunnel: stream read error: ", ecode.message ());
-				if (bytes_transferred > 0)
-					Write (m_StreamBuffer, bytes_transferred); // postpone termination
+				if (bytes_transferred > 0 && m_StreamBuffer)
+					Write (m_StreamBuffer->GetBuffer (), bytes_transferred); // postpone termination
 				else if (ecode == boost::asio::error::timed_out && m_Stream && m_Stream->IsOpen ())
 					StreamReceive ();
 				else
@@ -200,8 +333,22 @@ namespace client
 			else
 				Terminate ();
 		}
-		else
-			Write (m_StreamBuffer, bytes_transferred);
+		else if (!bytes_transferred)
+		{
+			// data is available, take buffer for all of it
+			if (!m_Stream) return;
+			m_StreamBuffer = AcquireBuffer (m_Stream->GetReceiveQueueSize ()*i2p::stream::STREAMING_MTU);
+			auto len = m_Stream->ReadSome (m_StreamBuffer->GetBuffer (), m_StreamBuffer->GetSize ());
+			if (len > 0)
+				Write (m_StreamBuffer->GetBuffer (), len);
+			else
+			{
+				m_StreamBuffer = nullptr;
+				StreamReceive ();
+			}
+		}
+		else if (m_StreamBuffer)
+			Write (m_StreamBuffer->GetBuffer (), bytes_transferred);
 	}
 
 	void I2PTunnelConnection::Write (const uint8_t * buf, size_t len)
@@ -215,6 +362,11 @@ namespace client
 		if (ecode)
 		{
 			LogPrint (eLogError, "I2PTunnel: connect error: ", ecode.message ());
+			if (m_Backend)
+			{
+				m_Backend->numFailures++;
+				m_Backend->isUp = false; // until next successful health check
+			}
 			Terminate ();
 		}
 		else
@@ -227,8 +379,9 @@ namespace client
 				// send destination first like received from I2P
 				std::string dest = m_Stream->GetRemoteIdentity ()->ToBase64 ();
 				dest += "\n";
-				if(sizeof(m_StreamBuffer) >= dest.size()) {
-					memcpy (m_StreamBuffer, dest.c_str (), dest.size ());
+				m_StreamBuffer = AcquireBuffer (dest.size ());
+				if(m_StreamBuffer->GetSize () >= dest.size()) {
+					memcpy (m_StreamBuffer->GetBuffer (), dest.c_str (), dest.size ());
 				}
 				HandleStreamReceive (boost::system::error_code (), dest.size ());
 			}
@@ -294,48 +447,92 @@ namespace client
 
 	void I2PServerTunnelConnectionHTTP::Write (const uint8_t * buf, size_t len)
 	{
-		if (m_HeaderSent)
+		if (m_HeaderSent && m_RequestBody.IsUntilClose ())
+		{
 			I2PTunnelConnection::Write (buf, len);
-		else
+			return;
+		}
+		m_Out.clear ();
+		while (len > 0)
 		{
-			m_InHeader.clear ();
-			m_InHeader.write ((const char *)buf, len);
-			std::string line;
-			bool endOfHeader = false;
-			while (!endOfHeader)
+			if (m_HeaderSent)
 			{
-				std::getline(m_InHeader, line);
-				if (!m_InHeader.fail ())
+				size_t l = m_RequestBody.Consume (buf, len);
+				if (l == len && m_Out.empty ())
 				{
-					if (line == "\r") endOfHeader = true;
-					else
-					{
-						if (m_Host.length () > 0 && line.find ("Host:") != std::string::npos)
-							m_OutHeader << "Host: " << m_Host << "\r\n"; // override host
-						else
-							m_OutHeader << line << "\n";
-					}
+					I2PTunnelConnection::Write (buf, len); // body only, as is
+					if (m_RequestBody.IsComplete ()) m_HeaderSent = false;
+					return;
 				}
-				else
-					break;
+				m_Out.append ((const char *)buf, l);
+				buf += l; len -= l;
+				if (m_RequestBody.IsComplete ()) m_HeaderSent = false; // next request on same stream
 			}
-			// add X-I2P fields
-			if (m_From)
+			else
 			{
-				m_OutHeader << X_I2P_DEST_B32 << ": " << context.GetAddressBook ().ToAddress(m_From->GetIdentHash ()) << "\r\n";
-				m_OutHeader << X_I2P_DEST_HASH << ": " << m_From->GetIdentHash ().ToBase64 () << "\r\n";
-				m_OutHeader << X_I2P_DEST_B64 << ": " << m_From->ToBase64 () << "\r\n";
+				m_InHeader.append ((const char *)buf, len);
+				len = 0;
+				auto eoh = m_InHeader.find ("\r\n\r\n");
+				if (eoh == std::string::npos)
+				{
+					if (m_InHeader.length () > I2P_TUNNEL_HTTP_MAX_HEADER_SIZE)
+					{
+						LogPrint (eLogError, "I2PTunnel: HTTP header is too long");
+						Terminate ();
+						return;
+					}
+					break; // wait for rest of header
+				}
+				m_Out += RewriteHeader (m_InHeader.substr (0, eoh + 2));
+				m_Rest = m_InHeader.substr (eoh + 4); // data right after header
+				m_InHeader.clear ();
+				m_HeaderSent = true;
+				buf = (const uint8_t *)m_Rest.c_str ();
+				len = m_Rest.length ();
 			}
+		}
+		if (!m_Out.empty ())
+			I2PTunnelConnection::Write ((const uint8_t *)m_Out.c_str (), m_Out.length ());
+		else
+			HandleWrite (boost::system::error_code ()); // nothing to write yet, receive more
+	}
 
-			if (endOfHeader)
+	std::string I2PServerTunnelConnectionHTTP::RewriteHeader (const std::string& header)
+	{
+		std::stringstream in (header), out;
+		std::string line;
+		m_RequestBody.SetLength (0);
+		bool isChunked = false, isUpgrade = false;
+		while (std::getline (in, line))
+		{
+			auto colon = line.find (':');
+			std::string name = line.substr (0, colon);
+			std::transform (name.begin (), name.end (), name.begin (), ::tolower);
+			if (colon != std::string::npos)
 			{
-				m_OutHeader << "\r\n"; // end of header
-				m_OutHeader << m_InHeader.str ().substr (m_InHeader.tellg ()); // data right after header
-				m_InHeader.str ("");
-				m_HeaderSent = true;
-				I2PTunnelConnection::Write ((uint8_t *)m_OutHeader.str ().c_str (), m_OutHeader.str ().length ());
+				if (name == "content-length")
+					m_RequestBody.SetLength (std::strtoull (line.c_str () + colon + 1, nullptr, 10));
+				else if (name == "transfer-encoding")
+					isChunked = true;
+				else if (name == "upgrade")
+					isUpgrade = true;
 			}
+			if (m_Host.length () > 0 && name == "host")
+				out << "Host: " << m_Host << "\r\n"; // override host
+			else
+				out << line << "\n";
+		}
+		if (isChunked) m_RequestBody.SetChunked ();
+		if (isUpgrade) m_RequestBody.SetUntilClose (); // not HTTP anymore
+		// add X-I2P fields
+		if (m_From)
+		{
+			out << X_I2P_DEST_B32 << ": " << context.GetAddressBook ().ToAddress(m_From->GetIdentHash ()) << "\r\n";
+			out << X_I2P_DEST_HASH << ": " << m_From->GetIdentHash ().ToBase64 () << "\r\n";
+			out << X_I2P_DEST_B64 << ": " << m_From->ToBase64 () << "\r\n";
 		}
+		out << "\r\n"; // end of header
+		return out.str ();
 	}
 
 	I2PTunnelConnectionIRC::I2PTunnelConnectionIRC (I2PService * owner, std::shared_ptr<i2p::stream::Stream> stream,
@@ -482,47 +679,245 @@ namespace client
 
 	I2PServerTunnel::I2PServerTunnel (const std::string& name, const std::string& address,
 		int port, std::shared_ptr<ClientDestination> localDestination, int inport, bool gzip):
-		I2PService (localDestination), m_IsUniqueLocal(true), m_Name (name), m_Address (address), m_Port (port), m_IsAccessList (false)
+		I2PService (localDestination), m_IsUniqueLocal(true), m_Name (name), m_Address (address), m_Port (port), m_IsAccessList (false),
+		m_Balancing (eI2PServerTunnelBalancingLeastConnections), m_NextBackend (0), m_HealthCheckInterval (0),
+		m_NumPreconnected (0), m_HealthCheckTimer (GetService ()), m_IsRunning (std::make_shared<bool> (false))
 	{
 		m_PortDestination = localDestination->CreateStreamingDestination (inport > 0 ? inport : port, gzip);
+		m_Backends.push_back (std::make_shared<I2PServerTunnelBackend> (address, port));
+	}
+
+	I2PServerTunnel::~I2PServerTunnel ()
+	{
+		*m_IsRunning = false;
+	}
+
+	void I2PServerTunnel::AddBackend (const std::string& address, int port)
+	{
+		m_Backends.push_back (std::make_shared<I2PServerTunnelBackend> (address, port));
 	}
 
 	void I2PServerTunnel::Start ()
 	{
+		*m_IsRunning = true;
 		m_Endpoint.port (m_Port);
-		boost::system::error_code ec;
-		auto addr = boost::asio::ip::address::from_string (m_Address, ec);
-		if (!ec)
-		{
-			m_Endpoint.address (addr);
-			Accept ();
-		}
-		else
+		for (auto& backend: m_Backends)
 		{
-			auto resolver = std::make_shared<boost::asio::ip::tcp::resolver>(GetService ());
-			resolver->async_resolve (boost::asio::ip::tcp::resolver::query (m_Address, ""),
-				std::bind (&I2PServerTunnel::HandleResolve, this,
-					std::placeholders::_1, std::placeholders::_2, resolver));
+			backend->endpoint.port (backend->port);
+			boost::system::error_code ec;
+			auto addr = boost::asio::ip::address::from_string (backend->address, ec);
+			if (!ec)
+			{
+				backend->endpoint.address (addr);
+				backend->isResolved = true;
+				Preconnect (backend);
+			}
+			else
+			{
+				auto resolver = std::make_shared<boost::asio::ip::tcp::resolver>(GetService ());
+				resolver->async_resolve (boost::asio::ip::tcp::resolver::query (backend->address, ""),
+					std::bind (&I2PServerTunnel::HandleResolve, this,
+						std::placeholders::_1, std::placeholders::_2, resolver, backend));
+			}
 		}
+		if (m_Backends[0]->isResolved) m_Endpoint.address (m_Backends[0]->endpoint.address ());
+		if (m_Backends.size () > 1)
+			LogPrint (eLogInfo, "I2PTunnel: server tunnel ", m_Name, " has ", m_Backends.size (), " backends");
+		Accept ();
+		ScheduleHealthCheck ();
 	}
 
 	void I2PServerTunnel::Stop ()
 	{
+		*m_IsRunning = false;
+		m_HealthCheckTimer.cancel ();
+		for (auto& backend: m_Backends)
+		{
+			for (auto& it: backend->connected)
+				it.first->close ();
+			backend->connected.clear ();
+		}
 		ClearHandlers ();
 	}
 
 	void I2PServerTunnel::HandleResolve (const boost::system::error_code& ecode, boost::asio::ip::tcp::resolver::iterator it,
-		std::shared_ptr<boost::asio::ip::tcp::resolver> resolver)
+		std::shared_ptr<boost::asio::ip::tcp::resolver> resolver, std::shared_ptr<I2PServerTunnelBackend> backend)
 	{
 		if (!ecode)
 		{
 			auto addr = (*it).endpoint ().address ();
 			LogPrint (eLogInfo, "I2PTunnel: server tunnel ", (*it).host_name (), " has been resolved to ", addr);
-			m_Endpoint.address (addr);
-			Accept ();
+			backend->endpoint.address (addr);
+			backend->isResolved = true;
+			if (backend == m_Backends[0]) m_Endpoint.address (addr);
+			Preconnect (backend);
 		}
 		else
-			LogPrint (eLogError, "I2PTunnel: Unable to resolve server tunnel address: ", ecode.message ());
+			LogPrint (eLogError, "I2PTunnel: Unable to resolve server tunnel address ", backend->address, ": ", ecode.message ());
+	}
+
+	std::shared_ptr<I2PServerTunnelBackend> I2PServerTunnel::SelectBackend ()
+	{
+		if (m_Backends.size () == 1)
+			return m_Backends[0]->isResolved ? m_Backends[0] : nullptr;
+		// backends which are up, or all resolved if none is
+		std::vector<std::shared_ptr<I2PServerTunnelBackend> > candidates;
+		for (auto& it: m_Backends)
+			if (it->isResolved && (it->isUp || !m_HealthCheckInterval))
+				candidates.push_back (it);
+		if (candidates.empty ())
+			for (auto& it: m_Backends)
+				if (it->isResolved) candidates.push_back (it);
+		if (candidates.empty ()) return nullptr;
+		size_t ind = (m_NextBackend++) % candidates.size ();
+		if (m_Balancing == eI2PServerTunnelBalancingLeastConnections)
+		{
+			// starting from next one to spread equal ones
+			for (size_t i = 1; i < candidates.size (); i++)
+			{
+				size_t j = (ind + i) % candidates.size ();
+				if (candidates[j]->numConnections < candidates[ind]->numConnections) ind = j;
+			}
+		}
+		return candidates[ind];
+	}
+
+	bool I2PServerTunnel::IsPreconnectable (std::shared_ptr<const I2PServerTunnelBackend> backend) const
+	{
+#ifdef __linux__
+		// local address depends on remote destination
+		if (m_IsUniqueLocal && backend->endpoint.address ().is_v4 () &&
+			backend->endpoint.address ().to_v4 ().to_bytes ()[0] == 127)
+			return false;
+#endif
+		return m_NumPreconnected > 0;
+	}
+
+	std::shared_ptr<boost::asio::ip::tcp::socket> I2PServerTunnel::GetPreconnected (std::shared_ptr<I2PServerTunnelBackend> backend)
+	{
+		auto ts = i2p::util::GetSecondsSinceEpoch ();
+		while (!backend->connected.empty ())
+		{
+			auto it = backend->connected.front ();
+			backend->connected.pop_front ();
+			if (ts > it.second + I2P_SERVER_TUNNEL_PRECONNECTED_TIMEOUT)
+			{
+				it.first->close ();
+				continue;
+			}
+			// check if closed by backend, some servers send data first
+			uint8_t c;
+			boost::system::error_code ec;
+			it.first->non_blocking (true, ec);
+			if (!ec) it.first->receive (boost::asio::buffer (&c, 1), boost::asio::socket_base::message_peek, ec);
+			if (!ec || ec == boost::asio::error::would_block)
+				return it.first;
+			it.first->close ();
+		}
+		return nullptr;
+	}
+
+	void I2PServerTunnel::Preconnect (std::shared_ptr<I2PServerTunnelBackend> backend)
+	{
+		if (!*m_IsRunning || !backend->isResolved || !IsPreconnectable (backend)) return;
+		auto isRunning = m_IsRunning;
+		while ((int)backend->connected.size () + backend->numConnecting < m_NumPreconnected)
+		{
+			auto socket = std::make_shared<boost::asio::ip::tcp::socket> (GetService ());
+			backend->numConnecting++;
+			socket->async_connect (backend->endpoint,
+				[this, isRunning, backend, socket](const boost::system::error_code& ecode)
+				{
+					backend->numConnecting--; // health check waits for it
+					if (!*isRunning) return; // tunnel is stopped or deleted
+					if (!ecode)
+					{
+						backend->isUp = true;
+						backend->connected.push_back (std::make_pair (socket, i2p::util::GetSecondsSinceEpoch ()));
+					}
+					else
+					{
+						LogPrint (eLogWarning, "I2PTunnel: can't pre-connect to ", backend->endpoint, ": ", ecode.message ());
+						backend->numFailures++;
+						backend->isUp = false; // will try again at next health check
+					}
+				});
+		}
+	}
+
+	void I2PServerTunnel::ScheduleHealthCheck ()
+	{
+		if (m_HealthCheckInterval <= 0) return;
+		m_HealthCheckTimer.expires_from_now (boost::posix_time::seconds (m_HealthCheckInterval));
+		auto isRunning = m_IsRunning;
+		m_HealthCheckTimer.async_wait ([this, isRunning](const boost::system::error_code& ecode)
+			{
+				if (!*isRunning) return; // tunnel is stopped or deleted
+				HandleHealthCheckTimer (ecode);
+			});
+	}
+
+	void I2PServerTunnel::HandleHealthCheckTimer (const boost::system::error_code& ecode)
+	{
+		if (ecode == boost::asio::error::operation_aborted) return;
+		auto isRunning = m_IsRunning;
+		auto ts = i2p::util::GetSecondsSinceEpoch ();
+		for (auto& backend: m_Backends)
+		{
+			if (!backend->isResolved) continue;
+			// replace old pre-connected sockets
+			for (auto it = backend->connected.begin (); it != backend->connected.end ();)
+				if (ts > it->second + I2P_SERVER_TUNNEL_PRECONNECTED_TIMEOUT)
+				{
+					it->first->close ();
+					it = backend->connected.erase (it);
+				}
+				else
+					++it;
+			if (IsPreconnectable (backend))
+			{
+				if (backend->isUp)
+				{
+					Preconnect (backend); // pre-connecting checks it as well
+					continue;
+				}
+				if (backend->numConnecting > 0) continue;
+			}
+			// probe by connect
+			auto socket = std::make_shared<boost::asio::ip::tcp::socket> (GetService ());
+			auto timer = std::make_shared<boost::asio::deadline_timer> (GetService ());
+			timer->expires_from_now (boost::posix_time::seconds (I2P_SERVER_TUNNEL_HEALTH_CHECK_TIMEOUT));
+			timer->async_wait ([socket](const boost::system::error_code& ecode)
+				{
+					if (ecode != boost::asio::error::operation_aborted) socket->close ();
+				});
+			socket->async_connect (backend->endpoint,
+				[this, isRunning, backend, socket, timer](const boost::system::error_code& ecode)
+				{
+					timer->cancel ();
+					if (!*isRunning) return;
+					bool isUp = !ecode;
+					if (isUp != backend->isUp)
+						LogPrint (isUp ? eLogInfo : eLogWarning, "I2PTunnel: server tunnel ", m_Name, " backend ",
+							backend->endpoint, isUp ? " is up" : " is down");
+					backend->isUp = isUp;
+					if (isUp)
+					{
+						if (IsPreconnectable (backend) && (int)backend->connected.size () < m_NumPreconnected)
+							backend->connected.push_back (std::make_pair (socket, i2p::util::GetSecondsSinceEpoch ()));
+						else
+						{
+							boost::system::error_code ec;
+							socket->shutdown (boost::asio::ip::tcp::socket::shutdown_both, ec);
+							socket->close ();
+						}
+						Preconnect (backend);
+					}
+					else
+						backend->numFailures++;
+				});
+		}
+		ScheduleHealthCheck ();
 	}
 
 	void I2PServerTunnel::SetAccessList (const std::set<i2p::data::IdentHash>& accessList)
@@ -559,17 +954,34 @@ namespace client
 					return;
 				}
 			}
+			auto backend = SelectBackend ();
+			if (!backend)
+			{
+				LogPrint (eLogError, "I2PTunnel: No resolved backend for server tunnel ", m_Name, ". Incoming connection dropped");
+				stream->Close ();
+				return;
+			}
+			backend->numConnects++;
 			// new connection
-			auto conn = CreateI2PConnection (stream);
+			auto socket = GetPreconnected (backend);
+			auto conn = CreateI2PConnection (stream, socket ? socket : std::make_shared<boost::asio::ip::tcp::socket> (GetService ()),
+				backend->endpoint);
+			conn->SetBackend (backend);
 			AddHandler (conn);
-			conn->Connect (m_IsUniqueLocal);
+			if (socket)
+			{
+				conn->Connected ();
+				Preconnect (backend); // replace it
+			}
+			else
+				conn->Connect (m_IsUniqueLocal);
 		}
 	}
 
-	std::shared_ptr<I2PTunnelConnection> I2PServerTunnel::CreateI2PConnection (std::shared_ptr<i2p::stream::Stream> stream)
+	std::shared_ptr<I2PTunnelConnection> I2PServerTunnel::CreateI2PConnection (std::shared_ptr<i2p::stream::Stream> stream,
+		std::shared_ptr<boost::asio::ip::tcp::socket> socket, const boost::asio::ip::tcp::endpoint& target)
 	{
-		return std::make_shared<I2PTunnelConnection> (this, stream, std::make_shared<boost::asio::ip::tcp::socket> (GetService ()), GetEndpoint ());
-
+		return std::make_shared<I2PTunnelConnection> (this, stream, socket, target);
 	}
 
 	I2PServerTunnelHTTP::I2PServerTunnelHTTP (const std::string& name, const std::string& address,
@@ -580,10 +992,10 @@ namespace client
 	{
 	}
 
-	std::shared_ptr<I2PTunnelConnection> I2PServerTunnelHTTP::CreateI2PConnection (std::shared_ptr<i2p::stream::Stream> stream)
+	std::shared_ptr<I2PTunnelConnection> I2PServerTunnelHTTP::CreateI2PConnection (std::shared_ptr<i2p::stream::Stream> stream,
+		std::shared_ptr<boost::asio::ip::tcp::socket> socket, const boost::asio::ip::tcp::endpoint& target)
 	{
-		return std::make_shared<I2PServerTunnelConnectionHTTP> (this, stream,
-			std::make_shared<boost::asio::ip::tcp::socket> (GetService ()), GetEndpoint (), m_Host);
+		return std::make_shared<I2PServerTunnelConnectionHTTP> (this, stream, socket, target, m_Host);
 	}
 
 	I2PServerTunnelIRC::I2PServerTunnelIRC (const std::string& name, const std::string& address,
@@ -594,9 +1006,10 @@ namespace client
 	{
 	}
 
-	std::shared_ptr<I2PTunnelConnection> I2PServerTunnelIRC::CreateI2PConnection (std::shared_ptr<i2p::stream::Stream> stream)
+	std::shared_ptr<I2PTunnelConnection> I2PServerTunnelIRC::CreateI2PConnection (std::shared_ptr<i2p::stream::Stream> stream,
+		std::shared_ptr<boost::asio::ip::tcp::socket> socket, const boost::asio::ip::tcp::endpoint& target)
 	{
-		return std::make_shared<I2PTunnelConnectionIRC> (this, stream, std::make_shared<boost::asio::ip::tcp::socket> (GetService ()), GetEndpoint (), this->m_WebircPass);
+		return std::make_shared<I2PTunnelConnectionIRC> (this, stream, socket, target, this->m_WebircPass);
 	}
 
 	void I2PUDPServerTunnel::HandleRecvFromI2P(const i2p::data::IdentityEx& from, uint16_t fromPort, uint16_t toPort, const uint8_t * buf, size_t len)
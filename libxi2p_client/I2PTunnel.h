@@ -6,6 +6,10 @@
 #include <set>
 #include <tuple>
 #include <memory>
+#include <mutex>
+#include <vector>
+#include <list>
+#include <atomic>
 #include <sstream>
 #include <boost/asio.hpp>
 #include "Identity.h"
@@ -13,19 +17,72 @@
 #include "Datagram.h"
 #include "Streaming.h"
 #include "I2PService.h"
+#include "HTTP.h"
 
 namespace i2p
 {
 namespace client
 {
 	const size_t I2P_TUNNEL_CONNECTION_BUFFER_SIZE = 65536;
+	const size_t I2P_TUNNEL_CONNECTION_MIN_BUFFER_SIZE = 4096;
+	const size_t I2P_TUNNEL_MAX_POOLED_BUFFERS_SIZE = 16*1024*1024; // free buffers kept for reuse, in bytes
 	const int I2P_TUNNEL_CONNECTION_MAX_IDLE = 3600; // in seconds
 	const int I2P_TUNNEL_DESTINATION_REQUEST_TIMEOUT = 10; // in seconds
+	const int I2P_SERVER_TUNNEL_DEFAULT_HEALTH_CHECK_INTERVAL = 10; // in seconds, if more than one backend
+	const int I2P_SERVER_TUNNEL_HEALTH_CHECK_TIMEOUT = 5; // in seconds
+	const int I2P_SERVER_TUNNEL_PRECONNECTED_TIMEOUT = 30; // in seconds, backends might close idle ones
 	// for HTTP tunnels
 	const char X_I2P_DEST_HASH[] = "X-I2P-DestHash"; // hash  in base64
 	const char X_I2P_DEST_B64[] = "X-I2P-DestB64"; // full address in base64
 	const char X_I2P_DEST_B32[] = "X-I2P-DestB32"; // .b32.i2p address
+	const size_t I2P_TUNNEL_HTTP_MAX_HEADER_SIZE = 65536;
 
+	class I2PTunnelBufferPool;
+	class I2PTunnelBuffer
+	{
+		public:
+
+			I2PTunnelBuffer (std::shared_ptr<I2PTunnelBufferPool> pool, uint8_t * buf, size_t len,
+				std::shared_ptr<I2PServiceBufferUsage> usage);
+			~I2PTunnelBuffer (); // returns memory to pool
+
+			uint8_t * GetBuffer () const { return m_Buf; };
+			size_t GetSize () const { return m_Len; };
+
+		private:
+
+			std::shared_ptr<I2PTunnelBufferPool> m_Pool;
+			uint8_t * m_Buf;
+			size_t m_Len;
+			std::shared_ptr<I2PServiceBufferUsage> m_Usage;
+	};
+
+	// buffers of power of 2 sizes from I2P_TUNNEL_CONNECTION_MIN_BUFFER_SIZE to I2P_TUNNEL_CONNECTION_BUFFER_SIZE,
+	// shared by all tunnels. Connections take them for a read and write only, idle ones have nothing
+	class I2PTunnelBufferPool: public std::enable_shared_from_this<I2PTunnelBufferPool>
+	{
+		public:
+
+			static std::shared_ptr<I2PTunnelBufferPool> GetPool ();
+
+			~I2PTunnelBufferPool ();
+			std::shared_ptr<I2PTunnelBuffer> Acquire (size_t len, std::shared_ptr<I2PServiceBufferUsage> usage); // at least len, up to max
+			void Release (uint8_t * buf, size_t len);
+			size_t GetPooledSize () const;
+
+		private:
+
+			I2PTunnelBufferPool ();
+			static size_t GetSizeClass (size_t len);
+
+		private:
+
+			mutable std::mutex m_Mutex;
+			std::vector<std::vector<uint8_t *> > m_Buffers; // free ones by size class
+			size_t m_PooledSize;
+	};
+
+	struct I2PServerTunnelBackend;
 	class I2PTunnelConnection: public I2PServiceHandler, public std::enable_shared_from_this<I2PTunnelConnection>
 	{
 		public:
@@ -38,11 +95,14 @@ namespace client
 			~I2PTunnelConnection ();
 			void I2PConnect (const uint8_t * msg = nullptr, size_t len = 0);
 			void Connect (bool isUniqueLocal = true);
+			void Connected (); // socket is connected to target already
+			void SetBackend (std::shared_ptr<I2PServerTunnelBackend> backend); // counts connection until terminated
 
 		protected:
 			void Terminate ();
 
 			void Receive ();
+			void HandleReadable (const boost::system::error_code& ecode);
 			void HandleReceived (const boost::system::error_code& ecode, std::size_t bytes_transferred);
 			virtual void Write (const uint8_t * buf, size_t len); // can be overloaded
 			void HandleWrite (const boost::system::error_code& ecode);
@@ -54,11 +114,15 @@ namespace client
 			std::shared_ptr<const boost::asio::ip::tcp::socket> GetSocket () const { return m_Socket; };
 
 		private:
-			uint8_t m_Buffer[I2P_TUNNEL_CONNECTION_BUFFER_SIZE], m_StreamBuffer[I2P_TUNNEL_CONNECTION_BUFFER_SIZE];
+			std::shared_ptr<I2PTunnelBuffer> AcquireBuffer (size_t len);
+
+		private:
+			std::shared_ptr<I2PTunnelBuffer> m_Buffer, m_StreamBuffer; // while reading or writing only
 			std::shared_ptr<boost::asio::ip::tcp::socket> m_Socket;
 			std::shared_ptr<i2p::stream::Stream> m_Stream;
 			boost::asio::ip::tcp::endpoint m_RemoteEndpoint;
 			bool m_IsQuiet; // don't send destination
+			std::shared_ptr<I2PServerTunnelBackend> m_Backend;
 	};
 
 	class I2PClientTunnelConnectionHTTP: public I2PTunnelConnection
@@ -87,10 +151,14 @@ namespace client
 		protected:
 			void Write (const uint8_t * buf, size_t len);
 
+		private:
+			std::string RewriteHeader (const std::string& header); // sets m_RequestBody
+
 		private:
 			std::string m_Host;
-			std::stringstream m_InHeader, m_OutHeader;
+			std::string m_InHeader, m_Out, m_Rest;
 			bool m_HeaderSent;
+			i2p::http::HTTPBodyTracker m_RequestBody; // next request can follow on the same stream
 			std::shared_ptr<const i2p::data::IdentityEx> m_From;
 	};
 
@@ -259,16 +327,44 @@ namespace client
 			bool m_cancel_resolve;
 	};
 
+	enum I2PServerTunnelBalancing
+	{
+		eI2PServerTunnelBalancingLeastConnections = 0,
+		eI2PServerTunnelBalancingRoundRobin
+	};
+
+	struct I2PServerTunnelBackend
+	{
+		std::string address;
+		int port;
+		boost::asio::ip::tcp::endpoint endpoint;
+		bool isResolved, isUp;
+		std::atomic<int> numConnections;
+		uint64_t numConnects, numFailures;
+		std::list<std::pair<std::shared_ptr<boost::asio::ip::tcp::socket>, uint64_t> > connected; // pre-connected, creation time
+		int numConnecting; // pre-connecting
+
+		I2PServerTunnelBackend (const std::string& addr, int p): address (addr), port (p),
+			isResolved (false), isUp (true), numConnections (0), numConnects (0), numFailures (0), numConnecting (0) {};
+	};
+
 	class I2PServerTunnel: public I2PService
 	{
 		public:
 			I2PServerTunnel (const std::string& name, const std::string& address, int port,
 				std::shared_ptr<ClientDestination> localDestination, int inport = 0, bool gzip = true);
+			~I2PServerTunnel ();
 
 			void Start ();
 			void Stop ();
 
 			void SetAccessList (const std::set<i2p::data::IdentHash>& accessList);
+			void AddBackend (const std::string& address, int port); // in addition to address and port
+			void SetBalancing (I2PServerTunnelBalancing balancing) { m_Balancing = balancing; };
+			void SetHealthCheckInterval (int interval) { m_HealthCheckInterval = interval; }; // in seconds, 0 disables
+			void SetNumPreconnected (int num) { m_NumPreconnected = num; }; // per backend
+			const std::vector<std::shared_ptr<I2PServerTunnelBackend> >& GetBackends () const { return m_Backends; };
+			std::shared_ptr<I2PServerTunnelBackend> SelectBackend (); // for new connection, nullptr if none is resolved
 
 			void SetUniqueLocal (bool isUniqueLocal) { m_IsUniqueLocal = isUniqueLocal; }
 			bool IsUniqueLocal () const { return m_IsUniqueLocal; }
@@ -282,11 +378,18 @@ namespace client
 
 		private:
 			void HandleResolve (const boost::system::error_code& ecode, boost::asio::ip::tcp::resolver::iterator it,
-				std::shared_ptr<boost::asio::ip::tcp::resolver> resolver);
+				std::shared_ptr<boost::asio::ip::tcp::resolver> resolver, std::shared_ptr<I2PServerTunnelBackend> backend);
 
 			void Accept ();
 			void HandleAccept (std::shared_ptr<i2p::stream::Stream> stream);
-			virtual std::shared_ptr<I2PTunnelConnection> CreateI2PConnection (std::shared_ptr<i2p::stream::Stream> stream);
+			virtual std::shared_ptr<I2PTunnelConnection> CreateI2PConnection (std::shared_ptr<i2p::stream::Stream> stream,
+				std::shared_ptr<boost::asio::ip::tcp::socket> socket, const boost::asio::ip::tcp::endpoint& target);
+
+			bool IsPreconnectable (std::shared_ptr<const I2PServerTunnelBackend> backend) const;
+			std::shared_ptr<boost::asio::ip::tcp::socket> GetPreconnected (std::shared_ptr<I2PServerTunnelBackend> backend);
+			void Preconnect (std::shared_ptr<I2PServerTunnelBackend> backend);
+			void ScheduleHealthCheck ();
+			void HandleHealthCheckTimer (const boost::system::error_code& ecode);
 
 		private:
 			bool m_IsUniqueLocal;
@@ -296,6 +399,12 @@ namespace client
 			std::shared_ptr<i2p::stream::StreamingDestination> m_PortDestination;
 			std::set<i2p::data::IdentHash> m_AccessList;
 			bool m_IsAccessList;
+			std::vector<std::shared_ptr<I2PServerTunnelBackend> > m_Backends; // first is address and port
+			I2PServerTunnelBalancing m_Balancing;
+			size_t m_NextBackend; // round robin
+			int m_HealthCheckInterval, m_NumPreconnected;
+			boost::asio::deadline_timer m_HealthCheckTimer;
+			std::shared_ptr<bool> m_IsRunning; // for handlers which may outlive tunnel
 	};
 
 	class I2PServerTunnelHTTP: public I2PServerTunnel
@@ -306,7 +415,8 @@ namespace client
 				int inport = 0, bool gzip = true);
 
 		private:
-			std::shared_ptr<I2PTunnelConnection> CreateI2PConnection (std::shared_ptr<i2p::stream::Stream> stream);
+			std::shared_ptr<I2PTunnelConnection> CreateI2PConnection (std::shared_ptr<i2p::stream::Stream> stream,
+				std::shared_ptr<boost::asio::ip::tcp::socket> socket, const boost::asio::ip::tcp::endpoint& target);
 
 		private:
 			std::string m_Host;
@@ -320,7 +430,8 @@ namespace client
 				int inport = 0, bool gzip = true);
 
 		private:
-			std::shared_ptr<I2PTunnelConnection> CreateI2PConnection (std::shared_ptr<i2p::stream::Stream> stream);
+			std::shared_ptr<I2PTunnelConnection> CreateI2PConnection (std::shared_ptr<i2p::stream::Stream> stream,
+				std::shared_ptr<boost::asio::ip::tcp::socket> socket, const boost::asio::ip::tcp::endpoint& target);
 
 		private:
 			std::string m_WebircPass;
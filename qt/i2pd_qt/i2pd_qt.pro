@@ -41,6 +41,7 @@ SOURCES += DaemonQT.cpp mainwindow.cpp \
     ../../libxi2p/Gost.cpp \
     ../../libxi2p/Gzip.cpp \
     ../../libxi2p/HTTP.cpp \
+    ../../libxi2p/HTTPCache.cpp \
     ../../libxi2p/I2NPProtocol.cpp \
     ../../libxi2p/I2PEndian.cpp \
     ../../libxi2p/Identity.cpp \
@@ -48,6 +49,7 @@ SOURCES += DaemonQT.cpp mainwindow.cpp \
     ../../libxi2p/Log.cpp \
     ../../libxi2p/NetDb.cpp \
     ../../libxi2p/NetDbRequests.cpp \
+    ../../libxi2p/NetDbSnapshot.cpp \
     ../../libxi2p/NTCPSession.cpp \
     ../../libxi2p/Profiling.cpp \
     ../../libxi2p/Reseed.cpp \
@@ -56,8 +58,11 @@ SOURCES += DaemonQT.cpp mainwindow.cpp \
     ../../libxi2p/Signature.cpp \
     ../../libxi2p/SSU.cpp \
     ../../libxi2p/SSUData.cpp \
+    ../../libxi2p/SSUCongestion.cpp \
+    ../../libxi2p/SSUBatch.cpp \
     ../../libxi2p/SSUSession.cpp \
     ../../libxi2p/Streaming.cpp \
+    ../../libxi2p/StreamingCongestion.cpp \
     ../../libxi2p/Timestamp.cpp \
     ../../libxi2p/TransitTunnel.cpp \
     ../../libxi2p/Transports.cpp \
@@ -112,6 +117,7 @@ HEADERS  += DaemonQT.h mainwindow.h \
     ../../libxi2p/Base.h \
     ../../libxi2p/BloomFilter.h \
     ../../libxi2p/Config.h \
+    ../../libxi2p/Congestion.h \
     ../../libxi2p/Crypto.h \
 	../../libxi2p/CryptoKey.h \
     ../../libxi2p/Datagram.h \
@@ -123,25 +129,34 @@ HEADERS  += DaemonQT.h mainwindow.h \
     ../../libxi2p/Gost.h \
     ../../libxi2p/Gzip.h \
     ../../libxi2p/HTTP.h \
+    ../../libxi2p/HTTPCache.h \
     ../../libxi2p/I2NPProtocol.h \
     ../../libxi2p/I2PEndian.h \
     ../../libxi2p/Identity.h \
+    ../../libxi2p/IOServicePool.h \
     ../../libxi2p/LeaseSet.h \
     ../../libxi2p/LittleBigEndian.h \
     ../../libxi2p/Log.h \
     ../../libxi2p/NetDb.hpp \
     ../../libxi2p/NetDbRequests.h \
+    ../../libxi2p/NetDbSnapshot.h \
     ../../libxi2p/NTCPSession.h \
     ../../libxi2p/Profiling.h \
     ../../libxi2p/Queue.h \
+    ../../libxi2p/RandomIndex.h \
+    ../../libxi2p/XORIndex.h \
+    ../../libxi2p/TagsTable.h \
     ../../libxi2p/Reseed.h \
     ../../libxi2p/RouterContext.h \
     ../../libxi2p/RouterInfo.h \
     ../../libxi2p/Signature.h \
     ../../libxi2p/SSU.h \
     ../../libxi2p/SSUData.h \
+    ../../libxi2p/SSUCongestion.h \
+    ../../libxi2p/SSUBatch.h \
     ../../libxi2p/SSUSession.h \
     ../../libxi2p/Streaming.h \
+    ../../libxi2p/StreamingCongestion.h \
     ../../libxi2p/Tag.h \
     ../../libxi2p/Timestamp.h \
     ../../libxi2p/TransitTunnel.h \
@@ -0,0 +1,110 @@
+#include <inttypes.h>
+#include <string.h>
+#include <chrono>
+#include <iostream>
+#include <list>
+#include <memory>
+#include <set>
+#include <vector>
+
+#include "XORIndex.h"
+
+using namespace i2p::data;
+
+// k closest floodfills to routing key, as DatabaseLookup handling and sending does:
+// scan of std::list with std::set of k best (as before) vs XORIndex, at 10k floodfills
+const int NUM_FLOODFILLS = 10000;
+const int NUM_LOOKUPS = 2000;
+
+struct Floodfill
+{
+	Tag<32> ident;
+};
+
+struct Metric
+{
+	uint8_t metric[32];
+	bool operator< (const Metric& other) const { return memcmp (metric, other.metric, 32) < 0; };
+};
+
+static Metric Xor (const Tag<32>& key1, const Tag<32>& key2)
+{
+	Metric m;
+	const uint64_t * h1 = key1.GetLL (), * h2 = key2.GetLL ();
+	uint64_t * r = (uint64_t *)m.metric;
+	for (int i = 0; i < 4; i++) r[i] = h1[i] ^ h2[i];
+	return m;
+}
+
+static std::vector<Tag<32> > GetClosestScan (const std::list<std::shared_ptr<Floodfill> >& floodfills, const Tag<32>& key, size_t num)
+{
+	struct Sorted
+	{
+		std::shared_ptr<const Floodfill> r;
+		Metric metric;
+		bool operator< (const Sorted& other) const { return metric < other.metric; };
+	};
+	std::set<Sorted> sorted;
+	for (const auto& it: floodfills)
+	{
+		auto m = Xor (key, it->ident);
+		if (sorted.size () < num)
+			sorted.insert ({it, m});
+		else if (m < sorted.rbegin ()->metric)
+		{
+			sorted.insert ({it, m});
+			sorted.erase (std::prev (sorted.end ()));
+		}
+	}
+	std::vector<Tag<32> > res;
+	for (const auto& it: sorted) res.push_back (it.r->ident);
+	return res;
+}
+
+static std::vector<Tag<32> > GetClosestIndex (const XORIndex<Floodfill>& floodfills, const Tag<32>& key, size_t num)
+{
+	std::vector<Tag<32> > res;
+	floodfills.VisitClosest (key, [&res, num](std::shared_ptr<const Floodfill> ff)
+		{
+			res.push_back (ff->ident);
+			return res.size () < num;
+		});
+	return res;
+}
+
+int main ()
+{
+	std::list<std::shared_ptr<Floodfill> > list;
+	XORIndex<Floodfill> index;
+	for (int i = 0; i < NUM_FLOODFILLS; i++)
+	{
+		auto ff = std::make_shared<Floodfill> ();
+		ff->ident.Randomize ();
+		list.push_back (ff);
+		index.Insert (ff->ident, ff);
+	}
+	std::vector<Tag<32> > keys (NUM_LOOKUPS);
+	for (auto& it: keys) it.Randomize ();
+
+	for (size_t num: { 1, 3, 7 })
+	{
+		size_t numFound = 0;
+		auto begin = std::chrono::high_resolution_clock::now ();
+		for (const auto& key: keys)
+			numFound += GetClosestScan (list, key, num).size ();
+		auto middle = std::chrono::high_resolution_clock::now ();
+		for (const auto& key: keys)
+			numFound += GetClosestIndex (index, key, num).size ();
+		auto end = std::chrono::high_resolution_clock::now ();
+		if (numFound != 2*num*NUM_LOOKUPS) std::cerr << "not enough found " << numFound << std::endl;
+		for (const auto& key: keys)
+			if (GetClosestIndex (index, key, num) != GetClosestScan (list, key, num))
+			{
+				std::cerr << "different result" << std::endl;
+				break;
+			}
+		std::cout << NUM_FLOODFILLS << " floodfills, " << num << " closest: list scan "
+			<< std::chrono::duration_cast<std::chrono::nanoseconds>(middle - begin).count ()/NUM_LOOKUPS << " ns, XORIndex "
+			<< std::chrono::duration_cast<std::chrono::nanoseconds>(end - middle).count ()/NUM_LOOKUPS << " ns" << std::endl;
+	}
+}
@@ -0,0 +1,138 @@
+#include <inttypes.h>
+#include <stdio.h>
+#include <string.h>
+#include <sys/resource.h>
+#include <chrono>
+#include <iostream>
+#include <memory>
+#include <thread>
+#include <vector>
+#include <boost/asio.hpp>
+
+#include "IOServicePool.h"
+
+// Destinations emulated by few timers each, like streaming ACK and resend timers and cleanup,
+// running on own io_service and thread each (as before) vs shared IOServicePool.
+// Measures memory and context switches of whole process while timers are firing
+const int NUM_TIMERS = 3; // per destination
+const int TIMER_INTERVAL = 50; // in milliseconds
+const int DURATION = 2; // in seconds
+const int POOL_THREADS = 4;
+
+struct Destination: public std::enable_shared_from_this<Destination>
+{
+	Destination (boost::asio::io_service& service): numHandled (0)
+	{
+		for (int i = 0; i < NUM_TIMERS; i++)
+			timers.push_back (std::make_shared<boost::asio::deadline_timer> (service));
+	}
+
+	void Start ()
+	{
+		for (auto& it: timers) Schedule (it);
+	}
+
+	void Schedule (std::shared_ptr<boost::asio::deadline_timer> timer)
+	{
+		timer->expires_from_now (boost::posix_time::milliseconds (TIMER_INTERVAL + rand () % TIMER_INTERVAL));
+		auto s = shared_from_this ();
+		timer->async_wait ([s, timer](const boost::system::error_code& ecode)
+		{
+			if (ecode == boost::asio::error::operation_aborted) return;
+			s->numHandled++;
+			s->Schedule (timer);
+		});
+	}
+
+	std::vector<std::shared_ptr<boost::asio::deadline_timer> > timers;
+	uint64_t numHandled;
+};
+
+struct Usage
+{
+	long rss, vsize; // in kB
+	long numSwitches;
+	std::chrono::steady_clock::time_point time;
+};
+
+static Usage GetUsage ()
+{
+	Usage usage{ 0, 0, 0, std::chrono::steady_clock::now () };
+	FILE * f = fopen ("/proc/self/status", "r");
+	if (f)
+	{
+		char line[256];
+		while (fgets (line, sizeof (line), f))
+		{
+			if (!strncmp (line, "VmRSS:", 6)) usage.rss = atol (line + 6);
+			if (!strncmp (line, "VmSize:", 7)) usage.vsize = atol (line + 7);
+		}
+		fclose (f);
+	}
+	struct rusage ru;
+	getrusage (RUSAGE_SELF, &ru);
+	usage.numSwitches = ru.ru_nvcsw + ru.ru_nivcsw;
+	return usage;
+}
+
+static void Report (const char * name, int numDestinations, const Usage& before, const Usage& after, uint64_t numHandled)
+{
+	// including creation of destinations
+	double duration = std::chrono::duration_cast<std::chrono::milliseconds>(after.time - before.time).count ()/1000.0;
+	std::cout << numDestinations << " destinations, " << name << ": RSS " << (after.rss - before.rss)/1024 << "MB, virtual "
+		<< (after.vsize - before.vsize)/1024 << "MB, " << (int)((after.numSwitches - before.numSwitches)/duration) << " context switches/s, "
+		<< (int)(numHandled/duration) << " timers/s" << std::endl;
+}
+
+static void MeasureThreadPerDestination (int numDestinations)
+{
+	auto before = GetUsage ();
+	std::vector<std::unique_ptr<boost::asio::io_service> > services;
+	std::vector<std::shared_ptr<Destination> > destinations;
+	std::vector<std::thread> threads;
+	for (int i = 0; i < numDestinations; i++)
+	{
+		services.emplace_back (new boost::asio::io_service ());
+		destinations.push_back (std::make_shared<Destination> (*services.back ()));
+		destinations.back ()->Start ();
+		auto service = services.back ().get ();
+		threads.emplace_back ([service]() { service->run (); });
+	}
+	std::this_thread::sleep_for (std::chrono::seconds (DURATION));
+	auto after = GetUsage ();
+	uint64_t numHandled = 0;
+	for (auto& it: destinations) numHandled += it->numHandled;
+	for (auto& it: services) it->stop ();
+	for (auto& it: threads) it.join ();
+	Report ("thread per destination", numDestinations, before, after, numHandled);
+}
+
+static void MeasurePool (int numDestinations)
+{
+	auto before = GetUsage ();
+	i2p::util::IOServicePool pool ("Destinations");
+	pool.Start (POOL_THREADS);
+	std::vector<std::shared_ptr<Destination> > destinations;
+	for (int i = 0; i < numDestinations; i++)
+	{
+		auto& service = pool.GetNextService ();
+		destinations.push_back (std::make_shared<Destination> (service));
+		auto dest = destinations.back ();
+		service.post ([dest]() { dest->Start (); });
+	}
+	std::this_thread::sleep_for (std::chrono::seconds (DURATION));
+	auto after = GetUsage ();
+	uint64_t numHandled = 0;
+	for (auto& it: destinations) numHandled += it->numHandled;
+	pool.Stop ();
+	Report ("pool", numDestinations, before, after, numHandled);
+}
+
+int main ()
+{
+	for (int numDestinations: { 100, 500, 2000 })
+	{
+		MeasurePool (numDestinations); // first, stacks of destinations' threads might be cached
+		MeasureThreadPerDestination (numDestinations);
+	}
+}
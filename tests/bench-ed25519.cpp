@@ -0,0 +1,46 @@
+#include <inttypes.h>
+#include <string.h>
+#include <chrono>
+#include <iostream>
+#include <vector>
+#include <openssl/rand.h>
+
+#include "Ed25519.h"
+#include "Signature.h"
+
+// prints microseconds per operation, key/sign/verify use Signer/Verifier only and build against older revisions too
+const int NUM_ITERATIONS = 2000;
+
+template<typename F>
+void Measure (const char * name, F f)
+{
+	auto begin = std::chrono::high_resolution_clock::now ();
+	for (int i = 0; i < NUM_ITERATIONS; i++) f (i);
+	auto end = std::chrono::high_resolution_clock::now ();
+	auto duration = std::chrono::duration_cast<std::chrono::microseconds>(end - begin).count ();
+	std::cout << name << ": " << (double)duration/NUM_ITERATIONS << " us" << std::endl;
+}
+
+int main ()
+{
+	uint8_t priv[32], pub[32], buf[1024], signature[64], shared[32];
+	RAND_bytes (priv, 32);
+	RAND_bytes (buf, 1024);
+	i2p::crypto::GetEd25519 (); // create tables
+	i2p::crypto::EDDSA25519Signer signer (priv);
+	memcpy (pub, signer.GetPublicKey (), 32);
+	i2p::crypto::EDDSA25519Verifier verifier (pub);
+
+	Measure ("EdDSA key", [&priv](int i) { priv[0] = i; i2p::crypto::EDDSA25519Signer s (priv); });
+	Measure ("EdDSA sign", [&](int) { signer.Sign (buf, 1024, signature); });
+	Measure ("EdDSA verify", [&](int) { verifier.Verify (buf, 1024, signature); });
+	std::vector<i2p::crypto::EDDSAVerification> verifications (i2p::crypto::EDDSA25519_MAX_BATCH_SIZE);
+	Measure ("EdDSA batch verify", [&](int i)
+		{
+			auto& v = verifications[i % verifications.size ()];
+			verifier.CreateVerification (buf, 1024, signature, v);
+			if (&v == &verifications.back ()) i2p::crypto::GetEd25519 ()->VerifyBatch (verifications.data (), verifications.size ());
+		});
+	Measure ("x25519 ScalarMulB", [&](int i) { priv[0] = i; i2p::crypto::GetEd25519 ()->ScalarMulB (priv, pub); });
+	Measure ("x25519 ScalarMul", [&](int i) { priv[0] = i; i2p::crypto::GetEd25519 ()->ScalarMul (pub, priv, shared); });
+}
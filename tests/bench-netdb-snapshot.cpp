@@ -0,0 +1,93 @@
+#include <inttypes.h>
+#include <stdlib.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <chrono>
+#include <fstream>
+#include <iostream>
+#include <string>
+#include <vector>
+#include <boost/filesystem.hpp>
+
+#include "NetDbSnapshot.h"
+
+using namespace i2p::data;
+
+// Reading of netDb at startup: file per router in 64 directories, as HashedStorage (before),
+// vs single mapped snapshot. Files are evicted from page cache first when possible, as after reboot
+const int NUM_ROUTERS = 5000;
+const int RI_SIZE = 1000; // typical
+const char CHARS[] = "ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz0123456789-~";
+
+static void Evict (const std::string& path)
+{
+	int fd = open (path.c_str (), O_RDONLY);
+	if (fd < 0) return;
+	fsync (fd);
+#ifdef POSIX_FADV_DONTNEED
+	posix_fadvise (fd, 0, 0, POSIX_FADV_DONTNEED);
+#endif
+	close (fd);
+}
+
+typedef std::chrono::steady_clock Clock;
+
+int main ()
+{
+	char tmpl[] = "/tmp/bench-netdb-snapshot-XXXXXX";
+	if (!mkdtemp (tmpl)) return 1;
+	std::string root (tmpl);
+	std::vector<std::string> files;
+	std::vector<std::vector<uint8_t> > buffers (NUM_ROUTERS, std::vector<uint8_t> (RI_SIZE));
+	std::vector<NetDbSnapshotRecord> records;
+	for (int i = 0; i < 64; i++)
+		boost::filesystem::create_directory (root + "/r" + CHARS[i]);
+	for (int i = 0; i < NUM_ROUTERS; i++)
+	{
+		NetDbSnapshotRecord record;
+		record.ident.Randomize ();
+		for (auto& it: buffers[i]) it = rand ();
+		auto ident = record.ident.ToBase64 ();
+		for (auto& c: ident) if (c == '/') c = '-';
+		files.push_back (root + "/r" + ident[0] + "/routerInfo-" + ident + ".dat");
+		std::ofstream f (files.back (), std::ofstream::binary);
+		f.write ((char *)buffers[i].data (), RI_SIZE);
+		record.timestamp = i;
+		record.flags = eNetDbSnapshotVerified;
+		record.buf = buffers[i].data ();
+		record.len = RI_SIZE;
+		records.push_back (record);
+	}
+	std::string snapshotPath = root + "/netDb.snapshot";
+	NetDbSnapshot::Save (snapshotPath, records, 1);
+	for (auto& it: files) Evict (it);
+	Evict (snapshotPath);
+
+	// files
+	auto start = Clock::now ();
+	uint64_t sum = 0;
+	int numRead = 0;
+	boost::filesystem::recursive_directory_iterator it (root), end;
+	for (; it != end; it++)
+	{
+		if (!boost::filesystem::is_regular_file (it->status ()) || it->path ().filename () == "netDb.snapshot") continue;
+		std::ifstream f (it->path ().string (), std::ifstream::binary);
+		uint8_t buf[2048];
+		f.read ((char *)buf, sizeof (buf));
+		sum += buf[0];
+		numRead++;
+	}
+	auto filesTime = std::chrono::duration_cast<std::chrono::microseconds>(Clock::now () - start).count ();
+	// snapshot
+	start = Clock::now ();
+	NetDbSnapshot snapshot;
+	snapshot.Open (snapshotPath);
+	for (auto& it: snapshot.GetRecords ())
+		sum += it.buf[it.len - 1];
+	auto snapshotTime = std::chrono::duration_cast<std::chrono::microseconds>(Clock::now () - start).count ();
+
+	std::cout << numRead << " files: " << filesTime/1000.0 << " ms, snapshot of " << snapshot.GetRecords ().size ()
+		<< ": " << snapshotTime/1000.0 << " ms (" << sum % 2 << ")" << std::endl;
+	snapshot.Close ();
+	boost::filesystem::remove_all (root);
+}
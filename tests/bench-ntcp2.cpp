@@ -0,0 +1,144 @@
+#include <inttypes.h>
+#include <string.h>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <iostream>
+#include <memory>
+#include <mutex>
+#include <vector>
+#include <boost/asio.hpp>
+#include <openssl/rand.h>
+
+#include "Crypto.h"
+#include "I2PEndian.h"
+#include "IOServicePool.h"
+
+// loopback throughput of NTCP2 style data phase (length + ChaCha20/Poly1305 frame)
+// with sessions spread over IOServicePool threads as NTCP2Server does
+const int NUM_SESSIONS = 64;
+const int NUM_FRAMES = 200; // per session
+const size_t FRAME_SIZE = 16384;
+
+std::mutex g_Mutex;
+std::condition_variable g_Done;
+int g_NumCompleted = 0;
+std::atomic<uint64_t> g_NumBytes;
+
+struct Session: public std::enable_shared_from_this<Session>
+{
+	Session (boost::asio::io_service& s): service (s), socket (s), seqn (0), numFrames (0)
+	{
+		memset (key, 1, 32);
+		payload.resize (FRAME_SIZE);
+		buf.resize (FRAME_SIZE + 16 + 2);
+	}
+
+	void CreateNonce (uint8_t * nonce)
+	{
+		memset (nonce, 0, 4);
+		htole64buf (nonce + 4, seqn++);
+	}
+
+	void SendNextFrame ()
+	{
+		if (numFrames >= NUM_FRAMES) return;
+		uint8_t nonce[12];
+		CreateNonce (nonce);
+		i2p::crypto::AEADChaCha20Poly1305 (payload.data (), FRAME_SIZE, nullptr, 0, key, nonce, buf.data () + 2, FRAME_SIZE + 16, true);
+		htobe16buf (buf.data (), FRAME_SIZE + 16);
+		auto s = shared_from_this ();
+		boost::asio::async_write (socket, boost::asio::buffer (buf.data (), FRAME_SIZE + 18), boost::asio::transfer_all (),
+			[s](const boost::system::error_code& ecode, std::size_t)
+			{
+				if (ecode) { std::cerr << "send error " << ecode.message () << std::endl; return; }
+				s->numFrames++;
+				s->SendNextFrame ();
+			});
+	}
+
+	void ReceiveLength ()
+	{
+		auto s = shared_from_this ();
+		boost::asio::async_read (socket, boost::asio::buffer (buf.data (), 2), boost::asio::transfer_all (),
+			[s](const boost::system::error_code& ecode, std::size_t)
+			{
+				if (ecode) { std::cerr << "receive error " << ecode.message () << std::endl; return; }
+				s->Receive (bufbe16toh (s->buf.data ()));
+			});
+	}
+
+	void Receive (size_t len)
+	{
+		auto s = shared_from_this ();
+		boost::asio::async_read (socket, boost::asio::buffer (buf.data () + 2, len), boost::asio::transfer_all (),
+			[s, len](const boost::system::error_code& ecode, std::size_t)
+			{
+				if (ecode) { std::cerr << "receive error " << ecode.message () << std::endl; return; }
+				uint8_t nonce[12];
+				s->CreateNonce (nonce);
+				if (!i2p::crypto::AEADChaCha20Poly1305 (s->buf.data () + 2, len - 16, nullptr, 0, s->key, nonce, s->payload.data (), len - 16, false))
+					std::cerr << "AEAD verification failed" << std::endl;
+				g_NumBytes += len - 16;
+				if (++s->numFrames < NUM_FRAMES)
+					s->ReceiveLength ();
+				else
+				{
+					std::unique_lock<std::mutex> l(g_Mutex);
+					g_NumCompleted++;
+					g_Done.notify_one ();
+				}
+			});
+	}
+
+	boost::asio::io_service& service;
+	boost::asio::ip::tcp::socket socket;
+	uint8_t key[32];
+	uint64_t seqn;
+	int numFrames;
+	std::vector<uint8_t> payload, buf;
+};
+
+void Measure (int numThreads)
+{
+	i2p::util::IOServicePool pool ("bench");
+	pool.Start (numThreads);
+	boost::asio::io_service service;
+	boost::asio::ip::tcp::acceptor acceptor (service, boost::asio::ip::tcp::endpoint (boost::asio::ip::address_v4::loopback (), 0));
+	std::vector<std::shared_ptr<Session> > senders, receivers;
+	for (int i = 0; i < NUM_SESSIONS; i++)
+	{
+		i2p::data::Tag<32> ident;
+		RAND_bytes (ident, 32);
+		auto sender = std::make_shared<Session> (pool.GetService (ident));
+		sender->socket.connect (acceptor.local_endpoint ());
+		auto receiver = std::make_shared<Session> (pool.GetNextService ());
+		acceptor.accept (receiver->socket);
+		senders.push_back (sender);
+		receivers.push_back (receiver);
+	}
+	g_NumCompleted = 0; g_NumBytes = 0;
+	auto begin = std::chrono::high_resolution_clock::now ();
+	for (int i = 0; i < NUM_SESSIONS; i++)
+	{
+		receivers[i]->service.post (std::bind (&Session::ReceiveLength, receivers[i]));
+		senders[i]->service.post (std::bind (&Session::SendNextFrame, senders[i]));
+	}
+	{
+		std::unique_lock<std::mutex> l(g_Mutex);
+		g_Done.wait (l, []{ return g_NumCompleted == NUM_SESSIONS; });
+	}
+	auto end = std::chrono::high_resolution_clock::now ();
+	auto duration = std::chrono::duration_cast<std::chrono::microseconds>(end - begin).count ();
+	std::cout << numThreads << " threads: " << g_NumBytes/duration << " MB/s" << std::endl;
+	for (auto& it: senders) it->socket.close ();
+	for (auto& it: receivers) it->socket.close ();
+	pool.Stop ();
+}
+
+int main ()
+{
+	std::cout << std::thread::hardware_concurrency () << " CPUs, " << NUM_SESSIONS << " sessions" << std::endl;
+	for (int n: { 1, 2, 4, 8 })
+		Measure (n);
+}
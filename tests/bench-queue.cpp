@@ -0,0 +1,104 @@
+#include <chrono>
+#include <iostream>
+#include <memory>
+#include <queue>
+#include <thread>
+#include <vector>
+#include <mutex>
+#include <condition_variable>
+
+#include "Queue.h"
+
+// messages per second through a queue with N producers and one consumer
+const int NUM_MESSAGES = 400000; // in total
+
+// previous i2p::util::Queue, mutex and condition variable on every operation
+template<typename Element>
+class MutexQueue
+{
+	public:
+
+		void Put (Element e)
+		{
+			std::unique_lock<std::mutex>  l(m_QueueMutex);
+			m_Queue.push (std::move(e));
+			m_NonEmpty.notify_one ();
+		}
+
+		Element GetNextWithTimeout (int usec)
+		{
+			std::unique_lock<std::mutex> l(m_QueueMutex);
+			auto el = GetNonThreadSafe ();
+			if (!el)
+			{
+				m_NonEmpty.wait_for (l, std::chrono::milliseconds (usec));
+				el = GetNonThreadSafe ();
+			}
+			return el;
+		}
+
+		Element Get ()
+		{
+			std::unique_lock<std::mutex> l(m_QueueMutex);
+			return GetNonThreadSafe ();
+		}
+
+	private:
+
+		Element GetNonThreadSafe ()
+		{
+			if (!m_Queue.empty ())
+			{
+				auto el = m_Queue.front ();
+				m_Queue.pop ();
+				return el;
+			}
+			return nullptr;
+		}
+
+	private:
+
+		std::queue<Element> m_Queue;
+		std::mutex m_QueueMutex;
+		std::condition_variable m_NonEmpty;
+};
+
+template<typename Q>
+void Measure (const char * name, int numProducers)
+{
+	Q queue;
+	auto msg = std::make_shared<int>(0);
+	auto begin = std::chrono::high_resolution_clock::now ();
+	std::vector<std::thread> producers;
+	for (int i = 0; i < numProducers; i++)
+		producers.emplace_back ([&queue, &msg, numProducers]()
+			{
+				for (int j = 0; j < NUM_MESSAGES/numProducers; j++)
+					queue.Put (msg);
+			});
+	// consumer loop as in Tunnels::Run
+	int received = 0, total = (NUM_MESSAGES/numProducers)*numProducers;
+	while (received < total)
+	{
+		auto el = queue.GetNextWithTimeout (1000);
+		while (el)
+		{
+			received++;
+			el = queue.Get ();
+		}
+	}
+	auto end = std::chrono::high_resolution_clock::now ();
+	for (auto& it: producers) it.join ();
+	auto duration = std::chrono::duration_cast<std::chrono::microseconds>(end - begin).count ();
+	std::cout << name << ", " << numProducers << " producers: " << (uint64_t)total*1000000/duration << " msgs/s" << std::endl;
+}
+
+int main ()
+{
+	std::cout << std::thread::hardware_concurrency () << " CPUs" << std::endl;
+	for (int n: { 1, 2, 4, 8 })
+	{
+		Measure<MutexQueue<std::shared_ptr<int> > > ("mutex queue", n);
+		Measure<i2p::util::Queue<std::shared_ptr<int> > > ("lock-free queue", n);
+	}
+}
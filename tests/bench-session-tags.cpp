@@ -0,0 +1,104 @@
+#include <inttypes.h>
+#include <chrono>
+#include <iostream>
+#include <map>
+#include <memory>
+#include <vector>
+
+#include "TagsTable.h"
+
+using namespace i2p::garlic;
+using i2p::data::Tag;
+
+// Incoming session tags of busy destination: batches of tags sharing decryption, every garlic
+// message takes one, cleanup every 3 minutes. std::map with std::shared_ptr per tag (as before) vs TagsTable
+const int NUM_TAGS = 400000;
+const int BATCH_SIZE = 32;
+const uint32_t EXPIRATION_TIMEOUT = 960;
+const uint32_t CLEANUP_INTERVAL = 180;
+
+struct Decryption
+{
+	uint8_t key[32];
+};
+
+struct SessionTag: public Tag<32>
+{
+	SessionTag (const uint8_t * buf, uint32_t ts = 0): Tag<32>(buf), creationTime (ts) {};
+	uint32_t creationTime;
+};
+
+typedef std::chrono::steady_clock Clock;
+
+static double Elapsed (Clock::time_point start) // in microseconds
+{
+	return std::chrono::duration_cast<std::chrono::nanoseconds>(Clock::now () - start).count ()/1000.0;
+}
+
+int main ()
+{
+	std::vector<Tag<32> > tags (NUM_TAGS);
+	for (auto& it: tags) it.Randomize ();
+	std::vector<uint32_t> times (NUM_TAGS/BATCH_SIZE); // spread over expiration timeout
+	for (size_t i = 0; i < times.size (); i++) times[i] = 1600000000 + i*EXPIRATION_TIMEOUT/times.size ();
+	uint32_t cleanupTime = times.back () + CLEANUP_INTERVAL;
+	std::vector<size_t> order (NUM_TAGS);
+	for (int i = 0; i < NUM_TAGS; i++) order[i] = (i*7919ULL) % NUM_TAGS; // 7919 is prime
+
+	// std::map
+	{
+		std::map<SessionTag, std::shared_ptr<Decryption> > m;
+		auto start = Clock::now ();
+		for (int i = 0; i < NUM_TAGS/BATCH_SIZE; i++)
+		{
+			auto d = std::make_shared<Decryption> ();
+			for (int j = 0; j < BATCH_SIZE; j++)
+				m[SessionTag (tags[i*BATCH_SIZE + j], times[i])] = d;
+		}
+		double insert = Elapsed (start)/NUM_TAGS;
+		start = Clock::now ();
+		int numExpired = 0;
+		for (auto it = m.begin (); it != m.end ();)
+			if (cleanupTime > it->first.creationTime + EXPIRATION_TIMEOUT)
+			{
+				numExpired++;
+				it = m.erase (it);
+			}
+			else
+				++it;
+		double cleanup = Elapsed (start);
+		start = Clock::now ();
+		int numFound = 0;
+		for (int i = 0; i < NUM_TAGS; i++)
+		{
+			auto it = m.find (SessionTag (tags[order[i]]));
+			if (it != m.end ())
+			{
+				auto d = it->second;
+				m.erase (it);
+				numFound++;
+			}
+		}
+		double take = Elapsed (start)/NUM_TAGS;
+		std::cout << "std::map: insert " << insert << " us/tag, take " << take << " us/tag, cleanup of " << numExpired
+			<< " expired " << cleanup/1000 << " ms, " << numFound << " found" << std::endl;
+	}
+	// TagsTable
+	{
+		TagsTable<Decryption> table (EXPIRATION_TIMEOUT);
+		auto start = Clock::now ();
+		for (int i = 0; i < NUM_TAGS/BATCH_SIZE; i++)
+			table.Insert (tags[i*BATCH_SIZE], BATCH_SIZE, std::make_shared<Decryption> (), times[i]);
+		double insert = Elapsed (start)/NUM_TAGS;
+		start = Clock::now ();
+		int numExpired = table.Expire (cleanupTime);
+		double cleanup = Elapsed (start);
+		start = Clock::now ();
+		int numFound = 0;
+		for (int i = 0; i < NUM_TAGS; i++)
+			if (table.Take (tags[order[i]])) numFound++;
+		double take = Elapsed (start)/NUM_TAGS;
+		std::cout << "TagsTable: insert " << insert << " us/tag, take " << take << " us/tag, cleanup of " << numExpired
+			<< " expired " << cleanup/1000 << " ms, " << numFound << " found" << std::endl;
+	}
+}
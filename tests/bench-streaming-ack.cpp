@@ -0,0 +1,147 @@
+#include <inttypes.h>
+#include <algorithm>
+#include <chrono>
+#include <iostream>
+#include <set>
+#include <vector>
+
+#include "Gzip.h"
+#include "Streaming.h"
+
+using namespace i2p::stream;
+
+// ACK/NACK walk of Stream::ProcessAck over window of sent packets,
+// std::set ordered by seqn (as before) vs PacketRing.
+// Every ACK confirms next ACK_STEP packets and NACKs every LOSS_INTERVAL-th packet of window
+// until window is done, acknowledged packets are replaced by new ones to keep window full as SendBuffer does
+const int ACK_STEP = 4;
+const int LOSS_INTERVAL = 10;
+const int NUM_ROUNDS = 2000;
+
+struct PacketCmp
+{
+	bool operator() (const Packet * p1, const Packet * p2) const
+	{
+		return p1->GetSeqn () < p2->GetSeqn ();
+	};
+};
+
+static void SetSeqn (Packet * p, uint32_t seqn)
+{
+	htobe32buf (p->buf + 8, seqn);
+}
+
+static void CreateAck (Packet& ack, uint32_t ackThrough, uint32_t first) // NACKs lost since first
+{
+	htobe32buf (ack.buf + 12, ackThrough);
+	int numNacks = 0;
+	for (uint32_t seqn = first; seqn < ackThrough && numNacks < 255; seqn += LOSS_INTERVAL)
+		htobe32buf (ack.buf + 17 + 4*numNacks++, seqn);
+	ack.buf[16] = numNacks;
+}
+
+static size_t ProcessAckSet (std::set<Packet *, PacketCmp>& sentPackets, const Packet& ack, std::vector<Packet *>& freePackets)
+{
+	size_t numAcked = 0;
+	uint32_t ackThrough = ack.GetAckThrough ();
+	int nackCount = ack.GetNACKCount ();
+	for (auto it = sentPackets.begin (); it != sentPackets.end ();)
+	{
+		auto seqn = (*it)->GetSeqn ();
+		if (seqn > ackThrough) break;
+		bool nacked = false;
+		for (int i = 0; i < nackCount; i++)
+			if (seqn == ack.GetNACK (i))
+			{
+				nacked = true;
+				break;
+			}
+		if (nacked)
+		{
+			(*it)->numNacks++;
+			++it;
+			continue;
+		}
+		freePackets.push_back (*it);
+		sentPackets.erase (it++);
+		numAcked++;
+	}
+	return numAcked;
+}
+
+static size_t ProcessAckRing (PacketRing& sentPackets, const Packet& ack, std::vector<Packet *>& freePackets)
+{
+	size_t numAcked = 0;
+	uint32_t ackThrough = ack.GetAckThrough ();
+	int nackCount = ack.GetNACKCount (), nackIndex = 0;
+	uint32_t nacks[256];
+	for (int i = 0; i < nackCount; i++)
+		nacks[i] = ack.GetNACK (i);
+	std::sort (nacks, nacks + nackCount);
+	for (uint32_t seqn = sentPackets.GetNextSeqn (0); seqn <= ackThrough && seqn < sentPackets.GetEndSeqn ();
+		seqn = sentPackets.GetNextSeqn (seqn + 1))
+	{
+		auto sentPacket = sentPackets.Get (seqn);
+		while (nackIndex < nackCount && nacks[nackIndex] < seqn) nackIndex++;
+		if (nackIndex < nackCount && nacks[nackIndex] == seqn)
+		{
+			sentPacket->numNacks++;
+			continue;
+		}
+		freePackets.push_back (sentPacket);
+		sentPackets.Remove (seqn);
+		numAcked++;
+	}
+	return numAcked;
+}
+
+template<typename Insert, typename Process>
+double Measure (int window, Insert insert, Process process)
+{
+	std::vector<Packet> packets (2*window);
+	std::vector<Packet *> freePackets;
+	for (auto& it: packets) freePackets.push_back (&it);
+	Packet ack;
+	uint32_t nextSeqn = 0;
+	size_t numAcks = 0, numAcked = 0;
+	auto begin = std::chrono::high_resolution_clock::now ();
+	for (int r = 0; r < NUM_ROUNDS; r++)
+	{
+		// fill window
+		while ((int)freePackets.size () > window)
+		{
+			auto p = freePackets.back ();
+			freePackets.pop_back ();
+			SetSeqn (p, nextSeqn++);
+			insert (p);
+		}
+		// lost are ACKed at end of window only
+		uint32_t first = nextSeqn - window;
+		for (uint32_t ackThrough = first + ACK_STEP; ackThrough < nextSeqn; ackThrough += ACK_STEP)
+		{
+			CreateAck (ack, ackThrough, first);
+			numAcked += process (ack, freePackets);
+			numAcks++;
+		}
+		CreateAck (ack, nextSeqn - 1, nextSeqn); // nothing NACKed, lost have been resent
+		numAcked += process (ack, freePackets);
+		numAcks++;
+	}
+	auto end = std::chrono::high_resolution_clock::now ();
+	if (numAcked != (size_t)window*NUM_ROUNDS) std::cerr << "not everything acked " << numAcked << std::endl;
+	return std::chrono::duration_cast<std::chrono::nanoseconds>(end - begin).count ()/(double)numAcks;
+}
+
+int main ()
+{
+	for (int window: { 128, 256, 512, 1024 })
+	{
+		std::set<Packet *, PacketCmp> set;
+		auto s = Measure (window, [&set](Packet * p) { set.insert (p); },
+			[&set](const Packet& ack, std::vector<Packet *>& freePackets) { return ProcessAckSet (set, ack, freePackets); });
+		PacketRing ring;
+		auto r = Measure (window, [&ring](Packet * p) { ring.Insert (p); },
+			[&ring](const Packet& ack, std::vector<Packet *>& freePackets) { return ProcessAckRing (ring, ack, freePackets); });
+		std::cout << "window " << window << ": std::set " << (int)s << " ns/ACK, PacketRing " << (int)r << " ns/ACK" << std::endl;
+	}
+}
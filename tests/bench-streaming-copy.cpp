@@ -0,0 +1,115 @@
+#include <cassert>
+#include <inttypes.h>
+#include <string.h>
+#include <chrono>
+#include <iostream>
+#include <vector>
+
+#include "Gzip.h"
+#include "Streaming.h"
+
+using namespace i2p::stream;
+
+// Payload from application's reads to gzipped streaming data message, copy bytes accounting.
+// Before: AsyncSend copied to SendBuffer, SendBuffer to Packet::buf, zlib to I2NP message
+// After: AsyncSend with handler refers to caller's buffer, Send's copy is referred by packet,
+// gathered packet is copied to message by gzip stored block
+const size_t TOTAL_SIZE = 64*1024*1024;
+const size_t HEADER_SIZE = 22; // follow on packet without NACKs and options
+
+struct Counters
+{
+	size_t copied = 0, delivered = 0;
+};
+
+typedef std::vector<std::pair<const uint8_t *, size_t> > Parts;
+
+static size_t Deliver (SendBufferQueue& queue, i2p::data::GzipDeflator& deflator, bool isLegacy, Counters& counters,
+	uint8_t * msg, std::vector<uint8_t> * verify)
+{
+	size_t num = 0;
+	while (!queue.IsEmpty ())
+	{
+		Packet p;
+		memset (p.buf, 0, HEADER_SIZE);
+		p.len = HEADER_SIZE;
+		size_t payloadLen;
+		if (isLegacy)
+		{
+			payloadLen = queue.Get (p.buf + HEADER_SIZE, STREAMING_MTU - HEADER_SIZE);
+			p.len += payloadLen;
+			counters.copied += payloadLen;
+			counters.copied += p.GetLength (); // zlib
+			counters.delivered += payloadLen;
+			num += deflator.Deflate (p.GetBuffer (), p.GetLength (), msg, MAX_PACKET_SIZE*2) > 0;
+		}
+		else
+		{
+			payloadLen = queue.Get (&p, STREAMING_MTU - HEADER_SIZE);
+			counters.copied += p.GetLength () - HEADER_SIZE; // inline part of payload
+			Parts parts{ { p.GetBuffer (), p.GetLength () } };
+			if (p.payloadRefLen) parts.push_back ({ p.payloadRef, p.payloadRefLen });
+			counters.copied += p.GetFullLength (); // stored block
+			counters.delivered += payloadLen;
+			num += deflator.Deflate (parts, msg, MAX_PACKET_SIZE*2) > 0;
+		}
+		if (verify)
+		{
+			uint8_t out[MAX_PACKET_SIZE];
+			i2p::data::GzipInflator inflator;
+			size_t size = inflator.Inflate (msg, MAX_PACKET_SIZE*2, out, sizeof (out));
+			assert (size == HEADER_SIZE + payloadLen);
+			verify->insert (verify->end (), out + HEADER_SIZE, out + size);
+		}
+	}
+	return num;
+}
+
+static void Run (const char * name, size_t chunkSize, bool withHandler, bool isLegacy, bool isVerify)
+{
+	std::vector<uint8_t> data (chunkSize);
+	for (size_t i = 0; i < chunkSize; i++) data[i] = i*31;
+	i2p::data::GzipDeflator deflator;
+	deflator.SetCompressionLevel (Z_NO_COMPRESSION);
+	std::vector<uint8_t> msg (MAX_PACKET_SIZE*2), verify;
+	Counters counters;
+	auto begin = std::chrono::high_resolution_clock::now ();
+	for (size_t sent = 0; sent < TOTAL_SIZE; sent += chunkSize)
+	{
+		SendBufferQueue queue;
+		bool isReleased = false;
+		// legacy copied in SendBuffer in any case
+		if (withHandler && !isLegacy)
+			queue.Add (data.data (), chunkSize, [&isReleased](const boost::system::error_code&) { isReleased = true; });
+		else
+		{
+			queue.Add (data.data (), chunkSize, nullptr);
+			counters.copied += chunkSize;
+			isReleased = true;
+		}
+		Deliver (queue, deflator, isLegacy, counters, msg.data (), isVerify ? &verify : nullptr);
+		assert (isReleased);
+		if (isVerify)
+		{
+			assert (verify == data);
+			break;
+		}
+	}
+	auto end = std::chrono::high_resolution_clock::now ();
+	if (isVerify) return;
+	double s = std::chrono::duration_cast<std::chrono::microseconds>(end - begin).count ()/1000000.0;
+	std::cout << name << ", " << chunkSize << " bytes writes: " << (double)counters.copied/counters.delivered
+		<< " bytes copied per delivered, " << (int)(counters.delivered/s/1024/1024) << " MB/s" << std::endl;
+}
+
+int main ()
+{
+	for (size_t chunkSize: { 8192, 65536 }) // SAM and I2PTunnel reads
+	{
+		Run ("verify", chunkSize, true, false, true);
+		Run ("verify", chunkSize, false, false, true);
+		Run ("before, AsyncSend", chunkSize, true, true, false);
+		Run ("after, AsyncSend", chunkSize, true, false, false);
+		Run ("after, Send", chunkSize, false, false, false);
+	}
+}
@@ -0,0 +1,331 @@
+#include <inttypes.h>
+#include <algorithm>
+#include <deque>
+#include <iostream>
+#include <map>
+#include <random>
+#include <set>
+#include <vector>
+
+#include "StreamingCongestion.h"
+
+using namespace i2p::stream;
+
+// bulk transfer between two local destinations over simulated tunnels:
+// one-way latency, bottleneck rate with drop-tail queue and random loss in both directions.
+// Sender follows Stream (window, pacing, fast retransmit on NACKs, resend timer),
+// receiver acks as Stream does: delayed ACK in order, quick ACK with NACKs out of order
+const int NUM_PACKETS = 3000;
+const size_t PAYLOAD_SIZE = 1700; // per packet
+const int ACK_DELAY = 200; // DEFAULT_INITIAL_ACK_DELAY
+
+struct Link
+{
+	const char * name;
+	int delay; // one way, in milliseconds
+	double rate; // packets per millisecond
+	size_t queueSize; // packets
+	double loss; // probability, in both directions
+};
+
+// window logic which Stream had before StreamingCongestionControl
+class LegacyControl
+{
+	public:
+
+		LegacyControl (): m_Window (MIN_WINDOW_SIZE), m_RTT (INITIAL_RTT), m_RTO (INITIAL_RTO), m_LastIncreaseTime (0) {};
+
+		void UpdateRTT (int) {};
+		void OnPacketAcked (uint64_t ts, uint32_t seqn, int rtt)
+		{
+			m_RTT = (m_RTT*seqn + rtt)/(seqn + 1);
+			m_RTO = m_RTT*1.5;
+			if (m_Window < WINDOW_SIZE)
+				m_Window++;
+			else if (ts > m_LastIncreaseTime + m_RTT)
+			{
+				m_Window++;
+				if (m_Window > MAX_WINDOW_SIZE) m_Window = MAX_WINDOW_SIZE;
+				m_LastIncreaseTime = ts;
+			}
+		}
+		void OnTimeout (int numResendAttempts)
+		{
+			m_RTO *= 2;
+			if (numResendAttempts == 1)
+			{
+				m_Window /= 2;
+				if (m_Window < MIN_WINDOW_SIZE) m_Window = MIN_WINDOW_SIZE;
+			}
+		}
+		void ResetRTO () { m_RTO = INITIAL_RTO; };
+		int GetWindowSize () const { return m_Window; };
+		int GetRTO () const { return m_RTO; };
+
+	private:
+
+		int m_Window, m_RTT, m_RTO;
+		uint64_t m_LastIncreaseTime;
+};
+
+struct SentPacket
+{
+	uint64_t sendTime;
+	int numResends, numNacks;
+};
+
+struct Ack
+{
+	uint32_t ackThrough;
+	std::vector<uint32_t> nacks;
+};
+
+struct Result
+{
+	uint64_t duration;
+	uint64_t numSent, numFastRetransmits, numTimeouts;
+	int maxWindow;
+};
+
+class Simulation
+{
+	public:
+
+		Simulation (const Link& link): m_Link (link), m_Rnd (1), m_Uniform (0, 1), m_Served (0),
+			m_LastReceived (-1), m_AckTime (0) {};
+
+		Result Run (int type); // -1 for legacy
+
+	private:
+
+		void Send (uint32_t seqn)
+		{
+			if (m_Uniform (m_Rnd) >= m_Link.loss && m_Bottleneck.size () < m_Link.queueSize)
+				m_Bottleneck.push_back (seqn);
+		}
+		void Transmit (uint64_t ts); // through bottleneck and latency to receiver
+		void Receive (uint64_t ts, uint32_t seqn);
+		void SendAck (uint64_t ts);
+
+		template<typename Control>
+		Result Run (Control& cc, bool isLegacy);
+
+	private:
+
+		Link m_Link;
+		std::mt19937 m_Rnd;
+		std::uniform_real_distribution<double> m_Uniform;
+		std::deque<uint32_t> m_Bottleneck;
+		double m_Served;
+		std::deque<std::pair<uint64_t, uint32_t> > m_Data; // arrival time, seqn
+		std::deque<std::pair<uint64_t, Ack> > m_Acks; // arrival time, ACK
+		// receiver
+		int32_t m_LastReceived;
+		std::set<uint32_t> m_Saved;
+		uint64_t m_AckTime; // delayed ACK, 0 if not scheduled
+};
+
+void Simulation::Transmit (uint64_t ts)
+{
+	m_Served += m_Link.rate;
+	while (m_Served >= 1 && !m_Bottleneck.empty ())
+	{
+		m_Data.push_back (std::make_pair (ts + m_Link.delay, m_Bottleneck.front ()));
+		m_Bottleneck.pop_front ();
+		m_Served -= 1;
+	}
+	if (m_Bottleneck.empty () && m_Served > 1) m_Served = 1;
+	while (!m_Data.empty () && m_Data.front ().first <= ts)
+	{
+		Receive (ts, m_Data.front ().second);
+		m_Data.pop_front ();
+	}
+	if (m_AckTime && ts >= m_AckTime)
+		SendAck (ts);
+}
+
+void Simulation::Receive (uint64_t ts, uint32_t seqn)
+{
+	if ((int32_t)seqn == m_LastReceived + 1)
+	{
+		m_LastReceived++;
+		while (!m_Saved.empty () && *m_Saved.begin () == (uint32_t)m_LastReceived + 1)
+		{
+			m_LastReceived++;
+			m_Saved.erase (m_Saved.begin ());
+		}
+		if (!m_AckTime) m_AckTime = ts + ACK_DELAY;
+	}
+	else if ((int32_t)seqn <= m_LastReceived)
+		SendAck (ts); // duplicate
+	else
+	{
+		m_Saved.insert (seqn);
+		SendAck (ts); // NACKs ASAP
+	}
+}
+
+void Simulation::SendAck (uint64_t ts)
+{
+	m_AckTime = 0;
+	if (m_LastReceived < 0) return;
+	Ack ack;
+	ack.ackThrough = m_Saved.empty () ? m_LastReceived : *m_Saved.rbegin ();
+	for (uint32_t i = m_LastReceived + 1; i < ack.ackThrough && ack.nacks.size () < 255; i++)
+		if (!m_Saved.count (i)) ack.nacks.push_back (i);
+	if (m_Uniform (m_Rnd) >= m_Link.loss)
+		m_Acks.push_back (std::make_pair (ts + m_Link.delay, ack));
+}
+
+template<typename Control>
+Result Simulation::Run (Control& cc, bool isLegacy)
+{
+	Result res = { 0, 0, 0, 0, 0 };
+	std::map<uint32_t, SentPacket> sent;
+	uint32_t nextSeqn = 0;
+	uint64_t resendTime = 0; // 0 if not scheduled
+	int numResendAttempts = 0;
+	uint64_t ts = 1000;
+	for (; nextSeqn < NUM_PACKETS || !sent.empty (); ts++)
+	{
+		if (ts > 3600000)
+		{
+			std::cerr << "transfer didn't complete" << std::endl;
+			break;
+		}
+		Transmit (ts);
+		// Stream::ProcessAck
+		while (!m_Acks.empty () && m_Acks.front ().first <= ts)
+		{
+			const Ack& ack = m_Acks.front ().second;
+			bool acknowledged = false;
+			int rtt = -1;
+			std::vector<uint32_t> resend;
+			for (auto it = sent.begin (); it != sent.end () && it->first <= ack.ackThrough;)
+			{
+				auto& p = it->second;
+				if (std::find (ack.nacks.begin (), ack.nacks.end (), it->first) != ack.nacks.end ())
+				{
+					if (!isLegacy)
+					{
+						if (!p.numResends || ts >= p.sendTime + cc.GetRTT ())
+							p.numNacks++;
+						if (p.numNacks >= FAST_RETRANSMIT_NACK_THRESHOLD)
+						{
+							cc.OnPacketLost (it->first, nextSeqn);
+							p.sendTime = ts; p.numResends++; p.numNacks = 0;
+							resend.push_back (it->first);
+						}
+					}
+					++it;
+					continue;
+				}
+				if (!p.numResends) rtt = ts - p.sendTime;
+				cc.OnPacketAcked (ts, it->first, ts - p.sendTime);
+				it = sent.erase (it);
+				acknowledged = true;
+			}
+			if (rtt >= 0) cc.UpdateRTT (rtt);
+			for (auto seqn: resend)
+			{
+				Send (seqn);
+				res.numSent++;
+				res.numFastRetransmits++;
+			}
+			if (sent.empty ()) resendTime = 0;
+			if (acknowledged) numResendAttempts = 0;
+			m_Acks.pop_front ();
+		}
+		// Stream::HandleResendTimer
+		if (resendTime && ts >= resendTime)
+		{
+			std::vector<uint32_t> resend;
+			for (auto& it: sent)
+				if (ts >= it.second.sendTime + cc.GetRTO ())
+				{
+					it.second.sendTime = ts; it.second.numResends++; it.second.numNacks = 0;
+					resend.push_back (it.first);
+				}
+			if (!resend.empty ())
+			{
+				numResendAttempts++;
+				if (isLegacy)
+					cc.OnTimeout (numResendAttempts);
+				else
+					cc.OnTimeout (nextSeqn);
+				if (numResendAttempts == 2) cc.ResetRTO ();
+				res.numTimeouts++;
+				for (auto seqn: resend)
+				{
+					Send (seqn);
+					res.numSent++;
+				}
+			}
+			resendTime = ts + cc.GetRTO ();
+		}
+		// Stream::SendBuffer
+		while (nextSeqn < NUM_PACKETS && (int)sent.size () < cc.GetWindowSize ())
+		{
+			if (!isLegacy && cc.GetPacingDelay (ts) > 0) break;
+			if (sent.empty ()) resendTime = ts + cc.GetRTO ();
+			sent[nextSeqn] = SentPacket{ ts, 0, 0 };
+			Send (nextSeqn++);
+			cc.OnPacketSent ();
+			res.numSent++;
+		}
+		if (cc.GetWindowSize () > res.maxWindow) res.maxWindow = cc.GetWindowSize ();
+	}
+	res.duration = ts - 1000;
+	return res;
+}
+
+// adapters to drive both with the same code
+struct Legacy: public LegacyControl
+{
+	void OnPacketAcked (uint64_t ts, uint32_t seqn, int rtt) { LegacyControl::OnPacketAcked (ts, seqn, rtt); };
+	void OnPacketLost (uint32_t, uint32_t) {};
+	void OnPacketSent () {};
+	int GetPacingDelay (uint64_t) { return 0; };
+	int GetRTT () const { return 0; };
+};
+
+struct Controller: public StreamingCongestionControl
+{
+	Controller (StreamingCongestionControlType type): StreamingCongestionControl (type, ACK_DELAY) {};
+	void OnPacketAcked (uint64_t ts, uint32_t seqn, int) { StreamingCongestionControl::OnPacketAcked (ts, seqn); };
+};
+
+Result Simulation::Run (int type)
+{
+	if (type < 0)
+	{
+		Legacy cc;
+		return Run (cc, true);
+	}
+	Controller cc ((StreamingCongestionControlType)type);
+	return Run (cc, false);
+}
+
+int main ()
+{
+	const Link links[] =
+	{
+		{ "clean", 250, 0.1, 64, 0 }, // 170 KB/s, 500 ms RTT
+		{ "lossy 1%", 250, 0.1, 64, 0.01 },
+		{ "lossy 3%", 250, 0.1, 64, 0.03 },
+		{ "long 2s RTT", 1000, 0.1, 64, 0.01 },
+		{ "short queue", 250, 0.2, 8, 0.005 }
+	};
+	const char * names[] = { "legacy", "reno", "cubic" };
+	std::cout << NUM_PACKETS << " packets of " << PAYLOAD_SIZE << " bytes" << std::endl;
+	for (const auto& link: links)
+		for (int type: { -1, (int)eStreamingCongestionControlReno, (int)eStreamingCongestionControlCubic })
+		{
+			Simulation sim (link);
+			auto r = sim.Run (type);
+			std::cout << link.name << ", " << names[type + 1] << ": " << r.duration << " ms, "
+				<< NUM_PACKETS*PAYLOAD_SIZE/r.duration << " KB/s, max window " << r.maxWindow
+				<< ", sent " << r.numSent << ", fast retransmits " << r.numFastRetransmits
+				<< ", timeouts " << r.numTimeouts << std::endl;
+		}
+}
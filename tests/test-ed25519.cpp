@@ -0,0 +1,199 @@
+#include <cassert>
+#include <inttypes.h>
+#include <string.h>
+#include <memory>
+
+#include <openssl/bn.h>
+#include <openssl/rand.h>
+#include <openssl/sha.h>
+
+#include "Ed25519.h"
+#include "Signature.h"
+
+// RFC 8032 7.1, TEST 1, TEST 2 and TEST 3
+const uint8_t priv[3][32] =
+{
+	{
+		0x9d, 0x61, 0xb1, 0x9d, 0xef, 0xfd, 0x5a, 0x60, 0xba, 0x84, 0x4a, 0xf4, 0x92, 0xec, 0x2c, 0xc4,
+		0x44, 0x49, 0xc5, 0x69, 0x7b, 0x32, 0x69, 0x19, 0x70, 0x3b, 0xac, 0x03, 0x1c, 0xae, 0x7f, 0x60
+	},
+	{
+		0x4c, 0xcd, 0x08, 0x9b, 0x28, 0xff, 0x96, 0xda, 0x9d, 0xb6, 0xc3, 0x46, 0xec, 0x11, 0x4e, 0x0f,
+		0x5b, 0x8a, 0x31, 0x9f, 0x35, 0xab, 0xa6, 0x24, 0xda, 0x8c, 0xf6, 0xed, 0x4f, 0xb8, 0xa6, 0xfb
+	},
+	{
+		0xc5, 0xaa, 0x8d, 0xf4, 0x3f, 0x9f, 0x83, 0x7b, 0xed, 0xb7, 0x44, 0x2f, 0x31, 0xdc, 0xb7, 0xb1,
+		0x66, 0xd3, 0x85, 0x35, 0x07, 0x6f, 0x09, 0x4b, 0x85, 0xce, 0x3a, 0x2e, 0x0b, 0x44, 0x58, 0xf7
+	}
+};
+
+const uint8_t pub[3][32] =
+{
+	{
+		0xd7, 0x5a, 0x98, 0x01, 0x82, 0xb1, 0x0a, 0xb7, 0xd5, 0x4b, 0xfe, 0xd3, 0xc9, 0x64, 0x07, 0x3a,
+		0x0e, 0xe1, 0x72, 0xf3, 0xda, 0xa6, 0x23, 0x25, 0xaf, 0x02, 0x1a, 0x68, 0xf7, 0x07, 0x51, 0x1a
+	},
+	{
+		0x3d, 0x40, 0x17, 0xc3, 0xe8, 0x43, 0x89, 0x5a, 0x92, 0xb7, 0x0a, 0xa7, 0x4d, 0x1b, 0x7e, 0xbc,
+		0x9c, 0x98, 0x2c, 0xcf, 0x2e, 0xc4, 0x96, 0x8c, 0xc0, 0xcd, 0x55, 0xf1, 0x2a, 0xf4, 0x66, 0x0c
+	},
+	{
+		0xfc, 0x51, 0xcd, 0x8e, 0x62, 0x18, 0xa1, 0xa3, 0x8d, 0xa4, 0x7e, 0xd0, 0x02, 0x30, 0xf0, 0x58,
+		0x08, 0x16, 0xed, 0x13, 0xba, 0x33, 0x03, 0xac, 0x5d, 0xeb, 0x91, 0x15, 0x48, 0x90, 0x80, 0x25
+	}
+};
+
+const uint8_t msg[3][2] = { { 0 }, { 0x72 }, { 0xaf, 0x82 } };
+
+const uint8_t sig[3][64] =
+{
+	{
+		0xe5, 0x56, 0x43, 0x00, 0xc3, 0x60, 0xac, 0x72, 0x90, 0x86, 0xe2, 0xcc, 0x80, 0x6e, 0x82, 0x8a,
+		0x84, 0x87, 0x7f, 0x1e, 0xb8, 0xe5, 0xd9, 0x74, 0xd8, 0x73, 0xe0, 0x65, 0x22, 0x49, 0x01, 0x55,
+		0x5f, 0xb8, 0x82, 0x15, 0x90, 0xa3, 0x3b, 0xac, 0xc6, 0x1e, 0x39, 0x70, 0x1c, 0xf9, 0xb4, 0x6b,
+		0xd2, 0x5b, 0xf5, 0xf0, 0x59, 0x5b, 0xbe, 0x24, 0x65, 0x51, 0x41, 0x43, 0x8e, 0x7a, 0x10, 0x0b
+	},
+	{
+		0x92, 0xa0, 0x09, 0xa9, 0xf0, 0xd4, 0xca, 0xb8, 0x72, 0x0e, 0x82, 0x0b, 0x5f, 0x64, 0x25, 0x40,
+		0xa2, 0xb2, 0x7b, 0x54, 0x16, 0x50, 0x3f, 0x8f, 0xb3, 0x76, 0x22, 0x23, 0xeb, 0xdb, 0x69, 0xda,
+		0x08, 0x5a, 0xc1, 0xe4, 0x3e, 0x15, 0x99, 0x6e, 0x45, 0x8f, 0x36, 0x13, 0xd0, 0xf1, 0x1d, 0x8c,
+		0x38, 0x7b, 0x2e, 0xae, 0xb4, 0x30, 0x2a, 0xee, 0xb0, 0x0d, 0x29, 0x16, 0x12, 0xbb, 0x0c, 0x00
+	},
+	{
+		0x62, 0x91, 0xd6, 0x57, 0xde, 0xec, 0x24, 0x02, 0x48, 0x27, 0xe6, 0x9c, 0x3a, 0xbe, 0x01, 0xa3,
+		0x0c, 0xe5, 0x48, 0xa2, 0x84, 0x74, 0x3a, 0x44, 0x5e, 0x36, 0x80, 0xd7, 0xdb, 0x5a, 0xc3, 0xac,
+		0x18, 0xff, 0x9b, 0x53, 0x8d, 0x16, 0xf2, 0x90, 0xae, 0x67, 0xf7, 0x60, 0x98, 0x4d, 0xc6, 0x59,
+		0x4a, 0x7c, 0x15, 0xe9, 0x71, 0x6e, 0xd2, 0x8d, 0xc0, 0x27, 0xbe, 0xce, 0xea, 0x1e, 0xc4, 0x0a
+	}
+};
+
+// r = p + T, T = (0,-1) of order 2, (x, y) + T = (-x, -y)
+static void AddOrder2 (const uint8_t * p, uint8_t * r)
+{
+	int borrow = 0;
+	for (int i = 0; i < 32; i++)
+	{
+		int d = (i ? 0xFF : 0xED) - (p[i] & (i < 31 ? 0xFF : 0x7F)) - borrow;
+		borrow = d < 0; r[i] = d & 0xFF;
+	}
+	r[31] = (r[31] & 0x7F) | (~p[31] & 0x80);
+}
+
+static BIGNUM * FromLE (const uint8_t * buf, size_t len)
+{
+	uint8_t be[64];
+	for (size_t i = 0; i < len; i++) be[i] = buf[len - 1 - i];
+	return BN_bin2bn (be, len, nullptr);
+}
+
+// R = r*B + T, S = r + h*a with h of R or of R without T
+static void SignWithTorsion (const uint8_t * expanded, const uint8_t * pub, const uint8_t * m, bool hOfR, uint8_t * signature)
+{
+	BN_CTX * ctx = BN_CTX_new ();
+	BIGNUM * l = BN_new ();
+	BN_hex2bn (&l, "1000000000000000000000000000000014def9dea2f79cd65812631a5cf5d3ed");
+	uint8_t r[32], R[32], digest[64];
+	RAND_bytes (r, 32); r[31] &= 0x0F; // < l
+	uint8_t e[64]; memcpy (e, r, 32); memset (e + 32, 0, 32);
+	auto& ed = i2p::crypto::GetEd25519 ();
+	ed->EncodePublicKey (ed->GeneratePublicKey (e), R);
+	AddOrder2 (R, signature);
+	SHA512_CTX c;
+	SHA512_Init (&c);
+	SHA512_Update (&c, hOfR ? signature : R, 32);
+	SHA512_Update (&c, pub, 32);
+	SHA512_Update (&c, m, 1);
+	SHA512_Final (digest, &c);
+	BIGNUM * h = FromLE (digest, 64), * a = FromLE (expanded, 32), * s = FromLE (r, 32);
+	BN_mod_mul (h, h, a, l, ctx);
+	BN_mod_add (s, s, h, l, ctx);
+	uint8_t be[32];
+	BN_bn2binpad (s, be, 32);
+	for (int i = 0; i < 32; i++) signature[32 + i] = be[31 - i];
+	BN_free (h); BN_free (a); BN_free (s); BN_free (l);
+	BN_CTX_free (ctx);
+}
+
+int main ()
+{
+	uint8_t signature[64];
+	for (int i = 0; i < 3; i++)
+	{
+		i2p::crypto::EDDSA25519Signer signer (priv[i], pub[i]);
+		signer.Sign (msg[i], i, signature);
+		assert (memcmp (signature, sig[i], 64) == 0);
+		i2p::crypto::EDDSA25519Verifier verifier (pub[i]);
+		assert (verifier.Verify (msg[i], i, signature));
+		signature[i] ^= 0x01;
+		assert (!verifier.Verify (msg[i], i, signature));
+	}
+
+	// batch of 8 with one invalid signature
+	std::unique_ptr<i2p::crypto::EDDSA25519Verifier> verifiers[3];
+	for (int i = 0; i < 3; i++)
+		verifiers[i].reset (new i2p::crypto::EDDSA25519Verifier (pub[i]));
+	i2p::crypto::EDDSAVerification verifications[8];
+	for (int i = 0; i < 8; i++)
+	{
+		memcpy (signature, sig[i % 3], 64);
+		if (i == 5) signature[40] ^= 0x01;
+		verifiers[i % 3]->CreateVerification (msg[i % 3], i % 3, signature, verifications[i]);
+	}
+	i2p::crypto::GetEd25519 ()->VerifyBatch (verifications, 8);
+	for (int i = 0; i < 8; i++)
+		assert (verifications[i].result == (i != 5));
+
+	// small order components of R and public key, cofactored Verify accepts them and batch
+	// must give the same result for every signature, also when components of several cancel
+	const int numCrafted = 6;
+	uint8_t crafted[numCrafted][64], m[numCrafted];
+	std::unique_ptr<i2p::crypto::EDDSA25519Verifier> craftedVerifiers[numCrafted];
+	uint8_t expanded[64], pubT[32];
+	i2p::crypto::Ed25519::ExpandPrivateKey (priv[0], expanded);
+	AddOrder2 (pub[0], pubT); // A + T
+	for (int i = 0; i < numCrafted; i++)
+	{
+		m[i] = i;
+		switch (i)
+		{
+			case 0: case 1: // R + T, valid S
+				SignWithTorsion (expanded, pub[0], m + i, true, crafted[i]);
+				craftedVerifiers[i].reset (new i2p::crypto::EDDSA25519Verifier (pub[0]));
+			break;
+			case 2: // A + T, signed as usual
+				i2p::crypto::GetEd25519 ()->Sign (expanded, pubT, m + i, 1, crafted[i]);
+				craftedVerifiers[i].reset (new i2p::crypto::EDDSA25519Verifier (pubT));
+			break;
+			case 3: // R + T, S of R without T
+				SignWithTorsion (expanded, pub[0], m + i, false, crafted[i]);
+				craftedVerifiers[i].reset (new i2p::crypto::EDDSA25519Verifier (pub[0]));
+			break;
+			default: // R + T with invalid S
+				SignWithTorsion (expanded, pub[0], m + i, true, crafted[i]);
+				crafted[i][40] ^= 0x01;
+				craftedVerifiers[i].reset (new i2p::crypto::EDDSA25519Verifier (pub[0]));
+		}
+	}
+	bool expected[numCrafted];
+	for (int i = 0; i < numCrafted; i++)
+		expected[i] = craftedVerifiers[i]->Verify (m + i, 1, crafted[i]);
+	assert (expected[0] && expected[1] && expected[2]); // cofactored
+	assert (!expected[4] && !expected[5]);
+	for (int k = 0; k < 100; k++) // random coefficients
+	{
+		// pairs of crafted mixed with 4 valid
+		int a = k % numCrafted, b = (k/numCrafted + a + 1) % numCrafted;
+		for (int i = 0; i < 6; i++)
+		{
+			if (i == 1)
+				craftedVerifiers[a]->CreateVerification (m + a, 1, crafted[a], verifications[i]);
+			else if (i == 4)
+				craftedVerifiers[b]->CreateVerification (m + b, 1, crafted[b], verifications[i]);
+			else
+				verifiers[i % 3]->CreateVerification (msg[i % 3], i % 3, sig[i % 3], verifications[i]);
+		}
+		i2p::crypto::GetEd25519 ()->VerifyBatch (verifications, 6);
+		for (int i = 0; i < 6; i++)
+			assert (verifications[i].result == (i == 1 ? expected[a] : (i == 4 ? expected[b] : true)));
+	}
+}
@@ -0,0 +1,51 @@
+#include <cassert>
+#include <inttypes.h>
+#include <string.h>
+#include <iostream>
+#include <vector>
+
+#include "Gzip.h"
+
+using namespace i2p::data;
+
+static void RoundTrip (GzipDeflator& deflator, const std::vector<std::pair<const uint8_t *, size_t> >& in)
+{
+	std::vector<uint8_t> expected;
+	for (const auto& it: in) expected.insert (expected.end (), it.first, it.first + it.second);
+	std::vector<uint8_t> out (expected.size () + 1024), inflated (expected.size () + 1);
+	size_t len = deflator.Deflate (in, out.data (), out.size ());
+	assert (len);
+	GzipInflator inflator;
+	assert (inflator.Inflate (out.data (), len, inflated.data (), inflated.size ()) == expected.size ());
+	assert (!memcmp (inflated.data (), expected.data (), expected.size ()));
+	// same as from one buffer
+	if (!expected.empty ())
+	{
+		std::vector<uint8_t> out1 (out.size ());
+		size_t len1 = deflator.Deflate (expected.data (), expected.size (), out1.data (), out1.size ());
+		assert (len1);
+		assert (inflator.Inflate (out1.data (), len1, inflated.data (), inflated.size ()) == expected.size ());
+		assert (!memcmp (inflated.data (), expected.data (), expected.size ()));
+	}
+}
+
+int main ()
+{
+	std::vector<uint8_t> data (200000);
+	for (size_t i = 0; i < data.size (); i++) data[i] = (i*7 + i/13) & 0xFF;
+	GzipDeflator deflator;
+	for (int level: { Z_NO_COMPRESSION, Z_DEFAULT_COMPRESSION })
+	{
+		deflator.SetCompressionLevel (level);
+		RoundTrip (deflator, {});
+		RoundTrip (deflator, { { data.data (), 0 } });
+		RoundTrip (deflator, { { data.data (), 22 } });
+		RoundTrip (deflator, { { data.data (), 22 }, { data.data () + 100, 1708 } }); // streaming packet
+		RoundTrip (deflator, { { data.data (), 10 }, { data.data () + 10, 0 }, { data.data () + 10, 5 } });
+		RoundTrip (deflator, { { data.data (), 65535 }, { data.data () + 70000, 65536 }, { data.data () + 1, 3 } }); // several stored blocks
+	}
+	// doesn't fit
+	deflator.SetCompressionLevel (Z_NO_COMPRESSION);
+	uint8_t out[100];
+	assert (!deflator.Deflate ({ { data.data (), 100 } }, out, sizeof (out)));
+}
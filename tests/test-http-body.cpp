@@ -0,0 +1,54 @@
+#include <cassert>
+#include <string>
+#include "HTTP.h"
+
+using namespace i2p::http;
+
+static size_t Consume (HTTPBodyTracker& body, const std::string& data)
+{
+	return body.Consume ((const uint8_t *)data.c_str (), data.length ());
+}
+
+int main ()
+{
+	HTTPBodyTracker body;
+	assert (body.IsComplete ());
+
+	// Content-Length, next response follows
+	body.SetLength (10);
+	assert (!body.IsComplete ());
+	assert (Consume (body, "01234") == 5);
+	assert (!body.IsComplete ());
+	assert (Consume (body, "56789HTTP/1.1 200 OK") == 5);
+	assert (body.IsComplete ());
+	body.SetLength (0);
+	assert (body.IsComplete ());
+
+	// chunked, byte by byte
+	const std::string chunked = "4\r\nHTTP\r\nA;ext=1\r\n response \r\n0\r\n\r\n";
+	body.SetChunked ();
+	for (size_t i = 0; i < chunked.length (); i++)
+	{
+		assert (!body.IsComplete ());
+		assert (Consume (body, chunked.substr (i, 1)) == 1);
+	}
+	assert (body.IsComplete ());
+
+	// chunked at once with trailer and data after it
+	body.SetChunked ();
+	assert (Consume (body, "1a\r\nabcdefghijklmnopqrstuvwxyz\r\n0\r\nExpires: 0\r\n\r\nnext") == 49);
+	assert (body.IsComplete ());
+
+	// malformed chunk size, end is not known
+	body.SetChunked ();
+	assert (Consume (body, "xyz\r\n") == 5);
+	assert (body.IsUntilClose () && !body.IsComplete ());
+	body.SetChunked ();
+	assert (Consume (body, "4\r\nHTTPxx") == 9);
+	assert (body.IsUntilClose ());
+
+	// until close
+	body.SetUntilClose ();
+	assert (Consume (body, "anything") == 8);
+	assert (!body.IsComplete ());
+}
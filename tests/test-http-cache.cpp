@@ -0,0 +1,116 @@
+#include <cassert>
+#include <string>
+#include "HTTPCache.h"
+
+using namespace i2p::http;
+
+static HTTPRes Parse (const std::string& header)
+{
+	HTTPRes res;
+	assert (res.parse (header) == (int)header.length ());
+	return res;
+}
+
+static HTTPReq Get (const std::string& uri, const std::string& headers = "")
+{
+	HTTPReq req;
+	std::string s = "GET " + uri + " HTTP/1.1\r\nHost: site.i2p\r\nAccept-Encoding: gzip\r\n" + headers + "\r\n";
+	assert (req.parse (s) > 0);
+	return req;
+}
+
+int main ()
+{
+	const uint64_t ts = 1500000000;
+	assert (ParseHTTPDate ("Thu, 01 Jan 1970 00:00:00 GMT") == 0);
+	assert (ParseHTTPDate ("Sun, 06 Nov 1994 08:49:37 GMT") == 784111777);
+	assert (ParseHTTPDate ("Fri, 14 Jul 2017 02:40:00 GMT") == 1500000000);
+	assert (ParseHTTPDate ("Sunday, 06-Nov-94 08:49:37 GMT") < 0);
+	assert (ParseHTTPDate ("0") < 0);
+
+	HTTPCache cache (1000);
+	auto key = HTTPCache::GetKey ("site.i2p", 80, Get ("/a.css"));
+	assert (!key.empty ());
+	assert (HTTPCache::GetKey ("site.i2p", 80, Get ("/a.css", "Range: bytes=0-10\r\n")).empty ());
+	assert (HTTPCache::GetKey ("site.i2p", 80, Get ("/a.css", "If-None-Match: \"x\"\r\n")).empty ());
+	assert (HTTPCache::GetKey ("site.i2p", 80, Get ("/a.css", "Cookie: session=1\r\n")).empty ()); // other user's
+	assert (HTTPCache::IsRevalidationRequested (Get ("/a.css", "Cache-Control: max-age=0\r\n")));
+	assert (HTTPCache::IsRevalidationRequested (Get ("/a.css", "Pragma: no-cache\r\n")));
+	assert (!HTTPCache::IsRevalidationRequested (Get ("/a.css")));
+
+	// max-age
+	std::string header = "HTTP/1.1 200 OK\r\nCache-Control: public, max-age=60\r\nETag: \"v1\"\r\nContent-Length: 4\r\n\r\n";
+	auto res = Parse (header);
+	assert (cache.IsStorable (res, header.length () + 4));
+	cache.Insert (key, res, header, "body", ts);
+	auto entry = cache.Lookup (key);
+	assert (entry && entry->body == "body" && entry->etag == "\"v1\"");
+	assert (entry->IsFresh (ts + 59) && !entry->IsFresh (ts + 60));
+	assert (entry->GetHeader (ts + 10).find ("Age: 10\r\n\r\n") != std::string::npos);
+
+	// conditional revalidation with 304 which extends freshness
+	HTTPReq req = Get ("/a.css");
+	HTTPCache::AddConditionalHeaders (req, *entry);
+	assert (req.GetHeader ("If-None-Match") == "\"v1\"");
+	auto updated = cache.Revalidate (key, entry, Parse ("HTTP/1.1 304 Not Modified\r\nCache-Control: max-age=120\r\n\r\n"), ts + 100);
+	assert (updated && updated->body == "body");
+	assert (updated->IsFresh (ts + 200) && !updated->IsFresh (ts + 220));
+	assert (updated->header.find ("max-age=120") != std::string::npos && updated->header.find ("max-age=60") == std::string::npos);
+	assert (cache.GetNumRevalidated () == 1);
+
+	// Expires and heuristic from Last-Modified
+	entry = nullptr;
+	res = Parse ("HTTP/1.1 200 OK\r\nDate: Fri, 14 Jul 2017 02:40:00 GMT\r\nExpires: Fri, 14 Jul 2017 03:40:00 GMT\r\n\r\n");
+	assert (cache.IsStorable (res, 100));
+	cache.Insert ("e", res, "HTTP/1.1 200 OK\r\n\r\n", "", ts);
+	assert (cache.Lookup ("e")->lifetime == 3600);
+	res = Parse ("HTTP/1.1 200 OK\r\nDate: Fri, 14 Jul 2017 02:40:00 GMT\r\nLast-Modified: Fri, 14 Jul 2017 00:00:00 GMT\r\n\r\n");
+	cache.Insert ("h", res, "HTTP/1.1 200 OK\r\n\r\n", "", ts);
+	assert (cache.Lookup ("h")->lifetime == 960);
+
+	// not storable
+	assert (!cache.IsStorable (Parse ("HTTP/1.1 200 OK\r\nCache-Control: no-store\r\n\r\n"), 10));
+	assert (!cache.IsStorable (Parse ("HTTP/1.1 200 OK\r\nCache-Control: private, max-age=60\r\n\r\n"), 10));
+	assert (!cache.IsStorable (Parse ("HTTP/1.1 200 OK\r\nCache-Control: max-age=60\r\nSet-Cookie: a=b\r\n\r\n"), 10));
+	assert (!cache.IsStorable (Parse ("HTTP/1.1 200 OK\r\nCache-Control: max-age=60\r\nVary: User-Agent\r\n\r\n"), 10));
+	assert (cache.IsStorable (Parse ("HTTP/1.1 200 OK\r\nCache-Control: max-age=60\r\nVary: Accept-Encoding\r\n\r\n"), 10));
+	assert (!cache.IsStorable (Parse ("HTTP/1.1 200 OK\r\n\r\n"), 10)); // can't be fresh or revalidated
+	assert (!cache.IsStorable (Parse ("HTTP/1.1 500 Internal Server Error\r\nCache-Control: max-age=60\r\n\r\n"), 10));
+	assert (!cache.IsStorable (Parse ("HTTP/1.1 200 OK\r\nCache-Control: max-age=60\r\n\r\n"), 251)); // quarter of cache
+	// no-cache is stored to be revalidated each time
+	res = Parse ("HTTP/1.1 200 OK\r\nCache-Control: no-cache\r\nETag: \"v2\"\r\n\r\n");
+	assert (cache.IsStorable (res, 10));
+	cache.Insert ("n", res, "HTTP/1.1 200 OK\r\n\r\n", "", ts);
+	assert (!cache.Lookup ("n")->IsFresh (ts));
+
+	// LRU eviction by size
+	HTTPCache small (1000);
+	res = Parse ("HTTP/1.1 200 OK\r\nCache-Control: max-age=60\r\n\r\n");
+	std::string body (200 - 19, 'x'); // 200 bytes with header
+	for (int i = 0; i < 5; i++)
+		small.Insert (std::to_string (i), res, "HTTP/1.1 200 OK\r\n\r\n", body, ts);
+	assert (small.GetNumEntries () == 5 && small.GetSize () == 1000);
+	assert (small.Lookup ("0")); // becomes most recent
+	small.Insert ("5", res, "HTTP/1.1 200 OK\r\n\r\n", body, ts);
+	assert (small.GetNumEntries () == 5 && small.GetSize () == 1000);
+	assert (small.Lookup ("0") && !small.Lookup ("1") && small.Lookup ("2"));
+	small.Insert ("big", res, "HTTP/1.1 200 OK\r\n\r\n", std::string (300, 'x'), ts);
+	assert (!small.Lookup ("big"));
+
+	// invalidated by POST
+	small.Insert (HTTPCache::GetKey ("site.i2p", 80, Get ("/form")), res, "HTTP/1.1 200 OK\r\n\r\n", "", ts);
+	assert (small.Lookup (HTTPCache::GetKey ("site.i2p", 80, Get ("/form"))));
+	HTTPReq post;
+	assert (post.parse ("POST /form HTTP/1.1\r\nHost: site.i2p\r\nAccept-Encoding: gzip\r\nCookie: session=1\r\n\r\n") > 0);
+	small.Invalidate ("site.i2p", 80, post);
+	assert (!small.Lookup (HTTPCache::GetKey ("site.i2p", 80, Get ("/form"))));
+
+	// evicted while being revalidated, held entry is served and stored again
+	auto held = small.Lookup ("2");
+	for (int i = 6; i < 12; i++)
+		small.Insert (std::to_string (i), res, "HTTP/1.1 200 OK\r\n\r\n", body, ts);
+	assert (held && !small.Lookup ("2"));
+	updated = small.Revalidate ("2", held, Parse ("HTTP/1.1 304 Not Modified\r\nCache-Control: max-age=120\r\n\r\n"), ts + 100);
+	assert (updated && updated->body == body && updated->IsFresh (ts + 200));
+	assert (small.Lookup ("2") == updated);
+}
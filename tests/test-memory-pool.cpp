@@ -0,0 +1,45 @@
+#include <cassert>
+#include <inttypes.h>
+#include <iostream>
+#include <memory>
+#include <vector>
+
+#include "Gzip.h"
+#include "Streaming.h"
+
+using namespace i2p::stream;
+
+int main ()
+{
+	const uint8_t data[1024] = { 0 };
+	auto buffer = std::make_shared<SendBuffer>(data, sizeof (data), nullptr);
+	{
+		i2p::util::MemoryPool<Packet> pool;
+		std::vector<Packet *> packets;
+		for (int i = 0; i < 8; i++)
+		{
+			auto p = pool.Acquire ();
+			p->payloadBuffer = buffer;
+			p->payloadRef = buffer->GetRemaningBuffer () + i*128;
+			p->payloadRefLen = 128;
+			packets.push_back (p);
+		}
+		assert (buffer.use_count () == 9);
+		// released packets drop their reference at once
+		for (int i = 0; i < 4; i++)
+			pool.Release (packets[i]);
+		assert (buffer.use_count () == 5);
+		// reused from the pool, constructed again
+		for (int i = 0; i < 4; i++)
+		{
+			auto p = pool.Acquire ();
+			assert (!p->payloadBuffer && !p->payloadRef && !p->payloadRefLen);
+			packets[i] = p;
+		}
+		for (auto p: packets)
+			pool.Release (p);
+		assert (buffer.use_count () == 1);
+	} // pool frees its storage without destroying released packets again
+	assert (buffer.use_count () == 1);
+	return 0;
+}
@@ -0,0 +1,104 @@
+#include <cassert>
+#include <stdio.h>
+#include <string.h>
+#include <unistd.h>
+#include <fstream>
+#include <vector>
+
+#include "NetDbSnapshot.h"
+
+using namespace i2p::data;
+
+int main ()
+{
+	char tmpl[] = "/tmp/test-netdb-snapshot-XXXXXX";
+	int fd = mkstemp (tmpl);
+	assert (fd >= 0);
+	close (fd);
+	std::string path (tmpl);
+
+	NetDbSnapshot snapshot;
+	unlink (tmpl);
+	assert (!snapshot.Open (path)); // missing
+
+	std::vector<std::vector<uint8_t> > buffers;
+	std::vector<NetDbSnapshotRecord> records;
+	for (int i = 0; i < 100; i++)
+	{
+		buffers.emplace_back (400 + i*7);
+		for (size_t j = 0; j < buffers.back ().size (); j++) buffers.back ()[j] = i + j;
+	}
+	for (int i = 0; i < 100; i++)
+	{
+		NetDbSnapshotRecord record;
+		record.ident.Randomize ();
+		record.timestamp = 1600000000000ULL + i;
+		record.flags = (i & 1) ? eNetDbSnapshotVerified : (eNetDbSnapshotVerified | eNetDbSnapshotUpdated);
+		record.buf = buffers[i].data ();
+		record.len = buffers[i].size ();
+		records.push_back (record);
+	}
+	auto invalid = records[0];
+	invalid.ident.Randomize ();
+	invalid.len = NETDB_SNAPSHOT_MAX_BUFFER_SIZE + 1; // skipped
+	records.push_back (invalid);
+	records.push_back (records[5]); // duplicate
+	assert (NetDbSnapshot::Save (path, records, 1600000100, false));
+	records.resize (100);
+
+	assert (snapshot.Open (path));
+	assert (snapshot.IsOpen ());
+	assert (snapshot.GetCreationTime () == 1600000100 && !snapshot.IsClean ());
+	assert (snapshot.GetRecords ().size () == 100);
+	for (int i = 0; i < 100; i++)
+	{
+		auto r = snapshot.Find (records[i].ident);
+		assert (r);
+		assert (r->timestamp == records[i].timestamp && r->flags == records[i].flags);
+		assert (r->len == records[i].len && !memcmp (r->buf, records[i].buf, r->len));
+	}
+	assert (!snapshot.Find (invalid.ident));
+
+	// new snapshot from records of opened one, as for routers without buffer
+	std::vector<NetDbSnapshotRecord> saved = snapshot.GetRecords ();
+	assert (NetDbSnapshot::Save (path, saved, 1600000200, true));
+	assert (snapshot.Open (path));
+	assert (snapshot.GetCreationTime () == 1600000200 && snapshot.GetRecords ().size () == 100);
+	assert (snapshot.IsClean ());
+	assert (!memcmp (snapshot.Find (records[7].ident)->buf, buffers[7].data (), buffers[7].size ()));
+
+	// truncated
+	std::vector<char> data;
+	{
+		std::ifstream f (path, std::ifstream::binary);
+		data.assign (std::istreambuf_iterator<char> (f), std::istreambuf_iterator<char> ());
+	}
+	{
+		std::ofstream f (path, std::ofstream::binary | std::ofstream::trunc);
+		f.write (data.data (), data.size () - 10);
+	}
+	assert (!snapshot.Open (path) && !snapshot.IsOpen ());
+	// wrong version
+	data[11] = 99;
+	{
+		std::ofstream f (path, std::ofstream::binary | std::ofstream::trunc);
+		f.write (data.data (), data.size ());
+	}
+	assert (!snapshot.Open (path));
+	// garbage at end
+	data[11] = NETDB_SNAPSHOT_VERSION;
+	data.push_back (0);
+	{
+		std::ofstream f (path, std::ofstream::binary | std::ofstream::trunc);
+		f.write (data.data (), data.size ());
+	}
+	assert (!snapshot.Open (path));
+	data.pop_back ();
+	{
+		std::ofstream f (path, std::ofstream::binary | std::ofstream::trunc);
+		f.write (data.data (), data.size ());
+	}
+	assert (snapshot.Open (path));
+	snapshot.Close ();
+	unlink (path.c_str ());
+}
@@ -0,0 +1,130 @@
+#include <cassert>
+#include <inttypes.h>
+#include <iostream>
+#include <map>
+#include <vector>
+
+#include "Gzip.h"
+#include "Streaming.h"
+
+using namespace i2p::stream;
+
+static Packet * CreatePacket (uint32_t seqn)
+{
+	auto p = new Packet;
+	htobe32buf (p->buf + 8, seqn);
+	return p;
+}
+
+// ring must have the same packets as the model in the same order
+static void Check (const PacketRing& ring, const std::map<uint32_t, Packet *>& model)
+{
+	assert (ring.GetSize () == model.size ());
+	assert (ring.IsEmpty () == model.empty ());
+	if (model.empty ()) return;
+	assert (ring.GetFirstSeqn () == model.begin ()->first);
+	assert (ring.GetEndSeqn () == model.rbegin ()->first + 1);
+	auto it = model.begin ();
+	ring.ForEach ([&it](Packet * p)
+		{
+			assert (p == it->second);
+			it++;
+		});
+	assert (it == model.end ());
+	// next kept from every position, including empty slots
+	for (uint32_t seqn = ring.GetFirstSeqn () - 1; seqn <= ring.GetEndSeqn (); seqn++)
+	{
+		auto next = model.lower_bound (seqn);
+		assert (ring.GetNextSeqn (seqn) == (next != model.end () ? next->first : ring.GetEndSeqn ()));
+		assert (ring.Get (seqn) == (model.count (seqn) ? model.at (seqn) : nullptr));
+	}
+}
+
+int main ()
+{
+	PacketRing ring;
+	std::map<uint32_t, Packet *> model;
+	assert (ring.IsEmpty () && !ring.Get (0) && !ring.Remove (0));
+
+	// insert out of order, duplicates are rejected
+	for (uint32_t seqn: { 5, 3, 9, 4, 12 })
+	{
+		auto p = CreatePacket (seqn);
+		assert (ring.Insert (p));
+		model[seqn] = p;
+	}
+	auto dup = CreatePacket (9);
+	assert (!ring.Insert (dup));
+	delete dup;
+	Check (ring, model);
+
+	// remove from middle, first and last
+	for (uint32_t seqn: { 9, 3, 12 })
+	{
+		assert (ring.Remove (seqn) == model[seqn]);
+		delete model[seqn]; model.erase (seqn);
+		assert (!ring.Remove (seqn));
+		Check (ring, model);
+	}
+
+	// sparse packets across several 64 bits words of bitmap, GetNextSeqn skips empty words
+	for (uint32_t seqn = 100; seqn < 1000; seqn += 97)
+	{
+		auto p = CreatePacket (seqn);
+		assert (ring.Insert (p));
+		model[seqn] = p;
+	}
+	Check (ring, model);
+
+	// grows up to MAX_PACKET_RING_SIZE range, no further
+	uint32_t last = ring.GetFirstSeqn () + MAX_PACKET_RING_SIZE - 1;
+	assert (ring.CanInsert (last) && !ring.CanInsert (last + 1));
+	auto p = CreatePacket (last);
+	assert (ring.Insert (p));
+	model[last] = p;
+	auto tooFar = CreatePacket (last + 1);
+	assert (!ring.CanInsert (last + 1) && !ring.Insert (tooFar));
+	Check (ring, model);
+
+	for (auto& it: model) { assert (ring.Remove (it.first) == it.second); delete it.second; }
+	model.clear ();
+	Check (ring, model);
+
+	// window slides, ring is less than twice of range and its slots wrap around many times
+	PacketRing window;
+	uint32_t next = 0xFFFF0000; // far from zero
+	for (int i = 0; i < 200; i++)
+	{
+		auto p = CreatePacket (next);
+		assert (window.Insert (p));
+		model[next++] = p;
+	}
+	for (int round = 0; round < 200; round++)
+	{
+		// acknowledge 30 oldest, every 7th later to leave gaps, send 30 new
+		int num = 0;
+		for (auto it = model.begin (); it != model.end () && num < 30;)
+		{
+			if (it->first % 7 || next - it->first > 300)
+			{
+				assert (window.Remove (it->first) == it->second);
+				delete it->second;
+				it = model.erase (it);
+				num++;
+			}
+			else
+				it++;
+		}
+		for (int i = 0; i < 30 && next - model.begin ()->first < MAX_PACKET_RING_SIZE; i++)
+		{
+			auto p = CreatePacket (next);
+			assert (window.Insert (p));
+			model[next++] = p;
+		}
+		Check (window, model);
+	}
+	assert (next - 0xFFFF0000 > 8*(window.GetEndSeqn () - window.GetFirstSeqn ()));
+	delete tooFar;
+	for (auto& it: model) delete it.second;
+	return 0;
+}
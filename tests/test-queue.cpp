@@ -0,0 +1,83 @@
+#include <cassert>
+#include <atomic>
+#include <chrono>
+#include <memory>
+#include <thread>
+#include <vector>
+
+#include "Queue.h"
+
+const int NUM_PRODUCERS = 4;
+const int NUM_ELEMENTS = 20000; // per producer, much more than capacity
+
+struct Element
+{
+	int producer, seqn;
+};
+
+int main ()
+{
+	// single thread, overflow keeps order
+	i2p::util::Queue<std::shared_ptr<int>, 8> small;
+	assert (small.IsEmpty ());
+	assert (!small.Get ());
+	for (int i = 0; i < 20; i++) small.Put (std::make_shared<int>(i));
+	assert (small.GetSize () == 20);
+	assert (*small.Peek () == 0);
+	for (int i = 0; i < 5; i++) assert (*small.Get () == i);
+	std::vector<std::shared_ptr<int> > batch;
+	assert (small.Get (batch, 10) == 10);
+	for (int i = 0; i < 10; i++) assert (*batch[i] == i + 5);
+	small.Put (batch); // goes after the rest
+	for (int i = 15; i < 20; i++) assert (*small.Get () == i);
+	for (int i = 5; i < 15; i++) assert (*small.GetNext () == i);
+	assert (small.IsEmpty ());
+	assert (!small.GetNextWithTimeout (10));
+
+	// state set by other thread before WakeUp is never missed, as decrypted build requests
+	std::atomic<bool> ready (false);
+	for (int i = 0; i < 1000; i++)
+	{
+		std::thread waker ([&small, &ready]()
+			{
+				ready = true;
+				small.WakeUp ();
+			});
+		auto start = std::chrono::steady_clock::now ();
+		while (!ready)
+			assert (!small.GetNextWithTimeout (5000, [&ready](void) { return ready.load (); }));
+		assert (std::chrono::steady_clock::now () - start < std::chrono::seconds (1));
+		waker.join ();
+		ready = false;
+	}
+
+	// multiple producers, order per producer is preserved
+	i2p::util::Queue<std::shared_ptr<Element>, 256> queue;
+	std::vector<std::thread> producers;
+	for (int p = 0; p < NUM_PRODUCERS; p++)
+		producers.emplace_back ([&queue, p]()
+			{
+				for (int i = 0; i < NUM_ELEMENTS; i++)
+					queue.Put (std::make_shared<Element>(Element{p, i}));
+			});
+	int next[NUM_PRODUCERS] = {0};
+	int total = 0;
+	std::vector<std::shared_ptr<Element> > elements;
+	while (total < NUM_PRODUCERS*NUM_ELEMENTS)
+	{
+		auto el = queue.GetNextWithTimeout (1000);
+		assert (el);
+		elements.clear ();
+		elements.push_back (el);
+		queue.Get (elements, 64);
+		for (auto& it: elements)
+		{
+			assert (it->seqn == next[it->producer]);
+			next[it->producer]++; total++;
+		}
+	}
+	for (auto& it: producers) it.join ();
+	assert (queue.IsEmpty ());
+
+	return 0;
+}
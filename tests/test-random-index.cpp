@@ -0,0 +1,62 @@
+#include <cassert>
+#include <map>
+#include <memory>
+#include <vector>
+
+#include "RandomIndex.h"
+
+using namespace i2p::data;
+
+struct Router
+{
+	int id;
+	bool hb;
+};
+
+int main ()
+{
+	RandomIndex<Router> index;
+	assert (index.IsEmpty ());
+	assert (!index.GetRandom ([](std::shared_ptr<Router>) { return true; }));
+
+	std::vector<std::shared_ptr<Router> > routers;
+	for (int i = 0; i < 100; i++)
+	{
+		routers.push_back (std::make_shared<Router> (Router{ i, i % 10 == 0 }));
+		assert (index.Insert (routers.back ()));
+	}
+	assert (!index.Insert (routers[5])); // already there
+	assert (index.GetSize () == 100);
+
+	// erase from middle, last one takes its place
+	assert (index.Erase (routers[5].get ()));
+	assert (!index.Erase (routers[5].get ()));
+	assert (index.Erase (routers[99].get ()));
+	assert (index.GetSize () == 98);
+	assert (!index.Contains (routers[5].get ()) && index.Contains (routers[98].get ()));
+	for (int i = 0; i < 1000; i++)
+	{
+		auto r = index.GetRandom ([](std::shared_ptr<Router>) { return true; });
+		assert (r && r->id != 5 && r->id != 99);
+	}
+
+	// every one is picked
+	std::map<int, int> picked;
+	for (int i = 0; i < 20000; i++)
+		picked[index.GetRandom ([](std::shared_ptr<Router>) { return true; })->id]++;
+	assert (picked.size () == 98);
+	for (auto& it: picked)
+		assert (it.second > 50 && it.second < 500); // about 204 each
+
+	// filter passed by few
+	for (int i = 0; i < 100; i++)
+	{
+		auto r = index.GetRandom ([](std::shared_ptr<Router> r) { return r->id == 42; });
+		assert (r && r->id == 42);
+	}
+	assert (!index.GetRandom ([](std::shared_ptr<Router> r) { return r->id == 5; }));
+
+	index.Clear ();
+	assert (index.IsEmpty () && !index.Contains (routers[0].get ()));
+	assert (index.Insert (routers[0]));
+}
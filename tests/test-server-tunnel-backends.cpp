@@ -0,0 +1,96 @@
+#include <cassert>
+#include <inttypes.h>
+#include <memory>
+#include <vector>
+#include <thread>
+#include <chrono>
+#include <boost/asio.hpp>
+
+#include "Timestamp.h"
+#include "Identity.h"
+#include "Destination.h"
+#include "I2PTunnel.h"
+
+using namespace i2p::client;
+
+// local backend, connections complete in listen queue
+static std::shared_ptr<boost::asio::ip::tcp::acceptor> CreateBackend (boost::asio::io_service& service)
+{
+	auto acceptor = std::make_shared<boost::asio::ip::tcp::acceptor> (service,
+		boost::asio::ip::tcp::endpoint (boost::asio::ip::address_v4::loopback (), 0));
+	acceptor->listen ();
+	return acceptor;
+}
+
+template<typename Condition>
+static bool RunUntil (boost::asio::io_service& service, Condition cond)
+{
+	auto ts = i2p::util::GetMillisecondsSinceEpoch ();
+	while (!cond ())
+	{
+		if (i2p::util::GetMillisecondsSinceEpoch () > ts + 5000) return false;
+		service.poll ();
+		service.reset ();
+		std::this_thread::sleep_for (std::chrono::milliseconds (10));
+	}
+	return true;
+}
+
+int main ()
+{
+	auto keys = i2p::data::PrivateKeys::CreateRandomKeys (i2p::data::SIGNING_KEY_TYPE_EDDSA_SHA512_ED25519);
+	auto destination = std::make_shared<ClientDestination> (keys, false);
+	auto& service = destination->GetService ();
+	auto up1 = CreateBackend (service), up2 = CreateBackend (service), down = CreateBackend (service);
+	int port1 = up1->local_endpoint ().port (), port2 = up2->local_endpoint ().port (),
+		port3 = down->local_endpoint ().port ();
+	down->close (); // refused from now on
+
+	I2PServerTunnel tunnel ("test", "127.0.0.1", port1, destination);
+	tunnel.AddBackend ("127.0.0.1", port2);
+	tunnel.AddBackend ("127.0.0.1", port3);
+	tunnel.SetUniqueLocal (false);
+	tunnel.SetHealthCheckInterval (1);
+	tunnel.Start ();
+	auto& backends = tunnel.GetBackends ();
+	assert (backends.size () == 3);
+
+	// round robin over all until health check
+	tunnel.SetBalancing (eI2PServerTunnelBalancingRoundRobin);
+	for (int i = 0; i < 6; i++)
+		assert (tunnel.SelectBackend () == backends[i % 3]);
+
+	// least connections, equal ones in turn
+	tunnel.SetBalancing (eI2PServerTunnelBalancingLeastConnections);
+	backends[0]->numConnections = 2; backends[1]->numConnections = 0; backends[2]->numConnections = 1;
+	for (int i = 0; i < 3; i++)
+		assert (tunnel.SelectBackend () == backends[1]);
+	backends[1]->numConnections = 2;
+	assert (tunnel.SelectBackend () == backends[2]);
+	backends[2]->numConnections = 2;
+	std::vector<int> selected (3, 0);
+	for (int i = 0; i < 6; i++)
+	{
+		auto backend = tunnel.SelectBackend ();
+		selected[backend == backends[0] ? 0 : (backend == backends[1] ? 1 : 2)]++;
+	}
+	assert (selected[0] == 2 && selected[1] == 2 && selected[2] == 2);
+
+	// down backend is skipped once health check finds it
+	assert (RunUntil (service, [&backends]() { return !backends[2]->isUp; }));
+	assert (backends[0]->isUp && backends[1]->isUp && backends[2]->numFailures > 0);
+	backends[0]->numConnections = 5;
+	assert (tunnel.SelectBackend () == backends[1]);
+	tunnel.SetBalancing (eI2PServerTunnelBalancingRoundRobin);
+	for (int i = 0; i < 6; i++)
+		assert (tunnel.SelectBackend () != backends[2]);
+
+	// pre-connecting finished after stop is not counted anymore
+	tunnel.SetNumPreconnected (1);
+	tunnel.Stop ();
+	tunnel.Start ();
+	assert (backends[0]->numConnecting == 1);
+	tunnel.Stop ();
+	assert (RunUntil (service, [&backends]() { return !backends[0]->numConnecting; }));
+	return 0;
+}
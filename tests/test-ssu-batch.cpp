@@ -0,0 +1,90 @@
+#include <cassert>
+#include <string.h>
+#include <unistd.h>
+#include <atomic>
+#include <vector>
+#include <boost/asio.hpp>
+
+#include "SSUBatch.h"
+
+using i2p::transport::SSUPacket;
+
+const size_t NUM_PACKETS = 100; // more than one batch
+
+// sends packets by batches as SSUServer does, returns number of them sent
+static size_t Send (int fd, std::vector<SSUPacket *>& packets, std::atomic<bool>& gso)
+{
+	size_t numSent = 0;
+	while (numSent < packets.size ())
+	{
+		size_t num = std::min (packets.size () - numSent, (size_t)i2p::transport::SSU_MAX_BATCH_SIZE);
+		size_t n = i2p::transport::SendDatagrams (fd, packets.data () + numSent, num, gso);
+		numSent += n;
+		if (n < num) break;
+	}
+	return numSent;
+}
+
+// receives exactly num datagrams and checks they are packets in order
+static void Receive (int fd, const std::vector<SSUPacket *>& packets, const boost::asio::ip::udp::endpoint& from)
+{
+	std::vector<SSUPacket *> received;
+	for (size_t i = 0; i < packets.size (); i++) received.push_back (new SSUPacket);
+	size_t num = 0;
+	for (int i = 0; i < 1000 && num < packets.size (); i++)
+	{
+		size_t r = i2p::transport::ReceiveDatagrams (fd, received.data () + num, packets.size () - num, i2p::transport::SSU_MTU_V4);
+		assert (r <= (size_t)i2p::transport::SSU_MAX_BATCH_SIZE);
+		num += r;
+		if (!r) usleep (1000);
+	}
+	assert (num == packets.size ());
+	for (size_t i = 0; i < num; i++)
+	{
+		assert (received[i]->len == packets[i]->len);
+		assert (!memcmp (received[i]->buf, packets[i]->buf, packets[i]->len));
+		assert (received[i]->from == from);
+		delete received[i];
+	}
+}
+
+int main ()
+{
+	boost::asio::io_service service;
+	boost::asio::ip::udp::socket sender (service, boost::asio::ip::udp::endpoint (boost::asio::ip::address_v4::loopback (), 0));
+	boost::asio::ip::udp::socket receiver (service, boost::asio::ip::udp::endpoint (boost::asio::ip::address_v4::loopback (), 0));
+	sender.non_blocking (true);
+	receiver.set_option (boost::asio::socket_base::receive_buffer_size (0x3FFFF));
+	auto to = receiver.local_endpoint ();
+
+	// nothing to read, doesn't block
+	SSUPacket packet;
+	SSUPacket * p = &packet;
+	assert (!i2p::transport::ReceiveDatagrams (receiver.native_handle (), &p, 1, i2p::transport::SSU_MTU_V4));
+
+	// runs of same size make GSO messages, shorter one ends a run
+	std::vector<SSUPacket *> packets;
+	for (size_t i = 0; i < NUM_PACKETS; i++)
+	{
+		auto packet = new SSUPacket;
+		packet->len = (i % 10 == 9) ? 100 + i : 1000 + (i/10)*20;
+		for (size_t j = 0; j < packet->len; j++) packet->buf[j] = i + j;
+		packet->from = to;
+		packets.push_back (packet);
+	}
+	for (int gso = 0; gso < 2; gso++)
+	{
+		std::atomic<bool> isGSO (gso); // might be reset if not supported
+		assert (Send (sender.native_handle (), packets, isGSO) == NUM_PACKETS);
+		Receive (receiver.native_handle (), packets, sender.local_endpoint ());
+	}
+
+	// closed socket, packets are dropped rather than retried
+	std::atomic<bool> isGSO (false);
+	int fd = sender.native_handle ();
+	sender.close ();
+	assert (i2p::transport::SendDatagrams (fd, packets.data (), 10, isGSO) == 10);
+
+	for (auto it: packets) delete it;
+	return 0;
+}
@@ -0,0 +1,177 @@
+#include <cassert>
+#include <deque>
+#include <iostream>
+#include <random>
+#include <vector>
+
+#include "SSUCongestion.h"
+
+using i2p::transport::SSUCongestionControl;
+
+// simulated link: one-way delay, bottleneck rate with drop-tail queue, random loss and blackout period.
+// Sender drives SSUCongestionControl as SSUData does: every packet ACKed separately like with ACK bitfields
+struct Link
+{
+	int delay; // one way, in milliseconds
+	double rate; // packets per millisecond
+	size_t queueSize; // packets
+	double loss; // probability
+	uint64_t blackoutStart, blackoutEnd; // everything is lost
+};
+
+struct Result
+{
+	uint64_t duration;
+	int maxWindow, rtt, maxRTO;
+	uint64_t numRetransmits, numLost, numTimeouts;
+};
+
+struct Packet
+{
+	uint64_t sendTime = 0, resendTime = 0;
+	uint32_t packetNum = 0;
+	int numSends = 0;
+	bool isAcked = false, isQueued = false;
+};
+
+Result Simulate (const Link& link, int numPackets)
+{
+	SSUCongestionControl cc;
+	std::vector<Packet> packets (numPackets);
+	std::deque<int> resendQueue, bottleneck;
+	std::deque<std::pair<uint64_t, int> > acks; // arrival time, packet
+	std::mt19937 rnd (1);
+	std::uniform_real_distribution<double> uniform (0, 1);
+	int nextNew = 0, numAcked = 0;
+	double served = 0;
+	Result res = { 0, 0, 0, 0, 0, 0, 0 };
+	uint64_t ts = 1000;
+	for (; numAcked < numPackets; ts++)
+	{
+		assert (ts < 1000000); // must complete
+		// ACKs
+		bool isAcked = false;
+		while (!acks.empty () && acks.front ().first <= ts)
+		{
+			auto& p = packets[acks.front ().second];
+			if (!p.isAcked)
+			{
+				cc.OnPacketAcked (ts, p.packetNum, p.sendTime, p.numSends > 1);
+				p.isAcked = true;
+				numAcked++;
+				isAcked = true;
+			}
+			acks.pop_front ();
+		}
+		if (isAcked)
+			for (int i = 0; i < nextNew; i++)
+			{
+				auto& p = packets[i];
+				if (!p.isAcked && !p.isQueued && cc.IsLost (ts, p.packetNum, p.sendTime))
+				{
+					cc.OnPacketLost (p.packetNum);
+					p.isQueued = true;
+					resendQueue.push_back (i);
+				}
+			}
+		// retransmission timeout
+		for (int i = 0; i < nextNew; i++)
+		{
+			auto& p = packets[i];
+			if (!p.isAcked && !p.isQueued && ts >= p.resendTime)
+			{
+				cc.OnTimeout (p.packetNum);
+				p.isQueued = true;
+				resendQueue.push_back (i);
+			}
+		}
+		// send
+		while (!resendQueue.empty () || nextNew < numPackets)
+		{
+			bool isResend = !resendQueue.empty ();
+			if (!isResend && cc.IsWindowFull ()) break;
+			if (cc.GetPacingDelay (ts) > 0) break;
+			int i;
+			if (isResend)
+			{
+				i = resendQueue.front ();
+				resendQueue.pop_front ();
+				if (packets[i].isAcked) continue;
+			}
+			else
+				i = nextNew++;
+			auto& p = packets[i];
+			p.isQueued = false;
+			p.packetNum = cc.OnPacketSent (p.numSends > 0);
+			p.sendTime = ts;
+			p.resendTime = ts + cc.GetRTO ();
+			p.numSends++;
+			bool isBlackout = ts >= link.blackoutStart && ts < link.blackoutEnd;
+			if (!isBlackout && uniform (rnd) >= link.loss && bottleneck.size () < link.queueSize)
+				bottleneck.push_back (i);
+		}
+		if (cc.GetWindowSize () > res.maxWindow) res.maxWindow = cc.GetWindowSize ();
+		if (cc.GetRTO () > res.maxRTO) res.maxRTO = cc.GetRTO ();
+		// bottleneck
+		served += link.rate;
+		while (served >= 1 && !bottleneck.empty ())
+		{
+			acks.push_back (std::make_pair (ts + 2*link.delay, bottleneck.front ()));
+			bottleneck.pop_front ();
+			served -= 1;
+		}
+		if (bottleneck.empty () && served > 1) served = 1;
+	}
+	assert (!cc.GetNumInFlight ());
+	res.duration = ts - 1000;
+	res.rtt = cc.GetRTT ();
+	res.numRetransmits = cc.GetNumRetransmits ();
+	res.numLost = cc.GetNumLost ();
+	res.numTimeouts = cc.GetNumTimeouts ();
+	return res;
+}
+
+void Print (const char * name, const Result& r, int numPackets)
+{
+	std::cout << name << ": " << r.duration << " ms, " << numPackets*1000/r.duration << " packets/s, max window "
+		<< r.maxWindow << ", rtt " << r.rtt << ", max rto " << r.maxRTO << ", resent " << r.numRetransmits
+		<< ", lost " << r.numLost << ", timeouts " << r.numTimeouts << std::endl;
+}
+
+int main ()
+{
+	const int NUM_PACKETS = 5000;
+
+	// clean fast link, ramps up beyond initial window and fills the pipe, no retransmissions
+	Link fast = { 50, 1.0, 1000, 0, 0, 0 };
+	auto r = Simulate (fast, NUM_PACKETS);
+	Print ("fast", r, NUM_PACKETS);
+	assert (r.maxWindow >= 100); // bandwidth-delay product
+	assert (r.rtt >= 2*fast.delay && r.rtt < 2*fast.delay + i2p::transport::SSU_MAX_WINDOW/fast.rate); // queue is long enough for whole window
+	assert (!r.numRetransmits && !r.numTimeouts);
+	assert (r.duration < NUM_PACKETS/fast.rate*1.3);
+
+	// slow link with short queue, window is cut on drops and queue doesn't stay full
+	Link slow = { 50, 0.2, 10, 0, 0, 0 };
+	r = Simulate (slow, NUM_PACKETS);
+	Print ("slow", r, NUM_PACKETS);
+	assert (r.numLost > 0);
+	assert (r.maxWindow < 100); // BDP is 20 + 10 queued
+	assert (r.duration < NUM_PACKETS/slow.rate*1.5);
+	assert (r.numRetransmits < NUM_PACKETS/10);
+
+	// lossy peer, everything is delivered without flooding
+	Link lossy = { 50, 1.0, 1000, 0.05, 0, 0 };
+	r = Simulate (lossy, NUM_PACKETS);
+	Print ("lossy", r, NUM_PACKETS);
+	assert (r.numLost > 0);
+	assert (r.numRetransmits < NUM_PACKETS/10);
+
+	// peer disappears for 5 seconds, RTO backs off
+	Link blackout = { 50, 1.0, 1000, 0, 2000, 7000 };
+	r = Simulate (blackout, NUM_PACKETS);
+	Print ("blackout", r, NUM_PACKETS);
+	assert (r.numTimeouts >= 2);
+	assert (r.maxRTO >= 1000);
+	assert (r.numRetransmits < NUM_PACKETS/4);
+}
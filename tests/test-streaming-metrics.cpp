@@ -0,0 +1,68 @@
+#include <cassert>
+
+#include "StreamingCongestion.h"
+
+using namespace i2p::stream;
+
+int main ()
+{
+	const int ACK_DELAY = 200;
+	const uint64_t ts = 1000000;
+	StreamingMetricsCache<int> cache;
+
+	// nothing learned yet
+	StreamingCongestionControl cc (eStreamingCongestionControlCubic, ACK_DELAY);
+	cache.Save (1, cc, ts);
+	assert (!cache.GetNumMetrics ());
+
+	// stream to remote 1 grows window and measures RTT
+	for (int i = 0; i < 20; i++)
+	{
+		cc.UpdateRTT (500);
+		cc.OnPacketAcked (ts, i);
+	}
+	assert (cc.GetWindowSize () == MIN_WINDOW_SIZE + 20);
+	cache.Save (1, cc, ts);
+	assert (cache.GetNumMetrics () == 1);
+
+	// new stream to remote 1 starts from it
+	StreamingCongestionControl cc1 (eStreamingCongestionControlCubic, ACK_DELAY);
+	assert (cache.Load (1, cc1, ts + 1000));
+	assert (cc1.IsRTTMeasured ());
+	assert (cc1.GetRTT () == 500);
+	assert (cc1.GetRTO () < INITIAL_RTO && cc1.GetRTO () >= 500 + ACK_DELAY);
+	assert (cc1.GetWindowSize () == (MIN_WINDOW_SIZE + 20)/2);
+	cc1.SetRTT (8000); // from routing path, ignored
+	assert (cc1.GetRTT () == 500);
+	// doesn't override own measurements
+	assert (!cache.Load (1, cc1, ts + 1000));
+
+	// other remote is not known
+	StreamingCongestionControl cc2 (eStreamingCongestionControlCubic, ACK_DELAY);
+	assert (!cache.Load (2, cc2, ts));
+	assert (cc2.GetRTT () == INITIAL_RTT && cc2.GetWindowSize () == MIN_WINDOW_SIZE);
+
+	// small window is not seeded below initial
+	StreamingCongestionControl cc3 (eStreamingCongestionControlReno, ACK_DELAY);
+	cc3.UpdateRTT (300);
+	cc3.OnTimeout (10);
+	cache.Save (3, cc3, ts);
+	StreamingCongestionControl cc4 (eStreamingCongestionControlReno, ACK_DELAY);
+	assert (cache.Load (3, cc4, ts));
+	assert (cc4.GetWindowSize () == MIN_WINDOW_SIZE);
+	assert (cc4.GetSlowStartThreshold () == cc3.GetSlowStartThreshold ());
+
+	// expired
+	StreamingCongestionControl cc5 (eStreamingCongestionControlCubic, ACK_DELAY);
+	assert (!cache.Load (1, cc5, ts + STREAMING_METRICS_EXPIRATION_TIMEOUT*1000LL + 1));
+	assert (!cc5.IsRTTMeasured ());
+	assert (cache.GetNumMetrics () == 1); // removed
+
+	// size bound, oldest goes first
+	for (size_t i = 0; i < MAX_NUM_STREAMING_METRICS + 10; i++)
+		cache.Save (100 + i, cc, ts + i);
+	assert (cache.GetNumMetrics () == MAX_NUM_STREAMING_METRICS);
+	StreamingCongestionControl cc6 (eStreamingCongestionControlCubic, ACK_DELAY);
+	assert (!cache.Load (100, cc6, ts + 1000));
+	assert (cache.Load (100 + MAX_NUM_STREAMING_METRICS + 9, cc6, ts + 1000));
+}
@@ -0,0 +1,129 @@
+#include <cassert>
+#include <stdlib.h>
+#include <map>
+#include <memory>
+#include <vector>
+
+#include "TagsTable.h"
+
+using namespace i2p::garlic;
+using i2p::data::Tag;
+
+const uint32_t EXPIRATION_TIMEOUT = 960;
+
+struct Decryption
+{
+	int id;
+};
+
+int main ()
+{
+	uint32_t ts = 1600000000;
+	TagsTable<Decryption> table (EXPIRATION_TIMEOUT);
+
+	// batch shares object
+	std::vector<Tag<32> > batch (32);
+	for (auto& it: batch) it.Randomize ();
+	batch[1] = batch[0]; batch[1][31] ^= 1; // same prefix
+	auto d1 = std::make_shared<Decryption> (Decryption{ 1 });
+	table.Insert (batch[0], 32, d1, ts);
+	assert (table.GetSize () == 32);
+	assert (table.GetNumObjects () == 1);
+	assert (d1.use_count () == 2);
+	assert (table.Take (batch[1]) == d1);
+	assert (!table.Take (batch[1])); // once
+	assert (table.Take (batch[0]) == d1);
+	Tag<32> unknown; unknown.Randomize ();
+	assert (!table.Take (unknown));
+	assert (table.GetSize () == 30);
+	// next batch of same object
+	std::vector<Tag<32> > batch2 (4);
+	for (auto& it: batch2) it.Randomize ();
+	table.Insert (batch2[0], 4, d1, ts);
+	assert (table.GetNumObjects () == 1);
+	for (size_t i = 2; i < batch.size (); i++)
+		assert (table.Take (batch[i]) == d1);
+	for (auto& it: batch2)
+		assert (table.Take (it) == d1);
+	assert (table.IsEmpty () && !table.GetNumObjects ());
+	assert (d1.use_count () == 1);
+
+	// random operations against std::map, with growth and backward shifts
+	std::map<Tag<32>, std::pair<int, uint32_t> > tags; // tag -> id, creation time
+	std::vector<std::shared_ptr<Decryption> > objects;
+	for (int i = 0; i < 3000; i++)
+	{
+		ts += rand () % 3;
+		int r = rand () % 10;
+		if (r < 4 || tags.empty ())
+		{
+			auto d = std::make_shared<Decryption> (Decryption{ i });
+			objects.push_back (d);
+			int num = 1 + rand () % 40;
+			std::vector<Tag<32> > newTags (num);
+			for (auto& it: newTags)
+			{
+				it.Randomize ();
+				if (!(rand () % 8)) it[0] = 0x55, it[1] = 0x55, it[2] = 0x55, it[3] = 0x55, it[4] = 0x55, it[5] = 0x55, it[6] = 0x55, it[7] = 0x55;
+				tags[it] = std::make_pair (i, ts);
+			}
+			table.Insert (newTags[0], num, d, ts);
+		}
+		else if (r < 9)
+		{
+			auto it = tags.begin ();
+			std::advance (it, rand () % tags.size ());
+			auto d = table.Take (it->first);
+			assert (d && d->id == it->second.first);
+			tags.erase (it);
+		}
+		else
+		{
+			int numExpired = table.Expire (ts);
+			int numExpected = 0;
+			for (auto it = tags.begin (); it != tags.end ();)
+				if (ts >= it->second.second + EXPIRATION_TIMEOUT + TAGS_TABLE_WHEEL_PERIOD) // bucket passed
+				{
+					assert (!table.Take (it->first));
+					it = tags.erase (it);
+					numExpected++;
+				}
+				else
+					++it;
+			assert (numExpired >= numExpected);
+			// what table expired is gone from reference
+			for (auto it = tags.begin (); it != tags.end ();)
+				if (ts > it->second.second + EXPIRATION_TIMEOUT)
+				{
+					auto d = table.Take (it->first);
+					assert (!d || d->id == it->second.first);
+					it = tags.erase (it);
+				}
+				else
+					++it;
+		}
+		assert (table.GetSize () == tags.size ());
+	}
+	size_t numVisited = 0;
+	table.Visit ([&tags, &numVisited](const uint8_t * tag, uint32_t creationTime, const std::shared_ptr<Decryption>& d)
+		{
+			auto it = tags.find (Tag<32> (tag));
+			assert (it != tags.end () && it->second.first == d->id && it->second.second == creationTime);
+			numVisited++;
+		});
+	assert (numVisited == tags.size ());
+
+	// everything expires, objects released and table shrinks
+	ts += EXPIRATION_TIMEOUT + 2*TAGS_TABLE_WHEEL_PERIOD;
+	table.Expire (ts);
+	assert (table.IsEmpty () && !table.GetNumObjects ());
+	for (auto& it: objects) assert (it.use_count () == 1);
+
+	// clock jump forward
+	table.Insert (batch[0], 1, d1, ts);
+	ts += 100*EXPIRATION_TIMEOUT;
+	assert (table.Expire (ts) == 1);
+	table.Insert (batch[0], 32, d1, ts);
+	table.Clear ();
+	assert (table.IsEmpty () && d1.use_count () == 1);
+}
@@ -0,0 +1,93 @@
+#include <cassert>
+#include <inttypes.h>
+#include <map>
+#include <mutex>
+#include <thread>
+#include <chrono>
+#include <vector>
+
+#include "Tunnel.h"
+
+using namespace i2p::tunnel;
+
+// records where and in which order its TunnelData messages are handled
+class TestTunnel: public TransitTunnel
+{
+	public:
+
+		TestTunnel (uint32_t tunnelID): TransitTunnel (tunnelID, zero, 0, zero, zero),
+			numHandled (0), numFlushes (0), isOrdered (true) {};
+
+		void HandleTunnelDataMsg (std::shared_ptr<const i2p::I2NPMessage> tunnelMsg)
+		{
+			uint32_t seqn = bufbe32toh (tunnelMsg->GetPayload () + 4);
+			if (seqn != numHandled) isOrdered = false;
+			numHandled++;
+			std::unique_lock<std::mutex> l(mutex);
+			threads[std::this_thread::get_id ()]++;
+		}
+		void FlushTunnelDataMsgs () { numFlushes++; };
+
+		static const uint8_t zero[32];
+		std::atomic<uint32_t> numHandled, numFlushes;
+		std::atomic<bool> isOrdered;
+		std::mutex mutex;
+		std::map<std::thread::id, int> threads;
+};
+const uint8_t TestTunnel::zero[32] = { 0 };
+
+int main ()
+{
+	const int numWorkers = 4, numTunnels = 16, numMsgs = 1000;
+	tunnels.StartWorkers (numWorkers);
+	std::vector<std::shared_ptr<TestTunnel> > testTunnels;
+	for (int i = 0; i < numTunnels; i++)
+	{
+		auto tunnel = std::make_shared<TestTunnel> (1000 + i);
+		tunnels.AddTransitTunnel (tunnel);
+		testTunnels.push_back (tunnel);
+	}
+	assert (tunnels.GetTunnel (1000) == testTunnels[0]);
+
+	// interleaved, rounds posted one by one and as batches in turn
+	uint8_t payload[8];
+	for (int seqn = 0; seqn < numMsgs; seqn++)
+	{
+		std::vector<std::shared_ptr<i2p::I2NPMessage> > batch;
+		for (int i = 0; i < numTunnels; i++)
+		{
+			htobe32buf (payload, 1000 + i);
+			htobe32buf (payload + 4, seqn);
+			auto msg = i2p::CreateI2NPMessage (i2p::eI2NPTunnelData, payload, 8);
+			if (seqn & 1)
+				batch.push_back (msg);
+			else
+				tunnels.PostTunnelData (msg);
+		}
+		if (!batch.empty ()) tunnels.PostTunnelData (batch);
+	}
+
+	for (int i = 0; i < 500; i++)
+	{
+		bool done = true;
+		for (auto& it: testTunnels)
+			if (it->numHandled < numMsgs) done = false;
+		if (done) break;
+		std::this_thread::sleep_for (std::chrono::milliseconds (10));
+	}
+
+	// every tunnel is handled by one worker only, in order, and flushed
+	std::map<std::thread::id, int> workers;
+	for (auto& it: testTunnels)
+	{
+		assert (it->numHandled == numMsgs);
+		assert (it->isOrdered);
+		assert (it->numFlushes > 0);
+		assert (it->threads.size () == 1);
+		assert (it->threads.begin ()->first != std::this_thread::get_id ());
+		workers[it->threads.begin ()->first]++;
+	}
+	assert (workers.size () == numWorkers); // tunnelIDs in a row are spread over all
+	tunnels.Stop ();
+	return 0;
+}
@@ -28,9 +28,7 @@ uint8_t p[32] =
 int main ()
 {
     uint8_t buf[32];
-    BN_CTX * ctx = BN_CTX_new ();
-    i2p::crypto::GetEd25519 ()->ScalarMul (u, k, buf, ctx);
-    BN_CTX_free (ctx);
+    i2p::crypto::GetEd25519 ()->ScalarMul (u, k, buf);
     assert(memcmp (buf, p, 32) == 0);
 }
 
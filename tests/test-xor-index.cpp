@@ -0,0 +1,81 @@
+#include <cassert>
+#include <string.h>
+#include <algorithm>
+#include <memory>
+#include <vector>
+
+#include "XORIndex.h"
+
+using namespace i2p::data;
+
+struct Router
+{
+	Tag<32> ident;
+};
+
+static bool IsCloser (const Tag<32>& key, const Tag<32>& h1, const Tag<32>& h2) // h1 is closer to key than h2
+{
+	for (int i = 0; i < 32; i++)
+	{
+		uint8_t m1 = key[i] ^ h1[i], m2 = key[i] ^ h2[i];
+		if (m1 != m2) return m1 < m2;
+	}
+	return false;
+}
+
+int main ()
+{
+	XORIndex<Router> index;
+	std::vector<std::shared_ptr<Router> > routers;
+	for (int i = 0; i < 1000; i++)
+	{
+		auto r = std::make_shared<Router> ();
+		r->ident.Randomize ();
+		if (i < 10) r->ident[0] = 0x55; // some with common prefix
+		routers.push_back (r);
+		assert (index.Insert (r->ident, r));
+	}
+	auto republished = std::make_shared<Router> (*routers[0]);
+	assert (!index.Insert (republished->ident, republished)); // replaced
+	assert (index.GetSize () == 1000);
+	std::shared_ptr<Router> found;
+	index.VisitClosest (republished->ident, [&found](std::shared_ptr<Router> r) { found = r; return false; });
+	assert (found == republished);
+	index.Insert (routers[0]->ident, routers[0]);
+
+	for (int n = 0; n < 100; n++)
+	{
+		Tag<32> key;
+		key.Randomize ();
+		if (n < 10) key[0] = 0x55;
+		auto sorted = routers;
+		std::sort (sorted.begin (), sorted.end (), [&key](std::shared_ptr<Router> r1, std::shared_ptr<Router> r2)
+			{ return IsCloser (key, r1->ident, r2->ident); });
+		// all in order
+		std::vector<std::shared_ptr<Router> > visited;
+		index.VisitClosest (key, [&visited](std::shared_ptr<Router> r) { visited.push_back (r); return true; });
+		assert (visited == sorted);
+		// stops
+		visited.clear ();
+		index.VisitClosest (key, [&visited](std::shared_ptr<Router> r) { visited.push_back (r); return visited.size () < 5; });
+		assert (visited.size () == 5 && std::equal (visited.begin (), visited.end (), sorted.begin ()));
+	}
+
+	// erase
+	assert (index.Erase (routers[3]->ident));
+	assert (!index.Erase (routers[3]->ident));
+	assert (index.EraseIf ([&routers](std::shared_ptr<Router> r) { return r == routers[4] || r == routers[5]; }) == 2);
+	assert (index.GetSize () == 997);
+	auto key = routers[4]->ident;
+	std::shared_ptr<Router> closest;
+	index.VisitClosest (key, [&closest](std::shared_ptr<Router> r) { closest = r; return false; });
+	assert (closest && closest != routers[4]);
+	// exact match is closest
+	key = routers[6]->ident;
+	index.VisitClosest (key, [&closest](std::shared_ptr<Router> r) { closest = r; return false; });
+	assert (closest == routers[6]);
+
+	index.Clear ();
+	assert (!index.GetSize ());
+	index.VisitClosest (key, [](std::shared_ptr<Router>) { assert (false); return true; });
+}